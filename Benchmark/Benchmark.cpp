@@ -0,0 +1,284 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Benchmark\Benchmark.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+// Benchmark.cpp : CPU cost of the lookups done for every draw with thousands of materials.
+// - the program of a material, ShaderProgramManager::FindProgram through the index cached on the Material
+// - the pipeline of (state bits, render pass) of a program, the open addressing map of ShaderProgram
+// Both are compared with the linear scans they replaced, on the same data.
+//
+
+#include "stdafx.h"
+
+#include "../Ion/Ion.h"
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// APP VULKAN MEMORY
+
+#ifdef _DEBUG
+#   define ION_VULKAN_VALIDATION_LAYER true
+#else
+#   define ION_VULKAN_VALIDATION_LAYER false
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
+
+#define BENCHMARK_MATERIAL_COUNT        4096
+#define BENCHMARK_PIPELINES_PER_PROGRAM 32      // different blend states, all in the same render pass
+#define BENCHMARK_ROUNDS                64
+
+EOS_USING_NAMESPACE
+ION_USING_NAMESPACE
+
+
+LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    switch (uMsg)
+    {
+    case WM_CLOSE:
+        PostMessage(hWnd, ION_WND_CLOSE, wParam, lParam);
+        break;
+    default:
+        return DefWindowProc(hWnd, uMsg, wParam, lParam);
+    }
+    return 0;
+}
+
+// the same layout of the integrated primitives, see RenderManager::LoadCommonMaterialForIntegratedPrimitive
+void SetupMaterial(Material* _material, ionS32 _vertexShaderIndex, ionS32 _fragmentShaderIndex)
+{
+    UniformBinding uniformVertex;
+    uniformVertex.m_bindingIndex = 0;
+    uniformVertex.m_parameters.push_back(ION_MODEL_MATRIX_PARAM);
+    uniformVertex.m_type.push_back(EBufferParameterType_Matrix);
+    uniformVertex.m_parameters.push_back(ION_VIEW_MATRIX_PARAM);
+    uniformVertex.m_type.push_back(EBufferParameterType_Matrix);
+    uniformVertex.m_parameters.push_back(ION_PROJ_MATRIX_PARAM);
+    uniformVertex.m_type.push_back(EBufferParameterType_Matrix);
+
+    UniformBinding uniformFragment;
+    uniformFragment.m_bindingIndex = 1;
+    uniformFragment.m_parameters.push_back(ION_MAIN_CAMERA_POSITION_VECTOR_PARAM);
+    uniformFragment.m_type.push_back(EBufferParameterType_Vector);
+    uniformFragment.m_parameters.push_back(ION_DIRECTIONAL_LIGHT_DIR_VECTOR_PARAM);
+    uniformFragment.m_type.push_back(EBufferParameterType_Vector);
+    uniformFragment.m_parameters.push_back(ION_DIRECTIONAL_LIGHT_COL_VECTOR_PARAM);
+    uniformFragment.m_type.push_back(EBufferParameterType_Vector);
+
+    SamplerBinding albedoMap;
+    albedoMap.m_bindingIndex = 2;
+    albedoMap.m_texture = ionRenderManager().GetNullTexure();
+
+    SamplerBinding normalMap;
+    normalMap.m_bindingIndex = 3;
+    normalMap.m_texture = ionRenderManager().GetNullTexure();
+
+    ShaderLayoutDef vertexLayout;
+    vertexLayout.m_uniforms.push_back(uniformVertex);
+
+    ShaderLayoutDef fragmentLayout;
+    fragmentLayout.m_uniforms.push_back(uniformFragment);
+    fragmentLayout.m_samplers.push_back(albedoMap);
+    fragmentLayout.m_samplers.push_back(normalMap);
+
+    ConstantsBindingDef constants;
+    constants.m_shaderStages = EPushConstantStage::EPushConstantStage_Fragment;
+    for (ionU32 i = 0; i < 8; ++i)
+    {
+        constants.m_values.push_back(1.0f);
+    }
+
+    _material->SetVertexShaderLayout(vertexLayout);
+    _material->SetFragmentShaderLayout(fragmentLayout);
+    _material->SetVertexLayout(EVertexLayout_Full);
+    _material->SetConstantsShaders(constants);
+    _material->SetShaders(_vertexShaderIndex, _fragmentShaderIndex);
+}
+
+// what FindProgram did before the index was cached on the material
+ionS32 FindProgramLinear(const Material* _material)
+{
+    const ionVector<ShaderProgram, ShaderProgramManagerAllocator, ShaderProgramManager::GetAllocator>& programs = ionShaderProgramManager().m_shaderPrograms;
+    for (ionSize i = 0; i < programs.size(); ++i)
+    {
+        if (programs[i].m_material == _material)
+        {
+            return static_cast<ionS32>(i);
+        }
+    }
+    return -1;
+}
+
+// what GetPipeline did before the open addressing map
+ionS32 FindPipelineLinear(const ShaderProgram& _program, VkRenderPass _renderPass, ionU64 _stateBits)
+{
+    for (ionSize i = 0; i < _program.m_pipelines.size(); ++i)
+    {
+        if (_program.m_pipelines[i].m_stateBits == _stateBits && _program.m_pipelines[i].m_renderpass == _renderPass)
+        {
+            return static_cast<ionS32>(i);
+        }
+    }
+    return -1;
+}
+
+ionU64 PipelineStateBits(const Material* _material, ionU32 _variant)
+{
+    const ionU64 blendBits = EBlendState_SourceBlend_Bits | EBlendState_DestBlend_Bits;
+    return (_material->GetState().GetStateBits() & ~blendBits) | (static_cast<ionU64>(_variant) & blendBits);
+}
+
+ionFloat NanosecondsPerLookup(std::chrono::steady_clock::duration _elapsed, ionSize _lookups)
+{
+    return static_cast<ionFloat>(std::chrono::duration_cast<std::chrono::nanoseconds>(_elapsed).count()) / static_cast<ionFloat>(_lookups);
+}
+
+int main(int argc, char **argv)
+{
+    ShaderProgramHelper::Create();
+
+    // the assets are the ones of the demo
+    ionFileSystemManager().Init("../Demo/Assets", "Shaders", "Textures", "Models");
+
+    Window window;
+    if (!window.ParseCommandLine(argc, argv))
+    {
+        return false;
+    }
+
+    if (!window.Create(WndProc, L"Ion Benchmark") ||
+        !ionRenderManager().Init(window.GetInstance(), window.GetHandle(), window.GetWidth(), window.GetHeight(), window.IsFullscreen(), ION_VULKAN_VALIDATION_LAYER))
+    {
+        std::cout << "Cannot initialize the renderer" << std::endl;
+        return -1;
+    }
+
+    ionRenderManager().GenerateNullTexture();
+
+    const ionS32 vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_PBR_SHADER_NAME, EShaderStage_Vertex);
+    const ionS32 fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_DIFFUSE_LIGHT_SHADER_NAME, EShaderStage_Fragment);
+
+    ionVector<const Material*, MaterialManagerAllocator, MaterialManager::GetAllocator> materials;
+    materials.reserve(BENCHMARK_MATERIAL_COUNT);
+    for (ionU32 i = 0; i < BENCHMARK_MATERIAL_COUNT; ++i)
+    {
+        const ionString name = ionString("Benchmark#") + ionString(std::to_string(i).c_str());
+
+        Material* material = ionMaterialManger().CreateMaterial(name);
+        SetupMaterial(material, vertexShaderIndex, fragmentShaderIndex);
+        materials.push_back(material);
+    }
+
+    // the first lookup creates the program, then the pipelines are added without creating them: only the lookups are measured
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (ionSize i = 0; i < materials.size(); ++i)
+    {
+        ionShaderProgramManager().FindProgram(materials[i]);
+    }
+    const std::chrono::steady_clock::duration programCreation = std::chrono::steady_clock::now() - start;
+
+    for (ionSize i = 0; i < materials.size(); ++i)
+    {
+        ShaderProgram& program = ionShaderProgramManager().m_shaderPrograms[ionShaderProgramManager().FindProgram(materials[i])];
+        for (ionU32 j = 0; j < BENCHMARK_PIPELINES_PER_PROGRAM; ++j)
+        {
+            program.AddPipeline(VK_NULL_HANDLE, PipelineStateBits(materials[i], j), VK_NULL_HANDLE);
+        }
+    }
+
+    // the draws do not come in the order of creation
+    ionVector<ionU32, MaterialManagerAllocator, MaterialManager::GetAllocator> drawOrder;
+    drawOrder.resize(BENCHMARK_MATERIAL_COUNT);
+    for (ionU32 i = 0; i < BENCHMARK_MATERIAL_COUNT; ++i)
+    {
+        drawOrder[i] = i;
+    }
+    std::mt19937 generator(1234);
+    std::shuffle(drawOrder.begin(), drawOrder.end(), generator);
+
+    const ionSize programLookups = static_cast<ionSize>(BENCHMARK_ROUNDS) * BENCHMARK_MATERIAL_COUNT;
+    const ionSize pipelineLookups = programLookups * BENCHMARK_PIPELINES_PER_PROGRAM;
+
+    // the sums keep the lookups from being optimized away and tell if the two ways agree
+    ionS64 cachedSum = 0;
+    start = std::chrono::steady_clock::now();
+    for (ionU32 r = 0; r < BENCHMARK_ROUNDS; ++r)
+    {
+        for (ionSize i = 0; i < drawOrder.size(); ++i)
+        {
+            cachedSum += ionShaderProgramManager().FindProgram(materials[drawOrder[i]]);
+        }
+    }
+    const std::chrono::steady_clock::duration programCached = std::chrono::steady_clock::now() - start;
+
+    ionS64 linearSum = 0;
+    start = std::chrono::steady_clock::now();
+    for (ionU32 r = 0; r < BENCHMARK_ROUNDS; ++r)
+    {
+        for (ionSize i = 0; i < drawOrder.size(); ++i)
+        {
+            linearSum += FindProgramLinear(materials[drawOrder[i]]);
+        }
+    }
+    const std::chrono::steady_clock::duration programLinear = std::chrono::steady_clock::now() - start;
+
+    ionS64 mapSum = 0;
+    start = std::chrono::steady_clock::now();
+    for (ionU32 r = 0; r < BENCHMARK_ROUNDS; ++r)
+    {
+        for (ionSize i = 0; i < drawOrder.size(); ++i)
+        {
+            const Material* material = materials[drawOrder[i]];
+            const ShaderProgram& program = ionShaderProgramManager().m_shaderPrograms[ionShaderProgramManager().FindProgram(material)];
+            for (ionU32 j = 0; j < BENCHMARK_PIPELINES_PER_PROGRAM; ++j)
+            {
+                mapSum += program.FindPipelineIndex(VK_NULL_HANDLE, PipelineStateBits(material, (j * 7 + r) % BENCHMARK_PIPELINES_PER_PROGRAM));
+            }
+        }
+    }
+    const std::chrono::steady_clock::duration pipelineMap = std::chrono::steady_clock::now() - start;
+
+    ionS64 scanSum = 0;
+    start = std::chrono::steady_clock::now();
+    for (ionU32 r = 0; r < BENCHMARK_ROUNDS; ++r)
+    {
+        for (ionSize i = 0; i < drawOrder.size(); ++i)
+        {
+            const Material* material = materials[drawOrder[i]];
+            const ShaderProgram& program = ionShaderProgramManager().m_shaderPrograms[ionShaderProgramManager().FindProgram(material)];
+            for (ionU32 j = 0; j < BENCHMARK_PIPELINES_PER_PROGRAM; ++j)
+            {
+                scanSum += FindPipelineLinear(program, VK_NULL_HANDLE, PipelineStateBits(material, (j * 7 + r) % BENCHMARK_PIPELINES_PER_PROGRAM));
+            }
+        }
+    }
+    const std::chrono::steady_clock::duration pipelineScan = std::chrono::steady_clock::now() - start;
+
+    std::cout << BENCHMARK_MATERIAL_COUNT << " materials, " << BENCHMARK_PIPELINES_PER_PROGRAM << " pipelines per program, " << BENCHMARK_ROUNDS << " rounds" << std::endl;
+    std::cout << "program creation:        " << std::chrono::duration_cast<std::chrono::milliseconds>(programCreation).count() << " ms" << std::endl;
+    std::cout << "program, cached index:   " << NanosecondsPerLookup(programCached, programLookups) << " ns per lookup" << std::endl;
+    std::cout << "program, linear scan:    " << NanosecondsPerLookup(programLinear, programLookups) << " ns per lookup" << std::endl;
+    std::cout << "pipeline, map:           " << NanosecondsPerLookup(pipelineMap, pipelineLookups) << " ns per lookup (program lookup included)" << std::endl;
+    std::cout << "pipeline, linear scan:   " << NanosecondsPerLookup(pipelineScan, pipelineLookups) << " ns per lookup (program lookup included)" << std::endl;
+
+    const ionBool matching = cachedSum == linearSum && mapSum == scanSum;
+    if (!matching)
+    {
+        std::cout << "The lookups do not match the linear scans!" << std::endl;
+    }
+
+    ionRenderManager().PrepareToShutDown();
+    ionRenderManager().RemoveAllSceneGraph();
+
+    ionRenderManager().Shutdown();
+
+    ionFileSystemManager().Shutdown();
+
+    ShaderProgramHelper::Destroy();
+
+    return matching ? 0 : -1;
+}
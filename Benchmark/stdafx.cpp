@@ -0,0 +1,13 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Benchmark\stdafx.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+// stdafx.cpp : source file that includes just the standard includes
+// Benchmark.pch will be the pre-compiled header
+// stdafx.obj will contain the pre-compiled type information
+
+#include "stdafx.h"
+
+// TODO: reference any additional headers you need in STDAFX.H
+// and not in this file
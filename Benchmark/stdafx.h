@@ -0,0 +1,29 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Benchmark\stdafx.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+
+#pragma once
+
+#include "targetver.h"
+
+#include <stdio.h>
+#include <tchar.h>
+
+#define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
+// Windows Header Files:
+#define _WINSOCKAPI_    // stops windows.h including winsock.h
+#include <windows.h>
+
+#include <random>
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <string>
+#include <algorithm>
\ No newline at end of file
@@ -0,0 +1,13 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Benchmark\targetver.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+// Including SDKDDKVer.h defines the highest available Windows platform.
+
+// If you wish to build your application for a previous Windows platform, include WinSDKVer.h and
+// set the _WIN32_WINNT macro to the platform you wish to support before including SDKDDKVer.h.
+
+#include <SDKDDKVer.h>
@@ -18,6 +18,8 @@ layout (binding = 3) uniform UBOParams
 	float exposure;
 	float gamma;
 	float prefilteredCubeMipLevels;
+	float useIrradianceSH;
+	vec4 irradianceSH[9];
 } uboParams;
 
 layout (binding = 4) uniform samplerCube samplerIrradiance;
@@ -146,6 +148,20 @@ vec3 getNormal()
 	return normalize(TBN * tangentNormal);
 }
 
+// Irradiance from the 9 L2 spherical harmonics coefficients, already convolved on the CPU
+vec3 irradianceSH(vec3 n)
+{
+	return uboParams.irradianceSH[0].rgb * 0.282095
+		+ uboParams.irradianceSH[1].rgb * 0.488603 * n.y
+		+ uboParams.irradianceSH[2].rgb * 0.488603 * n.z
+		+ uboParams.irradianceSH[3].rgb * 0.488603 * n.x
+		+ uboParams.irradianceSH[4].rgb * 1.092548 * n.x * n.y
+		+ uboParams.irradianceSH[5].rgb * 1.092548 * n.y * n.z
+		+ uboParams.irradianceSH[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0)
+		+ uboParams.irradianceSH[7].rgb * 1.092548 * n.x * n.z
+		+ uboParams.irradianceSH[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
 // Calculation of the lighting contribution from an optional Image Based Light source.
 // Precomputed Environment Maps are required uniform inputs and are computed as outlined in [1].
 // See our README.md on Environment Maps [3] for additional discussion.
@@ -154,7 +170,17 @@ vec3 getIBLContribution(PBRInfo pbrInputs, vec3 n, vec3 reflection)
 	float lod = (pbrInputs.perceptualRoughness * uboParams.prefilteredCubeMipLevels);
 	// retrieve a scale and bias to F0. See [1], Figure 3
 	vec3 brdf = (texture(samplerBRDFLUT, vec2(pbrInputs.NdotV, 1.0 - pbrInputs.perceptualRoughness))).rgb;
-	vec3 diffuseLight = SRGBtoLINEAR(tonemap(texture(samplerIrradiance, n))).rgb;
+	// a branch on a uniform value, so the cube map is not sampled at all when the harmonics are used
+	vec4 irradiance;
+	if (uboParams.useIrradianceSH == 1.0f)
+	{
+		irradiance = vec4(max(irradianceSH(n), vec3(0.0)), 1.0);
+	}
+	else
+	{
+		irradiance = texture(samplerIrradiance, n);
+	}
+	vec3 diffuseLight = SRGBtoLINEAR(tonemap(irradiance)).rgb;
 
 	vec3 specularLight = SRGBtoLINEAR(tonemap(textureLod(prefilteredMap, reflection, lod))).rgb;
 
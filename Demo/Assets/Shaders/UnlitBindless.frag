@@ -0,0 +1,61 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec3 inWorldPos;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec4 inColor;
+
+layout (binding = 1) uniform UBOParams 
+{
+	vec4 mainCameraPos;
+	vec4 directionalLight;
+	vec4 directionalLightColor;
+} uboParams;
+
+// all the textures of the TextureManager, see BindlessTextureTable
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+
+layout (push_constant) uniform Material {
+	float baseColorFactorR;
+	float baseColorFactorG;
+	float baseColorFactorB;
+	float baseColorFactorA;
+	float hasBaseColorTexture;
+	float hasNormalTexture;		
+	float alphaMask;	
+	float alphaMaskCutoff;
+	uint textureIndices[8];		// in the order of the samplers of the material: albedo, normal
+} material;
+
+layout (location = 0) out vec4 outColor;
+
+
+void main()
+{
+	if (material.alphaMask == 1.0 && material.hasBaseColorTexture == 1.0)
+	{
+		if (texture(textures[material.textureIndices[0]], inUV).a < material.alphaMaskCutoff)
+		{
+			discard;
+		}
+	}
+	
+	const float alpha = texture(textures[material.textureIndices[0]], inUV).a;
+	
+	const vec4 baseColorFactor = vec4(material.baseColorFactorR, material.baseColorFactorG, material.baseColorFactorB, material.baseColorFactorA);
+	
+	vec3 diffuse;
+	if (material.hasBaseColorTexture == 1.0) 
+	{
+		diffuse = uboParams.directionalLightColor.rgb * texture(textures[material.textureIndices[0]], inUV).rgb * baseColorFactor.rgb;
+	} 
+	else 
+	{
+		diffuse = uboParams.directionalLightColor.rgb * inColor.rgb * baseColorFactor.rgb;
+	}
+	
+    outColor = vec4(diffuse, alpha);
+}
\ No newline at end of file
@@ -153,6 +153,7 @@ int main(int argc, char **argv)
     window.GetCommandLineParse().AddWithValue<ionString>("-model", false);
     window.GetCommandLineParse().AddWithValue<ionString>("-primitive", false);
     window.GetCommandLineParse().Add("-usepath", false);
+    window.GetCommandLineParse().Add("-irradiancesh", false);
 
 #ifdef _DEBUG
     window.GetCommandLineParse().AddWithValueAndDefault<ionU32>("-dumpgltf", false, 1);
@@ -244,7 +245,14 @@ int main(int argc, char **argv)
     //////////////////////////////////////////////////////////////////////////
     // Continue texture generation
     const Texture* brdflut = ionRenderManager().GenerateBRDF(camera);
-    const Texture* irradiance = ionRenderManager().GenerateIrradianceCubemap(camera);
+
+    // -irradiancesh lights the diffuse part from the spherical harmonics of the skybox, the irradiance cube map is generated only if they are not used
+    const Texture* irradiance = nullptr;
+    if (!window.GetCommandLineParse().IsSet("-irradiancesh") || !ionRenderManager().GenerateIrradianceSH(camera))
+    {
+        irradiance = ionRenderManager().GenerateIrradianceCubemap(camera);
+    }
+
     const Texture* prefilteredEnvironmentMap = ionRenderManager().GeneratePrefilteredEnvironmentCubemap(camera);
 
     // reset camera pos after cubemap generations
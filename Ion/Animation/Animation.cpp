@@ -5,6 +5,8 @@
 
 #include "Animation.h"
 
+#include "../Utilities/HashedName.h"
+
 
 
 EOS_USING_NAMESPACE
@@ -111,7 +113,7 @@ Animation::~Animation()
 void Animation::SetName(const ionString& _name)
 {
     m_name = _name;
-    m_hash = std::hash<ionString>{}(m_name);
+    m_hash = HashedName(m_name);
 }
 
 void Animation::PushBackSampler(const AnimationSampler& _sampler)
@@ -5,6 +5,9 @@
 
 #include "FileSystemManager.h"
 
+#include <windows.h>
+#include <direct.h>
+
 
 EOS_USING_NAMESPACE
 
@@ -26,7 +29,7 @@ FileSystemManager& FileSystemManager::Instance()
     return instance;
 }
 
-ionBool FileSystemManager::Init(const ionString& _mainPath, const ionString& _shadersPath, const ionString& _texturesPath, const ionString& _modelsPath)
+ionBool FileSystemManager::Init(const ionString& _mainPath, const ionString& _shadersPath, const ionString& _texturesPath, const ionString& _modelsPath, const ionString& _cachePath /*= "Cache"*/)
 {
     GetFullPath("./", m_mainPath);
 
@@ -55,6 +58,13 @@ ionBool FileSystemManager::Init(const ionString& _mainPath, const ionString& _sh
     m_modelsPath.append(_modelsPath);
     m_modelsPath.append("/");
 
+    m_cachePath = m_mainPath;
+    m_cachePath.append(_cachePath);
+    m_cachePath.append("/");
+
+    // the cache folder is generated at runtime, so may not exist yet
+    _mkdir(m_cachePath.c_str());
+
     return true;
 }
 
@@ -63,6 +73,43 @@ void FileSystemManager::Shutdown()
 
 }
 
+ionBool FileSystemManager::WriteFileAtomic(const ionString& _path, const void* _data, ionSize _size) const
+{
+    if (_path.empty() || _data == nullptr || _size == 0)
+    {
+        return false;
+    }
+
+    ionString tmpPath = _path;
+    tmpPath.append(".tmp");
+
+    {
+        std::ofstream file(tmpPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(_data), static_cast<std::streamsize>(_size));
+        file.flush();
+
+        if (!file.good())
+        {
+            file.close();
+            remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    if (MoveFileExA(tmpPath.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) == 0)
+    {
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
 ionBool FileSystemManager::GetFullPath(const ionString& partialPath, ionString& fullPath)
 {
 	char tmp[256];
@@ -21,7 +21,7 @@ class ION_DLL FileSystemManager final
 public:
     static FileSystemManager& Instance();
 
-    ionBool Init(const ionString& _mainPath, const ionString& _shadersPath, const ionString& _texturesPath, const ionString& _modelsPath);
+    ionBool Init(const ionString& _mainPath, const ionString& _shadersPath, const ionString& _texturesPath, const ionString& _modelsPath, const ionString& _cachePath = "Cache");
     void    Shutdown();
 
     FileSystemManager();
@@ -31,6 +31,10 @@ public:
     const ionString& GetShadersPath() const { return m_shadersPath; }
     const ionString& GetTexturesPath() const { return m_texturesPath; }
     const ionString& GetModelsPath() const { return m_modelsPath; }
+    const ionString& GetCachePath() const { return m_cachePath; }
+
+    // Write first to a temporary file and then replace the destination, so a crash in the middle never leave a corrupted file
+    ionBool WriteFileAtomic(const ionString& _path, const void* _data, ionSize _size) const;
 
 private:
     FileSystemManager(const FileSystemManager& _Orig) = delete;
@@ -43,6 +47,7 @@ private:
     ionString m_shadersPath;
     ionString m_texturesPath;
     ionString m_modelsPath;
+    ionString m_cachePath;
 };
 
 ION_NAMESPACE_END
@@ -54,8 +54,12 @@ namespace Settings
 	static constexpr ionU32 kRenderManagerAllocatorSize = ION_MEMORY_8_MB;
 	static constexpr ionU32 kCubeMapHelperAllocatorSize = ION_MEMORY_256_MB;
 	static constexpr ionU32 kTextureManagerAllocatorSize = ION_MEMORY_128_MB;
+	static constexpr ionU32 kSamplerCacheAllocatorSize = ION_MEMORY_1_MB;
+	static constexpr ionU32 kMipMapGeneratorAllocatorSize = ION_MEMORY_1_MB;
 	static constexpr ionU32 kGeometryHelperAllocatorSize = ION_MEMORY_256_MB;
 	static constexpr ionU32 kShaderHelperAllocatorSize = ION_MEMORY_8_MB;
+	static constexpr ionU32 kHashedNameAllocatorSize = ION_MEMORY_1_MB;
+	static constexpr ionU32 kCommandRecorderAllocatorSize = ION_MEMORY_16_MB;
 
 	// Vulkan specific
 	static constexpr ionU32 kVulkanAllocatorSize = ION_MEMORY_16_MB;
@@ -455,9 +455,10 @@ struct Image {
 struct Texture {
   int sampler;
   int source;  // Required (not specified in the spec ?)
+  int basisuSource;  // KHR_texture_basisu extension, KTX2 image (-1 if not used)
   Value extras;
 
-  Texture() : sampler(-1), source(-1) {}
+  Texture() : sampler(-1), source(-1), basisuSource(-1) {}
 };
 
 // Each extension should be stored in a ParameterMap.
@@ -1778,6 +1779,19 @@ static bool ParseTexture(Texture *texture, std::string *err, const json &o,
   texture->sampler = static_cast<int>(sampler);
   texture->source = static_cast<int>(source);
 
+  json::const_iterator extensions_object = o.find("extensions");
+  if ((extensions_object != o.end()) && extensions_object.value().is_object()) {
+    json::const_iterator basisu_object =
+        extensions_object.value().find("KHR_texture_basisu");
+    if ((basisu_object != extensions_object.value().end()) &&
+        basisu_object.value().is_object()) {
+      double basisu_source = -1.0;
+      ParseNumberProperty(&basisu_source, err, basisu_object.value(), "source",
+                          false);
+      texture->basisuSource = static_cast<int>(basisu_source);
+    }
+  }
+
   return true;
 }
 
@@ -3679,6 +3693,12 @@ static void SerializeGltfTexture(Texture &texture, json &o) {
   SerializeNumberProperty("sampler", texture.sampler, o);
   SerializeNumberProperty("source", texture.source, o);
 
+  if (texture.basisuSource >= 0) {
+    json basisu;
+    SerializeNumberProperty("source", texture.basisuSource, basisu);
+    o["extensions"]["KHR_texture_basisu"] = basisu;
+  }
+
   if (texture.extras.Size()) {
     json extras;
     SerializeValue("extras", texture.extras, o);
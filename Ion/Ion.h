@@ -41,6 +41,9 @@
 #include "Texture/TextureCommon.h"
 #include "Texture/Texture.h"
 #include "Texture/TextureManager.h"
+#include "Texture/SamplerCache.h"
+#include "Texture/MipMapGenerator.h"
+#include "Texture/BindlessTextureTable.h"
 #include "Texture/CubemapHelper.h"
 
 #include "Material/MaterialState.h"
@@ -50,6 +53,7 @@
 #include "Renderer/RenderDefs.h"
 #include "Renderer/RenderCommon.h"
 #include "Renderer/GPU.h"
+#include "Renderer/CommandRecorder.h"
 #include "Renderer/RenderCore.h"
 #include "Renderer/BaseBufferObject.h"
 #include "Renderer/VertexBufferObject.h"
@@ -59,7 +63,9 @@
 #include "Renderer/RenderManager.h"
 
 #include "Shader/ShaderProgramHelper.h"
+#include "Shader/ShaderReflection.h"
 #include "Shader/ShaderProgram.h"
+#include "Shader/PipelineCompiler.h"
 #include "Shader/ShaderProgramManager.h"
 
 #include "Material/Material.h"
@@ -85,7 +91,9 @@
 
 #include "Utilities/LoaderGLTF.h"
 #include "Utilities/GeometryHelper.h"
+#include "Utilities/SphericalHarmonics.h"
 #include "Utilities/Serializer.h"
+#include "Utilities/HashedName.h"
 
 #include "App/Mode.h"
 #include "App/CommandLineParser.h"
@@ -10,8 +10,86 @@
 #include "../Shader/ShaderProgramManager.h"
 #include "../Shader/ShaderProgram.h"
 
+#include "MaterialManager.h"
+
+#include "../Utilities/Tools.h"
+#include "../Utilities/HashedName.h"
+
 ION_NAMESPACE_BEGIN
 
+namespace
+{
+    template<typename T>
+    ION_INLINE ionU64 HashValue(const T& _value, ionU64 _seed)
+    {
+        return Tools::HashFNV1a64(&_value, sizeof(T), _seed);
+    }
+
+    // the textures and the storages by identity, the uniforms by the hashes of their parameters
+    ionU64 HashShaderLayout(const ShaderLayoutDef& _layout, ionU64 _seed)
+    {
+        // the counts first, a binding cannot move from a list to the next one without changing the hash
+        ionU64 hash = HashValue(_layout.m_uniforms.size(), _seed);
+        hash = HashValue(_layout.m_samplers.size(), hash);
+        hash = HashValue(_layout.m_storages.size(), hash);
+
+        for (const UniformBinding& uniform : _layout.m_uniforms)
+        {
+            hash = HashValue(uniform.m_bindingIndex, hash);
+            for (ionSize i = 0; i < uniform.m_runtimeParameters.size(); ++i)
+            {
+                hash = HashValue(uniform.m_runtimeParameters[i], hash);
+                hash = HashValue(uniform.m_type[i], hash);
+            }
+        }
+        for (const SamplerBinding& sampler : _layout.m_samplers)
+        {
+            hash = HashValue(sampler.m_bindingIndex, hash);
+            hash = HashValue(sampler.m_texture, hash);
+        }
+        for (const StorageBinding& storage : _layout.m_storages)
+        {
+            hash = HashValue(storage.m_bindingIndex, hash);
+            hash = HashValue(storage.m_cache, hash);
+        }
+
+        return hash;
+    }
+
+    // same fields of HashShaderLayout
+    ionBool SameShaderLayout(const ShaderLayoutDef& _a, const ShaderLayoutDef& _b)
+    {
+        if (_a.m_uniforms.size() != _b.m_uniforms.size() || _a.m_samplers.size() != _b.m_samplers.size() || _a.m_storages.size() != _b.m_storages.size())
+        {
+            return false;
+        }
+
+        for (ionSize i = 0; i < _a.m_uniforms.size(); ++i)
+        {
+            if (_a.m_uniforms[i].m_runtimeParameters.size() != _b.m_uniforms[i].m_runtimeParameters.size() || !(_a.m_uniforms[i] == _b.m_uniforms[i]))
+            {
+                return false;
+            }
+        }
+        for (ionSize i = 0; i < _a.m_samplers.size(); ++i)
+        {
+            if (!(_a.m_samplers[i] == _b.m_samplers[i]))
+            {
+                return false;
+            }
+        }
+        for (ionSize i = 0; i < _a.m_storages.size(); ++i)
+        {
+            if (!(_a.m_storages[i] == _b.m_storages[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
 BasePBR::BasePBR() :
     m_baseColorTexture(nullptr),
     m_metalRoughness(nullptr),
@@ -88,7 +166,14 @@ Material::Material() :
 	m_isDiffuseLight(false),
 	m_isUnlit(false),
 	m_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST),
-	m_customDrawFunction(nullptr)
+	m_customDrawFunction(nullptr),
+	m_drawConstantsStages((EPushConstantStage)0),
+	m_bindlessTexturesStages((EPushConstantStage)0),
+	m_constantsBufferBinding(-1),
+	m_constantsSlot(ION_MATERIAL_CONSTANTS_INVALID_SLOT),
+	m_constantsDirty(false),
+	m_programIndex(-1),
+	m_programGeneration(0)
 {
 }
 
@@ -106,7 +191,14 @@ Material::Material(const ionString& _name) :
     m_isDiffuseLight(false),
     m_isUnlit(false),
     m_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST),
-    m_customDrawFunction(nullptr)
+    m_customDrawFunction(nullptr),
+    m_drawConstantsStages((EPushConstantStage)0),
+    m_bindlessTexturesStages((EPushConstantStage)0),
+    m_constantsBufferBinding(-1),
+    m_constantsSlot(ION_MATERIAL_CONSTANTS_INVALID_SLOT),
+    m_constantsDirty(false),
+    m_programIndex(-1),
+    m_programGeneration(0)
 {
 }
 
@@ -137,6 +229,8 @@ void Material::Destroy()
     m_useJoint = false;
     m_useSkinning = false;
 
+    SetConstantsBufferBinding(-1);
+
     m_customDrawFunction = nullptr;
 }
 
@@ -162,6 +256,165 @@ void Material::GetShaders(ionS32& _vertexIndex, ionS32& _fragmentIndex, ionS32&
     _useSkinning = m_useSkinning;
 }
 
+void Material::SetConstantsShaders(const ConstantsBindingDef& _constants)
+{
+    m_constants = _constants;
+    m_constants.m_runtimeStages = (VkShaderStageFlagBits)m_constants.m_shaderStages;
+
+    // uploaded with the next update of the manager, whether the shaders read them from the buffer or not
+    ionMaterialManger().SetConstantsDirty(this);
+}
+
+ionBool Material::SetConstantsBufferBinding(ionS32 _bindingIndex)
+{
+    if (_bindingIndex < 0)
+    {
+        ionMaterialManger().ReleaseConstantsSlot(this);
+        m_constantsBufferBinding = -1;
+        return true;
+    }
+
+    if (m_constantsSlot == ION_MATERIAL_CONSTANTS_INVALID_SLOT && !ionMaterialManger().AcquireConstantsSlot(this))
+    {
+        m_constantsBufferBinding = -1;
+        return false;
+    }
+
+    m_constantsBufferBinding = _bindingIndex;
+    return true;
+}
+
+ionU64 Material::ComputeHash() const
+{
+    // a custom draw cannot be compared, the material is unique
+    if (m_customDrawFunction != nullptr)
+    {
+        return HashValue(this, Tools::kFNV1aOffset64);
+    }
+
+    ionU64 hash = Tools::kFNV1aOffset64;
+
+    hash = HashValue(m_vertexShaderIndex, hash);
+    hash = HashValue(m_fragmentShaderIndex, hash);
+    hash = HashValue(m_tessellationControlIndex, hash);
+    hash = HashValue(m_tessellationEvaluationIndex, hash);
+    hash = HashValue(m_geometryIndex, hash);
+    hash = HashValue(m_useJoint, hash);
+    hash = HashValue(m_useSkinning, hash);
+    hash = HashValue(m_isUnlit, hash);
+    hash = HashValue(m_isDiffuseLight, hash);
+    hash = HashValue(m_useGlossiness, hash);
+    hash = HashValue(m_vertexLayout, hash);
+    hash = HashValue(m_alphaMode, hash);
+    hash = HashValue(m_topology, hash);
+    hash = HashValue(m_state.GetStateBits(), hash);
+
+    hash = HashValue(m_constants.m_shaderStages, hash);
+    if (m_constants.IsValid())
+    {
+        hash = Tools::HashFNV1a64(m_constants.GetData(), m_constants.GetSizeByte(), hash);
+    }
+    hash = HashValue(m_constantsBufferBinding, hash);
+    hash = HashValue(m_drawConstantsStages, hash);
+    hash = HashValue(m_bindlessTexturesStages, hash);
+
+    hash = HashShaderLayout(m_vertexShaderLayout, hash);
+    hash = HashShaderLayout(m_tessCtrlShaderLayout, hash);
+    hash = HashShaderLayout(m_tessEvalShaderLayout, hash);
+    hash = HashShaderLayout(m_geomtryShaderLayout, hash);
+    hash = HashShaderLayout(m_fragmentShaderLayout, hash);
+    hash = HashShaderLayout(m_computeShaderLayout, hash);
+
+    // the source parameters, usually already in the constants and in the samplers
+    hash = HashValue(m_basePBR.GetBaseColorTexture(), hash);
+    hash = HashValue(m_basePBR.GetMetalRoughnessTexture(), hash);
+    hash = Tools::HashFNV1a64(m_basePBR.GetColor(), sizeof(ionFloat) * 4, hash);
+    hash = HashValue(m_basePBR.GetMetallicFactor(), hash);
+    hash = HashValue(m_basePBR.GetRoughnessFactor(), hash);
+
+    hash = HashValue(m_advancePBR.GetNormalTexture(), hash);
+    hash = HashValue(m_advancePBR.GetOcclusionTexture(), hash);
+    hash = HashValue(m_advancePBR.GetEmissiveTexture(), hash);
+    hash = Tools::HashFNV1a64(m_advancePBR.GetEmissiveColor(), sizeof(ionFloat) * 3, hash);
+    hash = HashValue(m_advancePBR.GetAlphaCutoff(), hash);
+
+    hash = HashValue(m_specularGlossiness.GetBaseColorTexture(), hash);
+    hash = HashValue(m_specularGlossiness.GetSpecularGlossinessTexture(), hash);
+    hash = Tools::HashFNV1a64(m_specularGlossiness.GetBaseColor(), sizeof(ionFloat) * 4, hash);
+    hash = Tools::HashFNV1a64(m_specularGlossiness.GetGlossinessColor(), sizeof(ionFloat) * 4, hash);
+    hash = Tools::HashFNV1a64(m_specularGlossiness.GetSpecularColor(), sizeof(ionFloat) * 4, hash);
+
+    return hash;
+}
+
+ionBool Material::DrawsSameAs(const Material& _other) const
+{
+    if (this == &_other)
+    {
+        return true;
+    }
+
+    if (m_customDrawFunction != nullptr || _other.m_customDrawFunction != nullptr)
+    {
+        return false;
+    }
+
+    if (m_vertexShaderIndex != _other.m_vertexShaderIndex || m_fragmentShaderIndex != _other.m_fragmentShaderIndex ||
+        m_tessellationControlIndex != _other.m_tessellationControlIndex || m_tessellationEvaluationIndex != _other.m_tessellationEvaluationIndex ||
+        m_geometryIndex != _other.m_geometryIndex || m_useJoint != _other.m_useJoint || m_useSkinning != _other.m_useSkinning ||
+        m_isUnlit != _other.m_isUnlit || m_isDiffuseLight != _other.m_isDiffuseLight || m_useGlossiness != _other.m_useGlossiness ||
+        m_vertexLayout != _other.m_vertexLayout || m_alphaMode != _other.m_alphaMode || m_topology != _other.m_topology ||
+        m_state.GetStateBits() != _other.m_state.GetStateBits())
+    {
+        return false;
+    }
+
+    if (m_constants.m_shaderStages != _other.m_constants.m_shaderStages || m_constants.GetSizeByte() != _other.m_constants.GetSizeByte() ||
+        (m_constants.IsValid() && memcmp(m_constants.GetData(), _other.m_constants.GetData(), m_constants.GetSizeByte()) != 0) ||
+        m_constantsBufferBinding != _other.m_constantsBufferBinding || m_drawConstantsStages != _other.m_drawConstantsStages ||
+        m_bindlessTexturesStages != _other.m_bindlessTexturesStages)
+    {
+        return false;
+    }
+
+    if (!SameShaderLayout(m_vertexShaderLayout, _other.m_vertexShaderLayout) || !SameShaderLayout(m_tessCtrlShaderLayout, _other.m_tessCtrlShaderLayout) ||
+        !SameShaderLayout(m_tessEvalShaderLayout, _other.m_tessEvalShaderLayout) || !SameShaderLayout(m_geomtryShaderLayout, _other.m_geomtryShaderLayout) ||
+        !SameShaderLayout(m_fragmentShaderLayout, _other.m_fragmentShaderLayout) || !SameShaderLayout(m_computeShaderLayout, _other.m_computeShaderLayout))
+    {
+        return false;
+    }
+
+    // the source parameters, as in ComputeHash
+    return m_basePBR.GetBaseColorTexture() == _other.m_basePBR.GetBaseColorTexture() &&
+        m_basePBR.GetMetalRoughnessTexture() == _other.m_basePBR.GetMetalRoughnessTexture() &&
+        memcmp(m_basePBR.GetColor(), _other.m_basePBR.GetColor(), sizeof(ionFloat) * 4) == 0 &&
+        m_basePBR.GetMetallicFactor() == _other.m_basePBR.GetMetallicFactor() &&
+        m_basePBR.GetRoughnessFactor() == _other.m_basePBR.GetRoughnessFactor() &&
+        m_advancePBR.GetNormalTexture() == _other.m_advancePBR.GetNormalTexture() &&
+        m_advancePBR.GetOcclusionTexture() == _other.m_advancePBR.GetOcclusionTexture() &&
+        m_advancePBR.GetEmissiveTexture() == _other.m_advancePBR.GetEmissiveTexture() &&
+        memcmp(m_advancePBR.GetEmissiveColor(), _other.m_advancePBR.GetEmissiveColor(), sizeof(ionFloat) * 3) == 0 &&
+        m_advancePBR.GetAlphaCutoff() == _other.m_advancePBR.GetAlphaCutoff() &&
+        m_specularGlossiness.GetBaseColorTexture() == _other.m_specularGlossiness.GetBaseColorTexture() &&
+        m_specularGlossiness.GetSpecularGlossinessTexture() == _other.m_specularGlossiness.GetSpecularGlossinessTexture() &&
+        memcmp(m_specularGlossiness.GetBaseColor(), _other.m_specularGlossiness.GetBaseColor(), sizeof(ionFloat) * 4) == 0 &&
+        memcmp(m_specularGlossiness.GetGlossinessColor(), _other.m_specularGlossiness.GetGlossinessColor(), sizeof(ionFloat) * 4) == 0 &&
+        memcmp(m_specularGlossiness.GetSpecularColor(), _other.m_specularGlossiness.GetSpecularColor(), sizeof(ionFloat) * 4) == 0;
+}
+
+ionU32 Material::GetPushConstantsSize() const
+{
+    if (UseBindlessTextures())
+    {
+        return GetBindlessTexturesOffset() + static_cast<ionU32>(sizeof(BindlessTextureIndices));
+    }
+    if (UseDrawConstants())
+    {
+        return GetDrawConstantsOffset() + static_cast<ionU32>(sizeof(DrawConstants));
+    }
+    return UseConstantsBuffer() ? 0 : static_cast<ionU32>(m_constants.GetSizeByte());
+}
+
 ionBool Material::IsValidPBR() const
 {
     return (m_basePBR.GetBaseColorTexture() != nullptr && m_basePBR.GetMetalRoughnessTexture() != nullptr);
@@ -183,7 +436,7 @@ void Material::SetVertexShaderLayout(const ShaderLayoutDef& _defines)
         m_vertexShaderLayout.m_uniforms[i].m_runtimeParameters.resize(paramCount);
         for (ionSize j = 0; j < paramCount; ++j)
         {
-            const ionSize hash = std::hash<ionString>{}(m_vertexShaderLayout.m_uniforms[i].m_parameters[j]);
+            const ionSize hash = HashedName::Intern(m_vertexShaderLayout.m_uniforms[i].m_parameters[j]);
             m_vertexShaderLayout.m_uniforms[i].m_runtimeParameters[j] = hash;
         }
     }
@@ -200,7 +453,7 @@ void Material::SetTessellationControlShaderLayout(const ShaderLayoutDef& _define
         m_tessCtrlShaderLayout.m_uniforms[i].m_runtimeParameters.resize(paramCount);
         for (ionSize j = 0; j < paramCount; ++j)
         {
-            const ionSize hash = std::hash<ionString>{}(m_tessCtrlShaderLayout.m_uniforms[i].m_parameters[j]);
+            const ionSize hash = HashedName::Intern(m_tessCtrlShaderLayout.m_uniforms[i].m_parameters[j]);
             m_tessCtrlShaderLayout.m_uniforms[i].m_runtimeParameters[j] = hash;
         }
     }
@@ -217,7 +470,7 @@ void Material::SetTessellationEvaluatorShaderLayout(const ShaderLayoutDef& _defi
         m_tessEvalShaderLayout.m_uniforms[i].m_runtimeParameters.resize(paramCount);
         for (ionSize j = 0; j < paramCount; ++j)
         {
-            const ionSize hash = std::hash<ionString>{}(m_tessEvalShaderLayout.m_uniforms[i].m_parameters[j]);
+            const ionSize hash = HashedName::Intern(m_tessEvalShaderLayout.m_uniforms[i].m_parameters[j]);
             m_tessEvalShaderLayout.m_uniforms[i].m_runtimeParameters[j] = hash;
         }
     }
@@ -234,7 +487,7 @@ void Material::SetGeometryShaderLayout(const ShaderLayoutDef& _defines)
         m_geomtryShaderLayout.m_uniforms[i].m_runtimeParameters.resize(paramCount);
         for (ionSize j = 0; j < paramCount; ++j)
         {
-            const ionSize hash = std::hash<ionString>{}(m_geomtryShaderLayout.m_uniforms[i].m_parameters[j]);
+            const ionSize hash = HashedName::Intern(m_geomtryShaderLayout.m_uniforms[i].m_parameters[j]);
             m_geomtryShaderLayout.m_uniforms[i].m_runtimeParameters[j] = hash;
         }
     }
@@ -251,7 +504,7 @@ void Material::SetFragmentShaderLayout(const ShaderLayoutDef& _defines)
         m_fragmentShaderLayout.m_uniforms[i].m_runtimeParameters.resize(paramCount);
         for (ionSize j = 0; j < paramCount; ++j)
         {
-            const ionSize hash = std::hash<ionString>{}(m_fragmentShaderLayout.m_uniforms[i].m_parameters[j]);
+            const ionSize hash = HashedName::Intern(m_fragmentShaderLayout.m_uniforms[i].m_parameters[j]);
             m_fragmentShaderLayout.m_uniforms[i].m_runtimeParameters[j] = hash;
         }
     }
@@ -268,7 +521,7 @@ void Material::SetComputeShaderLayout(const ShaderLayoutDef& _defines)
         m_computeShaderLayout.m_uniforms[i].m_runtimeParameters.resize(paramCount);
         for (ionSize j = 0; j < paramCount; ++j)
         {
-            const ionSize hash = std::hash<ionString>{}(m_computeShaderLayout.m_uniforms[i].m_parameters[j]);
+            const ionSize hash = HashedName::Intern(m_computeShaderLayout.m_uniforms[i].m_parameters[j]);
             m_computeShaderLayout.m_uniforms[i].m_runtimeParameters[j] = hash;
         }
     }
@@ -22,6 +22,9 @@
 #include "../Core/MemorySettings.h"
 
 
+#define ION_MATERIAL_CONSTANTS_INVALID_SLOT     0xFFFFFFFF
+
+
 ION_NAMESPACE_BEGIN
 
 class Texture;
@@ -248,11 +251,45 @@ public:
     ionBool IsValidPBR() const;
     ionBool IsValidSpecularGlossiness() const;
 
+    // Of everything the draw depends on: shaders, layouts with the identity of their textures, state bits and constants, not the name.
+    // Two materials with the same hash should draw the same, see MaterialManager::Deduplicate
+    ionU64 ComputeHash() const;
+    // The same fields compared one by one, to tell a real duplicate from a collision of the hash
+    ionBool DrawsSameAs(const Material& _other) const;
+
     //////////////////////////////////////////////////////////////////////////
     // Shader Specific
-    void SetConstantsShaders(const ConstantsBindingDef& _constants) { m_constants = _constants; m_constants.m_runtimeStages = (VkShaderStageFlagBits)m_constants.m_shaderStages; }
+    void SetConstantsShaders(const ConstantsBindingDef& _constants);
     const ConstantsBindingDef& GetConstantsShaders() const { return m_constants; }
 
+    // The constants above are not pushed every draw but written once in the constants buffer of the MaterialManager, at GetConstantsSlot(),
+    // and again only when they change. The shaders of the constants stages read them from the storage buffer at this binding, indexed by
+    // DrawConstants::m_materialIndex, so the material has to push the draw constants too. -1 (default) pushes the constants.
+    // Only the materials set here take a slot: false when the buffer is full, the material keeps pushing its constants then.
+    ionBool SetConstantsBufferBinding(ionS32 _bindingIndex);
+    ionS32 GetConstantsBufferBinding() const { return m_constantsBufferBinding; }
+    ionBool UseConstantsBuffer() const { return m_constantsBufferBinding >= 0; }
+    ionU32 GetConstantsSlot() const { return m_constantsSlot; }
+
+    // The per draw data (see DrawConstants) is pushed to these stages instead of going through the uniform blocks.
+    // The shaders have to declare it in the push constant block at GetDrawConstantsOffset(), after the constants above,
+    // and must not have "model" in their uniforms anymore. 0 (default) keeps the model matrix in the uniform block.
+    void SetDrawConstantsStages(EPushConstantStage _stages) { m_drawConstantsStages = _stages; }
+    EPushConstantStage GetDrawConstantsStages() const { return m_drawConstantsStages; }
+    ionBool UseDrawConstants() const { return m_drawConstantsStages != 0; }
+    ionU32 GetDrawConstantsOffset() const { return UseConstantsBuffer() ? 0 : static_cast<ionU32>((m_constants.GetSizeByte() + 15) & ~15); }
+
+    // The textures of the samplers are not written in the descriptor set of the material but read from the bindless table (set 1),
+    // by the indices (see BindlessTextureIndices) pushed to these stages at GetBindlessTexturesOffset(), after the draw constants.
+    // The table exists only if the device supports the descriptor indexing: check TextureManager::IsBindlessEnabled() before choosing the shaders.
+    void SetBindlessTexturesStages(EPushConstantStage _stages) { m_bindlessTexturesStages = _stages; }
+    EPushConstantStage GetBindlessTexturesStages() const { return m_bindlessTexturesStages; }
+    ionBool UseBindlessTextures() const { return m_bindlessTexturesStages != 0; }
+    ionU32 GetBindlessTexturesOffset() const { return GetDrawConstantsOffset() + (UseDrawConstants() ? static_cast<ionU32>(sizeof(DrawConstants)) : 0); }
+
+    // End of all the push constants above, it has to fit in the maxPushConstantsSize of the device (only 128 bytes are guaranteed)
+    ionU32 GetPushConstantsSize() const;
+
     void SetVertexShaderLayout(const ShaderLayoutDef& _defines);
     void SetTessellationControlShaderLayout(const ShaderLayoutDef& _defines);
     void SetTessellationEvaluatorShaderLayout(const ShaderLayoutDef& _defines);
@@ -289,6 +326,8 @@ private:
     SpecularGlossiness m_specularGlossiness;
 
     ConstantsBindingDef m_constants;
+    EPushConstantStage  m_drawConstantsStages;
+    EPushConstantStage  m_bindlessTexturesStages;
 
     VkPrimitiveTopology m_topology;
 
@@ -308,6 +347,17 @@ private:
     ionBool         m_useGlossiness;       // the default render pipeline is PBR, but if the texture are not found, this became true and use the specular glossiness, so it is just a fallback!
     ionBool         m_useJoint;
     ionBool         m_useSkinning;
+
+    // slot in the constants buffer, given by the MaterialManager
+    friend class MaterialManager;
+    ionS32          m_constantsBufferBinding;
+    ionU32          m_constantsSlot;
+    ionBool         m_constantsDirty;
+
+    // cache of ShaderProgramManager::FindProgram, valid only while m_programGeneration matches the manager one
+    friend class ShaderProgramManager;
+    mutable ionS32  m_programIndex;
+    mutable ionU32  m_programGeneration;
 };
 
 ION_NAMESPACE_END
\ No newline at end of file
@@ -5,10 +5,16 @@
 
 #include "MaterialManager.h"
 
+#include <algorithm>
+
 #include "../Dependencies/Eos/Eos/Eos.h"
 
 #include "../Texture/TextureManager.h"
 
+#include "../Renderer/StagingBufferManager.h"
+
+#include "../Utilities/HashedName.h"
+
 EOS_USING_NAMESPACE
 
 ION_NAMESPACE_BEGIN
@@ -22,7 +28,7 @@ MaterialManagerAllocator* MaterialManager::GetAllocator()
 }
 
 
-MaterialManager::MaterialManager()
+MaterialManager::MaterialManager() : m_deduplicatedCount(0), m_frame(0)
 {
 }
 
@@ -36,8 +42,20 @@ MaterialManager& MaterialManager::Instance()
     return instance;
 }
 
-void MaterialManager::Init()
+void MaterialManager::Init(VkDevice _vkDevice)
 {
+    // never mapped, written through the staging buffer
+    const ionSize constantsSize = static_cast<ionSize>(ION_MATERIAL_CONSTANTS_MAX_MATERIALS) * ION_MATERIAL_CONSTANTS_SLOT_SIZE;
+    if (m_constantsBuffer.Alloc(_vkDevice, nullptr, constantsSize, EBufferUsage_Static))
+    {
+        // the lowest slots first
+        m_freeSlots.reserve(ION_MATERIAL_CONSTANTS_MAX_MATERIALS);
+        for (ionU32 i = ION_MATERIAL_CONSTANTS_MAX_MATERIALS; i > 0; --i)
+        {
+            m_freeSlots.push_back(i - 1);
+        }
+    }
+
 	// DEFAULT MATERIAL
 	// For now is here, I need to more somewhere else!
 	Material* material = CreateMaterial(ION_DEFAULT_MATERIAL);
@@ -64,6 +82,175 @@ void MaterialManager::Shutdown()
         DestroyMaterial(&it->second);
     }
     m_hashMaterial.clear();
+    m_uniqueMaterials.clear();
+    m_deduplicatedCount = 0;
+
+    m_dirtyMaterials.clear();
+    m_pendingSlots.clear();
+    m_freeSlots.clear();
+    m_constantsBuffer.Free();
+}
+
+Material* MaterialManager::Deduplicate(Material* _material)
+{
+    if (_material == nullptr)
+    {
+        return nullptr;
+    }
+
+    const ionU64 hash = _material->ComputeHash();
+
+    auto search = m_uniqueMaterials.find(hash);
+    if (search == m_uniqueMaterials.end())
+    {
+        m_uniqueMaterials.insert(std::make_pair(hash, _material));
+        RestoreConstantsSlot(_material);
+        return _material;
+    }
+
+    Material* unique = search->second;
+    if (unique == _material)
+    {
+        return _material;
+    }
+
+    // changed after it was registered: the entry is stale and this material takes its place
+    if (unique->ComputeHash() != hash)
+    {
+        search->second = _material;
+        RestoreConstantsSlot(_material);
+        return _material;
+    }
+
+    // same hash but not the same draw: a collision, this material is drawn on its own
+    if (!_material->DrawsSameAs(*unique))
+    {
+        RestoreConstantsSlot(_material);
+        return _material;
+    }
+
+    // the duplicate is never drawn, its constants are already in the slot of the unique one
+    ReleaseConstantsSlot(_material);
+
+    ++m_deduplicatedCount;
+
+    return unique;
+}
+
+void MaterialManager::Update()
+{
+    ++m_frame;
+    ReleasePendingSlots(false);
+
+    ION_MEMORY_ALIGNED ionFloat values[ION_MATERIAL_CONSTANTS_SLOT_SIZE / sizeof(ionFloat)];
+
+    const ionSize dirtyCount = m_dirtyMaterials.size();
+
+    // The frames in flight, submitted before on the same queue, can still read the slots written below:
+    // the copies wait their shaders (write after read, the execution dependency is enough).
+    // Recorded before the copies, it covers also the ones going in the next submit if the staging buffer is full
+    if (dirtyCount > 0)
+    {
+        VkCommandBuffer commandBuffer = ionStagingBufferManager().GetCommandBuffer();
+        if (commandBuffer != VK_NULL_HANDLE)
+        {
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+        }
+    }
+
+    for (ionSize i = 0; i < dirtyCount; ++i)
+    {
+        Material* material = m_dirtyMaterials[i];
+        material->m_constantsDirty = false;
+
+        const ConstantsBindingDef& constants = material->GetConstantsShaders();
+        ionAssert(constants.GetSizeByte() <= ION_MATERIAL_CONSTANTS_SLOT_SIZE, "The constants of the material " << material->GetName() << " exceed the slot of the buffer!");
+
+        // the whole slot, the values not set are 0
+        memset(values, 0, sizeof(values));
+        if (constants.IsValid())
+        {
+            memcpy(values, constants.GetData(), std::min(constants.GetSizeByte(), sizeof(values)));
+        }
+
+        m_constantsBuffer.Update(values, sizeof(values), static_cast<ionSize>(material->m_constantsSlot) * ION_MATERIAL_CONSTANTS_SLOT_SIZE);
+    }
+    m_dirtyMaterials.clear();
+}
+
+void MaterialManager::SetConstantsDirty(Material* _material)
+{
+    if (_material->m_constantsSlot == ION_MATERIAL_CONSTANTS_INVALID_SLOT || _material->m_constantsDirty)
+    {
+        return;
+    }
+
+    _material->m_constantsDirty = true;
+    m_dirtyMaterials.push_back(_material);
+}
+
+ionBool MaterialManager::AcquireConstantsSlot(Material* _material)
+{
+    if (m_freeSlots.empty())
+    {
+        return false;
+    }
+
+    _material->m_constantsSlot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    SetConstantsDirty(_material);
+
+    return true;
+}
+
+void MaterialManager::ReleaseConstantsSlot(Material* _material)
+{
+    if (_material->m_constantsSlot == ION_MATERIAL_CONSTANTS_INVALID_SLOT)
+    {
+        return;
+    }
+
+    if (_material->m_constantsDirty)
+    {
+        m_dirtyMaterials.erase(std::find(m_dirtyMaterials.begin(), m_dirtyMaterials.end(), _material));
+        _material->m_constantsDirty = false;
+    }
+
+    // the draws in flight can still read the slot
+    m_pendingSlots.push_back({ _material->m_constantsSlot, m_frame });
+    _material->m_constantsSlot = ION_MATERIAL_CONSTANTS_INVALID_SLOT;
+}
+
+void MaterialManager::RestoreConstantsSlot(Material* _material)
+{
+    // dropped as a duplicate before, and drawn again
+    if (!_material->UseConstantsBuffer() || _material->m_constantsSlot != ION_MATERIAL_CONSTANTS_INVALID_SLOT)
+    {
+        return;
+    }
+
+    const ionBool acquired = AcquireConstantsSlot(_material);
+    ionAssert(acquired, "The constants buffer is full, the material " << _material->GetName() << " has no slot to read its constants from!");
+}
+
+void MaterialManager::ReleasePendingSlots(ionBool _force)
+{
+    // same delay used by the texture manager: more frames than the ones in flight
+    static const ionU64 kReleaseDelayFrames = 4;
+
+    for (auto it = m_pendingSlots.begin(); it != m_pendingSlots.end();)
+    {
+        if (!_force && it->m_frame + kReleaseDelayFrames > m_frame)
+        {
+            ++it;
+            continue;
+        }
+
+        m_freeSlots.push_back(it->m_slot);
+
+        it = m_pendingSlots.erase(it);
+    }
 }
 
 Material* MaterialManager::CreateMaterial(const ionString& _name, ionU64 _stateBits /*= 0*/)
@@ -101,7 +288,7 @@ Material* MaterialManager::GetMaterial(const ionString& _name)
         return nullptr;
     }
 
-    ionSize hash = std::hash<ionString>{}(_name);
+    ionSize hash = HashedName(_name);
 
     const auto search = m_hashMaterial.find(hash);
     if (search != m_hashMaterial.cend())
@@ -121,16 +308,22 @@ Material* MaterialManager::InternalCreateMaterial(const ionString& _name)
         return nullptr;
     }
 
-    ionSize hash = std::hash<ionString>{}(_name);
+    ionSize hash = HashedName(_name);
 
     // just to inform the user
     auto search = m_hashMaterial.find(hash);
     ionAssert(!(search != m_hashMaterial.end()), "A material with the same name has already added!");
+    if (search != m_hashMaterial.end())
+    {
+        ReleaseConstantsSlot(&search->second);
+    }
 
 	m_hashMaterial[hash] = Material();
 	m_hashMaterial[hash].SetName(_name);
 
-    return &m_hashMaterial[hash];
+    Material* material = &m_hashMaterial[hash];
+
+    return material;
 }
 
 void MaterialManager::DestroyMaterial(const ionString& _name)
@@ -140,7 +333,7 @@ void MaterialManager::DestroyMaterial(const ionString& _name)
         return;
     }
 
-    ionSize hash = std::hash<ionString>{}(_name);
+    ionSize hash = HashedName(_name);
     DestroyMaterial(hash);
 }
 
@@ -149,7 +342,17 @@ void MaterialManager::DestroyMaterial(ionSize _hash)
     auto search = m_hashMaterial.find(_hash);
     if (search != m_hashMaterial.end())
 	{
+        for (auto it = m_uniqueMaterials.begin(); it != m_uniqueMaterials.end(); ++it)
+        {
+            if (it->second == &search->second)
+            {
+                m_uniqueMaterials.erase(it);
+                break;
+            }
+        }
+
         DestroyMaterial(&search->second);
+        ReleaseConstantsSlot(&search->second);
         m_hashMaterial.erase(_hash);
     }
 }
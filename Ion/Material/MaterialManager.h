@@ -11,11 +11,16 @@
 
 #include "../Core/MemorySettings.h"
 
+#include "../Renderer/StorageBufferObject.h"
+
 #include "Material.h"
 
 
 #define ION_DEFAULT_MATERIAL "DefaultMaterial"
 
+#define ION_MATERIAL_CONSTANTS_MAX_MATERIALS    4096
+#define ION_MATERIAL_CONSTANTS_SLOT_SIZE        256     // bytes of a material in the constants buffer, the largest push constant block of the devices
+
 
 EOS_USING_NAMESPACE
 
@@ -35,22 +40,73 @@ public:
     MaterialManager();
     ~MaterialManager();
 
-    void        Init();
+    void        Init(VkDevice _vkDevice);
     void        Shutdown();
 
+    // once per frame, before the staging buffer is submitted: uploads the constants changed since the last update
+    void        Update();
+
     Material*   CreateMaterial(const ionString& _name, ionU64 _stateBits = 0u);
     Material*   GetMaterial(const ionString& _name);
 
     // This call actually destroy/delete the material
     void        DestroyMaterial(const ionString& _name);
 
+    // The first material drawing the same as this one (see Material::ComputeHash), to be used in its place once it is fully set:
+    // the duplicates share one program, its pipelines and descriptor sets. The material itself if it is the first one.
+    // The duplicates stay in the manager, so the lookup by name still works, but they are never drawn and give back their constants slot.
+    // The hash only finds the candidate, the materials are compared field by field (see Material::DrawsSameAs) before being merged.
+    Material*   Deduplicate(Material* _material);
+    ionU32      GetDeduplicatedCount() const { return m_deduplicatedCount; }
+
+    // The constants of the materials set by Material::SetConstantsBufferBinding in a device local storage buffer,
+    // a slot of ION_MATERIAL_CONSTANTS_SLOT_SIZE bytes per material. In the shader (see PBRBuffer.frag):
+    /*
+    struct Material {
+        float baseColorR;   // the constants in the same order
+        ...
+        float padding[];    // up to ION_MATERIAL_CONSTANTS_SLOT_SIZE / 4 floats
+    };
+
+    layout (set = 0, binding = <Material::GetConstantsBufferBinding()>) readonly buffer Materials {
+        Material slots[];
+    } materials;
+
+    float baseColorR = materials.slots[draw.materialIndex].baseColorR;
+    */
+    const StorageBuffer& GetConstantsBuffer() const { return m_constantsBuffer; }
+    void        SetConstantsDirty(Material* _material);
+
 private:
     Material*   InternalCreateMaterial(const ionString& _name);
     void        DestroyMaterial(Material* _material);
     void        DestroyMaterial(ionSize _hash);         // This call actually destroy/delete the material
 
 private:
+    friend class Material;
+
+    // false when all the slots are taken or the buffer has not been created
+    ionBool     AcquireConstantsSlot(Material* _material);
+    void        ReleaseConstantsSlot(Material* _material);
+    void        RestoreConstantsSlot(Material* _material);
+    void        ReleasePendingSlots(ionBool _force);
+
+private:
+    struct PendingSlot
+    {
+        ionU32              m_slot;
+        ionU64              m_frame;
+    };
+
     ionMap<ionSize, Material, MaterialManagerAllocator, GetAllocator> m_hashMaterial;
+    ionMap<ionU64, Material*, MaterialManagerAllocator, GetAllocator> m_uniqueMaterials;    // by content hash
+    ionU32                  m_deduplicatedCount;
+
+    StorageBuffer           m_constantsBuffer;
+    ionVector<Material*, MaterialManagerAllocator, GetAllocator>    m_dirtyMaterials;
+    ionVector<ionU32, MaterialManagerAllocator, GetAllocator>       m_freeSlots;
+    ionVector<PendingSlot, MaterialManagerAllocator, GetAllocator>  m_pendingSlots;
+    ionU64                  m_frame;
 };
 
 ION_NAMESPACE_END
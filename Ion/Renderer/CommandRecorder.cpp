@@ -0,0 +1,305 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Renderer\CommandRecorder.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#include "CommandRecorder.h"
+
+#include "RenderCore.h"
+
+#include "../GPU/GpuMemoryManager.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+CommandRecorderAllocator* CommandRecorder::GetAllocator()
+{
+    static HeapArea<Settings::kCommandRecorderAllocatorSize> memoryArea;
+    static CommandRecorderAllocator memoryAllocator(memoryArea, "CommandRecorderFreeListAllocator");
+
+    return &memoryAllocator;
+}
+
+CommandRecorder::CommandRecorder() :
+    m_render(nullptr),
+    m_vkDevice(VK_NULL_HANDLE),
+    m_renderPass(VK_NULL_HANDLE),
+    m_frameBuffer(VK_NULL_HANDLE),
+    m_generation(0),
+    m_pending(0),
+    m_frameIndex(0),
+    m_framesInFlight(0),
+    m_running(false)
+{
+    memset(&m_viewport, 0, sizeof(m_viewport));
+    memset(&m_scissor, 0, sizeof(m_scissor));
+    memset(&m_depthValues, 0, sizeof(m_depthValues));
+}
+
+CommandRecorder::~CommandRecorder()
+{
+
+}
+
+ionBool CommandRecorder::Init(const RenderCore& _render, ionU32 _threadCount)
+{
+    if (m_running)
+    {
+        return true;
+    }
+
+    m_render = &_render;
+    m_vkDevice = _render.GetDevice();
+    m_framesInFlight = _render.GetFramesInFlight();
+    m_generation = 0;
+    m_pending = 0;
+    m_frameIndex = 0;
+
+    const ionU32 threadCount = std::min(std::max(_threadCount, 1u), static_cast<ionU32>(ION_MAX_RECORDING_THREADS));
+
+    m_contexts.resize(threadCount);
+    for (ionU32 i = 0; i < threadCount; ++i)
+    {
+        RecordingContext& context = m_contexts[i];
+        context.m_usedCommandBuffers = 0;
+        context.m_packets = nullptr;
+        context.m_packetCount = 0;
+        context.m_commandBuffer = VK_NULL_HANDLE;
+        context.m_succeeded = true;
+
+        for (ionU32 j = 0; j < ION_MAX_FRAMES_IN_FLIGHT; ++j)
+        {
+            context.m_commandPools[j] = VK_NULL_HANDLE;
+        }
+
+        // transient like the pools of the primary command buffers, reset as a whole every time the frame starts again
+        for (ionU32 j = 0; j < m_framesInFlight; ++j)
+        {
+            VkCommandPoolCreateInfo poolCreateInfo = {};
+            poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolCreateInfo.queueFamilyIndex = _render.GetGraphicFamilyIndex();
+
+            VkResult result = vkCreateCommandPool(m_vkDevice, &poolCreateInfo, vkMemory, &context.m_commandPools[j]);
+            ionAssertReturnValue(result == VK_SUCCESS, "Cannot create recording command pool!", false);
+        }
+    }
+
+    m_running = true;
+
+    m_threads.reserve(threadCount - 1);
+    for (ionU32 i = 1; i < threadCount; ++i)
+    {
+        m_threads.push_back(std::thread(&CommandRecorder::Run, this, i));
+    }
+
+    return true;
+}
+
+void CommandRecorder::Shutdown()
+{
+    if (m_running)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_wakeUp.notify_all();
+
+        for (ionSize i = 0; i < m_threads.size(); ++i)
+        {
+            m_threads[i].join();
+        }
+    }
+    m_threads.clear();
+
+    // destroying the pools frees their command buffers
+    for (ionSize i = 0; i < m_contexts.size(); ++i)
+    {
+        RecordingContext& context = m_contexts[i];
+        for (ionU32 j = 0; j < m_framesInFlight; ++j)
+        {
+            if (context.m_commandPools[j] != VK_NULL_HANDLE)
+            {
+                vkDestroyCommandPool(m_vkDevice, context.m_commandPools[j], vkMemory);
+            }
+            context.m_commandBuffers[j].clear();
+        }
+    }
+    m_contexts.clear();
+}
+
+ionBool CommandRecorder::StartFrame(ionU32 _frameIndex)
+{
+    ionAssertReturnValue(_frameIndex < m_framesInFlight, "Frame index out of range!", false);
+
+    m_frameIndex = _frameIndex;
+
+    for (ionSize i = 0; i < m_contexts.size(); ++i)
+    {
+        RecordingContext& context = m_contexts[i];
+        context.m_usedCommandBuffers = 0;
+
+        VkResult result = vkResetCommandPool(m_vkDevice, context.m_commandPools[m_frameIndex], 0);
+        ionAssertReturnValue(result == VK_SUCCESS, "Reset recording command pool failed!", false);
+    }
+
+    return true;
+}
+
+ionBool CommandRecorder::Record(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, const VkViewport& _viewport, const VkRect2D& _scissor, const DepthValues& _depthValues, const DrawPacket* _packets, ionU32 _packetCount,
+    ionVector<VkCommandBuffer, CommandRecorderAllocator, GetAllocator>& _outCommandBuffers)
+{
+    ionAssertReturnValue(m_running, "The command recorder is not running!", false);
+
+    if (_packetCount == 0)
+    {
+        return true;
+    }
+
+    // contiguous chunks, so executing the command buffers in order keeps the order of the packets
+    const ionU32 contextCount = GetThreadCount();
+    const ionU32 chunkSize = (_packetCount + contextCount - 1) / contextCount;
+
+    for (ionU32 i = 0; i < contextCount; ++i)
+    {
+        RecordingContext& context = m_contexts[i];
+
+        const ionU32 first = std::min(i * chunkSize, _packetCount);
+        context.m_packets = _packets + first;
+        context.m_packetCount = std::min(chunkSize, _packetCount - first);
+        context.m_commandBuffer = context.m_packetCount > 0 ? AcquireCommandBuffer(context) : VK_NULL_HANDLE;
+        context.m_succeeded = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_renderPass = _renderPass;
+        m_frameBuffer = _frameBuffer;
+        m_viewport = _viewport;
+        m_scissor = _scissor;
+        m_depthValues = _depthValues;
+        m_pending = contextCount - 1;
+        ++m_generation;
+    }
+    m_wakeUp.notify_all();
+
+    m_contexts[0].m_succeeded = RecordChunk(m_contexts[0]);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_pending == 0; });
+    }
+
+    for (ionU32 i = 0; i < contextCount; ++i)
+    {
+        ionAssertReturnValue(m_contexts[i].m_succeeded, "Cannot record the chunk of the draws!", false);
+    }
+
+    for (ionU32 i = 0; i < contextCount; ++i)
+    {
+        if (m_contexts[i].m_packetCount > 0)
+        {
+            _outCommandBuffers.push_back(m_contexts[i].m_commandBuffer);
+        }
+    }
+
+    return true;
+}
+
+VkCommandBuffer CommandRecorder::AcquireCommandBuffer(RecordingContext& _context)
+{
+    ionVector<VkCommandBuffer, CommandRecorderAllocator, GetAllocator>& commandBuffers = _context.m_commandBuffers[m_frameIndex];
+
+    if (_context.m_usedCommandBuffers == commandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        createInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        createInfo.commandPool = _context.m_commandPools[m_frameIndex];
+        createInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkResult result = vkAllocateCommandBuffers(m_vkDevice, &createInfo, &commandBuffer);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create secondary command buffer!", VK_NULL_HANDLE);
+
+        commandBuffers.push_back(commandBuffer);
+    }
+
+    return commandBuffers[_context.m_usedCommandBuffers++];
+}
+
+ionBool CommandRecorder::RecordChunk(const RecordingContext& _context) const
+{
+    if (_context.m_packetCount == 0)
+    {
+        return true;
+    }
+
+    ionAssertReturnValue(_context.m_commandBuffer != VK_NULL_HANDLE, "No command buffer to record the chunk!", false);
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = m_renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = m_frameBuffer;
+
+    VkCommandBufferBeginInfo commandBufferBeginInfo = {};
+    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    VkResult result = vkBeginCommandBuffer(_context.m_commandBuffer, &commandBufferBeginInfo);
+    ionAssertReturnValue(result == VK_SUCCESS, "vkBeginCommandBuffer failed!", false);
+
+    // nothing of the dynamic state is inherited from the primary command buffer
+    vkCmdSetViewport(_context.m_commandBuffer, 0, 1, &m_viewport);
+    vkCmdSetScissor(_context.m_commandBuffer, 0, 1, &m_scissor);
+    m_render->RecordDepthValues(_context.m_commandBuffer, m_depthValues);
+
+    ionU64 appliedStateBits = 0;
+    ionBool stateApplied = false;
+    for (ionU32 i = 0; i < _context.m_packetCount; ++i)
+    {
+        m_render->RecordDraw(_context.m_commandBuffer, _context.m_packets[i], m_depthValues, appliedStateBits, stateApplied);
+    }
+
+    result = vkEndCommandBuffer(_context.m_commandBuffer);
+    ionAssertReturnValue(result == VK_SUCCESS, "vkEndCommandBuffer failed!", false);
+
+    return true;
+}
+
+void CommandRecorder::Run(ionU32 _contextIndex)
+{
+    // the generation is 0 when the workers are started, before any Record
+    ionU64 recordedGeneration = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wakeUp.wait(lock, [this, &recordedGeneration]() { return !m_running || m_generation != recordedGeneration; });
+        if (!m_running)
+        {
+            break;
+        }
+
+        recordedGeneration = m_generation;
+
+        // every worker records its own chunk in its own command buffer, without the lock
+        lock.unlock();
+        const ionBool succeeded = RecordChunk(m_contexts[_contextIndex]);
+        lock.lock();
+
+        m_contexts[_contextIndex].m_succeeded = succeeded;
+        if (--m_pending == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
+
+ION_NAMESPACE_END
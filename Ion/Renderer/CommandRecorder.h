@@ -0,0 +1,132 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Renderer\CommandRecorder.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../Core/CoreDefs.h"
+
+#include "../Dependencies/Eos/Eos/Eos.h"
+
+#include "../Core/MemoryWrapper.h"
+#include "../Core/MemorySettings.h"
+
+#include "RenderDefs.h"
+
+#include "../Shader/ShaderProgram.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+using CommandRecorderAllocator = MemoryAllocator<FreeListBestSearchAllocationPolicy, MultiThreadPolicy, MemoryBoundsCheck, MemoryTag, MemoryLog>;
+
+// A draw resolved on the render thread by RenderCore::PrepareDraw, everything RenderCore::RecordDraw needs to record it
+struct DrawPacket
+{
+    DrawCommit          m_commit;
+    DrawConstants       m_drawConstants;
+    ionU64              m_stateBits;
+    VkBuffer            m_indexBuffer;      // VK_NULL_HANDLE if the cache is not valid
+    VkDeviceSize        m_indexOffset;
+    VkBuffer            m_vertexBuffer;     // VK_NULL_HANDLE if the cache is not valid
+    VkDeviceSize        m_vertexOffset;
+    ionU32              m_indexStart;
+    ionU32              m_indexCount;
+    ionBool             m_pushDrawConstants;
+};
+
+// The values of the depth bias and of the depth bounds, set by RenderCore::SetPolygonOffset and RenderCore::SetDepthBoundsTest
+struct DepthValues
+{
+    ionFloat            m_biasConstant;
+    ionFloat            m_biasSlope;
+    ionFloat            m_boundsMin;
+    ionFloat            m_boundsMax;
+};
+
+class RenderCore;
+
+// Records the draw packets of a render pass in secondary command buffers: the packets are split in contiguous chunks,
+// the first recorded by the calling thread and the others by the workers.
+// Every recording thread has a command pool per frame in flight, reset when the frame starts again, so the recording needs no lock.
+class ION_DLL CommandRecorder final
+{
+public:
+    static CommandRecorderAllocator* GetAllocator();
+
+public:
+    CommandRecorder();
+    ~CommandRecorder();
+
+    // _threadCount includes the calling thread, 1 records everything on it
+    ionBool Init(const RenderCore& _render, ionU32 _threadCount);
+    void    Shutdown();
+
+    // after the fence of the frame: the command buffers recorded the last time with the same index are free again
+    ionBool StartFrame(ionU32 _frameIndex);
+
+    // A secondary command buffer per chunk in _outCommandBuffers, to execute in the same order in the render pass started with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+    // Blocking until all the chunks are recorded: the packets can be reused as soon as it returns
+    ionBool Record(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, const VkViewport& _viewport, const VkRect2D& _scissor, const DepthValues& _depthValues, const DrawPacket* _packets, ionU32 _packetCount,
+        ionVector<VkCommandBuffer, CommandRecorderAllocator, GetAllocator>& _outCommandBuffers);
+
+    ionU32  GetThreadCount() const { return static_cast<ionU32>(m_contexts.size()); }
+
+private:
+    CommandRecorder(const CommandRecorder& _Orig) = delete;
+    CommandRecorder& operator = (const CommandRecorder&) = delete;
+
+    // of a recording thread, the first is the calling one
+    struct RecordingContext
+    {
+        VkCommandPool       m_commandPools[ION_MAX_FRAMES_IN_FLIGHT];
+        ionVector<VkCommandBuffer, CommandRecorderAllocator, GetAllocator> m_commandBuffers[ION_MAX_FRAMES_IN_FLIGHT];
+        ionU32              m_usedCommandBuffers;   // of the current frame, more than one if more render passes are recorded in parallel
+
+        // the chunk of the current Record
+        const DrawPacket*   m_packets;
+        ionU32              m_packetCount;
+        VkCommandBuffer     m_commandBuffer;
+        ionBool             m_succeeded;
+    };
+
+    void    Run(ionU32 _contextIndex);
+    VkCommandBuffer AcquireCommandBuffer(RecordingContext& _context);
+    ionBool RecordChunk(const RecordingContext& _context) const;
+
+private:
+    const RenderCore*           m_render;
+    VkDevice                    m_vkDevice;
+
+    ionVector<RecordingContext, CommandRecorderAllocator, GetAllocator>  m_contexts;
+    ionVector<std::thread, CommandRecorderAllocator, GetAllocator>       m_threads;     // of the contexts after the first
+
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wakeUp;
+    std::condition_variable     m_done;
+
+    // the state of the current Record, written only while the workers are waiting
+    VkRenderPass                m_renderPass;
+    VkFramebuffer               m_frameBuffer;
+    VkViewport                  m_viewport;
+    VkRect2D                    m_scissor;
+    DepthValues                 m_depthValues;
+
+    ionU64                      m_generation;       // incremented by every Record, the workers record once per generation
+    ionU32                      m_pending;          // workers still recording the current generation
+    ionU32                      m_frameIndex;
+    ionU32                      m_framesInFlight;
+    ionBool                     m_running;
+};
+
+ION_NAMESPACE_END
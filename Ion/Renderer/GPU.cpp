@@ -5,6 +5,10 @@
 
 #include "GPU.h"
 
+#include <algorithm>
+
+#include "RenderDefs.h"
+
 
 EOS_USING_NAMESPACE
 
@@ -24,6 +28,10 @@ GPU::GPU() :  m_vkPhysicalDevice(VK_NULL_HANDLE)
 	memset(&m_vkPhysicalDeviceMemoryProperties, 0, sizeof(VkPhysicalDeviceMemoryProperties));
 	memset(&m_vkPhysicalDevFeatures, 0, sizeof(VkPhysicalDeviceFeatures));
 	memset(&m_vkSurfaceCaps, 0, sizeof(VkSurfaceCapabilitiesKHR));
+    memset(&m_vkDescriptorIndexingFeatures, 0, sizeof(VkPhysicalDeviceDescriptorIndexingFeaturesEXT));
+    memset(&m_vkDescriptorIndexingProps, 0, sizeof(VkPhysicalDeviceDescriptorIndexingPropertiesEXT));
+    memset(&m_vkExtendedDynamicStateFeatures, 0, sizeof(VkPhysicalDeviceExtendedDynamicStateFeaturesEXT));
+    memset(&m_vkExtendedDynamicState2Features, 0, sizeof(VkPhysicalDeviceExtendedDynamicState2FeaturesEXT));
 }
 
 GPU::~GPU()
@@ -84,7 +92,104 @@ ionBool GPU::Set(const VkInstance& _vkInstance, const VkSurfaceKHR& _vkSurface,
     vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &m_vkPhysicalDeviceProps);
     vkGetPhysicalDeviceFeatures(m_vkPhysicalDevice, &m_vkPhysicalDevFeatures);
 
+    // the entry points are there only if the instance enabled VK_KHR_get_physical_device_properties2
+    memset(&m_vkDescriptorIndexingFeatures, 0, sizeof(VkPhysicalDeviceDescriptorIndexingFeaturesEXT));
+    memset(&m_vkDescriptorIndexingProps, 0, sizeof(VkPhysicalDeviceDescriptorIndexingPropertiesEXT));
+    memset(&m_vkExtendedDynamicStateFeatures, 0, sizeof(VkPhysicalDeviceExtendedDynamicStateFeaturesEXT));
+    memset(&m_vkExtendedDynamicState2Features, 0, sizeof(VkPhysicalDeviceExtendedDynamicState2FeaturesEXT));
+    m_vkDescriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    m_vkDescriptorIndexingProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    m_vkExtendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    m_vkExtendedDynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+
+    PFN_vkGetPhysicalDeviceFeatures2KHR getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(_vkInstance, "vkGetPhysicalDeviceFeatures2KHR");
+    PFN_vkGetPhysicalDeviceProperties2KHR getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(_vkInstance, "vkGetPhysicalDeviceProperties2KHR");
+    if (getFeatures2 != nullptr && getProperties2 != nullptr)
+    {
+        // only the structures of the extensions exposed by the device can be chained
+        VkPhysicalDeviceFeatures2KHR features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+
+        VkPhysicalDeviceProperties2KHR properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+
+        if (HasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+        {
+            m_vkDescriptorIndexingFeatures.pNext = features.pNext;
+            features.pNext = &m_vkDescriptorIndexingFeatures;
+
+            properties.pNext = &m_vkDescriptorIndexingProps;
+        }
+        if (HasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+        {
+            m_vkExtendedDynamicStateFeatures.pNext = features.pNext;
+            features.pNext = &m_vkExtendedDynamicStateFeatures;
+        }
+        if (HasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME))
+        {
+            m_vkExtendedDynamicState2Features.pNext = features.pNext;
+            features.pNext = &m_vkExtendedDynamicState2Features;
+        }
+
+        getFeatures2(m_vkPhysicalDevice, &features);
+        getProperties2(m_vkPhysicalDevice, &properties);
+
+        m_vkDescriptorIndexingFeatures.pNext = nullptr;
+        m_vkDescriptorIndexingProps.pNext = nullptr;
+        m_vkExtendedDynamicStateFeatures.pNext = nullptr;
+        m_vkExtendedDynamicState2Features.pNext = nullptr;
+    }
+
     return true;
 }
 
+ionBool GPU::HasExtension(const char* _extensionName) const
+{
+    for (const VkExtensionProperties& extension : m_vkExtensionProps)
+    {
+        if (strcmp(extension.extensionName, _extensionName) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+ionBool GPU::IsBindlessSupported() const
+{
+    // the draws index the array with a push constant, dynamically uniform: the non uniform indexing is not needed
+    return HasExtension(VK_KHR_MAINTENANCE3_EXTENSION_NAME) && HasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+        m_vkPhysicalDevFeatures.shaderSampledImageArrayDynamicIndexing == VK_TRUE &&
+        m_vkDescriptorIndexingFeatures.runtimeDescriptorArray == VK_TRUE &&
+        m_vkDescriptorIndexingFeatures.descriptorBindingPartiallyBound == VK_TRUE &&
+        m_vkDescriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+        m_vkDescriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending == VK_TRUE;
+}
+
+ionBool GPU::IsExtendedDynamicStateSupported() const
+{
+    return HasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) && m_vkExtendedDynamicStateFeatures.extendedDynamicState == VK_TRUE;
+}
+
+ionBool GPU::IsExtendedDynamicState2Supported() const
+{
+    return IsExtendedDynamicStateSupported() && HasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME) && m_vkExtendedDynamicState2Features.extendedDynamicState2 == VK_TRUE;
+}
+
+ionU32 GPU::GetBindlessTextureLimit() const
+{
+    if (!IsBindlessSupported())
+    {
+        return 0;
+    }
+
+    const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& props = m_vkDescriptorIndexingProps;
+    ionU32 limit = std::min(props.maxPerStageDescriptorUpdateAfterBindSampledImages, props.maxPerStageDescriptorUpdateAfterBindSamplers);
+    limit = std::min(limit, std::min(props.maxDescriptorSetUpdateAfterBindSampledImages, props.maxDescriptorSetUpdateAfterBindSamplers));
+
+    // the per stage limits count the other descriptors of the pipeline layout as well
+    const ionU32 reserved = ION_MAX_DESCRIPTOR_SET_WRITES;
+    return limit > reserved ? limit - reserved : 0;
+}
+
 ION_NAMESPACE_END
\ No newline at end of file
@@ -34,10 +34,24 @@ struct GPU final
 
     ionBool Set(const VkInstance& _vkInstance, const VkSurfaceKHR& _vkSurface, const VkPhysicalDevice& _vkDevice);
 
+    ionBool HasExtension(const char* _extensionName) const;
+
+    // the descriptor indexing features needed by the bindless textures, see BindlessTextureTable
+    ionBool IsBindlessSupported() const;
+    ionU32  GetBindlessTextureLimit() const;
+
+    // cull, depth and stencil states set while recording instead of baked in the pipelines (the depth bias enable with the version 2)
+    ionBool IsExtendedDynamicStateSupported() const;
+    ionBool IsExtendedDynamicState2Supported() const;
+
     VkPhysicalDevice                    m_vkPhysicalDevice;
     VkPhysicalDeviceProperties          m_vkPhysicalDeviceProps;
     VkPhysicalDeviceMemoryProperties    m_vkPhysicalDeviceMemoryProperties;
     VkPhysicalDeviceFeatures            m_vkPhysicalDevFeatures;
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT   m_vkDescriptorIndexingFeatures;     // queried only with VK_KHR_get_physical_device_properties2
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT m_vkDescriptorIndexingProps;
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT     m_vkExtendedDynamicStateFeatures;
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT    m_vkExtendedDynamicState2Features;
     VkSurfaceCapabilitiesKHR            m_vkSurfaceCaps;
     ionVector<VkSurfaceFormatKHR, GPUAllocator, GetAllocator>        m_vkSurfaceFormats;
     ionVector<VkPresentModeKHR, GPUAllocator, GetAllocator>            m_vkPresentModes;
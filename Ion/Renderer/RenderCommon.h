@@ -14,6 +14,9 @@
 
 #include "RenderDefs.h"
 
+#include "../Utilities/SphericalHarmonics.h"
+#include "../Utilities/HashedName.h"
+
 
 
 // The hardware converts a byte to a float by division with 255 and in the
@@ -27,14 +30,14 @@
 #define ION_VERTEX_FLOAT_TO_BYTE(x)            eos::Utilities::FloatToByte( ( (x) + 1.0f ) * ( ION_VERTEX_DIV_RANGE ) + 0.5f )
 
 
-// REMEMBER TO ADD THE ONE WITH THE HASH!
+// REMEMBER TO ADD THE ONE WITH THE HASH! (computed at compile time, the same value of the hash of the string)
 #define ION_MODEL_MATRIX_PARAM  "model"
 #define ION_VIEW_MATRIX_PARAM   "view"
 #define ION_PROJ_MATRIX_PARAM   "proj"
 
-#define ION_MODEL_MATRIX_PARAM_HASH  11377574333308104762
-#define ION_VIEW_MATRIX_PARAM_HASH   18322600418174592600
-#define ION_PROJ_MATRIX_PARAM_HASH   9615908744109468950
+#define ION_MODEL_MATRIX_PARAM_HASH  ION_HASHED_NAME(ION_MODEL_MATRIX_PARAM)
+#define ION_VIEW_MATRIX_PARAM_HASH   ION_HASHED_NAME(ION_VIEW_MATRIX_PARAM)
+#define ION_PROJ_MATRIX_PARAM_HASH   ION_HASHED_NAME(ION_PROJ_MATRIX_PARAM)
 
 // PBR
 #define ION_MAIN_CAMERA_POSITION_VECTOR_PARAM       "mainCameraPos"
@@ -44,14 +47,18 @@
 #define ION_GAMMA_FLOAT_PARAM                       "gamma"
 #define ION_PREFILTERED_CUBE_MIP_LEVELS_FLOAT_PARAM "prefilteredCubeMipLevels"
 #define ION_WEIGHTS_FLOATS_ARRAY_PARAM              "weights"
-
-#define ION_MAIN_CAMERA_POSITION_VECTOR_PARAM_HASH          15235675884061678663
-#define ION_DIRECTIONAL_LIGHT_DIR_VECTOR_PARAM_HASH         11254454282578422209
-#define ION_DIRECTIONAL_LIGHT_COL_VECTOR_PARAM_HASH         8321831752619492932
-#define ION_EXPOSURE_FLOAT_PARAM_HASH                       7428861124213858496
-#define ION_GAMMA_FLOAT_PARAM_HASH                          2490902623560640874
-#define ION_PREFILTERED_CUBE_MIP_LEVELS_FLOAT_PARAM_HASH    16846083055572138945
-//#define ION_WEIGHTS_FLOATS_ARRAY_PARAM_HASH                 12774824757867200798  // can use because is an array
+#define ION_IRRADIANCE_SH_VECTOR_ARRAY_PARAM        "irradianceSH"
+#define ION_USE_IRRADIANCE_SH_FLOAT_PARAM           "useIrradianceSH"
+
+#define ION_MAIN_CAMERA_POSITION_VECTOR_PARAM_HASH          ION_HASHED_NAME(ION_MAIN_CAMERA_POSITION_VECTOR_PARAM)
+#define ION_DIRECTIONAL_LIGHT_DIR_VECTOR_PARAM_HASH         ION_HASHED_NAME(ION_DIRECTIONAL_LIGHT_DIR_VECTOR_PARAM)
+#define ION_DIRECTIONAL_LIGHT_COL_VECTOR_PARAM_HASH         ION_HASHED_NAME(ION_DIRECTIONAL_LIGHT_COL_VECTOR_PARAM)
+#define ION_EXPOSURE_FLOAT_PARAM_HASH                       ION_HASHED_NAME(ION_EXPOSURE_FLOAT_PARAM)
+#define ION_GAMMA_FLOAT_PARAM_HASH                          ION_HASHED_NAME(ION_GAMMA_FLOAT_PARAM)
+#define ION_PREFILTERED_CUBE_MIP_LEVELS_FLOAT_PARAM_HASH    ION_HASHED_NAME(ION_PREFILTERED_CUBE_MIP_LEVELS_FLOAT_PARAM)
+#define ION_WEIGHTS_FLOATS_ARRAY_PARAM_HASH                 ION_HASHED_NAME(ION_WEIGHTS_FLOATS_ARRAY_PARAM)         // of the array, the elements with Tools::HashNameIndex
+#define ION_IRRADIANCE_SH_VECTOR_ARRAY_PARAM_HASH           ION_HASHED_NAME(ION_IRRADIANCE_SH_VECTOR_ARRAY_PARAM)   // of the array, the elements with Tools::HashNameIndex
+#define ION_USE_IRRADIANCE_SH_FLOAT_PARAM_HASH              ION_HASHED_NAME(ION_USE_IRRADIANCE_SH_FLOAT_PARAM)
 
 // ANIMATION
 #define ION_MAX_WEIGHT_COUNT    8
@@ -100,6 +107,7 @@ enum EShaderBinding
     EShaderBinding_Uniform = 0,
     EShaderBinding_Sampler,
     EShaderBinding_Storage,
+    EShaderBinding_MaterialConstants,       // the constants buffer of the MaterialManager, see Material::SetConstantsBufferBinding
 
     EShaderBinding_Count
 };
@@ -1133,14 +1141,33 @@ typedef ionU64 VertexCacheHandler;
 class Material;
 class Node;
 
+// What is the same for all the draws of a camera in a frame, computed once per camera and written in the uniform blocks
+// shared by the draws, see RenderCore::SetSceneConstants
+struct SceneConstants final
+{
+    Matrix4x4           m_viewMatrix;
+    Matrix4x4           m_projectionMatrix;
+    Vector4             m_mainCameraPos;
+    Vector4             m_directionalLight;
+    Vector4             m_directionalLightColor;
+    Vector4             m_irradianceSH[ION_SH_COEFFICIENTS_COUNT];
+    ionFloat            m_exposure;
+    ionFloat            m_gamma;
+    ionFloat            m_prefilteredCubeMipLevels;
+    ionFloat            m_useIrradianceSH;
+
+    SceneConstants()
+    {
+        m_exposure = 4.5f;
+        m_gamma = 2.2f;
+        m_prefilteredCubeMipLevels = 32.0f;
+        m_useIrradianceSH = 0.0f;
+    }
+};
+
 struct DrawSurface final
 {
     Matrix4x4              m_modelMatrix;
-    Matrix4x4              m_viewMatrix;
-    Matrix4x4              m_projectionMatrix;
-    Vector4              m_mainCameraPos;
-    Vector4              m_directionalLight;
-    Vector4              m_directionalLightColor;
     ionU64              m_extraGLState;
     VertexCacheHandler  m_vertexCache;
     VertexCacheHandler  m_indexCache;
@@ -1150,9 +1177,8 @@ struct DrawSurface final
     ionU32              m_indexStart;
     ionU32              m_indexCount;
     ionU32              m_meshIndexRef;
-    ionFloat            m_exposure;
-    ionFloat            m_gamma;
-    ionFloat            m_prefilteredCubeMipLevels;
+    ionU32              m_objectIndex;  // in the draw list of the camera, after the sorting
+    ionFloat            m_uvScale;      // largest UV range covered by the mesh, used by the mip streaming
     ionU8               m_sortingIndex; // 0 = opaque, 1 = mask, 2 = blend
     ionBool             m_visible;
 
@@ -1168,9 +1194,7 @@ struct DrawSurface final
         m_indexCache = 0;
         m_jointCache = 0;
         m_extraGLState = 0;
-        m_exposure = 4.5f;
-        m_gamma = 2.2f;
-        m_prefilteredCubeMipLevels = 32.0f;
+        m_uvScale = 1.0f;
         m_nodeRef = nullptr;
         m_visible = true;
         m_indexStart = 0;
@@ -1178,6 +1202,7 @@ struct DrawSurface final
         m_material = nullptr;
         m_sortingIndex = 0;
         m_meshIndexRef = 0;
+        m_objectIndex = 0;
     }
 
     ~DrawSurface()
@@ -15,6 +15,7 @@
 #include "../Texture/TextureManager.h"
 
 #include "../Shader/ShaderProgramManager.h"
+#include "../Shader/ShaderProgramHelper.h"
 
 #include "../Material/MaterialManager.h"
 
@@ -23,15 +24,38 @@
 
 #include "RenderState.h"
 
+#include "../Core/FileSystemManager.h"
+
+#include "../Utilities/Tools.h"
+
 
 #define VK_NAME                     "Ion"
 #define VK_LUNAR_VALIDATION_LAYER   "VK_LAYER_LUNARG_standard_validation"
 #define VK_KHRONOS_VALIDATION_LAYER "VK_LAYER_KHRONOS_validation"
 
+#define ION_PIPELINE_CACHE_FILENAME "PipelineCache.bin"
+#define ION_PIPELINE_CACHE_MAGIC    0x50434E49      // "INCP"
+#define ION_PIPELINE_CACHE_VERSION  1
+#define ION_PIPELINE_CACHE_MAX_SIZE (256 * 1024 * 1024)    // bigger data is not loaded or saved, the cache starts empty
+
 EOS_USING_NAMESPACE
 
 ION_NAMESPACE_BEGIN
 
+// The driver data is prefixed by the device identity: the data of another GPU or driver is discarded instead of being given to the driver
+struct PipelineCacheHeader
+{
+    ionU32  m_magic;
+    ionU32  m_version;
+    ionU32  m_vendorID;
+    ionU32  m_deviceID;
+    ionU32  m_driverVersion;
+    ionU32  m_padding;
+    ionU8   m_pipelineCacheUUID[VK_UUID_SIZE];
+    ionU64  m_dataSize;
+    ionU64  m_dataHash;
+};
+
 RenderCoreAllocator* RenderCore::GetAllocator()
 {
 	static HeapArea<Settings::kRenderCoreAllocatorSize> memoryArea;
@@ -278,6 +302,24 @@ ionBool RenderCore::CreateInstance(ionBool _enableValidationLayer)
     enabledExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
     enabledExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 
+    // needed to query the descriptor indexing of the devices, see GPU::IsBindlessSupported
+    {
+        ionU32 extensionCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+        ionVector<VkExtensionProperties, RenderCoreAllocator, GetAllocator> extensions;
+        extensions.resize(extensionCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+        for (const VkExtensionProperties& extension : extensions)
+        {
+            if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+            {
+                enabledExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+                break;
+            }
+        }
+    }
 
 	VkDebugReportCallbackCreateInfoEXT createInfoDebugReport;
 	VkDebugUtilsMessengerCreateInfoEXT createInfoUtilsMessenger;
@@ -503,12 +545,63 @@ ionBool RenderCore::CreateLogicalDeviceAndQueues()
     }
 
     VkPhysicalDeviceFeatures deviceFeatures = {};
-    deviceFeatures.textureCompressionBC = VK_TRUE;
+    // KHR_texture_basisu textures are transcoded to RGBA8 when missing, see TextureManager::IsFormatSupported
+    deviceFeatures.textureCompressionBC = m_vkGPU.m_vkPhysicalDevFeatures.textureCompressionBC;
     deviceFeatures.imageCubeArray = VK_TRUE;
     deviceFeatures.depthClamp = VK_TRUE;
     deviceFeatures.depthBiasClamp = VK_TRUE;
     deviceFeatures.depthBounds = m_vkGPU.m_vkPhysicalDevFeatures.depthBounds;
     deviceFeatures.fillModeNonSolid = VK_TRUE;
+    // compute mip map generation, see MipMapGenerator
+    deviceFeatures.shaderStorageImageReadWithoutFormat = m_vkGPU.m_vkPhysicalDevFeatures.shaderStorageImageReadWithoutFormat;
+    deviceFeatures.shaderStorageImageWriteWithoutFormat = m_vkGPU.m_vkPhysicalDevFeatures.shaderStorageImageWriteWithoutFormat;
+    deviceFeatures.shaderStorageImageArrayDynamicIndexing = m_vkGPU.m_vkPhysicalDevFeatures.shaderStorageImageArrayDynamicIndexing;
+
+    // the feature structures of the enabled extensions, chained to the create info
+    void* pNext = nullptr;
+
+    // bindless textures, see BindlessTextureTable
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {};
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (m_vkGPU.IsBindlessSupported())
+    {
+        enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+        enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+        deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+        descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        // not needed by the material path, useful to the shaders indexing by draw or instance
+        descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = m_vkGPU.m_vkDescriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+
+        descriptorIndexingFeatures.pNext = pNext;
+        pNext = &descriptorIndexingFeatures;
+    }
+
+    // cull, depth and stencil set while recording, see ApplyDynamicState
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = {};
+    extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    if (m_vkGPU.IsExtendedDynamicStateSupported())
+    {
+        enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+
+        extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+        extendedDynamicStateFeatures.pNext = pNext;
+        pNext = &extendedDynamicStateFeatures;
+    }
+
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Features = {};
+    extendedDynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+    if (m_vkGPU.IsExtendedDynamicState2Supported())
+    {
+        enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+
+        extendedDynamicState2Features.extendedDynamicState2 = VK_TRUE;
+        extendedDynamicState2Features.pNext = pNext;
+        pNext = &extendedDynamicState2Features;
+    }
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -517,6 +610,7 @@ ionBool RenderCore::CreateLogicalDeviceAndQueues()
     createInfo.pEnabledFeatures = &deviceFeatures;
     createInfo.enabledExtensionCount = (ionU32)enabledExtensions.size();
     createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+    createInfo.pNext = pNext;
 
 	ionVector<const char*, RenderCoreAllocator, GetAllocator> enabledLayers;
     if (m_vkValidationEnabled)
@@ -537,19 +631,68 @@ ionBool RenderCore::CreateLogicalDeviceAndQueues()
     vkGetDeviceQueue(m_vkDevice, m_vkGraphicsFamilyIndex, 0, &m_vkGraphicsQueue);
     vkGetDeviceQueue(m_vkDevice, m_vkPresentFamilyIndex, 0, &m_vkPresentQueue);
 
+    LoadExtendedDynamicState();
+
     return true;
 }
 
+void RenderCore::LoadExtendedDynamicState()
+{
+    memset(&m_dynamicStateFunctions, 0, sizeof(m_dynamicStateFunctions));
+    m_dynamicStateBits = 0;
+    m_useExtendedDynamicState = false;
+    m_useExtendedDynamicState2 = false;
+
+    if (!m_vkGPU.IsExtendedDynamicStateSupported())
+    {
+        return;
+    }
+
+    m_dynamicStateFunctions.m_setCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdSetCullModeEXT");
+    m_dynamicStateFunctions.m_setFrontFace = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdSetFrontFaceEXT");
+    m_dynamicStateFunctions.m_setDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdSetDepthTestEnableEXT");
+    m_dynamicStateFunctions.m_setDepthWriteEnable = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdSetDepthWriteEnableEXT");
+    m_dynamicStateFunctions.m_setDepthCompareOp = (PFN_vkCmdSetDepthCompareOpEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdSetDepthCompareOpEXT");
+    m_dynamicStateFunctions.m_setDepthBoundsTestEnable = (PFN_vkCmdSetDepthBoundsTestEnableEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdSetDepthBoundsTestEnableEXT");
+    m_dynamicStateFunctions.m_setStencilTestEnable = (PFN_vkCmdSetStencilTestEnableEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdSetStencilTestEnableEXT");
+    m_dynamicStateFunctions.m_setStencilOp = (PFN_vkCmdSetStencilOpEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdSetStencilOpEXT");
+
+    m_useExtendedDynamicState = m_dynamicStateFunctions.m_setCullMode != nullptr && m_dynamicStateFunctions.m_setFrontFace != nullptr &&
+        m_dynamicStateFunctions.m_setDepthTestEnable != nullptr && m_dynamicStateFunctions.m_setDepthWriteEnable != nullptr &&
+        m_dynamicStateFunctions.m_setDepthCompareOp != nullptr && m_dynamicStateFunctions.m_setDepthBoundsTestEnable != nullptr &&
+        m_dynamicStateFunctions.m_setStencilTestEnable != nullptr && m_dynamicStateFunctions.m_setStencilOp != nullptr;
+    ionAssertReturnVoid(m_useExtendedDynamicState, "Extended dynamic state entry points not found, the states stay in the pipelines");
+
+    m_dynamicStateBits = ECullingMode_Bits | ERasterization_View_Specular | ERasterization_Face_Clockwise |
+        EColorMask_Depth | EDepthFunction_Bits | ERasterization_DepthTest_Mask |
+        EStencilFrontFunction_Bits | EStencilBackFunction_Bits | EStencilOperator_Bits | EStencilBackOperator_Bits | EStencilFunctionReference_RefBits | EStencilFunctionReference_MaskBits;
+
+    if (m_vkGPU.IsExtendedDynamicState2Supported())
+    {
+        m_dynamicStateFunctions.m_setDepthBiasEnable = (PFN_vkCmdSetDepthBiasEnableEXT)vkGetDeviceProcAddr(m_vkDevice, "vkCmdSetDepthBiasEnableEXT");
+        m_useExtendedDynamicState2 = m_dynamicStateFunctions.m_setDepthBiasEnable != nullptr;
+        if (m_useExtendedDynamicState2)
+        {
+            m_dynamicStateBits |= ERasterization_PolygonMode_Offset;
+        }
+    }
+}
+
 ionBool RenderCore::CreateSemaphores()
 {
     VkSemaphoreCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkResult result = vkCreateSemaphore(m_vkDevice, &createInfo, vkMemory, &m_vkAcquiringSemaphore);
-    ionAssertReturnValue(result == VK_SUCCESS, "Cannot create semaphore for locking!", false);
+    m_vkAcquiringSemaphores.resize(m_framesInFlight, VK_NULL_HANDLE);
+    m_vkCompletedSemaphores.resize(m_framesInFlight, VK_NULL_HANDLE);
+    for (ionU32 i = 0; i < m_framesInFlight; ++i)
+    {
+        VkResult result = vkCreateSemaphore(m_vkDevice, &createInfo, vkMemory, &m_vkAcquiringSemaphores[i]);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create semaphore for locking!", false);
 
-    result = vkCreateSemaphore(m_vkDevice, &createInfo, vkMemory, &m_vkCompletedSemaphore);
-    ionAssertReturnValue(result == VK_SUCCESS, "Cannot create semaphore for unlocking!", false);
+        result = vkCreateSemaphore(m_vkDevice, &createInfo, vkMemory, &m_vkCompletedSemaphores[i]);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create semaphore for unlocking!", false);
+    }
     
     return true;
 }
@@ -641,6 +784,10 @@ ionBool RenderCore::CreateSwapChain()
 
     m_vkSwapchainViews.resize(m_swapChainImageCount, VK_NULL_HANDLE);
 
+    // the images of a new swapchain are not used by any frame
+    m_vkSwapchainImageFences.clear();
+    m_vkSwapchainImageFences.resize(m_swapChainImageCount, VK_NULL_HANDLE);
+
     for (ionU32 i = 0; i < m_swapChainImageCount; ++i)
     {
         VkImageViewCreateInfo createInfo = {};
@@ -686,24 +833,35 @@ void RenderCore::DestroySwapChain()
 
 ionBool RenderCore::CreateCommandBuffer()
 {
-    m_vkCommandBuffers.resize(m_swapChainImageCount, VK_NULL_HANDLE);
+    // a pool per frame, transient because it is reset every time the frame starts again
+    m_vkFrameCommandPools.resize(m_framesInFlight, VK_NULL_HANDLE);
+    m_vkCommandBuffers.resize(m_framesInFlight, VK_NULL_HANDLE);
+    for (ionU32 i = 0; i < m_framesInFlight; ++i)
     {
+        VkCommandPoolCreateInfo poolCreateInfo = {};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolCreateInfo.queueFamilyIndex = m_vkGraphicsFamilyIndex;
+
+        VkResult result = vkCreateCommandPool(m_vkDevice, &poolCreateInfo, vkMemory, &m_vkFrameCommandPools[i]);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create frame command pool!", false);
+
         VkCommandBufferAllocateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         createInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        createInfo.commandPool = m_vkCommandPool;
-        createInfo.commandBufferCount = m_swapChainImageCount;
+        createInfo.commandPool = m_vkFrameCommandPools[i];
+        createInfo.commandBufferCount = 1;
 
-        VkResult result = vkAllocateCommandBuffers(m_vkDevice, &createInfo, m_vkCommandBuffers.data());
+        result = vkAllocateCommandBuffers(m_vkDevice, &createInfo, &m_vkCommandBuffers[i]);
         ionAssertReturnValue(result == VK_SUCCESS, "Cannot create command buffer!", false);
     }
 
-    m_vkCommandBufferFences.resize(m_swapChainImageCount, VK_NULL_HANDLE);
+    m_vkCommandBufferFences.resize(m_framesInFlight, VK_NULL_HANDLE);
     {
         VkFenceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-        for (ionU32 i = 0; i < m_swapChainImageCount; ++i)
+        for (ionU32 i = 0; i < m_framesInFlight; ++i)
         {
             VkResult result = vkCreateFence(m_vkDevice, &createInfo, vkMemory, &m_vkCommandBufferFences[i]);
             ionAssertReturnValue(result == VK_SUCCESS, "Cannot create fence!", false);
@@ -1185,15 +1343,125 @@ ionBool RenderCore::CreateRenderPass(VkRenderPass& _vkRenderPass, EFramebufferLo
 
 ionBool RenderCore::CreatePipelineCache()
 {
+    // the driver data can be far bigger than the heap of the render core, so it is a temporary allocation
+    std::vector<ionU8> initialData;
+    const ionBool loaded = LoadPipelineCacheData(initialData);
+
     VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
     pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCreateInfo.initialDataSize = loaded ? initialData.size() : 0;
+    pipelineCacheCreateInfo.pInitialData = loaded ? initialData.data() : nullptr;
 
     VkResult result = vkCreatePipelineCache(m_vkDevice, &pipelineCacheCreateInfo, vkMemory, &m_vkPipelineCache);
+
+    // the driver can still reject the data, start from an empty cache in that case
+    if (result != VK_SUCCESS && loaded)
+    {
+        pipelineCacheCreateInfo.initialDataSize = 0;
+        pipelineCacheCreateInfo.pInitialData = nullptr;
+
+        result = vkCreatePipelineCache(m_vkDevice, &pipelineCacheCreateInfo, vkMemory, &m_vkPipelineCache);
+    }
+
     ionAssertReturnValue(result == VK_SUCCESS, "Cannot create pipeline cache!", false);
 
     return true;
 }
 
+ionBool RenderCore::LoadPipelineCacheData(std::vector<ionU8>& _outData) const
+{
+    _outData.clear();
+
+    const ionString path = ionFileSystemManager().GetCachePath() + ION_PIPELINE_CACHE_FILENAME;
+
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    const ionSize fileSize = static_cast<ionSize>(file.tellg());
+    if (fileSize < sizeof(PipelineCacheHeader))
+    {
+        return false;
+    }
+
+    file.seekg(0, std::ios::beg);
+
+    PipelineCacheHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(PipelineCacheHeader));
+
+    const VkPhysicalDeviceProperties& props = m_vkGPU.m_vkPhysicalDeviceProps;
+    if (header.m_magic != ION_PIPELINE_CACHE_MAGIC || header.m_version != ION_PIPELINE_CACHE_VERSION ||
+        header.m_vendorID != props.vendorID || header.m_deviceID != props.deviceID || header.m_driverVersion != props.driverVersion ||
+        memcmp(header.m_pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        return false;
+    }
+
+    if (header.m_dataSize == 0 || header.m_dataSize > ION_PIPELINE_CACHE_MAX_SIZE || fileSize != sizeof(PipelineCacheHeader) + header.m_dataSize)
+    {
+        return false;
+    }
+
+    const ionSize dataSize = static_cast<ionSize>(header.m_dataSize);
+    _outData.resize(dataSize);
+    file.read(reinterpret_cast<char*>(_outData.data()), static_cast<std::streamsize>(dataSize));
+
+    if (!file.good() || Tools::HashFNV1a64(_outData.data(), dataSize) != header.m_dataHash)
+    {
+        _outData.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void RenderCore::SavePipelineCache() const
+{
+    if (m_vkPipelineCache == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    size_t dataSize = 0;
+    VkResult result = vkGetPipelineCacheData(m_vkDevice, m_vkPipelineCache, &dataSize, nullptr);
+    if (result != VK_SUCCESS || dataSize == 0)
+    {
+        return;
+    }
+
+    // not saved, the file of the previous run stays as it is
+    if (dataSize > ION_PIPELINE_CACHE_MAX_SIZE)
+    {
+        return;
+    }
+
+    std::vector<ionU8> fileData(sizeof(PipelineCacheHeader) + dataSize);
+    ionU8* data = fileData.data() + sizeof(PipelineCacheHeader);
+
+    result = vkGetPipelineCacheData(m_vkDevice, m_vkPipelineCache, &dataSize, data);
+    if (result == VK_SUCCESS)
+    {
+        const VkPhysicalDeviceProperties& props = m_vkGPU.m_vkPhysicalDeviceProps;
+
+        PipelineCacheHeader header = {};
+        header.m_magic = ION_PIPELINE_CACHE_MAGIC;
+        header.m_version = ION_PIPELINE_CACHE_VERSION;
+        header.m_vendorID = props.vendorID;
+        header.m_deviceID = props.deviceID;
+        header.m_driverVersion = props.driverVersion;
+        MemUtils::MemCpy(header.m_pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+        header.m_dataSize = dataSize;
+        header.m_dataHash = Tools::HashFNV1a64(data, dataSize);
+
+        MemUtils::MemCpy(fileData.data(), &header, sizeof(PipelineCacheHeader));
+
+        const ionString path = ionFileSystemManager().GetCachePath() + ION_PIPELINE_CACHE_FILENAME;
+        ionFileSystemManager().WriteFileAtomic(path, fileData.data(), sizeof(PipelineCacheHeader) + dataSize);
+    }
+}
+
 ionBool RenderCore::CreateFrameBuffers(VkRenderPass _vkRenderPass, ionVector<VkFramebuffer, RenderCoreAllocator, GetAllocator>& _vkFrameBuffers)
 {
     VkImageView attachments[4] = {};
@@ -1263,14 +1531,19 @@ RenderCore::~RenderCore()
 {
     m_vkSwapchainViews.clear();
     m_vkSwapchainImages.clear();
+    m_vkSwapchainImageFences.clear();
     m_vkCommandBufferFences.clear();
     m_vkCommandBuffers.clear();
+    m_vkFrameCommandPools.clear();
+    m_vkAcquiringSemaphores.clear();
+    m_vkCompletedSemaphores.clear();
 }
 
 void RenderCore::Clear()
 {
     // core context
     m_jointCacheHandler = 0;
+    memset(&m_surfaceParamSlots, 0, sizeof(m_surfaceParamSlots));
     m_vkGPU = GPU();
     m_vkDevice = VK_NULL_HANDLE;
     m_vkGraphicsFamilyIndex = -1;
@@ -1302,20 +1575,38 @@ void RenderCore::Clear()
     m_vkPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
     m_vkValidationEnabled = false;
 
-    m_vkAcquiringSemaphore = VK_NULL_HANDLE;
-    m_vkCompletedSemaphore = VK_NULL_HANDLE;
-
     m_vkSwapchainExtent.width = m_width;
     m_vkSwapchainExtent.height = m_height;
     m_vkSwapchainImages.clear();
     m_vkSwapchainViews.clear();
     m_currentSwapIndex = 0;
+    m_framesInFlight = ION_DEFAULT_FRAMES_IN_FLIGHT;
+    m_currentFrameIndex = 0;
 
+    m_vkFrameCommandPools.clear();
     m_vkCommandBuffers.clear();
     m_vkCommandBufferFences.clear();
+    m_vkAcquiringSemaphores.clear();
+    m_vkCompletedSemaphores.clear();
+    m_vkSwapchainImageFences.clear();
+
+    memset(&m_dynamicStateFunctions, 0, sizeof(m_dynamicStateFunctions));
+    m_dynamicStateBits = 0;
+    m_useExtendedDynamicState = false;
+    m_useExtendedDynamicState2 = false;
+    m_appliedStateBits = 0;
+    m_appliedStateCommandBuffer = VK_NULL_HANDLE;
+
+    m_depthValues.m_biasConstant = 0.0f;
+    m_depthValues.m_biasSlope = 0.0f;
+    m_depthValues.m_boundsMin = 0.0f;
+    m_depthValues.m_boundsMax = 1.0f;
+
+    m_secondaryCommandBuffers.clear();
+    m_parallelRecording = true;
 }
 
-ionBool RenderCore::Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU32 _height, ionBool _fullScreen, ionBool _enableValidationLayer)
+ionBool RenderCore::Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU32 _height, ionBool _fullScreen, ionBool _enableValidationLayer, ionU32 _framesInFlight /*= ION_DEFAULT_FRAMES_IN_FLIGHT*/)
 {
     // this prevent a odd crash due steam validation layer
     _putenv("DISABLE_VK_LAYER_VALVE_steam_overlay_1=1");
@@ -1329,6 +1620,9 @@ ionBool RenderCore::Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU3
     m_height = _height;
     m_vkFullScreen = _fullScreen;
 
+    ionAssert(_framesInFlight > 0 && _framesInFlight <= ION_MAX_FRAMES_IN_FLIGHT, "Frames in flight must be between 1 and " << ION_MAX_FRAMES_IN_FLIGHT);
+    m_framesInFlight = std::min(std::max(_framesInFlight, 1u), static_cast<ionU32>(ION_MAX_FRAMES_IN_FLIGHT));
+
     if (!CreateInstance(_enableValidationLayer))
     {
         return false;
@@ -1389,6 +1683,12 @@ ionBool RenderCore::Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU3
         return false;
     }
 
+    // the render thread records a chunk too
+    if (!m_commandRecorder.Init(*this, std::max(1u, std::thread::hardware_concurrency())))
+    {
+        return false;
+    }
+
     if (!CreateRenderTargets())
     {
         return false;
@@ -1399,13 +1699,31 @@ ionBool RenderCore::Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU3
         return false;
     }
  
-    ionShaderProgramManager().Init(m_vkDevice);
+    ionShaderProgramManager().Init(m_vkDevice, m_framesInFlight, m_vkGPU.m_vkPhysicalDeviceProps.limits.maxPushConstantsSize);
+
+    // the scene parameters before any program is linked, to let the programs share the blocks made only of them
+    m_surfaceParamSlots.m_viewMatrix = ionShaderProgramManager().GetSceneRenderParamSlot(ION_VIEW_MATRIX_PARAM_HASH, EBufferParameterType_Matrix);
+    m_surfaceParamSlots.m_projectionMatrix = ionShaderProgramManager().GetSceneRenderParamSlot(ION_PROJ_MATRIX_PARAM_HASH, EBufferParameterType_Matrix);
+    m_surfaceParamSlots.m_modelMatrix = ionShaderProgramManager().GetRenderParamSlot(ION_MODEL_MATRIX_PARAM_HASH, EBufferParameterType_Matrix);
+    m_surfaceParamSlots.m_mainCameraPos = ionShaderProgramManager().GetSceneRenderParamSlot(ION_MAIN_CAMERA_POSITION_VECTOR_PARAM_HASH, EBufferParameterType_Vector);
+    m_surfaceParamSlots.m_directionalLight = ionShaderProgramManager().GetSceneRenderParamSlot(ION_DIRECTIONAL_LIGHT_DIR_VECTOR_PARAM_HASH, EBufferParameterType_Vector);
+    m_surfaceParamSlots.m_directionalLightColor = ionShaderProgramManager().GetSceneRenderParamSlot(ION_DIRECTIONAL_LIGHT_COL_VECTOR_PARAM_HASH, EBufferParameterType_Vector);
+    for (ionU32 i = 0; i < ION_SH_COEFFICIENTS_COUNT; ++i)
+    {
+        // the same name of the array elements of ShaderProgramManager::SetRenderParamsVector
+        const ionSize elementHash = static_cast<ionSize>(Tools::HashNameIndex(ION_IRRADIANCE_SH_VECTOR_ARRAY_PARAM_HASH, i));
+        m_surfaceParamSlots.m_irradianceSH[i] = ionShaderProgramManager().GetSceneRenderParamSlot(elementHash, EBufferParameterType_Vector);
+    }
+    m_surfaceParamSlots.m_exposure = ionShaderProgramManager().GetSceneRenderParamSlot(ION_EXPOSURE_FLOAT_PARAM_HASH, EBufferParameterType_Float);
+    m_surfaceParamSlots.m_gamma = ionShaderProgramManager().GetSceneRenderParamSlot(ION_GAMMA_FLOAT_PARAM_HASH, EBufferParameterType_Float);
+    m_surfaceParamSlots.m_prefilteredCubeMipLevels = ionShaderProgramManager().GetSceneRenderParamSlot(ION_PREFILTERED_CUBE_MIP_LEVELS_FLOAT_PARAM_HASH, EBufferParameterType_Float);
+    m_surfaceParamSlots.m_useIrradianceSH = ionShaderProgramManager().GetSceneRenderParamSlot(ION_USE_IRRADIANCE_SH_FLOAT_PARAM_HASH, EBufferParameterType_Float);
 
     ionVertexCacheManager().Init(m_vkDevice, m_vkGPU.m_vkPhysicalDeviceProps.limits.minUniformBufferOffsetAlignment);
 
-    ionMaterialManger().Init();
+    ionMaterialManger().Init(m_vkDevice);
 
-    ionTextureManger().Init(m_vkDevice, ETextureSamplesPerBit_16);
+    ionTextureManger().Init(m_vkGPU.m_vkPhysicalDevice, m_vkDevice, m_vkGraphicsFamilyIndex, ETextureSamplesPerBit_16, m_vkGPU.GetBindlessTextureLimit());
 
     return true;
 }
@@ -1414,6 +1732,9 @@ void RenderCore::DestroyRenderPass(VkRenderPass _renderPass)
 {
     if (_renderPass != VK_NULL_HANDLE)
     {
+        // a queued pipeline can still be created with it
+        ionShaderProgramManager().WaitPipelineCompilation();
+
         vkDestroyRenderPass(m_vkDevice, _renderPass, vkMemory);
     }
 }
@@ -1421,7 +1742,16 @@ void RenderCore::DestroyRenderPass(VkRenderPass _renderPass)
 void RenderCore::DestroyCommandBuffers()
 {
     vkDeviceWaitIdle(m_vkDevice);
-    vkFreeCommandBuffers(m_vkDevice, m_vkCommandPool, static_cast<ionU32>(m_vkCommandBuffers.size()), m_vkCommandBuffers.data());
+
+    const ionU32 count = static_cast<ionU32>(m_vkCommandBuffers.size());
+    for (ionU32 i = 0; i < count; ++i)
+    {
+        if (m_vkCommandBuffers[i] != VK_NULL_HANDLE)
+        {
+            vkFreeCommandBuffers(m_vkDevice, m_vkFrameCommandPools[i], 1, &m_vkCommandBuffers[i]);
+            m_vkCommandBuffers[i] = VK_NULL_HANDLE;
+        }
+    }
 }
 
 void RenderCore::Shutdown()
@@ -1438,6 +1768,7 @@ void RenderCore::Shutdown()
 
     if (m_vkPipelineCache != VK_NULL_HANDLE)
     {
+        SavePipelineCache();
         vkDestroyPipelineCache(m_vkDevice, m_vkPipelineCache, vkMemory);
     }
 
@@ -1445,30 +1776,34 @@ void RenderCore::Shutdown()
 
     DestroySwapChain();
 
-    for (ionU32 i = 0; i < m_swapChainImageCount; ++i)
+    m_commandRecorder.Shutdown();
+    m_secondaryCommandBuffers.clear();
+
+    // destroying the pools frees their command buffers
+    for (ionU32 i = 0; i < m_framesInFlight; ++i)
     {
         if (m_vkCommandBufferFences[i] != VK_NULL_HANDLE)
         {
             vkDestroyFence(m_vkDevice, m_vkCommandBufferFences[i], vkMemory);
         }
+        if (m_vkFrameCommandPools[i] != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(m_vkDevice, m_vkFrameCommandPools[i], vkMemory);
+        }
+        if (m_vkAcquiringSemaphores[i] != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(m_vkDevice, m_vkAcquiringSemaphores[i], vkMemory);
+        }
+        if (m_vkCompletedSemaphores[i] != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(m_vkDevice, m_vkCompletedSemaphores[i], vkMemory);
+        }
     }
 
-    //vkFreeCommandBuffers(m_vkDevice, m_vkCommandPool, static_cast<ionU32>(m_vkCommandBuffers->size()), m_vkCommandBuffers->data());
-
     if (m_vkCommandPool != VK_NULL_HANDLE)
     {
         vkDestroyCommandPool(m_vkDevice, m_vkCommandPool, vkMemory);
     }
-
-
-    if (m_vkAcquiringSemaphore != VK_NULL_HANDLE)
-    {
-        vkDestroySemaphore(m_vkDevice, m_vkAcquiringSemaphore, vkMemory);
-    }
-    if (m_vkCompletedSemaphore != VK_NULL_HANDLE)
-    {
-        vkDestroySemaphore(m_vkDevice, m_vkCompletedSemaphore, vkMemory);
-    }
     
     ionStagingBufferManager().Shutdown();
     ionGPUMemoryManager().Shutdown();
@@ -1502,6 +1837,8 @@ void RenderCore::Recreate()
 {
     vkDeviceWaitIdle(m_vkDevice);
 
+    // the pipelines compiled so far are reloaded by CreatePipelineCache below
+    SavePipelineCache();
     vkDestroyPipelineCache(m_vkDevice, m_vkPipelineCache, vkMemory);
 
     DestroyRenderTargets();
@@ -1514,18 +1851,8 @@ void RenderCore::Recreate()
     ionAssertReturnVoid(result == VK_SUCCESS, "Device surface changed and not supported!");
     ionAssertReturnVoid(supportsPresent == VK_TRUE, "New surface does not support present");
 
-    for (ionU32 i = 0; i < m_swapChainImageCount; ++i)
-    {
-        if (m_vkCommandBufferFences[i] != VK_NULL_HANDLE)
-        {
-            vkDestroyFence(m_vkDevice, m_vkCommandBufferFences[i], vkMemory);
-        }
-    }
-
-    vkFreeCommandBuffers(m_vkDevice, m_vkCommandPool, static_cast<ionU32>(m_vkCommandBuffers.size()), m_vkCommandBuffers.data());
-
+    // the per frame resources do not depend on the swapchain, the device is idle so they are all free
     CreateSwapChain();
-    CreateCommandBuffer();
     CreateRenderTargets();
     CreatePipelineCache();
 
@@ -1549,37 +1876,57 @@ void RenderCore::Recreate()
 
 EFrameStatus RenderCore::StartFrame()
 {
-    VkResult result = vkWaitForFences(m_vkDevice, 1, &m_vkCommandBufferFences[m_currentSwapIndex], VK_TRUE, UINT64_MAX);
+    // only wait for the frame which used these resources the last time: the ones after it are still rendering while this is recorded
+    m_currentFrameIndex = static_cast<ionU32>(m_counter % m_framesInFlight);
+
+    VkResult result = vkWaitForFences(m_vkDevice, 1, &m_vkCommandBufferFences[m_currentFrameIndex], VK_TRUE, UINT64_MAX);
     ionAssertReturnValue(result == VK_SUCCESS, "Wait for fences failed!", EFrameStatus_Error);
 
-    result = vkResetCommandBuffer(m_vkCommandBuffers[m_currentSwapIndex], VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
-    ionAssertReturnValue(result == VK_SUCCESS, "Reset command buffer failed!", EFrameStatus_Error);
+    result = vkResetCommandPool(m_vkDevice, m_vkFrameCommandPools[m_currentFrameIndex], 0);
+    ionAssertReturnValue(result == VK_SUCCESS, "Reset command pool failed!", EFrameStatus_Error);
+
+    if (!m_commandRecorder.StartFrame(m_currentFrameIndex))
+    {
+        return EFrameStatus_Error;
+    }
 
     ionStagingBufferManager().Submit();
-    ionShaderProgramManager().StartFrame();
+    ionShaderProgramManager().StartFrame(m_currentFrameIndex);
 
-    result = vkAcquireNextImageKHR(m_vkDevice, m_vkSwapchain, UINT64_MAX, m_vkAcquiringSemaphore, VK_NULL_HANDLE, &m_currentSwapIndex);
+    result = vkAcquireNextImageKHR(m_vkDevice, m_vkSwapchain, UINT64_MAX, m_vkAcquiringSemaphores[m_currentFrameIndex], VK_NULL_HANDLE, &m_currentSwapIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR) 
     {
         return EFrameStatus_NeedUpdate;
     }
     ionAssertReturnValue(result == VK_SUCCESS || result  == VK_SUBOPTIMAL_KHR, "vkAcquireNextImageKHR failed!", EFrameStatus_Error);
 
-    result = vkResetFences(m_vkDevice, 1, &m_vkCommandBufferFences[m_currentSwapIndex]);
+    // with more frames in flight than images an image can be acquired while an older frame is still rendering in it
+    VkFence& imageFence = m_vkSwapchainImageFences[m_currentSwapIndex];
+    if (imageFence != VK_NULL_HANDLE && imageFence != m_vkCommandBufferFences[m_currentFrameIndex])
+    {
+        result = vkWaitForFences(m_vkDevice, 1, &imageFence, VK_TRUE, UINT64_MAX);
+        ionAssertReturnValue(result == VK_SUCCESS, "Wait for fences failed!", EFrameStatus_Error);
+    }
+    imageFence = m_vkCommandBufferFences[m_currentFrameIndex];
+
+    result = vkResetFences(m_vkDevice, 1, &m_vkCommandBufferFences[m_currentFrameIndex]);
     ionAssertReturnValue(result == VK_SUCCESS, "Reset fences failed!", EFrameStatus_Error);
 
     
-    VkCommandBuffer commandBuffer = m_vkCommandBuffers[m_currentSwapIndex];
+    VkCommandBuffer commandBuffer = m_vkCommandBuffers[m_currentFrameIndex];
 
     VkCommandBufferBeginInfo commandBufferBeginInfo = {};
     commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
     ionAssertReturnValue(result == VK_SUCCESS, "vkBeginCommandBuffer failed!", EFrameStatus_Error);
 
+    // a new recording has no dynamic state
+    m_appliedStateCommandBuffer = VK_NULL_HANDLE;
+
     return EFrameStatus_Success;
 }
 
-void RenderCore::StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, VkCommandBuffer _commandBuffer, const ionVector<VkClearValue, RenderCoreAllocator, GetAllocator>& _clearValues, const VkRect2D& _renderArea)
+void RenderCore::StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, VkCommandBuffer _commandBuffer, const ionVector<VkClearValue, RenderCoreAllocator, GetAllocator>& _clearValues, const VkRect2D& _renderArea, VkSubpassContents _contents /*= VK_SUBPASS_CONTENTS_INLINE*/)
 {
     VkRenderPassBeginInfo renderPassBeginInfo = {};
     renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -1589,10 +1936,10 @@ void RenderCore::StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameB
     renderPassBeginInfo.clearValueCount = static_cast<ionU32>(_clearValues.size());
     renderPassBeginInfo.pClearValues = _clearValues.data();
 
-    vkCmdBeginRenderPass(_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(_commandBuffer, &renderPassBeginInfo, _contents);
 }
 
-void RenderCore::StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, ionFloat _clearDepthValue, ionU8 _clearStencilValue, ionFloat _clearRed, ionFloat _clearGreen, ionFloat _clearBlue, const VkRect2D& _renderArea)
+void RenderCore::StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, ionFloat _clearDepthValue, ionU8 _clearStencilValue, ionFloat _clearRed, ionFloat _clearGreen, ionFloat _clearBlue, const VkRect2D& _renderArea, VkSubpassContents _contents /*= VK_SUBPASS_CONTENTS_INLINE*/)
 {
     ionAssertReturnVoid(_clearDepthValue >= 0.0f && _clearDepthValue <= 1.0f, "Clear depth must be between 0 and 1!");
     ionAssertReturnVoid(_clearRed >= 0.0f && _clearRed <= 1.0f, "Clear red must be between 0 and 1!");
@@ -1614,7 +1961,7 @@ void RenderCore::StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameB
         clearValues[1].depthStencil = { _clearDepthValue, _clearStencilValue };
     }
 
-    StartRenderPass(_renderPass, _frameBuffer, m_vkCommandBuffers[m_currentSwapIndex], clearValues, _renderArea);
+    StartRenderPass(_renderPass, _frameBuffer, m_vkCommandBuffers[m_currentFrameIndex], clearValues, _renderArea, _contents);
 }
 
 void RenderCore::EndRenderPass(VkCommandBuffer _commandBuffer)
@@ -1624,12 +1971,12 @@ void RenderCore::EndRenderPass(VkCommandBuffer _commandBuffer)
 
 void RenderCore::EndRenderPass()
 {
-    EndRenderPass(m_vkCommandBuffers[m_currentSwapIndex]);
+    EndRenderPass(m_vkCommandBuffers[m_currentFrameIndex]);
 }
 
 EFrameStatus RenderCore::EndFrame()
 {
-    VkCommandBuffer commandBuffer = m_vkCommandBuffers[m_currentSwapIndex];
+    VkCommandBuffer commandBuffer = m_vkCommandBuffers[m_currentFrameIndex];
 
 
     // Transition our swap image to present.
@@ -1667,18 +2014,21 @@ EFrameStatus RenderCore::EndFrame()
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
     submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &m_vkAcquiringSemaphore;
+    submitInfo.pWaitSemaphores = &m_vkAcquiringSemaphores[m_currentFrameIndex];
     submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &m_vkCompletedSemaphore;
+    submitInfo.pSignalSemaphores = &m_vkCompletedSemaphores[m_currentFrameIndex];
     submitInfo.pWaitDstStageMask = &dstStageMask;
 
-    result = vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, m_vkCommandBufferFences[m_currentSwapIndex]);
+    result = vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, m_vkCommandBufferFences[m_currentFrameIndex]);
     ionAssertReturnValue(result == VK_SUCCESS, "vkQueueSubmit failed!", EFrameStatus_Error);
 
+    // submitted: the next frame uses the next resources, even if the present below asks to recreate the swapchain
+    ++m_counter;
+
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &m_vkCompletedSemaphore;
+    presentInfo.pWaitSemaphores = &m_vkCompletedSemaphores[m_currentFrameIndex];
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &m_vkSwapchain;
     presentInfo.pImageIndices = &m_currentSwapIndex;
@@ -1693,8 +2043,6 @@ EFrameStatus RenderCore::EndFrame()
         ionAssertReturnValue(false, "vkQueuePresentKHR failed!", EFrameStatus_Error);
     }
 
-    ++m_counter;
-
     return EFrameStatus_Success;
 }
 
@@ -1727,12 +2075,12 @@ void RenderCore::SetViewport(VkCommandBuffer _commandBuffer, const VkViewport& _
 
 void RenderCore::SetScissor(const VkRect2D& _scissor)
 {
-    SetScissor(m_vkCommandBuffers[m_currentSwapIndex], _scissor);
+    SetScissor(m_vkCommandBuffers[m_currentFrameIndex], _scissor);
 }
 
 void RenderCore::SetViewport(const VkViewport& _viewport)
 {
-    SetViewport(m_vkCommandBuffers[m_currentSwapIndex], _viewport);
+    SetViewport(m_vkCommandBuffers[m_currentFrameIndex], _viewport);
 }
 
 void RenderCore::SetScissor(VkCommandBuffer _commandBuffer, ionS32 _leftX, ionS32 _bottomY, ionU32 _width, ionU32 _height)
@@ -1759,17 +2107,19 @@ void RenderCore::SetViewport(VkCommandBuffer _commandBuffer, ionFloat _leftX, io
 
 void RenderCore::SetScissor(ionS32 _leftX, ionS32 _bottomY, ionU32 _width, ionU32 _height)
 {
-    SetScissor(m_vkCommandBuffers[m_currentSwapIndex], _leftX, _bottomY, _width, _height);
+    SetScissor(m_vkCommandBuffers[m_currentFrameIndex], _leftX, _bottomY, _width, _height);
 }
 
 void RenderCore::SetViewport(ionFloat _leftX, ionFloat _bottomY, ionFloat _width, ionFloat _height, ionFloat _minDepth, ionFloat _maxDepth)
 {
-    SetViewport(m_vkCommandBuffers[m_currentSwapIndex], _leftX, _bottomY, _width, _height, _minDepth, _maxDepth);
+    SetViewport(m_vkCommandBuffers[m_currentFrameIndex], _leftX, _bottomY, _width, _height, _minDepth, _maxDepth);
 }
 
 void RenderCore::SetPolygonOffset(ionFloat _scale, ionFloat _bias)
 {
-    vkCmdSetDepthBias(m_vkCommandBuffers[m_currentSwapIndex], _bias, 0.0f, _scale);
+    m_depthValues.m_biasConstant = _bias;
+    m_depthValues.m_biasSlope = _scale;
+    vkCmdSetDepthBias(m_vkCommandBuffers[m_currentFrameIndex], _bias, 0.0f, _scale);
 }
 
 void RenderCore::SetDepthBoundsTest(ionFloat _zMin, ionFloat _zMax)
@@ -1786,7 +2136,9 @@ void RenderCore::SetDepthBoundsTest(ionFloat _zMin, ionFloat _zMax)
     else 
     {
         m_stateBits |= ERasterization_DepthTest_Mask;
-        vkCmdSetDepthBounds(m_vkCommandBuffers[m_currentSwapIndex], _zMin, _zMax);
+        m_depthValues.m_boundsMin = _zMin;
+        m_depthValues.m_boundsMax = _zMax;
+        vkCmdSetDepthBounds(m_vkCommandBuffers[m_currentFrameIndex], _zMin, _zMax);
     }
 }
 
@@ -1925,10 +2277,144 @@ void RenderCore::CopyFrameBuffer(Texture* _texture)
     CopyFrameBuffer(_texture, m_vkSwapchainImages[m_currentSwapIndex]);
 }
 
+ionBool RenderCore::ReadbackTexture(const Texture* _texture, ionU8* _outBuffer, ionSize _outBufferSize, ionU32 _baseLevel /*= 0*/, ionU32 _levelCount /*= 0*/)
+{
+    ionAssertReturnValue(_texture != nullptr && _outBuffer != nullptr, "Invalid texture or buffer for readback!", false);
+    ionAssertReturnValue(_baseLevel < _texture->GetNumLevels(), "Readback level out of range!", false);
+
+    const ionU32 numLevels = _levelCount == 0 ? _texture->GetNumLevels() - _baseLevel : _levelCount;
+    const ionU32 numLayers = _texture->GetNumLayers();
+    const ionSize bytesPerPixel = Texture::BitsPerFormat(_texture->GetTextureFormat()) / 8;
+
+    ionAssertReturnValue(_baseLevel + numLevels <= _texture->GetNumLevels(), "Readback level out of range!", false);
+
+    ionSize size = 0;
+    for (ionU32 i = _baseLevel; i < _baseLevel + numLevels; ++i)
+    {
+        size += std::max(static_cast<ionU32>(_texture->GetWidth()) >> i, 1u) * std::max(static_cast<ionU32>(_texture->GetHeight()) >> i, 1u) * bytesPerPixel * numLayers;
+    }
+    ionAssertReturnValue(size > 0 && size <= _outBufferSize, "Readback buffer too small!", false);
+
+    VkBuffer readbackBuffer = VK_NULL_HANDLE;
+    GpuMemoryAllocation readbackAllocation;
+
+    {
+        VkBufferCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = size;
+        createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkResult result = vkCreateBuffer(m_vkDevice, &createInfo, vkMemory, &readbackBuffer);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create buffer for readback!", false);
+    }
+
+    {
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements(m_vkDevice, readbackBuffer, &memoryRequirements);
+
+        GpuMemoryCreateInfo createInfo = {};
+        createInfo.m_size = memoryRequirements.size;
+        createInfo.m_align = memoryRequirements.alignment;
+        createInfo.m_memoryTypeBits = memoryRequirements.memoryTypeBits;
+        createInfo.m_usage = EMemoryUsage_GPU_to_CPU;
+        createInfo.m_type = EGpuMemoryType_Buffer;
+
+        readbackAllocation = ionGPUMemoryManager().Alloc(createInfo);
+        if (readbackAllocation.m_result != VK_SUCCESS || readbackAllocation.m_mappedData == nullptr)
+        {
+            vkDestroyBuffer(m_vkDevice, readbackBuffer, vkMemory);
+            ionAssertReturnValue(false, "Cannot allocate host visible memory for readback!", false);
+        }
+
+        VkResult result = vkBindBufferMemory(m_vkDevice, readbackBuffer, readbackAllocation.m_memory, readbackAllocation.m_offset);
+        if (result != VK_SUCCESS)
+        {
+            vkDestroyBuffer(m_vkDevice, readbackBuffer, vkMemory);
+            ionGPUMemoryManager().Free(readbackAllocation);
+            ionAssertReturnValue(false, "Cannot bind the readback memory!", false);
+        }
+    }
+
+    VkCommandBuffer commandBuffer = CreateCustomCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    if (BeginCustomCommandBuffer(commandBuffer))
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = _texture->GetImage();
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = _baseLevel;
+        barrier.subresourceRange.levelCount = numLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = numLayers;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        // same layout used by Texture::UploadTextureLevels: level by level, all the layers of each level
+        ionVector<VkBufferImageCopy, RenderCoreAllocator, GetAllocator> regions;
+        regions.resize(numLevels);
+
+        VkDeviceSize offset = 0;
+        for (ionU32 i = 0; i < numLevels; ++i)
+        {
+            const ionU32 level = _baseLevel + i;
+            const ionU32 width = std::max(static_cast<ionU32>(_texture->GetWidth()) >> level, 1u);
+            const ionU32 height = std::max(static_cast<ionU32>(_texture->GetHeight()) >> level, 1u);
+
+            VkBufferImageCopy& region = regions[i];
+            region = {};
+            region.bufferOffset = offset;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = numLayers;
+            region.imageExtent.width = width;
+            region.imageExtent.height = height;
+            region.imageExtent.depth = 1;
+
+            offset += width * height * bytesPerPixel * numLayers;
+        }
+
+        vkCmdCopyImageToBuffer(commandBuffer, _texture->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, static_cast<ionU32>(regions.size()), regions.data());
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferMemoryBarrier bufferBarrier = {};
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = readbackBuffer;
+        bufferBarrier.offset = 0;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+        EndCustomCommandBuffer(commandBuffer);
+        FlushCustomCommandBuffer(commandBuffer);     // wait idle inside
+
+        MemUtils::MemCpy(_outBuffer, readbackAllocation.m_mappedData, size);
+    }
+
+    vkDestroyBuffer(m_vkDevice, readbackBuffer, vkMemory);
+    ionGPUMemoryManager().Free(readbackAllocation);
+
+    return true;
+}
+
 /*
 void RenderCore::CopyFrameBuffer(Texture* _texture, ionS32 _width, ionS32 _height)
 {
-    VkCommandBuffer commandBuffer = m_vkCommandBuffers[m_currentSwapIndex];
+    VkCommandBuffer commandBuffer = m_vkCommandBuffers[m_currentFrameIndex];
 
     vkCmdEndRenderPass(commandBuffer);
 
@@ -2009,51 +2495,148 @@ void RenderCore::CopyFrameBuffer(Texture* _texture, ionS32 _width, ionS32 _heigh
 }
 */
 
-void RenderCore::Draw(VkCommandBuffer _commandBuffer, VkRenderPass _renderPass, const DrawSurface& _surface)
+void RenderCore::SetSceneConstants(const SceneConstants& _constants)
+{
+    ionShaderProgramManager().SetRenderParamMatrixAt(m_surfaceParamSlots.m_viewMatrix, _constants.m_viewMatrix);
+    ionShaderProgramManager().SetRenderParamMatrixAt(m_surfaceParamSlots.m_projectionMatrix, _constants.m_projectionMatrix);
+    ionShaderProgramManager().SetRenderParamVectorAt(m_surfaceParamSlots.m_mainCameraPos, _constants.m_mainCameraPos);
+    ionShaderProgramManager().SetRenderParamVectorAt(m_surfaceParamSlots.m_directionalLight, _constants.m_directionalLight);
+    ionShaderProgramManager().SetRenderParamVectorAt(m_surfaceParamSlots.m_directionalLightColor, _constants.m_directionalLightColor);
+    for (ionU32 i = 0; i < ION_SH_COEFFICIENTS_COUNT; ++i)
+    {
+        ionShaderProgramManager().SetRenderParamVectorAt(m_surfaceParamSlots.m_irradianceSH[i], _constants.m_irradianceSH[i]);
+    }
+    ionShaderProgramManager().SetRenderParamFloatAt(m_surfaceParamSlots.m_exposure, _constants.m_exposure);
+    ionShaderProgramManager().SetRenderParamFloatAt(m_surfaceParamSlots.m_gamma, _constants.m_gamma);
+    ionShaderProgramManager().SetRenderParamFloatAt(m_surfaceParamSlots.m_prefilteredCubeMipLevels, _constants.m_prefilteredCubeMipLevels);
+    ionShaderProgramManager().SetRenderParamFloatAt(m_surfaceParamSlots.m_useIrradianceSH, _constants.m_useIrradianceSH);
+
+    // the blocks written for the previous camera are not valid anymore
+    ionShaderProgramManager().InvalidateSceneBlocks();
+}
+
+void RenderCore::Draw(VkCommandBuffer _commandBuffer, VkRenderPass _renderPass, const DrawSurface& _surface, ionBool _asyncPipeline /*= false*/)
 {
-    // THIS SHOULD BE PER SCENE 
-    ionShaderProgramManager().SetRenderParamMatrix(ION_VIEW_MATRIX_PARAM_HASH, _surface.m_viewMatrix);
-    ionShaderProgramManager().SetRenderParamMatrix(ION_PROJ_MATRIX_PARAM_HASH, _surface.m_projectionMatrix);
-    ionShaderProgramManager().SetRenderParamVector(ION_MAIN_CAMERA_POSITION_VECTOR_PARAM_HASH, _surface.m_mainCameraPos);
-    ionShaderProgramManager().SetRenderParamVector(ION_DIRECTIONAL_LIGHT_DIR_VECTOR_PARAM_HASH, _surface.m_directionalLight);
-    ionShaderProgramManager().SetRenderParamVector(ION_DIRECTIONAL_LIGHT_COL_VECTOR_PARAM_HASH, _surface.m_directionalLightColor);
-    ionShaderProgramManager().SetRenderParamFloat(ION_EXPOSURE_FLOAT_PARAM_HASH, _surface.m_exposure);
-    ionShaderProgramManager().SetRenderParamFloat(ION_GAMMA_FLOAT_PARAM_HASH, _surface.m_gamma);
-    ionShaderProgramManager().SetRenderParamFloat(ION_PREFILTERED_CUBE_MIP_LEVELS_FLOAT_PARAM_HASH, _surface.m_prefilteredCubeMipLevels);
+    DrawPacket packet;
+    if (!PrepareDraw(_renderPass, _surface, packet, _asyncPipeline))
+    {
+        return;
+    }
 
-    // THIS SHOULD BE PER OBJECT
-    ionShaderProgramManager().SetRenderParamMatrix(ION_MODEL_MATRIX_PARAM_HASH, _surface.m_modelMatrix);
+    ionBool stateApplied = m_appliedStateCommandBuffer == _commandBuffer;
+    if (!stateApplied)
+    {
+        RecordDepthValues(_commandBuffer, m_depthValues);
+    }
+    RecordDraw(_commandBuffer, packet, m_depthValues, m_appliedStateBits, stateApplied);
+    m_appliedStateCommandBuffer = _commandBuffer;
+}
 
+ionBool RenderCore::PrepareDraw(VkRenderPass _renderPass, const DrawSurface& _surface, DrawPacket& _outPacket, ionBool _asyncPipeline /*= false*/)
+{
+    // the scene parameters are set once per camera, see SetSceneConstants
     // ALL THE FOLLOWING SHOULD DONE PER MATERIAL
     const Material* material = _surface.m_material;
 
+    // per object: pushed after the commit, or through the uniform block for the shaders still reading it from there
+    if (!material->UseDrawConstants())
+    {
+        ionShaderProgramManager().SetRenderParamMatrixAt(m_surfaceParamSlots.m_modelMatrix, _surface.m_modelMatrix);
+    }
+
     //material->CustomDraw(_surface);
 
     const ionS32 shaderProgramIndex = ionShaderProgramManager().FindProgram(material);
     ionShaderProgramManager().BindProgram(shaderProgramIndex);
-    ionShaderProgramManager().CommitCurrent(*this, material, _renderPass, m_stateBits, _commandBuffer);
+    if (!ionShaderProgramManager().PrepareCurrent(*this, material, _renderPass, m_stateBits, _outPacket.m_commit, _asyncPipeline))
+    {
+        return false;
+    }
+
+    _outPacket.m_stateBits = m_stateBits;
 
-    ionSize indexOffset = 0;
-    ionSize vertexOffset = 0;
+    _outPacket.m_pushDrawConstants = material->UseDrawConstants();
+    if (_outPacket.m_pushDrawConstants)
+    {
+        _outPacket.m_drawConstants.m_modelMatrix = _surface.m_modelMatrix;
+        _outPacket.m_drawConstants.m_objectIndex = _surface.m_objectIndex;
+        _outPacket.m_drawConstants.m_materialIndex = material->GetConstantsSlot();
+        _outPacket.m_drawConstants.m_padding[0] = _outPacket.m_drawConstants.m_padding[1] = 0;
+    }
+
+    // the caches are resolved here, the recording does not access the vertex cache manager
+    _outPacket.m_indexBuffer = VK_NULL_HANDLE;
+    _outPacket.m_indexOffset = 0;
     IndexBuffer indexBuffer;
     if (ionVertexCacheManager().GetIndexBuffer(_surface.m_indexCache, &indexBuffer))
     {
-        const VkBuffer buffer = indexBuffer.GetObject();
-        const VkDeviceSize offset = indexBuffer.GetOffset();
-        indexOffset = offset;
-        vkCmdBindIndexBuffer(_commandBuffer, buffer, offset, VK_INDEX_TYPE_UINT32);
+        _outPacket.m_indexBuffer = indexBuffer.GetObject();
+        _outPacket.m_indexOffset = indexBuffer.GetOffset();
     }
 
+    _outPacket.m_vertexBuffer = VK_NULL_HANDLE;
+    _outPacket.m_vertexOffset = 0;
     VertexBuffer vertexBufer;
     if (ionVertexCacheManager().GetVertexBuffer(_surface.m_vertexCache, &vertexBufer))
     {
-        const VkBuffer buffer = vertexBufer.GetObject();
-        const VkDeviceSize offset = vertexBufer.GetOffset();
-        vertexOffset = offset;
-        vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &buffer, &offset);
+        _outPacket.m_vertexBuffer = vertexBufer.GetObject();
+        _outPacket.m_vertexOffset = vertexBufer.GetOffset();
     }
 
-    vkCmdDrawIndexed(_commandBuffer, _surface.m_indexCount, 1, _surface.m_indexStart /*(indexOffset >> 1)*/, 0 /*vertexOffset / sizeof(Vertex)*/, 0);
+    _outPacket.m_indexStart = _surface.m_indexStart;
+    _outPacket.m_indexCount = _surface.m_indexCount;
+
+    return true;
+}
+
+void RenderCore::RecordDraw(VkCommandBuffer _commandBuffer, const DrawPacket& _packet, const DepthValues& _depthValues, ionU64& _appliedStateBits, ionBool& _stateApplied) const
+{
+    ShaderProgramManager::RecordCommit(_commandBuffer, _packet.m_commit);
+
+    _appliedStateBits = RecordDynamicState(_commandBuffer, _packet.m_stateBits, _depthValues, _appliedStateBits, _stateApplied);
+    _stateApplied = true;
+
+    if (_packet.m_pushDrawConstants)
+    {
+        ShaderProgramManager::RecordDrawConstants(_commandBuffer, _packet.m_commit, _packet.m_drawConstants);
+    }
+
+    if (_packet.m_indexBuffer != VK_NULL_HANDLE)
+    {
+        vkCmdBindIndexBuffer(_commandBuffer, _packet.m_indexBuffer, _packet.m_indexOffset, VK_INDEX_TYPE_UINT32);
+    }
+
+    if (_packet.m_vertexBuffer != VK_NULL_HANDLE)
+    {
+        vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &_packet.m_vertexBuffer, &_packet.m_vertexOffset);
+    }
+
+    vkCmdDrawIndexed(_commandBuffer, _packet.m_indexCount, 1, _packet.m_indexStart /*(indexOffset >> 1)*/, 0 /*vertexOffset / sizeof(Vertex)*/, 0);
+}
+
+void RenderCore::ExecuteDrawPackets(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, const VkViewport& _viewport, const VkRect2D& _scissor, const DrawPacket* _packets, ionU32 _packetCount)
+{
+    m_secondaryCommandBuffers.clear();
+    if (!m_commandRecorder.Record(_renderPass, _frameBuffer, _viewport, _scissor, m_depthValues, _packets, _packetCount, m_secondaryCommandBuffers))
+    {
+        return;
+    }
+
+    if (!m_secondaryCommandBuffers.empty())
+    {
+        vkCmdExecuteCommands(m_vkCommandBuffers[m_currentFrameIndex], static_cast<ionU32>(m_secondaryCommandBuffers.size()), m_secondaryCommandBuffers.data());
+    }
+
+    // the dynamic state of the command buffer of the frame is undefined after the secondary command buffers
+    if (m_appliedStateCommandBuffer == m_vkCommandBuffers[m_currentFrameIndex])
+    {
+        m_appliedStateCommandBuffer = VK_NULL_HANDLE;
+    }
+}
+
+ionBool RenderCore::UseParallelRecording(ionSize _drawCount) const
+{
+    return m_parallelRecording && m_commandRecorder.GetThreadCount() > 1 && _drawCount >= ION_PARALLEL_RECORDING_MIN_DRAWS;
 }
 
 
@@ -2067,14 +2650,124 @@ void RenderCore::DrawNoBinding(VkCommandBuffer _commandBuffer, VkRenderPass _ren
     const ionS32 shaderProgramIndex = ionShaderProgramManager().FindProgram(material);
 
     ionShaderProgramManager().BindProgram(shaderProgramIndex);
-    ionShaderProgramManager().CommitCurrent(*this, material, _renderPass, m_stateBits, _commandBuffer);
+    if (!ionShaderProgramManager().CommitCurrent(*this, material, _renderPass, m_stateBits, _commandBuffer))
+    {
+        return;
+    }
+    ApplyDynamicState(_commandBuffer);
 
     vkCmdDraw(_commandBuffer, _vertexCount, _instanceCount, _firstVertex, _firstInstance);
 }
 
+void RenderCore::ApplyDynamicState(VkCommandBuffer _commandBuffer)
+{
+    if (m_appliedStateCommandBuffer != _commandBuffer)
+    {
+        RecordDepthValues(_commandBuffer, m_depthValues);
+    }
+
+    m_appliedStateBits = RecordDynamicState(_commandBuffer, m_stateBits, m_depthValues, m_appliedStateBits, m_appliedStateCommandBuffer == _commandBuffer);
+    m_appliedStateCommandBuffer = _commandBuffer;
+}
+
+ionU64 RenderCore::RecordDynamicState(VkCommandBuffer _commandBuffer, ionU64 _stateBits, const DepthValues& _depthValues, ionU64 _appliedStateBits, ionBool _stateApplied) const
+{
+    const ionBool depthBounds = m_vkGPU.m_vkPhysicalDevFeatures.depthBounds == VK_TRUE;
+
+    // Without the extended dynamic state the bounds and the bias are dynamic only in the pipelines enabling them and the bind of the other pipelines drops them,
+    // so they are set at every draw enabling them. Otherwise they are set once at the beginning of the command buffer, see RecordDepthValues
+    if (!m_useExtendedDynamicState && depthBounds && (_stateBits & ERasterization_DepthTest_Mask) != 0)
+    {
+        vkCmdSetDepthBounds(_commandBuffer, _depthValues.m_boundsMin, _depthValues.m_boundsMax);
+    }
+
+    if (!m_useExtendedDynamicState2 && (_stateBits & ERasterization_PolygonMode_Offset) != 0)
+    {
+        vkCmdSetDepthBias(_commandBuffer, _depthValues.m_biasConstant, 0.0f, _depthValues.m_biasSlope);
+    }
+
+    if (!m_useExtendedDynamicState)
+    {
+        return _appliedStateBits;
+    }
+
+    const ionU64 stateBits = _stateBits & m_dynamicStateBits;
+    const ionU64 changedBits = _stateApplied ? (stateBits ^ _appliedStateBits) : m_dynamicStateBits;
+    if (changedBits == 0)
+    {
+        return stateBits;
+    }
+
+    const VkPipelineDepthStencilStateCreateInfo depthStencilState = ShaderProgramHelper::GetDepthStencilState(stateBits, depthBounds);
+
+    if (changedBits & (ECullingMode_Bits | ERasterization_View_Specular))
+    {
+        m_dynamicStateFunctions.m_setCullMode(_commandBuffer, ShaderProgramHelper::GetCullMode(stateBits));
+    }
+
+    if (changedBits & ERasterization_Face_Clockwise)
+    {
+        m_dynamicStateFunctions.m_setFrontFace(_commandBuffer, ShaderProgramHelper::GetFrontFace(stateBits));
+    }
+
+    if (changedBits & EColorMask_Depth)
+    {
+        m_dynamicStateFunctions.m_setDepthTestEnable(_commandBuffer, depthStencilState.depthTestEnable);
+        m_dynamicStateFunctions.m_setDepthWriteEnable(_commandBuffer, depthStencilState.depthWriteEnable);
+    }
+
+    if (changedBits & EDepthFunction_Bits)
+    {
+        m_dynamicStateFunctions.m_setDepthCompareOp(_commandBuffer, depthStencilState.depthCompareOp);
+    }
+
+    if (depthBounds && (changedBits & ERasterization_DepthTest_Mask))
+    {
+        m_dynamicStateFunctions.m_setDepthBoundsTestEnable(_commandBuffer, depthStencilState.depthBoundsTestEnable);
+    }
+
+    if (changedBits & (EStencilFrontFunction_Bits | EStencilBackFunction_Bits | EStencilOperator_Bits | EStencilBackOperator_Bits))
+    {
+        m_dynamicStateFunctions.m_setStencilTestEnable(_commandBuffer, depthStencilState.stencilTestEnable);
+        m_dynamicStateFunctions.m_setStencilOp(_commandBuffer, VK_STENCIL_FACE_FRONT_BIT, depthStencilState.front.failOp, depthStencilState.front.passOp, depthStencilState.front.depthFailOp, depthStencilState.front.compareOp);
+        m_dynamicStateFunctions.m_setStencilOp(_commandBuffer, VK_STENCIL_FACE_BACK_BIT, depthStencilState.back.failOp, depthStencilState.back.passOp, depthStencilState.back.depthFailOp, depthStencilState.back.compareOp);
+    }
+
+    if (changedBits & EStencilFunctionReference_RefBits)
+    {
+        vkCmdSetStencilReference(_commandBuffer, VK_STENCIL_FACE_FRONT_AND_BACK, depthStencilState.front.reference);
+    }
+
+    if (changedBits & EStencilFunctionReference_MaskBits)
+    {
+        vkCmdSetStencilCompareMask(_commandBuffer, VK_STENCIL_FACE_FRONT_AND_BACK, depthStencilState.front.compareMask);
+    }
+
+    if (m_useExtendedDynamicState2 && (changedBits & ERasterization_PolygonMode_Offset))
+    {
+        m_dynamicStateFunctions.m_setDepthBiasEnable(_commandBuffer, (stateBits & ERasterization_PolygonMode_Offset) != 0);
+    }
+
+    return stateBits;
+}
+
+void RenderCore::RecordDepthValues(VkCommandBuffer _commandBuffer, const DepthValues& _depthValues) const
+{
+    if (m_useExtendedDynamicState && m_vkGPU.m_vkPhysicalDevFeatures.depthBounds == VK_TRUE)
+    {
+        vkCmdSetDepthBounds(_commandBuffer, _depthValues.m_boundsMin, _depthValues.m_boundsMax);
+    }
+
+    if (m_useExtendedDynamicState2)
+    {
+        vkCmdSetDepthBias(_commandBuffer, _depthValues.m_biasConstant, 0.0f, _depthValues.m_biasSlope);
+    }
+}
+
 void RenderCore::Draw(VkRenderPass _renderPass, const DrawSurface& _surface)
 {
-    Draw(m_vkCommandBuffers[m_currentSwapIndex], _renderPass, _surface);
+    // the draws of the frame do not wait for the pipelines
+    Draw(m_vkCommandBuffers[m_currentFrameIndex], _renderPass, _surface, true);
 }
 
 
@@ -2103,6 +2796,11 @@ ionBool RenderCore::BeginCustomCommandBuffer(VkCommandBuffer _commandBuffer)
     VkResult result = vkBeginCommandBuffer(_commandBuffer, &commandBufferBeginInfo);
     ionAssertReturnValue(result == VK_SUCCESS, "vkBeginCommandBuffer failed!", false);
 
+    if (m_appliedStateCommandBuffer == _commandBuffer)
+    {
+        m_appliedStateCommandBuffer = VK_NULL_HANDLE;
+    }
+
     return true;
 }
 
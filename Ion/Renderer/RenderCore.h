@@ -9,6 +9,8 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
 
+#include <vector>
+
 #include "../Dependencies/Eos/Eos/Eos.h"
 
 #include "../GPU/GpuDataStructure.h"
@@ -22,6 +24,7 @@
 #include "../Core/MemorySettings.h"
 
 #include "RenderCommon.h"
+#include "CommandRecorder.h"
 
 #include "GPU.h"
 
@@ -41,7 +44,7 @@ public:
     RenderCore();
     ~RenderCore();
 
-    ionBool Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU32 _height, ionBool _fullScreen, ionBool _enableValidationLayer);
+    ionBool Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU32 _height, ionBool _fullScreen, ionBool _enableValidationLayer, ionU32 _framesInFlight = ION_DEFAULT_FRAMES_IN_FLIGHT);
     void    Shutdown();
     void    DestroyCommandBuffers();
     void    Recreate();
@@ -49,7 +52,7 @@ public:
 
     EFrameStatus StartFrame();
     EFrameStatus EndFrame();
-    void    StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, ionFloat _clearDepthValue, ionU8 _clearStencilValue, ionFloat _clearRed, ionFloat _clearGreen, ionFloat _clearBlue, const VkRect2D& _renderArea);
+    void    StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, ionFloat _clearDepthValue, ionU8 _clearStencilValue, ionFloat _clearRed, ionFloat _clearGreen, ionFloat _clearBlue, const VkRect2D& _renderArea, VkSubpassContents _contents = VK_SUBPASS_CONTENTS_INLINE);
     void    EndRenderPass();
     void    SetDefaultState();
     void    SetState(ionU64 _stateBits);
@@ -61,6 +64,8 @@ public:
     void    SetDepthBoundsTest(ionFloat _zMin, ionFloat _zMax);
     void    CopyFrameBuffer(Texture* _texture, VkImage _srcImage);
     void    CopyFrameBuffer(Texture* _texture);
+    // Copy back to the host the levels (all of them if _levelCount is 0) and all the layers of the texture (which has to be in VK_IMAGE_LAYOUT_GENERAL), blocking call
+    ionBool ReadbackTexture(const Texture* _texture, ionU8* _outBuffer, ionSize _outBufferSize, ionU32 _baseLevel = 0, ionU32 _levelCount = 0);
     void    Draw(VkRenderPass _renderPass, const DrawSurface& _surface);
     
     //////////////////////////////////////////////////////////////////////////
@@ -71,13 +76,31 @@ public:
     void EndCustomCommandBuffer(VkCommandBuffer _commandBuffer);
     void FlushCustomCommandBuffer(VkCommandBuffer _commandBuffer);
 
-    void Draw(VkCommandBuffer _commandBuffer, VkRenderPass _renderPass, const DrawSurface& _surface);
+    // Once per camera before its draws: the uniform blocks made only of these are written once and shared by all the draws with their dynamic offset
+    void SetSceneConstants(const SceneConstants& _constants);
+
+    // _asyncPipeline: a pipeline not created yet does not stall, see ShaderProgramManager::CommitCurrent. Not for the one shot passes!
+    void Draw(VkCommandBuffer _commandBuffer, VkRenderPass _renderPass, const DrawSurface& _surface, ionBool _asyncPipeline = false);
     void DrawNoBinding(VkCommandBuffer _commandBuffer, VkRenderPass _renderPass, const DrawSurface& _surface, ionU32 _vertexCount, ionU32 _instanceCount, ionU32 _firstVertex, ionU32 _firstInstance);
 
+    // The draws of a render pass recorded in parallel: prepared in order on the render thread, which writes the uniform blocks and the descriptor sets,
+    // then recorded in secondary command buffers by the command recorder and executed in the same order by the command buffer of the frame.
+    // The render pass has to be started with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, see SceneGraph::Render
+    ionBool PrepareDraw(VkRenderPass _renderPass, const DrawSurface& _surface, DrawPacket& _outPacket, ionBool _asyncPipeline = false);
+    void    ExecuteDrawPackets(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, const VkViewport& _viewport, const VkRect2D& _scissor, const DrawPacket* _packets, ionU32 _packetCount);
+
+    // Thread safe. _appliedStateBits and _stateApplied are the dynamic state set in the command buffer, _stateApplied false at the beginning of its recording
+    void    RecordDraw(VkCommandBuffer _commandBuffer, const DrawPacket& _packet, const DepthValues& _depthValues, ionU64& _appliedStateBits, ionBool& _stateApplied) const;
+
+    // false below ION_PARALLEL_RECORDING_MIN_DRAWS or without more recording threads
+    ionBool UseParallelRecording(ionSize _drawCount) const;
+    void    SetParallelRecording(ionBool _enable) { m_parallelRecording = _enable; }
+    ionBool IsParallelRecording() const { return m_parallelRecording; }
+
     VkRenderPass CreateTexturedRenderPass(Texture* _texture, VkImageLayout _finalLayout);
     VkFramebuffer CreateTexturedFrameBuffer(VkRenderPass _renderPass, Texture* _texture);
 
-    void StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, VkCommandBuffer _commandBuffer, const ionVector<VkClearValue, RenderCoreAllocator, GetAllocator>& _clearValues, const VkRect2D& _renderArea);
+    void StartRenderPass(VkRenderPass _renderPass, VkFramebuffer _frameBuffer, VkCommandBuffer _commandBuffer, const ionVector<VkClearValue, RenderCoreAllocator, GetAllocator>& _clearValues, const VkRect2D& _renderArea, VkSubpassContents _contents = VK_SUBPASS_CONTENTS_INLINE);
     void EndRenderPass(VkCommandBuffer _commandBuffer);
 
     void SetScissor(VkCommandBuffer _commandBuffer, const VkRect2D& _scissor);
@@ -105,6 +128,10 @@ public:
 
     ionU32 GetCurrentSwapIndex() const { return m_currentSwapIndex; }
 
+    // the per frame resources (command buffer, uniform range) are the ones of the current frame index, not of the swapchain image
+    ionU32 GetFramesInFlight() const { return m_framesInFlight; }
+    ionU32 GetCurrentFrameIndex() const { return m_currentFrameIndex; }
+
     ionS32 GetGraphicFamilyIndex() const { return m_vkGraphicsFamilyIndex; }
     ionS32 GetPresentFamilyIndex() const { return m_vkPresentFamilyIndex; }
 
@@ -112,6 +139,14 @@ public:
     const VkSampleCountFlagBits& GetSampleCount() const { return m_vkSampleCount; }
     ionBool GetUsesSuperSampling() const { return m_vkSupersampling; }
     const VkPipelineCache& GetPipelineCache() const { return m_vkPipelineCache; }
+    ionU64 GetStateBits() const { return m_stateBits; }
+
+    // The state bits set while recording (VK_EXT_extended_dynamic_state) instead of baked in the pipelines, 0 without the extension.
+    // They are not part of the pipeline key, so the draws differing only by cull, depth or stencil share the same pipeline.
+    ionU64 GetDynamicStateBits() const { return m_dynamicStateBits; }
+    ionU64 GetPipelineStateBits(ionU64 _stateBits) const { return _stateBits & ~m_dynamicStateBits; }
+    ionBool UseExtendedDynamicState() const { return m_useExtendedDynamicState; }
+    ionBool UseExtendedDynamicState2() const { return m_useExtendedDynamicState2; }
 
     const VertexCacheHandler& GetJointCacheHandler() const { return m_jointCacheHandler; }
 
@@ -147,12 +182,25 @@ private:
     ionBool CreateRenderTargets();
     void    DestroyRenderTargets();
     ionBool CreatePipelineCache();
+    // the pipeline cache is saved in the cache folder and reloaded only on the same GPU and driver
+    ionBool LoadPipelineCacheData(std::vector<ionU8>& _outData) const;
+    void    SavePipelineCache() const;
 
     void    CreateDebugReport(const VkDebugReportCallbackCreateInfoEXT& createInfo);
     void    DestroyDebugReport();
 	void    CreateDebugUtilMessanger(const VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 	void    DestroyDebugUtilMessanger();
 
+    // VK_EXT_extended_dynamic_state entry points, after the creation of the device
+    void    LoadExtendedDynamicState();
+
+    // after the commit of the draw, only the dynamic state changed since the previous draw of the same command buffer
+    void    ApplyDynamicState(VkCommandBuffer _commandBuffer);
+    // return the dynamic state bits set in the command buffer after the draw
+    ionU64  RecordDynamicState(VkCommandBuffer _commandBuffer, ionU64 _stateBits, const DepthValues& _depthValues, ionU64 _appliedStateBits, ionBool _stateApplied) const;
+    // at the beginning of a command buffer, the depth bias and bounds dynamic in every pipeline
+    void    RecordDepthValues(VkCommandBuffer _commandBuffer, const DepthValues& _depthValues) const;
+
 
 private:
     HINSTANCE                   m_instance;
@@ -172,8 +220,6 @@ private:
     VkFormat                    m_vkDepthFormat;
     VkPipelineCache             m_vkPipelineCache;
     VkDebugReportCallbackEXT    m_vkDebugCallback;
-    VkSemaphore                 m_vkAcquiringSemaphore;
-    VkSemaphore                 m_vkCompletedSemaphore;
 
 	// report message only
 	VkDebugUtilsMessengerEXT	m_debugUtilsMessenger;
@@ -190,19 +236,69 @@ private:
     VkImage                     m_vkDepthStencilImage;
     VkImageView                 m_vkDepthStencilImageView;
 
+    // per frame in flight, the pools are reset as a whole when the frame starts again
+    ionVector<VkCommandPool, RenderCoreAllocator, GetAllocator>    m_vkFrameCommandPools;
     ionVector<VkCommandBuffer, RenderCoreAllocator, GetAllocator>  m_vkCommandBuffers;
     ionVector<VkFence, RenderCoreAllocator, GetAllocator>          m_vkCommandBufferFences;
+    ionVector<VkSemaphore, RenderCoreAllocator, GetAllocator>      m_vkAcquiringSemaphores;
+    ionVector<VkSemaphore, RenderCoreAllocator, GetAllocator>      m_vkCompletedSemaphores;
+
+    // per swapchain image, the fence of the last frame rendered in it (VK_NULL_HANDLE if none)
+    ionVector<VkFence, RenderCoreAllocator, GetAllocator>          m_vkSwapchainImageFences;
     ionVector<VkImage, RenderCoreAllocator, GetAllocator>          m_vkSwapchainImages;
     ionVector<VkImageView, RenderCoreAllocator, GetAllocator>      m_vkSwapchainViews;
 
     VertexCacheHandler          m_jointCacheHandler;
 
+    // slots of the parameters set by every draw and by every camera, resolved once at the init
+    struct SurfaceParamSlots
+    {
+        ionU32                  m_viewMatrix;
+        ionU32                  m_projectionMatrix;
+        ionU32                  m_modelMatrix;
+        ionU32                  m_mainCameraPos;
+        ionU32                  m_directionalLight;
+        ionU32                  m_directionalLightColor;
+        ionU32                  m_irradianceSH[ION_SH_COEFFICIENTS_COUNT];
+        ionU32                  m_exposure;
+        ionU32                  m_gamma;
+        ionU32                  m_prefilteredCubeMipLevels;
+        ionU32                  m_useIrradianceSH;
+    };
+    SurfaceParamSlots           m_surfaceParamSlots;
+
     ionU64                      m_stateBits;
     ionU64                      m_microSeconds;
 
+    struct ExtendedDynamicStateFunctions
+    {
+        PFN_vkCmdSetCullModeEXT             m_setCullMode;
+        PFN_vkCmdSetFrontFaceEXT            m_setFrontFace;
+        PFN_vkCmdSetDepthTestEnableEXT      m_setDepthTestEnable;
+        PFN_vkCmdSetDepthWriteEnableEXT     m_setDepthWriteEnable;
+        PFN_vkCmdSetDepthCompareOpEXT       m_setDepthCompareOp;
+        PFN_vkCmdSetDepthBoundsTestEnableEXT m_setDepthBoundsTestEnable;
+        PFN_vkCmdSetStencilTestEnableEXT    m_setStencilTestEnable;
+        PFN_vkCmdSetStencilOpEXT            m_setStencilOp;
+        PFN_vkCmdSetDepthBiasEnableEXT      m_setDepthBiasEnable;
+    };
+    ExtendedDynamicStateFunctions m_dynamicStateFunctions;
+    ionU64                      m_dynamicStateBits;
+    ionBool                     m_useExtendedDynamicState;
+    ionBool                     m_useExtendedDynamicState2;
+    ionU64                      m_appliedStateBits;         // of m_appliedStateCommandBuffer
+    DepthValues                 m_depthValues;              // set again in every command buffer, see RecordDynamicState
+    VkCommandBuffer             m_appliedStateCommandBuffer;
+
+    CommandRecorder             m_commandRecorder;
+    ionVector<VkCommandBuffer, CommandRecorderAllocator, CommandRecorder::GetAllocator>  m_secondaryCommandBuffers;     // of the last ExecuteDrawPackets
+    ionBool                     m_parallelRecording;
+
     ionU64                      m_counter;
     ionU32                      m_swapChainImageCount;
     ionU32                      m_currentSwapIndex;
+    ionU32                      m_framesInFlight;
+    ionU32                      m_currentFrameIndex;
 
     ionU32                      m_width;
     ionU32                      m_height;
@@ -8,9 +8,20 @@
 #define ION_FRAME_ALLOC_ALIGNMENT                   128
 #define ION_RENDER_QUERY_POOL                       16
 
+// frames recorded by the CPU while the GPU is still rendering the previous ones, not tied to the count of the swapchain images.
+// The resources released at runtime wait 4 frames before being destroyed, so they must stay more than the ones in flight
+#define ION_DEFAULT_FRAMES_IN_FLIGHT                2
+#define ION_MAX_FRAMES_IN_FLIGHT                    3
+
+// threads recording the draws of a render pass in secondary command buffers, the render thread included.
+// Below the min draws the cost of the secondary command buffers is higher than the one of the recording
+#define ION_MAX_RECORDING_THREADS                   8
+#define ION_PARALLEL_RECORDING_MIN_DRAWS            512
+
 #define ION_MAX_DESCRIPTOR_SETS                     16384
 #define ION_MAX_DESCRIPTOR_UNIFORM_BUFFERS          8192
 #define ION_MAX_DESCRIPTOR_IMAGE_SAMPLERS           12384
+#define ION_MAX_DESCRIPTOR_STORAGE_BUFFERS          1024
 #define ION_MAX_DESCRIPTOR_SET_WRITES               32
 #define ION_MAX_DESCRIPTOR_SET_UNIFORMS             48
 #define ION_MAX_IMAGE_PARMAMETERS                   16
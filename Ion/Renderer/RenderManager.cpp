@@ -26,6 +26,8 @@
 
 #include "../Material/MaterialManager.h"
 
+#include "../Utilities/Tools.h"
+
 
 #define ION_BRDFLUT_TEXTURENAME    "BRDFLUT"
 #define ION_BRDFLUT_SHADER_NAME    "GenerateBRDFLUT"
@@ -40,6 +42,13 @@
 #define ION_IRRADIANCE_FRAGMENT_SHADER_NAME                 "IrradianceCube"
 #define ION_PREFILTEREDENVIRONMENT_FRAGMENT_SHADER_NAME     "PrefilteredEnvironmentMap"
 
+// pushed to the irradiance generation shader, and part of its cache key
+#define ION_IRRADIANCE_DELTA_PHI    ((2.0f * NIX_PI) / 180.0f)
+#define ION_IRRADIANCE_DELTA_THETA  ((0.5f * NIX_PI) / 64.0f)
+
+#define ION_IBL_CACHE_VERSION       2
+#define ION_IBL_CACHE_EXTENSION     ".ibl"
+
 //#define SHADOW_MAP_SIZE                    1024
 
 #define ION_CACHE_LINE_SIZE        128
@@ -63,11 +72,16 @@ RenderManagerAllocator* RenderManager::GetAllocator()
 	return &memoryAllocator;
 }
 
-RenderManager::RenderManager() : m_deltaTime(ION_FPS_LIMIT), m_running(false)
+RenderManager::RenderManager() : m_deltaTime(ION_FPS_LIMIT), m_running(false), m_iblCacheEnabled(true), m_useIrradianceSH(false)
 {
     m_exposure = 4.5f;
     m_gamma = 2.2f;
     m_prefilteredCubeMipLevels = 32.0f;
+
+    for (ionU32 i = 0; i < ION_SH_COEFFICIENTS_COUNT; ++i)
+    {
+        m_irradianceSH[i] = MathFunctions::Splat(0.0f);
+    }
 }
 
 RenderManager::~RenderManager()
@@ -75,9 +89,9 @@ RenderManager::~RenderManager()
 
 }
 
-ionBool RenderManager::Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU32 _height, ionBool _fullScreen, ionBool _enableValidationLayer)
+ionBool RenderManager::Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU32 _height, ionBool _fullScreen, ionBool _enableValidationLayer, ionU32 _framesInFlight /*= ION_DEFAULT_FRAMES_IN_FLIGHT*/)
 {
-    if (m_renderCore.Init(_instance, _handle, _width, _height, _fullScreen, _enableValidationLayer))
+    if (m_renderCore.Init(_instance, _handle, _width, _height, _fullScreen, _enableValidationLayer, _framesInFlight))
     {
         m_running = true;
         return true;
@@ -306,6 +320,9 @@ void RenderManager::Recreate()
 {
     m_renderCore.Recreate();
     m_sceneGraph.UpdateAllCameraAspectRatio(m_renderCore);
+
+    // the programs and the render passes are new, warm them again instead of stalling the next frame
+    m_sceneGraph.PrewarmPipelines(m_renderCore);
 }
 
 void RenderManager::Resize(ionS32& _outNewWidth, ionS32 _outNewHeight)
@@ -323,7 +340,9 @@ void RenderManager::PrepareToShutDown()
 
 void RenderManager::Begin()
 {
+    m_sceneGraph.SetScreenHeight(m_renderCore.GetHeight());
     m_sceneGraph.Begin();
+    m_sceneGraph.PrewarmPipelines(m_renderCore);
 }
 
 void RenderManager::End()
@@ -356,6 +375,11 @@ void RenderManager::CoreLoop()
 void RenderManager::Update(ionFloat _deltaTime)
 {
     m_sceneGraph.Update(_deltaTime);
+
+    ionTextureManger().UpdateStreaming();
+    ionTextureManger().UpdateResidency();
+
+    ionMaterialManger().Update();
 }
 
 void RenderManager::Frame()
@@ -433,8 +457,92 @@ ionBool RenderManager::IsRunning()
     return m_running;
 }
 
+ionU64 RenderManager::ComputeIBLCacheKey(ionU64 _sourceHash, ionBool _environmentDependent, ionS32 _vertexShaderIndex, ionS32 _fragmentShaderIndex, ionU32 _size, ionU32 _numLevels, ETextureFormat _format, ETextureType _type, ionFloat _param0, ionFloat _param1) const
+{
+    if (_environmentDependent && _sourceHash == 0)
+    {
+        return 0;
+    }
+
+    struct IBLCacheParams
+    {
+        ionU64          m_sourceHash;
+        ionU64          m_shaderHash;
+        ionU32          m_version;
+        ionU32          m_size;
+        ionU32          m_numLevels;
+        ionU32          m_format;
+        ionU32          m_type;
+        ionFloat        m_param0;
+        ionFloat        m_param1;
+        ionU32          m_padding;
+    };
+
+    IBLCacheParams params = {};
+    params.m_sourceHash = _environmentDependent ? _sourceHash : 0;
+    // a changed generation shader does not reuse the maps of the previous one
+    const ionU64 shaderHashes[2] = { ionShaderProgramManager().GetShaderCodeHash(_vertexShaderIndex), ionShaderProgramManager().GetShaderCodeHash(_fragmentShaderIndex) };
+    params.m_shaderHash = Tools::HashFNV1a64(shaderHashes, sizeof(shaderHashes));
+    params.m_version = ION_IBL_CACHE_VERSION;
+    params.m_size = _size;
+    params.m_numLevels = _numLevels;
+    params.m_format = static_cast<ionU32>(_format);
+    params.m_type = static_cast<ionU32>(_type);
+    params.m_param0 = _param0;
+    params.m_param1 = _param1;
+
+    const ionU64 key = Tools::HashFNV1a64(&params, sizeof(params));
+    return key != 0 ? key : 1;
+}
+
+ionString RenderManager::GetIBLCachePath(const ionString& _name, ionU64 _key) const
+{
+    char hex[17];
+    sprintf_s(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(_key));
+
+    return ionFileSystemManager().GetCachePath() + _name + "_" + hex + ION_IBL_CACHE_EXTENSION;
+}
+
+const Texture* RenderManager::LoadIBLCache(const ionString& _name, ionU64 _key) const
+{
+    if (!m_iblCacheEnabled || _key == 0)
+    {
+        return nullptr;
+    }
+
+    return ionTextureManger().LoadTextureCache(_name, GetIBLCachePath(_name, _key), _key);
+}
+
+void RenderManager::SaveIBLCache(const ionString& _name, ionU64 _key, const Texture* _texture)
+{
+    if (!m_iblCacheEnabled || _key == 0 || _texture == nullptr)
+    {
+        return;
+    }
+
+    const ionSize size = _texture->GetLevelsSize();
+    ionU8* levels = static_cast<ionU8*>(ionNewRaw(size, Texture::GetAllocator()));
+
+    if (m_renderCore.ReadbackTexture(_texture, levels, size))
+    {
+        ionTextureManger().SaveTextureCache(GetIBLCachePath(_name, _key), _key, _texture, levels, size);
+    }
+
+    ionDeleteRaw(levels, Texture::GetAllocator());
+}
+
 const Texture* RenderManager::GenerateBRDF(Node* _camera)
 {
+    ionS32 vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_BRDFLUT_SHADER_NAME, EShaderStage_Vertex);
+    ionS32 fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_BRDFLUT_SHADER_NAME, EShaderStage_Fragment);
+
+    const ionU64 cacheKey = ComputeIBLCacheKey(0, false, vertexShaderIndex, fragmentShaderIndex, 512, 1, ETextureFormat_BRDF, ETextureType_2D, 0.0f, 0.0f);
+    const Texture* cached = LoadIBLCache(ION_BRDFLUT_TEXTURENAME, cacheKey);
+    if (cached != nullptr)
+    {
+        return cached;
+    }
+
     Texture* brdflut = ionTextureManger().GenerateTexture(ION_BRDFLUT_TEXTURENAME, 512, 512, ETextureFormat_BRDF, ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag_Linear, ETextureRepeat_Clamp);
 
 	Camera* cameraPtr = dynamic_cast<Camera*>(_camera);
@@ -448,9 +556,6 @@ const Texture* RenderManager::GenerateBRDF(Node* _camera)
     Material* material = ionMaterialManger().CreateMaterial(ION_BRDFLUT_TEXTURENAME);
     brdflutEntity->GetMesh(0)->SetMaterial(material);
 
-    ionS32 vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_BRDFLUT_SHADER_NAME, EShaderStage_Vertex);
-    ionS32 fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_BRDFLUT_SHADER_NAME, EShaderStage_Fragment);
-
     brdflutEntity->GetMesh(0)->GetMaterial()->SetVertexLayout(brdflutEntity->GetMeshRenderer()->GetLayout());
 
     brdflutEntity->GetMesh(0)->GetMaterial()->SetShaders(vertexShaderIndex, fragmentShaderIndex);
@@ -463,7 +568,7 @@ const Texture* RenderManager::GenerateBRDF(Node* _camera)
     VkCommandBuffer cmdBuffer = m_renderCore.CreateCustomCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
     ionStagingBufferManager().Submit();
-    ionShaderProgramManager().StartFrame();
+    ionShaderProgramManager().StartFrame(m_renderCore.GetCurrentFrameIndex());
 
     DrawSurface drawSurface;
     drawSurface.m_indexStart = brdflutEntity->GetMesh(0)->GetIndexStart();
@@ -485,8 +590,11 @@ const Texture* RenderManager::GenerateBRDF(Node* _camera)
 
 		cameraPtr->StartRenderPass(m_renderCore, renderPass, framebuffer, cmdBuffer, clearValues);
 
-        drawSurface.m_projectionMatrix = cameraPtr->GetPerspectiveProjection();
-        drawSurface.m_viewMatrix = cameraPtr->GetView();
+        SceneConstants sceneConstants;
+        sceneConstants.m_projectionMatrix = cameraPtr->GetPerspectiveProjection();
+        sceneConstants.m_viewMatrix = cameraPtr->GetView();
+        m_renderCore.SetSceneConstants(sceneConstants);
+
         drawSurface.m_modelMatrix = brdflutEntity->GetTransform().GetMatrixWS();
 
         m_renderCore.SetState(drawSurface.m_material->GetState().GetStateBits());
@@ -504,6 +612,8 @@ const Texture* RenderManager::GenerateBRDF(Node* _camera)
 
     ionShaderProgramManager().Restart();
 
+    SaveIBLCache(ION_BRDFLUT_TEXTURENAME, cacheKey, brdflut);
+
     return brdflut;
 }
 
@@ -516,6 +626,17 @@ const Texture* RenderManager::GenerateIrradianceCubemap(Node* _camera)
 {
 	const ionU32 mipMapsLevel = static_cast<ionU32>(std::floor(std::log2(512))) + 1;
 
+	const Texture* environment = dynamic_cast<Camera*>(_camera)->GetSkybox()->GetMaterial()->GetBasePBR().GetBaseColorTexture();
+	ionS32 vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_IRRADIANCE_PREFILTERED_VERTEX_SHADER_NAME, EShaderStage_Vertex);
+	ionS32 fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_IRRADIANCE_FRAGMENT_SHADER_NAME, EShaderStage_Fragment);
+
+	const ionU64 cacheKey = ComputeIBLCacheKey(environment->GetSourceHash(), true, vertexShaderIndex, fragmentShaderIndex, 512, mipMapsLevel, ETextureFormat_Irradiance, ETextureType_Cubic, ION_IRRADIANCE_DELTA_PHI, ION_IRRADIANCE_DELTA_THETA);
+	const Texture* cached = LoadIBLCache(ION_IRRADIANCE_TEXTURENAME, cacheKey);
+	if (cached != nullptr)
+	{
+		return cached;
+	}
+
 	Texture* irradiance = ionTextureManger().GenerateTexture(ION_IRRADIANCE_TEXTURENAME, 512, 512, ETextureFormat_Irradiance, ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag_Linear, ETextureRepeat_Clamp, ETextureType_Cubic, mipMapsLevel);
 	Texture* offscreen = ionTextureManger().GenerateTexture(ION_IRRADIANCE_TEXTURENAME_OFFSCREEN, 512, 512, ETextureFormat_Irradiance, ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag_Linear, ETextureRepeat_Clamp, ETextureType_2D);
 
@@ -575,8 +696,8 @@ const Texture* RenderManager::GenerateIrradianceCubemap(Node* _camera)
 	//
 	ConstantsBindingDef constants;
 	constants.m_shaderStages = EPushConstantStage::EPushConstantStage_Fragment;
-	constants.m_values.push_back((2.0f * NIX_PI) / 180.0f);
-	constants.m_values.push_back((0.5f * NIX_PI) / 64.0f);
+	constants.m_values.push_back(ION_IRRADIANCE_DELTA_PHI);
+	constants.m_values.push_back(ION_IRRADIANCE_DELTA_THETA);
 
 
 	ShaderLayoutDef vertexLayout;
@@ -588,9 +709,6 @@ const Texture* RenderManager::GenerateIrradianceCubemap(Node* _camera)
 	irradianceEntity->GetMesh(0)->GetMaterial()->SetVertexShaderLayout(vertexLayout);
 	irradianceEntity->GetMesh(0)->GetMaterial()->SetFragmentShaderLayout(fragmentLayout);
 
-	ionS32 vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_IRRADIANCE_PREFILTERED_VERTEX_SHADER_NAME, EShaderStage_Vertex);
-	ionS32 fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_IRRADIANCE_FRAGMENT_SHADER_NAME, EShaderStage_Fragment);
-
 	irradianceEntity->GetMesh(0)->GetMaterial()->SetConstantsShaders(constants);
 	irradianceEntity->GetMesh(0)->GetMaterial()->SetVertexLayout(irradianceEntity->GetMeshRenderer()->GetLayout());
 
@@ -606,7 +724,7 @@ const Texture* RenderManager::GenerateIrradianceCubemap(Node* _camera)
 	VkCommandBuffer cmdBuffer = m_renderCore.CreateCustomCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
 	ionStagingBufferManager().Submit();
-	ionShaderProgramManager().StartFrame();
+	ionShaderProgramManager().StartFrame(m_renderCore.GetCurrentFrameIndex());
 
 	DrawSurface drawSurface;
 	drawSurface.m_indexStart = irradianceEntity->GetMesh(0)->GetIndexStart();
@@ -666,8 +784,11 @@ const Texture* RenderManager::GenerateIrradianceCubemap(Node* _camera)
 
 				// draw irradiance
 				{
-					drawSurface.m_projectionMatrix = cameraPtr->GetPerspectiveProjection();
-					drawSurface.m_viewMatrix = cameraPtr->GetView();
+					SceneConstants sceneConstants;
+					sceneConstants.m_projectionMatrix = cameraPtr->GetPerspectiveProjection();
+					sceneConstants.m_viewMatrix = cameraPtr->GetView();
+					m_renderCore.SetSceneConstants(sceneConstants);
+
 					drawSurface.m_modelMatrix = irradianceEntity->GetTransform().GetMatrixWS();
 
 					m_renderCore.SetState(drawSurface.m_material->GetState().GetStateBits());
@@ -770,6 +891,8 @@ const Texture* RenderManager::GenerateIrradianceCubemap(Node* _camera)
 
 	ionShaderProgramManager().Restart();
 
+	SaveIBLCache(ION_IRRADIANCE_TEXTURENAME, cacheKey, irradiance);
+
 	return irradiance;
 }
 
@@ -778,10 +901,52 @@ const Texture* RenderManager::GetIrradianceCubemap() const
     return ionTextureManger().GetTexture(ION_IRRADIANCE_TEXTURENAME);
 }
 
+ionBool RenderManager::GenerateIrradianceSH(Node* _camera)
+{
+    const Texture* environment = dynamic_cast<Camera*>(_camera)->GetSkybox()->GetMaterial()->GetBasePBR().GetBaseColorTexture();
+    ionAssertReturnValue(environment != nullptr && environment->GetTextureType() == ETextureType_Cubic, "Spherical harmonics need a cube map environment!", false);
+
+    // the projection is low frequency, so a small level is more than enough and saves time and memory in the readback
+    static const ionU32 kMinProjectionSize = 64;
+    ionU32 level = 0;
+    while (level + 1 < environment->GetNumLevels() && (static_cast<ionU32>(environment->GetWidth()) >> (level + 1)) >= kMinProjectionSize)
+    {
+        ++level;
+    }
+
+    const ionU32 size = std::max(static_cast<ionU32>(environment->GetWidth()) >> level, 1u);
+    const ionSize levelSize = static_cast<ionSize>(size) * size * (Texture::BitsPerFormat(environment->GetTextureFormat()) / 8) * environment->GetNumLayers();
+
+    ionU8* faces = static_cast<ionU8*>(ionNewRaw(levelSize, Texture::GetAllocator()));
+
+    ionBool result = m_renderCore.ReadbackTexture(environment, faces, levelSize, level, 1);
+    if (result)
+    {
+        result = SphericalHarmonics::ProjectIrradiance(faces, size, environment->GetTextureFormat(), m_irradianceSH);
+    }
+
+    ionDeleteRaw(faces, Texture::GetAllocator());
+
+    m_useIrradianceSH = result;
+
+    return result;
+}
+
 const Texture* RenderManager::GeneratePrefilteredEnvironmentCubemap(Node* _camera)
 {
     const ionU32 mipMapsLevel = static_cast<ionU32>(std::floor(std::log2(1024))) + 1;
 
+    const Texture* environment = dynamic_cast<Camera*>(_camera)->GetSkybox()->GetMaterial()->GetBasePBR().GetBaseColorTexture();
+    ionS32 vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_IRRADIANCE_PREFILTERED_VERTEX_SHADER_NAME, EShaderStage_Vertex);
+    ionS32 fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_PREFILTEREDENVIRONMENT_FRAGMENT_SHADER_NAME, EShaderStage_Fragment);
+
+    const ionU64 cacheKey = ComputeIBLCacheKey(environment->GetSourceHash(), true, vertexShaderIndex, fragmentShaderIndex, 1024, mipMapsLevel, ETextureFormat_PrefilteredEnvironment, ETextureType_Cubic, m_prefilteredCubeMipLevels, 0.0f);
+    const Texture* cached = LoadIBLCache(ION_PREFILTEREDENVIRONMENT_TEXTURENAME, cacheKey);
+    if (cached != nullptr)
+    {
+        return cached;
+    }
+
     Texture* prefilteredEnvironment = ionTextureManger().GenerateTexture(ION_PREFILTEREDENVIRONMENT_TEXTURENAME, 1024, 1024, ETextureFormat_PrefilteredEnvironment, ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag_Linear, ETextureRepeat_Clamp, ETextureType_Cubic, mipMapsLevel);
     Texture* offscreen = ionTextureManger().GenerateTexture(ION_PREFILTEREDENVIRONMENT_TEXTURENAME_OFFSCREEN, 1024, 1024, ETextureFormat_PrefilteredEnvironment, ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag_Linear, ETextureRepeat_Clamp, ETextureType_2D);
 
@@ -859,9 +1024,6 @@ const Texture* RenderManager::GeneratePrefilteredEnvironmentCubemap(Node* _camer
     prefilteredEntity->GetMesh(0)->GetMaterial()->SetVertexShaderLayout(vertexLayout);
     prefilteredEntity->GetMesh(0)->GetMaterial()->SetFragmentShaderLayout(fragmentLayout);
 
-    ionS32 vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_IRRADIANCE_PREFILTERED_VERTEX_SHADER_NAME, EShaderStage_Vertex);
-    ionS32 fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_PREFILTEREDENVIRONMENT_FRAGMENT_SHADER_NAME, EShaderStage_Fragment);
-
     prefilteredEntity->GetMesh(0)->GetMaterial()->SetConstantsShaders(constants);
     prefilteredEntity->GetMesh(0)->GetMaterial()->SetVertexLayout(prefilteredEntity->GetMeshRenderer()->GetLayout());
 
@@ -877,7 +1039,7 @@ const Texture* RenderManager::GeneratePrefilteredEnvironmentCubemap(Node* _camer
     VkCommandBuffer cmdBuffer = m_renderCore.CreateCustomCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
     ionStagingBufferManager().Submit();
-    ionShaderProgramManager().StartFrame();
+    ionShaderProgramManager().StartFrame(m_renderCore.GetCurrentFrameIndex());
 
 
     DrawSurface drawSurface;
@@ -941,8 +1103,11 @@ const Texture* RenderManager::GeneratePrefilteredEnvironmentCubemap(Node* _camer
                     // custom draw uniform
                     ionShaderProgramManager().SetRenderParamFloat("roughness", (ionFloat)m / (ionFloat)(mipMapsLevel - 1));
 
-                    drawSurface.m_projectionMatrix = cameraPtr->GetPerspectiveProjection();
-                    drawSurface.m_viewMatrix = cameraPtr->GetView();
+                    SceneConstants sceneConstants;
+                    sceneConstants.m_projectionMatrix = cameraPtr->GetPerspectiveProjection();
+                    sceneConstants.m_viewMatrix = cameraPtr->GetView();
+                    m_renderCore.SetSceneConstants(sceneConstants);
+
                     drawSurface.m_modelMatrix = prefilteredEntity->GetTransform().GetMatrixWS();
 
                     m_renderCore.SetState(drawSurface.m_material->GetState().GetStateBits());
@@ -1045,6 +1210,8 @@ const Texture* RenderManager::GeneratePrefilteredEnvironmentCubemap(Node* _camer
 
     ionShaderProgramManager().Restart();
 
+    SaveIBLCache(ION_PREFILTEREDENVIRONMENT_TEXTURENAME, cacheKey, prefilteredEnvironment);
+
     return prefilteredEnvironment;
 }
 
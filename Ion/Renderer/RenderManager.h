@@ -25,6 +25,7 @@
 #include "../Scene/SceneGraph.h"
 
 #include "../Utilities/LoaderGLTF.h"
+#include "../Utilities/SphericalHarmonics.h"
 
 #include "../App/Mode.h"
 
@@ -38,6 +39,19 @@
 #define ION_UNLIT_SHADER_NAME    "Unlit"
 #define ION_UNLIT_MORPH_SHADER_NAME    "UnlitMorph"
 
+// vertex shaders of the PBR material reading the model matrix from the draw constants, at this offset after the material constants
+#define ION_PBR_DRAW_SHADER_NAME    "PBRDraw"
+#define ION_PBR_MORPH_DRAW_SHADER_NAME    "PBRMorphDraw"
+#define ION_PBR_DRAW_CONSTANTS_OFFSET    128
+
+// fragment shader of the unlit material reading its textures from the bindless table, the indices at this offset after the material constants
+#define ION_UNLIT_BINDLESS_SHADER_NAME    "UnlitBindless"
+#define ION_UNLIT_BINDLESS_TEXTURES_OFFSET    32
+
+// shaders of the PBR material reading its constants from the buffer of the material manager at this binding, only the draw constants are pushed
+#define ION_PBR_BUFFER_SHADER_NAME    "PBRBuffer"
+#define ION_PBR_CONSTANTS_BUFFER_BINDING    10
+
 EOS_USING_NAMESPACE
 
 ION_NAMESPACE_BEGIN
@@ -77,7 +91,8 @@ public:
     void LoadColoredSphere(Entity*& _entity, ionFloat _r = 1.0f, ionFloat _g = 1.0f, ionFloat _b = 1.0f, ionFloat _a = 1.0f);
     void LoadColoredPyramid(Entity*& _entity, ionFloat _r = 1.0f, ionFloat _g = 1.0f, ionFloat _b = 1.0f, ionFloat _a = 1.0f);
 
-    ionBool Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU32 _height, ionBool _fullScreen, ionBool _enableValidationLayer);
+    // _framesInFlight: frames the CPU can record while the GPU renders the previous ones, up to ION_MAX_FRAMES_IN_FLIGHT
+    ionBool Init(HINSTANCE _instance, HWND _handle, ionU32 _width, ionU32 _height, ionBool _fullScreen, ionBool _enableValidationLayer, ionU32 _framesInFlight = ION_DEFAULT_FRAMES_IN_FLIGHT);
     void    Shutdown();
 
     RenderManager();
@@ -124,9 +139,22 @@ public:
     const Texture*  GeneratePrefilteredEnvironmentCubemap(Node* _camera);
     const Texture*  GetPrefilteredEnvironmentCubemap() const;
 
+    // Diffuse IBL as 9 L2 spherical harmonics projected on the CPU from the skybox, alternative to the irradiance cube map.
+    // When in use the PBR shader evaluates the coefficients instead of sampling the irradiance cube map, so GenerateIrradianceCubemap can be skipped
+    ionBool         GenerateIrradianceSH(Node* _camera);
+    const Vector4*  GetIrradianceSH() const { return m_irradianceSH; }
+
+    void    SetUseIrradianceSH(ionBool _use) { m_useIrradianceSH = _use; }
+    ionBool IsUsingIrradianceSH() const { return m_useIrradianceSH; }
+
     const Texture*  GenerateNullTexture();
     const Texture*  GetNullTexure() const;
 
+    // when enabled the generated BRDF, irradiance and prefiltered textures are saved in the cache folder and reloaded on the next run
+    // the key is built from the generation parameters and from the content of the environment texture (if any)
+    void    SetIBLCacheEnabled(ionBool _enabled) { m_iblCacheEnabled = _enabled; }
+    ionBool IsIBLCacheEnabled() const { return m_iblCacheEnabled; }
+
     // render core interface for outside user (very minimal)
     VkCommandBuffer InstantiateCommandBuffer(VkCommandBufferLevel _level);
     void            ShutdownCommandBuffer(VkCommandBuffer _commandBuffer);
@@ -148,7 +176,15 @@ private:
 
     void LoadCommonMaterialForIntegratedPrimitive(Entity*& _entity, Material* _material);
 
+    // return 0 when the data cannot be cached (environment dependent without a known source), the code of the generation shaders is part of the key
+    ionU64      ComputeIBLCacheKey(ionU64 _sourceHash, ionBool _environmentDependent, ionS32 _vertexShaderIndex, ionS32 _fragmentShaderIndex, ionU32 _size, ionU32 _numLevels, ETextureFormat _format, ETextureType _type, ionFloat _param0, ionFloat _param1) const;
+    ionString   GetIBLCachePath(const ionString& _name, ionU64 _key) const;
+    const Texture* LoadIBLCache(const ionString& _name, ionU64 _key) const;
+    void        SaveIBLCache(const ionString& _name, ionU64 _key, const Texture* _texture);
+
 private:
+    Vector4     m_irradianceSH[ION_SH_COEFFICIENTS_COUNT];
+
     RenderCore  m_renderCore;
     SceneGraph  m_sceneGraph;
     LoaderGLTF  m_loader;
@@ -156,6 +192,8 @@ private:
     ionFloat    m_deltaTime;
 
     ionBool     m_running;
+    ionBool     m_iblCacheEnabled;
+    ionBool     m_useIrradianceSH;
 };
 
 ION_NAMESPACE_END
@@ -165,14 +165,43 @@ ionU8* StagingBufferManager::Stage(ionSize _size, ionSize _alignment, VkCommandB
         Submit();
     }
 
-    stagingBuffer = m_buffer;
+    if (!Restart())
+    {
+        return nullptr;
+    }
+
+    _outVkCommandBuffer = stagingBuffer.m_vkCommandBuffer;
+    _outVkBuffer = stagingBuffer.m_vkBuffer;
+    _outVkBufferOffset = stagingBuffer.m_vkOffset;
+
+    ionU8* data = stagingBuffer.m_data + stagingBuffer.m_vkOffset;
+    stagingBuffer.m_vkOffset += _size;
+
+    return data;
+}
+
+VkCommandBuffer StagingBufferManager::GetCommandBuffer()
+{
+    if (!Restart())
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    m_buffer.m_hasCommands = true;
+
+    return m_buffer.m_vkCommandBuffer;
+}
+
+ionBool StagingBufferManager::Restart()
+{
+    StagingBuffer& stagingBuffer = m_buffer;
     if (stagingBuffer.m_submitted) 
     {
         VkResult result = vkWaitForFences(m_vkDevice, 1, &stagingBuffer.m_vkFence, VK_TRUE, UINT64_MAX);
-        ionAssertReturnValue(result == VK_SUCCESS, "Cannot wait fences for staging!", nullptr);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot wait fences for staging!", false);
 
         result = vkResetFences(m_vkDevice, 1, &stagingBuffer.m_vkFence);
-        ionAssertReturnValue(result == VK_SUCCESS, "Cannot reset fences for staging!", nullptr);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot reset fences for staging!", false);
 
         stagingBuffer.m_vkOffset = 0;
         stagingBuffer.m_submitted = false;
@@ -181,24 +210,17 @@ ionU8* StagingBufferManager::Stage(ionSize _size, ionSize _alignment, VkCommandB
         commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
         result = vkBeginCommandBuffer(stagingBuffer.m_vkCommandBuffer, &commandBufferBeginInfo);
-        ionAssertReturnValue(result == VK_SUCCESS, "Cannot begin command buffer for staging!", nullptr);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot begin command buffer for staging!", false);
     }
 
-    _outVkCommandBuffer = stagingBuffer.m_vkCommandBuffer;
-    _outVkBuffer = stagingBuffer.m_vkBuffer;
-    _outVkBufferOffset = stagingBuffer.m_vkOffset;
-
-    ionU8* data = stagingBuffer.m_data + stagingBuffer.m_vkOffset;
-    stagingBuffer.m_vkOffset += _size;
-
-    return data;
+    return true;
 }
 
 void StagingBufferManager::Submit()
 {
     StagingBuffer& stagingBuffer = m_buffer;
 
-    if (stagingBuffer.m_submitted || stagingBuffer.m_vkOffset == 0) 
+    if (stagingBuffer.m_submitted || (stagingBuffer.m_vkOffset == 0 && !stagingBuffer.m_hasCommands)) 
     {
         return;
     }
@@ -206,8 +228,9 @@ void StagingBufferManager::Submit()
     VkMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
-    vkCmdPipelineBarrier(stagingBuffer.m_vkCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    // the static storage buffers (morph targets, material constants) are read by the shaders
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(stagingBuffer.m_vkCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
 
     vkEndCommandBuffer(stagingBuffer.m_vkCommandBuffer);
 
@@ -225,6 +248,7 @@ void StagingBufferManager::Submit()
     vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, stagingBuffer.m_vkFence);
 
     stagingBuffer.m_submitted = true;
+    stagingBuffer.m_hasCommands = false;
 }
 
 ION_NAMESPACE_END
\ No newline at end of file
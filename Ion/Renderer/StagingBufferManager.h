@@ -24,6 +24,7 @@ struct StagingBuffer
 {
     StagingBuffer() :
         m_submitted(false),
+        m_hasCommands(false),
         m_vkCommandBuffer(VK_NULL_HANDLE),
         m_vkBuffer(VK_NULL_HANDLE),
         m_vkFence(VK_NULL_HANDLE),
@@ -31,6 +32,7 @@ struct StagingBuffer
         m_data(nullptr) {}
 
     ionBool                m_submitted;
+    ionBool                m_hasCommands;      // recorded without staging any data, to submit even if the offset is 0
     VkCommandBuffer        m_vkCommandBuffer;
     VkBuffer            m_vkBuffer;
     VkFence                m_vkFence;
@@ -53,10 +55,17 @@ public:
     ionU8*  Stage(ionSize _size, ionSize _alignment, VkCommandBuffer& _outVkCommandBuffer, VkBuffer& _outVkBuffer, ionSize& _outVkBufferOffset);
     void    Submit();
 
+    // The command buffer of the next submit, for the commands which do not need any staged data (copies between images, dispatches).
+    // Any Stage called after can submit and restart it, so stage first and record after
+    VkCommandBuffer GetCommandBuffer();
+
 private:
     StagingBufferManager(const StagingBufferManager& _Orig) = delete;
     StagingBufferManager& operator = (const StagingBufferManager&) = delete;
 
+    // wait the previous submit of the buffer, if any, and begin it again
+    ionBool Restart();
+
 private:
     VkDevice        m_vkDevice;
     VkQueue         m_vkGraphicsQueue;
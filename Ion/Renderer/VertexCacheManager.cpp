@@ -135,7 +135,7 @@ void VertexCacheManager::Alloc(GeometryBufferSet& _buffer, ionSize _vertexBytes,
 
     if (_jointBytes > 0)
     {
-        _buffer.m_jointBuffer.Alloc(m_device, nullptr, _jointBytes, _usage);
+        _buffer.m_jointBuffer.Alloc(m_device, nullptr, _jointBytes + ION_VERTCACHE_JOINT_BLOCK_RANGE, _usage);
     }
 
     ClearGeometryBufferSet(_buffer);
@@ -226,7 +226,7 @@ VertexCacheHandler VertexCacheManager::Alloc(GeometryBufferSet& _buffer, const v
     {
         _buffer.m_jointMemUsed.fetch_add(_bytes, std::memory_order_relaxed);
         endPos = _buffer.m_jointMemUsed.load();
-        if (endPos > _buffer.m_jointBuffer.GetAllocedSize())
+        if (endPos + ION_VERTCACHE_JOINT_BLOCK_RANGE > _buffer.m_jointBuffer.GetAllocedSize())
         {
             ionAssertReturnValue(false, "Out of joint cache", (VertexCacheHandler)0);
         }
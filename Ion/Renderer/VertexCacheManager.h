@@ -27,6 +27,10 @@
 //#define ION_VERTCACHE_JOINT_MEMORY_PER_FRAME    256 * 1024
 #define ION_VERTCACHE_JOINT_MEMORY_PER_FRAME    0       // I'm not going to use join at the moment
 
+// range of the joint descriptor, the same for every skeleton so another count of joints does not need another descriptor set (16 KB, the min maxUniformBufferRange).
+// The joint buffers have this much more space at the end, so the range from the last block is still in the buffer
+#define ION_VERTCACHE_JOINT_BLOCK_RANGE         256ULL * 64ULL
+
 
 #define ION_STATIC_INDEX_MEMORY                 255ULL * 1024ULL * 1024ULL
 #define ION_STATIC_VERTEX_MEMORY                255ULL * 1024ULL * 1024ULL    // make sure it fits in ION_VERTCACHE_OFFSET_MASK!
@@ -152,7 +152,7 @@ void Camera::UpdateView()
 
     if (m_skybox != nullptr)
     {
-        m_skybox->UpdateUniformBuffer(m_projection, m_view, identity);
+        m_skybox->UpdateUniformBuffer(identity);
     }
 }
 
@@ -188,6 +188,15 @@ void Camera::RenderSkybox(RenderCore& _renderCore)
     }
 }
 
+ionBool Camera::PrepareSkybox(RenderCore& _renderCore, DrawPacket& _outPacket)
+{
+    if (m_skybox != nullptr)
+    {
+        return m_skybox->PrepareDraw(m_vkRenderPass, _renderCore, _outPacket);
+    }
+    return false;
+}
+
 void Camera::CustomRenderSkybox(RenderCore& _renderCore, VkCommandBuffer _commandBuffer, VkRenderPass _renderPass)
 {
     if (m_skybox != nullptr)
@@ -280,10 +289,10 @@ void Camera::SetScissor(RenderCore& _renderCore)
     _renderCore.SetScissor(m_scissor);
 }
 
-void Camera::StartRenderPass(RenderCore& _renderCore)
+void Camera::StartRenderPass(RenderCore& _renderCore, VkSubpassContents _contents /*= VK_SUBPASS_CONTENTS_INLINE*/)
 {
     const ionU32 swapIndex = _renderCore.GetCurrentSwapIndex();
-    _renderCore.StartRenderPass(m_vkRenderPass, m_vkFrameBuffers[swapIndex], m_clearDepthValue, m_clearStencilValue, m_clearRed, m_clearGreen, m_clearBlue, m_renderArea);
+    _renderCore.StartRenderPass(m_vkRenderPass, m_vkFrameBuffers[swapIndex], m_clearDepthValue, m_clearStencilValue, m_clearRed, m_clearGreen, m_clearBlue, m_renderArea, _contents);
 }
 
 void Camera::EndRenderPass(RenderCore& _renderCore)
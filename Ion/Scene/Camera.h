@@ -69,6 +69,8 @@ public:
     void RemoveSkybox();
 
     void RenderSkybox(RenderCore& _renderCore);
+    // false without a skybox or if it cannot be drawn, see RenderCore::PrepareDraw
+    ionBool PrepareSkybox(RenderCore& _renderCore, DrawPacket& _outPacket);
     void CustomRenderSkybox(RenderCore& _renderCore, VkCommandBuffer _commandBuffer, VkRenderPass _renderPass);
 
     //////////////////////////////////////////////////////////////////////////
@@ -85,7 +87,7 @@ public:
     // Render
     void SetViewport(RenderCore& _renderCore);
     void SetScissor(RenderCore& _renderCore);
-    void StartRenderPass(RenderCore& _renderCore);
+    void StartRenderPass(RenderCore& _renderCore, VkSubpassContents _contents = VK_SUBPASS_CONTENTS_INLINE);
     void EndRenderPass(RenderCore& _renderCore);
 
 
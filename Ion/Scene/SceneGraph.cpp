@@ -5,6 +5,8 @@
 
 #include "SceneGraph.h"
 
+#include <limits>
+
 #include "../Renderer/RenderCore.h"
 #include "../Renderer/VertexCacheManager.h"
 
@@ -18,6 +20,12 @@
 
 #include "../Core/UUID.h"
 
+#include "../Texture/TextureManager.h"
+
+#include "../Shader/ShaderProgramManager.h"
+
+#include "Skybox.h"
+
 NIX_USING_NAMESPACE
 EOS_USING_NAMESPACE
 
@@ -33,7 +41,7 @@ SceneGraphAllocator* SceneGraph::GetAllocator()
 }
 
 
-SceneGraph::SceneGraph()
+SceneGraph::SceneGraph() : m_screenHeight(0.0f)
 {
     m_root = CreateNode(Node, "ION_SCENEGRAPH_ROOT");
 }
@@ -48,6 +56,7 @@ SceneGraph::~SceneGraph()
         drawSurfaces.clear();
     }
     m_drawSurfaces.clear();
+    m_sceneConstants.clear();
 
     m_registeredInput.clear();
 
@@ -111,6 +120,8 @@ void SceneGraph::UpdateAllCameraAspectRatio(RenderCore& _renderCore)
         cam->RecreateRenderPassAndFrameBuffers(_renderCore);
         cam->UpdateAspectRatio((ionFloat)_renderCore.GetWidth() / (ionFloat)_renderCore.GetHeight());
     }
+
+    SetScreenHeight(_renderCore.GetHeight());
 }
 
 void SceneGraph::Begin()
@@ -193,6 +204,7 @@ void SceneGraph::Begin()
                             drawSurface->m_indexCount = _node->GetMesh(i)->GetIndexCount();
                             drawSurface->m_material = _node->GetMesh(i)->GetMaterial();
                             drawSurface->m_sortingIndex = static_cast<ionU8>(drawSurface->m_material->GetAlphaMode());
+                            drawSurface->m_uvScale = ComputeUVScale(renderer, drawSurface->m_indexStart, drawSurface->m_indexCount);
 
                             BoundingBox* bb = _node->GetBoundingBox();
                             m_sceneBoundingBox.Expande(bb->GetTransformed(_node->GetTransform().GetMatrix()));
@@ -247,6 +259,12 @@ void SceneGraph::SortDrawSurfaces()
             drawSurfaces[miniPos] = drawSurfaces[i];
             drawSurfaces[i] = temp;
         }
+
+        // the index pushed with the draw constants
+        for (ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>::size_type i = 0; i < drawSurfaces.size(); ++i)
+        {
+            drawSurfaces[i].m_objectIndex = static_cast<ionU32>(i);
+        }
     }
 }
 
@@ -262,10 +280,29 @@ void SceneGraph::Update(ionFloat _deltaTime)
 
         cam->UpdateView();  // here is updated the sky box either
 
-        const Matrix4x4& projection = cam->GetPerspectiveProjection();
-        const Matrix4x4& view = cam->GetView();
+        // once per camera, set before its draws by the Render
+        SceneConstants& sceneConstants = m_sceneConstants[cam];
+        sceneConstants.m_projectionMatrix = cam->GetPerspectiveProjection();
+        sceneConstants.m_viewMatrix = cam->GetView();
+        sceneConstants.m_mainCameraPos = cam->GetTransform().GetPosition();
+
+        if (m_directionalLight != nullptr)
+        {
+            sceneConstants.m_directionalLight = m_directionalLight->GetLightDirection();
+            sceneConstants.m_directionalLightColor = m_directionalLight->GetColor();
+        }
 
-        const Vector4& cameraPos = cam->GetTransform().GetPosition();
+        sceneConstants.m_exposure = ionRenderManager().m_exposure;
+        sceneConstants.m_gamma = ionRenderManager().m_gamma;
+        sceneConstants.m_prefilteredCubeMipLevels = ionRenderManager().m_prefilteredCubeMipLevels;
+
+        // same for all the PBR materials of the frame
+        const Vector4* irradianceSH = ionRenderManager().GetIrradianceSH();
+        for (ionU32 i = 0; i < ION_SH_COEFFICIENTS_COUNT; ++i)
+        {
+            sceneConstants.m_irradianceSH[i] = irradianceSH[i];
+        }
+        sceneConstants.m_useIrradianceSH = ionRenderManager().IsUsingIrradianceSH() ? 1.0f : 0.0f;
 
         ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>& drawSurfaces = iter->second;
         ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>::iterator beginDS = drawSurfaces.begin(), endDS = drawSurfaces.end(), itDS = beginDS;
@@ -273,28 +310,117 @@ void SceneGraph::Update(ionFloat _deltaTime)
         {
             DrawSurface& drawSurface = (*itDS);
 
-            drawSurface.m_viewMatrix = view;
-            drawSurface.m_projectionMatrix = projection;
-            drawSurface.m_mainCameraPos = cameraPos;
+            // relative to the nodes
+            drawSurface.m_modelMatrix = drawSurface.m_nodeRef->GetTransform().GetMatrixWS();
+
+            drawSurface.m_visible = drawSurface.m_nodeRef->IsVisible();
 
-            if (m_directionalLight != nullptr)
+            // keep resident (or reload) the textures needed by this frame
+            if (drawSurface.m_visible && drawSurface.m_material != nullptr)
             {
-                drawSurface.m_directionalLight = m_directionalLight->GetLightDirection();
-                drawSurface.m_directionalLightColor = m_directionalLight->GetColor();
+                const ionFloat screenSize = ComputeScreenSize(drawSurface, cam);
+
+                MarkTexturesUsed(drawSurface.m_material->GetVertexShaderLayout(), screenSize);
+                MarkTexturesUsed(drawSurface.m_material->GetTessellationControlShaderLayout(), screenSize);
+                MarkTexturesUsed(drawSurface.m_material->GetTessellationEvaluatorShaderLayout(), screenSize);
+                MarkTexturesUsed(drawSurface.m_material->GetGeometryShaderLayout(), screenSize);
+                MarkTexturesUsed(drawSurface.m_material->GetFragmentShaderLayout(), screenSize);
             }
+        }
+    }
+    //ionVertexCacheManager().EndMapping();
+}
+
+void SceneGraph::MarkTexturesUsed(const ShaderLayoutDef& _layout, ionFloat _screenSize)
+{
+    for (const SamplerBinding& sampler : _layout.m_samplers)
+    {
+        ionTextureManger().MarkTextureUsed(sampler.m_texture, _screenSize);
+    }
+}
 
-            drawSurface.m_exposure = ionRenderManager().m_exposure;
-            drawSurface.m_gamma = ionRenderManager().m_gamma;
-            drawSurface.m_prefilteredCubeMipLevels = ionRenderManager().m_prefilteredCubeMipLevels;
+ionFloat SceneGraph::ComputeScreenSize(const DrawSurface& _drawSurface, const Camera* _camera) const
+{
+    BoundingBox* boundingBox = _drawSurface.m_nodeRef->GetBoundingBox();
+    if (m_screenHeight <= 0.0f || boundingBox == nullptr || !boundingBox->IsValid())
+    {
+        return 0.0f;
+    }
 
+    const BoundingBox worldBoundingBox = boundingBox->GetTransformed(_drawSurface.m_modelMatrix);
 
-            // relative to the nodes
-            drawSurface.m_modelMatrix = drawSurface.m_nodeRef->GetTransform().GetMatrixWS();
+    const Vector4& halfExtent = worldBoundingBox.GetHalfExtent();
+    const Vector4 toCamera = worldBoundingBox.GetCenter() - _camera->GetTransform().GetPosition();
 
-            drawSurface.m_visible = drawSurface.m_nodeRef->IsVisible();
+    const ionFloat hx = MathFunctions::ExtractX(halfExtent), hy = MathFunctions::ExtractY(halfExtent), hz = MathFunctions::ExtractZ(halfExtent);
+    const ionFloat dx = MathFunctions::ExtractX(toCamera), dy = MathFunctions::ExtractY(toCamera), dz = MathFunctions::ExtractZ(toCamera);
+
+    const ionFloat radius = std::sqrt(hx * hx + hy * hy + hz * hz);
+    const ionFloat distance = std::sqrt(dx * dx + dy * dy + dz * dz) - radius;
+
+    // camera inside the bounding sphere: needs the full resolution
+    if (distance <= _camera->GetNear())
+    {
+        return std::numeric_limits<ionFloat>::max();
+    }
+
+    // projected diameter in pixels, divided by the times the UV range is repeated over the mesh
+    const ionFloat projectedSize = (radius / distance) * m_screenHeight / std::tan(_camera->GetFovRad() * 0.5f);
+    return projectedSize / _drawSurface.m_uvScale;
+}
+
+ionFloat SceneGraph::ComputeUVScale(const BaseMeshRenderer* _renderer, ionU32 _indexStart, ionU32 _indexCount)
+{
+    // only the full vertex layout is always textured
+    if (_renderer == nullptr || _renderer->GetLayout() != EVertexLayout_Full || _indexCount == 0)
+    {
+        return 1.0f;
+    }
+
+    const MeshRenderer* meshRenderer = static_cast<const MeshRenderer*>(_renderer);
+    const Index* indices = static_cast<const Index*>(_renderer->GetIndexData());
+
+    ionFloat minU = std::numeric_limits<ionFloat>::max(), minV = std::numeric_limits<ionFloat>::max();
+    ionFloat maxU = -std::numeric_limits<ionFloat>::max(), maxV = -std::numeric_limits<ionFloat>::max();
+    for (ionU32 i = _indexStart; i < _indexStart + _indexCount; ++i)
+    {
+        const Vertex& vertex = meshRenderer->GetVertex(indices[i]);
+        minU = std::min(minU, vertex.m_textureCoordUV0[0]);
+        maxU = std::max(maxU, vertex.m_textureCoordUV0[0]);
+        minV = std::min(minV, vertex.m_textureCoordUV0[1]);
+        maxV = std::max(maxV, vertex.m_textureCoordUV0[1]);
+    }
+
+    // clamp: an atlas sub-rect should not drop the texture to the last levels
+    return std::max(std::max(maxU - minU, maxV - minV), 0.0625f);
+}
+
+void SceneGraph::PrewarmPipelines(const RenderCore& _renderCore)
+{
+    for (ionMap<Camera*, ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>, SceneGraphAllocator, GetAllocator>::iterator iter = m_drawSurfaces.begin(); iter != m_drawSurfaces.end(); ++iter)
+    {
+        Camera* cam = iter->first;
+
+        ionVector<const Material*, ShaderProgramManagerAllocator, ShaderProgramManager::GetAllocator> materials;
+
+        Skybox* skybox = cam->GetSkybox();
+        if (skybox != nullptr)
+        {
+            materials.push_back(skybox->GetMaterial());
         }
+
+        // the same material is shared by many surfaces, the manager skips the duplicates anyway
+        const ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>& surfaces = iter->second;
+        for (ionSize i = 0; i < surfaces.size(); ++i)
+        {
+            if (surfaces[i].m_material != nullptr)
+            {
+                materials.push_back(surfaces[i].m_material);
+            }
+        }
+
+        ionShaderProgramManager().PrewarmPipelines(_renderCore, cam->GetRenderPass(), materials);
     }
-    //ionVertexCacheManager().EndMapping();
 }
 
 void SceneGraph::Render(RenderCore& _renderCore, ionU32 _x, ionU32 _y, ionU32 _width, ionU32 _height)
@@ -304,14 +430,23 @@ void SceneGraph::Render(RenderCore& _renderCore, ionU32 _x, ionU32 _y, ionU32 _w
         Camera* cam = iter->first;
 
         cam->ConputeRenderAreaViewportScissor(_x, _y, _width, _height);
+
+        const ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>& surfaces = iter->second;
+        if (_renderCore.UseParallelRecording(surfaces.size()))
+        {
+            RenderParallel(_renderCore, cam, surfaces);
+            continue;
+        }
+
         cam->StartRenderPass(_renderCore);
 
         cam->SetViewport(_renderCore);
         cam->SetScissor(_renderCore);
 
-        cam->RenderSkybox(_renderCore);
+        // the skybox and all the draws of the camera share the blocks written with these
+        _renderCore.SetSceneConstants(m_sceneConstants[cam]);
 
-        const ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>& surfaces = iter->second;
+        cam->RenderSkybox(_renderCore);
 
         ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>::const_iterator begin = surfaces.cbegin(), end = surfaces.cend(), it = begin;
         for (; it != end; ++it)
@@ -338,6 +473,53 @@ void SceneGraph::Render(RenderCore& _renderCore, ionU32 _x, ionU32 _y, ionU32 _w
     }
 }
 
+void SceneGraph::RenderParallel(RenderCore& _renderCore, Camera* _camera, const ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>& _surfaces)
+{
+    // no inline command in the render pass: the viewport and the scissor are set by every secondary command buffer
+    _camera->StartRenderPass(_renderCore, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    _renderCore.SetSceneConstants(m_sceneConstants[_camera]);
+
+    // the skybox is the first packet, the draws after it in the same order of the serial recording
+    m_drawPackets.resize(_surfaces.size() + 1);
+    ionU32 packetCount = 0;
+
+    if (_camera->PrepareSkybox(_renderCore, m_drawPackets[packetCount]))
+    {
+        ++packetCount;
+    }
+
+    ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>::const_iterator begin = _surfaces.cbegin(), end = _surfaces.cend(), it = begin;
+    for (; it != end; ++it)
+    {
+        const DrawSurface& drawSurface = (*it);
+
+        if (drawSurface.m_visible)
+        {
+            // the weights are written in the uniform blocks by the prepare, before the next surface changes them
+            AnimationRenderer* animationRenderer = drawSurface.m_nodeRef->GetAnimationRenderer();
+            if (animationRenderer != nullptr)
+            {
+                if (animationRenderer->IsEnabled())
+                {
+                    animationRenderer->Draw(drawSurface.m_nodeRef);
+                }
+            }
+
+            _renderCore.SetState(drawSurface.m_material->GetState().GetStateBits());
+            if (_renderCore.PrepareDraw(_camera->GetRenderPass(), drawSurface, m_drawPackets[packetCount], true))
+            {
+                ++packetCount;
+            }
+        }
+    }
+
+    const ionU32 swapIndex = _renderCore.GetCurrentSwapIndex();
+    _renderCore.ExecuteDrawPackets(_camera->GetRenderPass(), _camera->m_vkFrameBuffers[swapIndex], _camera->m_viewport, _camera->m_scissor, m_drawPackets.data(), packetCount);
+
+    _camera->EndRenderPass(_renderCore);
+}
+
 void SceneGraph::RegisterToInput(Node*_node)
 {
     m_registeredInput.push_back(_node);
@@ -32,6 +32,7 @@ using SceneGraphAllocator = MemoryAllocator<FreeListBestSearchAllocationPolicy,
 class UUID;
 class RenderCore;
 class DirectionalLight;
+struct ShaderLayoutDef;
 class ION_DLL SceneGraph final
 {
 public:
@@ -53,9 +54,15 @@ public:
 
     void UpdateAllCameraAspectRatio(RenderCore& _renderCore);
 
+    // used to estimate the mip levels needed by the draws
+    void SetScreenHeight(ionU32 _height) { m_screenHeight = static_cast<ionFloat>(_height); }
+
     void Begin();
     void End();
 
+    // create the pipelines of every (material, state, camera render pass) drawn by the scene before the first frame
+    void PrewarmPipelines(const RenderCore& _renderCore);
+
     void Update(ionFloat _deltaTime);
     void Render(RenderCore& _renderCore, ionU32 _x, ionU32 _y, ionU32 _width, ionU32 _height);
 
@@ -75,13 +82,21 @@ private:
     SceneGraph& operator = (const SceneGraph&) = delete;
 
     void SortDrawSurfaces();
+    // the draws of the camera prepared in order and recorded by the command recorder, the render pass is already computed
+    void RenderParallel(RenderCore& _renderCore, Camera* _camera, const ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>& _surfaces);
+    void MarkTexturesUsed(const ShaderLayoutDef& _layout, ionFloat _screenSize);
+    ionFloat ComputeScreenSize(const DrawSurface& _drawSurface, const Camera* _camera) const;
+    static ionFloat ComputeUVScale(const BaseMeshRenderer* _renderer, ionU32 _indexStart, ionU32 _indexCount);
 
 private:
     BoundingBox                                 m_sceneBoundingBox;
 	DirectionalLight*							m_directionalLight;
 	Node*										m_root;
     ionMap<Camera*, ionVector<DrawSurface, SceneGraphAllocator, GetAllocator>, SceneGraphAllocator, GetAllocator>     m_drawSurfaces;
+    ionMap<Camera*, SceneConstants, SceneGraphAllocator, GetAllocator>     m_sceneConstants;     // computed once per camera by the Update
     ionVector<Node*, SceneGraphAllocator, GetAllocator> m_registeredInput;
+    ionVector<DrawPacket, CommandRecorderAllocator, CommandRecorder::GetAllocator> m_drawPackets;     // of the camera rendered in parallel, reused by every camera
+    ionFloat                                    m_screenHeight;
     ionBool                                     m_isMeshGeneratedFirstTime;  // is an helper
 };
 
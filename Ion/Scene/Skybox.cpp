@@ -115,11 +115,9 @@ Material* Skybox::GetMaterial()
     return m_mesh.GetMaterial();
 }
 
-void Skybox::UpdateUniformBuffer(const Matrix4x4& _projection, const Matrix4x4& _view, const Matrix4x4& _model)
+void Skybox::UpdateUniformBuffer(const Matrix4x4& _model)
 {
     m_drawSurface.m_modelMatrix = _model;
-    m_drawSurface.m_viewMatrix = _view;
-    m_drawSurface.m_projectionMatrix = _projection;
 }
 
 void Skybox::Draw(VkRenderPass _renderPass, RenderCore& _renderCore)
@@ -128,6 +126,12 @@ void Skybox::Draw(VkRenderPass _renderPass, RenderCore& _renderCore)
     _renderCore.Draw(_renderPass, m_drawSurface);
 }
 
+ionBool Skybox::PrepareDraw(VkRenderPass _renderPass, RenderCore& _renderCore, DrawPacket& _outPacket)
+{
+    _renderCore.SetState(m_mesh.GetMaterial()->GetState().GetStateBits());
+    return _renderCore.PrepareDraw(_renderPass, m_drawSurface, _outPacket, true);
+}
+
 void Skybox::CustomDraw(RenderCore& _renderCore, VkCommandBuffer _commandBuffer, VkRenderPass _renderPass)
 {
     _renderCore.SetState(m_mesh.GetMaterial()->GetState().GetStateBits());
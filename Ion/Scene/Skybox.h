@@ -34,6 +34,7 @@ using SkyboxAllocator = MemoryAllocator<FreeListBestSearchAllocationPolicy, Mult
 
 class RenderCore;
 class Material;
+struct DrawPacket;
 
 class ION_DLL Skybox
 {
@@ -49,8 +50,10 @@ public:
     void SetMaterial(Material* _material);
     Material* GetMaterial();
 
-    void UpdateUniformBuffer(const Matrix4x4& _projection, const Matrix4x4& _view, const Matrix4x4& _model);
+    // the view and the projection are the scene constants of the camera, see RenderCore::SetSceneConstants
+    void UpdateUniformBuffer(const Matrix4x4& _model);
     void Draw(VkRenderPass _renderPass, RenderCore& _renderCore);
+    ionBool PrepareDraw(VkRenderPass _renderPass, RenderCore& _renderCore, DrawPacket& _outPacket);
     void CustomDraw(RenderCore& _renderCore, VkCommandBuffer _commandBuffer, VkRenderPass _renderPass);
 
 private:
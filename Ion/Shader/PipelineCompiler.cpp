@@ -0,0 +1,140 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Shader\PipelineCompiler.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#include "PipelineCompiler.h"
+
+#include "ShaderProgramHelper.h"
+
+#include "../GPU/GpuMemoryManager.h"
+
+#include "../Renderer/RenderCore.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+PipelineCompiler::PipelineCompiler() :
+    m_running(false),
+    m_compiling(false)
+{
+
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+
+}
+
+void PipelineCompiler::Init()
+{
+    if (m_running)
+    {
+        return;
+    }
+
+    m_running = true;
+    m_thread = std::thread(&PipelineCompiler::Run, this);
+}
+
+void PipelineCompiler::Shutdown()
+{
+    if (!m_running)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_wakeUp.notify_one();
+    m_thread.join();
+
+    // never compiled or never collected
+    for (ionSize i = 0; i < m_completed.size(); ++i)
+    {
+        if (m_completed[i].m_pipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(m_completed[i].m_render->GetDevice(), m_completed[i].m_pipeline, vkMemory);
+        }
+    }
+    m_completed.clear();
+    m_queued.clear();
+}
+
+void PipelineCompiler::Enqueue(const PipelineRequest& _request)
+{
+    ionAssertReturnVoid(m_running, "The pipeline compiler is not running!");
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued.push_back(_request);
+    }
+    m_wakeUp.notify_one();
+}
+
+void PipelineCompiler::CollectCompleted(ionVector<PipelineRequest, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>& _outCompleted)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    _outCompleted.insert(_outCompleted.end(), m_completed.begin(), m_completed.end());
+    m_completed.clear();
+}
+
+void PipelineCompiler::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_queued.empty() && !m_compiling; });
+}
+
+ionBool PipelineCompiler::IsIdle()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queued.empty() && !m_compiling;
+}
+
+VkPipeline PipelineCompiler::Create(const PipelineRequest& _request)
+{
+    const PipelineShaders& shaders = _request.m_shaders;
+    return ShaderProgramHelper::CreateGraphicsPipeline(*_request.m_render, _request.m_renderPass, _request.m_topology, _request.m_vertexLayoutType, _request.m_pipelineLayout, _request.m_stateBits,
+        shaders.m_vertexShader, shaders.m_fragmentShader, shaders.m_tessellationControlShader, shaders.m_tessellationEvaluatorShader, shaders.m_geometryShader,
+        shaders.m_vertexSpecConst, shaders.m_fragmentSpecConst, shaders.m_tessCtrlSpecConst, shaders.m_tessEvalSpecConst, shaders.m_geomSpecConst);
+}
+
+void PipelineCompiler::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wakeUp.wait(lock, [this]() { return !m_running || !m_queued.empty(); });
+        if (!m_running)
+        {
+            break;
+        }
+
+        PipelineRequest request = m_queued.front();
+        m_queued.erase(m_queued.begin());
+        m_compiling = true;
+
+        // the driver compiles without the lock, the render thread can keep queueing and collecting
+        lock.unlock();
+        request.m_pipeline = Create(request);
+        lock.lock();
+
+        m_completed.push_back(request);
+        m_compiling = false;
+
+        if (m_queued.empty())
+        {
+            m_idle.notify_all();
+        }
+    }
+
+    m_compiling = false;
+    m_idle.notify_all();
+}
+
+ION_NAMESPACE_END
@@ -0,0 +1,72 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Shader\PipelineCompiler.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../Core/CoreDefs.h"
+
+#include "../Dependencies/Eos/Eos/Eos.h"
+
+#include "../Core/MemoryWrapper.h"
+
+#include "ShaderProgram.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+// Creates the pipelines on a background thread, so a draw needing a new pipeline does not stall the frame on vkCreateGraphicsPipelines.
+// The requests are processed in order, the results are collected by the render thread (see ShaderProgramManager::ResolveCompiledPipelines).
+class ION_DLL PipelineCompiler final
+{
+public:
+    PipelineCompiler();
+    ~PipelineCompiler();
+
+    void    Init();
+    void    Shutdown();
+
+    void    Enqueue(const PipelineRequest& _request);
+
+    // move the completed requests in _outCompleted, the pipeline of every request is owned by the caller
+    void    CollectCompleted(ionVector<PipelineRequest, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>& _outCompleted);
+
+    // block until the queue is empty, i.e. before destroying what the requests refer to
+    void    WaitIdle();
+
+    ionBool IsIdle();
+
+    // create the pipeline of the request on the calling thread
+    static VkPipeline Create(const PipelineRequest& _request);
+
+private:
+    PipelineCompiler(const PipelineCompiler& _Orig) = delete;
+    PipelineCompiler& operator = (const PipelineCompiler&) = delete;
+
+    void    Run();
+
+private:
+    std::thread                 m_thread;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wakeUp;
+    std::condition_variable     m_idle;
+
+    ionVector<PipelineRequest, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>  m_queued;
+    ionVector<PipelineRequest, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>  m_completed;
+
+    ionBool                     m_running;
+    ionBool                     m_compiling;
+};
+
+ION_NAMESPACE_END
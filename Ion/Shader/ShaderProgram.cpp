@@ -7,6 +7,15 @@
 
 #include "ShaderProgramHelper.h"
 
+#include <algorithm>
+
+#include "../Renderer/RenderState.h"
+
+#include "../Utilities/Tools.h"
+
+
+#define ION_PIPELINE_MAP_MIN_SLOTS  16
+
 EOS_USING_NAMESPACE
 
 ION_NAMESPACE_BEGIN
@@ -16,7 +25,13 @@ ShaderProgram::ShaderProgram() :
     m_vertextLayoutType(EVertexLayout_Full),
     m_pipelineLayout(VK_NULL_HANDLE),
     m_descriptorSetLayout(VK_NULL_HANDLE),
-    m_material(nullptr)
+    m_material(nullptr),
+    m_constantsStages(0),
+    m_drawConstantsStages(0),
+    m_drawConstantsOffset(0),
+    m_bindlessTexturesStages(0),
+    m_bindlessTexturesOffset(0),
+    m_descriptorSet(VK_NULL_HANDLE)
 {
 
 }
@@ -30,30 +45,155 @@ VkPipeline ShaderProgram::GetPipeline(const RenderCore& _render, VkRenderPass _r
     VkShaderModule _vertexShader /*= VK_NULL_HANDLE*/, VkShaderModule _fragmentShader /*= VK_NULL_HANDLE*/, VkShaderModule _tessellationControlShader /*= VK_NULL_HANDLE*/, VkShaderModule _tessellationEvaluatorShader /*= VK_NULL_HANDLE*/, VkShaderModule _geometryShader /*= VK_NULL_HANDLE*/,
     SpecializationConstants* _vertexSpecConst /*= nullptr*/, SpecializationConstants* _fragmentSpecConst /*= nullptr*/, SpecializationConstants* _tessCtrlSpecConst /*= nullptr*/, SpecializationConstants* _tessEvalSpecConst /*= nullptr*/, SpecializationConstants* _geomSpecConst /*= nullptr*/)
 {
-    for (ionU32 i = 0; i < m_pipelines.size(); ++i) 
+    const ionS32 index = FindPipelineIndex(_renderPass, _stateBits);
+    if (index >= 0 && m_pipelines[index].m_pipeline != VK_NULL_HANDLE)
+    {
+        return m_pipelines[index].m_pipeline;
+    }
+
+    VkPipeline pipeline = ShaderProgramHelper::CreateGraphicsPipeline(_render, _renderPass, _topology, m_vertextLayoutType, m_pipelineLayout, _stateBits, _vertexShader, _fragmentShader, _tessellationControlShader, _tessellationEvaluatorShader, _geometryShader,
+        _vertexSpecConst, _fragmentSpecConst, _tessCtrlSpecConst, _tessEvalSpecConst, _geomSpecConst);
+
+    if (pipeline != VK_NULL_HANDLE)
+    {
+        // still queued to the compiler: take its slot, the compiled one will be discarded
+        if (index >= 0)
+        {
+            ResolvePendingPipeline(index, pipeline);
+        }
+        else
+        {
+            AddPipeline(_renderPass, _stateBits, pipeline);
+        }
+    }
+
+    return pipeline;
+}
+
+ionS32 ShaderProgram::FindPipelineIndex(VkRenderPass _renderPass, ionU64 _stateBits) const
+{
+    if (m_pipelineSlots.empty())
+    {
+        return -1;
+    }
+
+    const ionU64 hash = ComputePipelineHash(_stateBits, _renderPass);
+    const ionSize mask = m_pipelineSlots.size() - 1;
+    for (ionSize slot = static_cast<ionSize>(hash) & mask; m_pipelineSlots[slot] >= 0; slot = (slot + 1) & mask)
     {
         // same state and same renderpass
-        if (_stateBits == m_pipelines[i].m_stateBits && _renderPass == m_pipelines[i].m_renderpass)
+        const PipelineState& state = m_pipelines[m_pipelineSlots[slot]];
+        if (_stateBits == state.m_stateBits && _renderPass == state.m_renderpass)
         {
-            return m_pipelines[i].m_pipeline;
+            return m_pipelineSlots[slot];
         }
     }
 
-    VkPipeline pipeline = ShaderProgramHelper::CreateGraphicsPipeline(_render, _renderPass, _topology, m_vertextLayoutType, m_pipelineLayout, _stateBits, _vertexShader, _fragmentShader, _tessellationControlShader, _tessellationEvaluatorShader, _geometryShader,
-        _vertexSpecConst, _fragmentSpecConst, _tessCtrlSpecConst, _tessEvalSpecConst, _geomSpecConst);
+    return -1;
+}
+
+VkPipeline ShaderProgram::FindPipeline(VkRenderPass _renderPass, ionU64 _stateBits) const
+{
+    const ionS32 index = FindPipelineIndex(_renderPass, _stateBits);
+    return index >= 0 ? m_pipelines[index].m_pipeline : VK_NULL_HANDLE;
+}
+
+VkPipeline ShaderProgram::FindFallbackPipeline(VkRenderPass _renderPass, ionU64 _stateBits) const
+{
+    // the bits changing the dynamic states of the pipeline, see ShaderProgramHelper::CreateGraphicsPipeline
+    const ionU64 dynamicBits = ERasterization_PolygonMode_Offset | ERasterization_DepthTest_Mask;
 
+    // a program has just a few pipelines, the first compatible one is fine
+    for (ionSize i = 0; i < m_pipelines.size(); ++i)
+    {
+        const PipelineState& state = m_pipelines[i];
+        if (state.m_pipeline != VK_NULL_HANDLE && state.m_renderpass == _renderPass && (state.m_stateBits & dynamicBits) == (_stateBits & dynamicBits))
+        {
+            return state.m_pipeline;
+        }
+    }
+
+    return VK_NULL_HANDLE;
+}
+
+void ShaderProgram::AddPipeline(VkRenderPass _renderPass, ionU64 _stateBits, VkPipeline _pipeline)
+{
     PipelineState pipelineState;
-    pipelineState.m_pipeline = pipeline;
+    pipelineState.m_pipeline = _pipeline;
     pipelineState.m_stateBits = _stateBits;
     pipelineState.m_renderpass = _renderPass;
+    pipelineState.m_hash = ComputePipelineHash(_stateBits, _renderPass);
     m_pipelines.push_back(pipelineState);
 
-    return pipeline;
+    InsertPipelineSlot(static_cast<ionS32>(m_pipelines.size() - 1));
+}
+
+ionS32 ShaderProgram::AddPendingPipeline(VkRenderPass _renderPass, ionU64 _stateBits)
+{
+    AddPipeline(_renderPass, _stateBits, VK_NULL_HANDLE);
+
+    const ionS32 index = static_cast<ionS32>(m_pipelines.size() - 1);
+    m_pipelines[index].m_pending = true;
+
+    return index;
+}
+
+void ShaderProgram::ResolvePendingPipeline(ionS32 _index, VkPipeline _pipeline)
+{
+    PipelineState& state = m_pipelines[_index];
+    state.m_pipeline = _pipeline;
+    state.m_pending = false;
+}
+
+void ShaderProgram::ClearPipelines()
+{
+    m_pipelines.clear();
+    m_pipelineSlots.clear();
+}
+
+ionU64 ShaderProgram::ComputePipelineHash(ionU64 _stateBits, VkRenderPass _renderPass)
+{
+    ionU64 hash = Tools::HashFNV1a64(&_stateBits, sizeof(_stateBits), Tools::kFNV1aOffset64);
+    hash = Tools::HashFNV1a64(&_renderPass, sizeof(_renderPass), hash);
+    return hash;
+}
+
+void ShaderProgram::InsertPipelineSlot(ionS32 _index)
+{
+    // keep the load factor under 1/2 so the probe sequences stay short, growing re-inserts every pipeline (the new one too)
+    if (m_pipelines.size() * 2 > m_pipelineSlots.size())
+    {
+        const ionSize slotCount = std::max(m_pipelineSlots.size() * 2, static_cast<ionSize>(ION_PIPELINE_MAP_MIN_SLOTS));
+        m_pipelineSlots.assign(slotCount, -1);
+
+        const ionSize mask = slotCount - 1;
+        for (ionSize i = 0; i < m_pipelines.size(); ++i)
+        {
+            ionSize slot = static_cast<ionSize>(m_pipelines[i].m_hash) & mask;
+            while (m_pipelineSlots[slot] >= 0)
+            {
+                slot = (slot + 1) & mask;
+            }
+            m_pipelineSlots[slot] = static_cast<ionS32>(i);
+        }
+        return;
+    }
+
+    const ionSize mask = m_pipelineSlots.size() - 1;
+    ionSize slot = static_cast<ionSize>(m_pipelines[_index].m_hash) & mask;
+    while (m_pipelineSlots[slot] >= 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    m_pipelineSlots[slot] = _index;
 }
 
 ShaderProgram::PipelineState::PipelineState() :
     m_stateBits(0),
-    m_pipeline(VK_NULL_HANDLE) 
+    m_hash(0),
+    m_pipeline(VK_NULL_HANDLE),
+    m_renderpass(VK_NULL_HANDLE),
+    m_pending(false)
 {
 
 }
@@ -20,6 +20,7 @@
 #include "../Core/MemorySettings.h"
 
 #include "ShaderProgramHelper.h"
+#include "ShaderReflection.h"
 
 
 EOS_USING_NAMESPACE
@@ -214,6 +215,61 @@ ION_INLINE ionBool operator!=(const ConstantsBindingDef& lhs, const ConstantsBin
     return (lhs.GetData() != rhs.GetData());
 }
 
+// The per draw push constants, after the ones of the material, see Material::SetDrawConstantsStages
+// in the shader:
+/*
+layout (push_constant) uniform Draw {
+    layout (offset = <Material::GetDrawConstantsOffset()>) mat4 model;
+    uint objectIndex;
+    uint materialIndex;
+} draw;
+*/
+struct DrawConstants
+{
+    Matrix4x4   m_modelMatrix;
+    ionU32      m_objectIndex;      // of the surface in the draw list of the camera
+    ionU32      m_materialIndex;    // slot of the material in the constants buffer of the MaterialManager
+    ionU32      m_padding[2];
+};
+
+#define ION_BINDLESS_MATERIAL_TEXTURES  8
+
+// The textures of a material read from the bindless table, pushed after the draw constants, see Material::SetBindlessTexturesStages
+// in the shader (a cube map is declared as samplerCube on the same set and binding, and a stage with the constants too declares the indices
+// as the last member of their block, see UnlitBindless.frag):
+/*
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+layout (push_constant) uniform Textures {
+    layout (offset = <Material::GetBindlessTexturesOffset()>) uint indices[8];
+} material;
+
+vec4 albedo = texture(textures[material.indices[0]], uv);
+*/
+struct BindlessTextureIndices
+{
+    ionU32      m_indices[ION_BINDLESS_MATERIAL_TEXTURES];     // in the order of the samplers of the stages: vertex, tessellation, geometry, fragment
+};
+
+// What the commit of a draw binds, resolved on the render thread by ShaderProgramManager::PrepareCurrent.
+// Only handles and values: it is recorded later by ShaderProgramManager::RecordCommit, on any thread.
+struct DrawCommit
+{
+    VkPipeline              m_pipeline;
+    VkPipelineLayout        m_pipelineLayout;
+    VkDescriptorSet         m_descriptorSets[2];        // of the program and the bindless table
+    ionU32                  m_descriptorSetCount;
+    ionU32                  m_dynamicOffsets[ION_MAX_DESCRIPTOR_SET_WRITES];
+    ionU32                  m_dynamicOffsetCount;
+    const void*             m_constantsData;            // owned by the material, nullptr if not pushed
+    ionU32                  m_constantsSize;
+    VkShaderStageFlags      m_constantsStages;
+    VkShaderStageFlags      m_drawConstantsStages;
+    ionU32                  m_drawConstantsOffset;
+    VkShaderStageFlags      m_bindlessTexturesStages;
+    ionU32                  m_bindlessTexturesOffset;
+    BindlessTextureIndices  m_bindlessIndices;
+};
+
 //////////////////////////////////////////////////////////////////////////
 
 struct ION_DLL ShaderLayoutDef final
@@ -362,7 +418,8 @@ class RenderCore;
 struct Shader
 {
     Shader() :
-        m_shaderModule(VK_NULL_HANDLE)
+        m_shaderModule(VK_NULL_HANDLE),
+        m_codeHash(0)
     {}
 
     ~Shader()
@@ -391,10 +448,86 @@ struct Shader
     EShaderStage                    m_stage;
     VkShaderModule                  m_shaderModule;
     SpecializationConstants         m_specializationConstants;
+    ShaderReflection                m_reflection;       // of the module as compiled, read when loaded
+    ionU64                          m_codeHash;         // FNV-1a of the SPIR-V, read when loaded
 };
 
 //////////////////////////////////////////////////////////////////////////
 
+// the shader stages of a material resolved to the modules, see ShaderProgramManager::GetPipelineShaders
+struct PipelineShaders
+{
+    VkShaderModule              m_vertexShader;
+    VkShaderModule              m_fragmentShader;
+    VkShaderModule              m_tessellationControlShader;
+    VkShaderModule              m_tessellationEvaluatorShader;
+    VkShaderModule              m_geometryShader;
+    SpecializationConstants*    m_vertexSpecConst;
+    SpecializationConstants*    m_fragmentSpecConst;
+    SpecializationConstants*    m_tessCtrlSpecConst;
+    SpecializationConstants*    m_tessEvalSpecConst;
+    SpecializationConstants*    m_geomSpecConst;
+};
+
+// Everything needed to create a pipeline away from its program, on another thread.
+// The program is identified by index and generation, because the programs can be cleared while the pipeline is created.
+struct PipelineRequest
+{
+    const RenderCore*           m_render;
+    ionS32                      m_programIndex;
+    ionU32                      m_programGeneration;
+    ionS32                      m_pipelineIndex;        // pending slot in ShaderProgram::m_pipelines, -1 if none
+    VkRenderPass                m_renderPass;
+    ionU64                      m_stateBits;
+    VkPrimitiveTopology         m_topology;
+    EVertexLayout               m_vertexLayoutType;
+    VkPipelineLayout            m_pipelineLayout;
+    PipelineShaders             m_shaders;
+    VkPipeline                  m_pipeline;             // the result
+};
+
+// A parameter of a uniform block resolved when the program is linked: where its value is in the flat storage
+// of the ShaderProgramManager (the slot of its type) and where it goes in the block.
+struct UniformParameterSlot
+{
+    EBufferParameterType        m_type;
+    ionU32                      m_slot;
+    ionU32                      m_offset;       // in bytes from the beginning of the block
+    ionU32                      m_components;   // floats written for a vector, a vec2/vec3 member takes only its own bytes
+};
+
+// The packed layout of a uniform binding, the size is not aligned yet to the device offset alignment
+struct UniformBlockLayout
+{
+    ionU32                      m_bindingIndex;
+    ionU32                      m_size;
+    ionU64                      m_sceneKey;     // 0 if the block has per draw parameters, otherwise the hash of its layout to share it between the draws
+    ionVector<UniformParameterSlot, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>   m_parameters;
+};
+
+// What is written in a binding of the descriptor set of a program, to know when the cached set is still valid.
+// The uniform blocks are always written at offset 0 and addressed by the dynamic offset of the draw.
+struct DescriptorBindingState
+{
+    VkBuffer                    m_buffer;
+    VkDeviceSize                m_offset;
+    VkDeviceSize                m_range;
+    VkImageView                 m_view;
+    VkSampler                   m_sampler;
+    VkImageLayout               m_layout;
+};
+
+ION_INLINE ionBool operator==(const DescriptorBindingState& lhs, const DescriptorBindingState& rhs)
+{
+    return lhs.m_buffer == rhs.m_buffer && lhs.m_offset == rhs.m_offset && lhs.m_range == rhs.m_range &&
+        lhs.m_view == rhs.m_view && lhs.m_sampler == rhs.m_sampler && lhs.m_layout == rhs.m_layout;
+}
+
+ION_INLINE ionBool operator!=(const DescriptorBindingState& lhs, const DescriptorBindingState& rhs)
+{
+    return !(lhs == rhs);
+}
+
 class Material;
 struct ShaderProgram
 {
@@ -406,20 +539,63 @@ struct ShaderProgram
         PipelineState();
 
         ionU64          m_stateBits;
+        ionU64          m_hash;
         VkPipeline      m_pipeline;
         VkRenderPass    m_renderpass;
+        ionBool         m_pending;      // queued to the pipeline compiler, m_pipeline is still VK_NULL_HANDLE
     };
 
+    // called for every draw: the pipelines are found through an open addressing map on (state bits, render pass)
     VkPipeline GetPipeline(const RenderCore& _render, VkRenderPass _renderPass, ionU64 _stateBits, VkPrimitiveTopology _topology, 
                             VkShaderModule _vertexShader = VK_NULL_HANDLE, VkShaderModule _fragmentShader = VK_NULL_HANDLE, VkShaderModule _tessellationControlShader = VK_NULL_HANDLE, VkShaderModule _tessellationEvaluatorShader = VK_NULL_HANDLE, VkShaderModule _geometryShader = VK_NULL_HANDLE,
                             SpecializationConstants* _vertexSpecConst = nullptr, SpecializationConstants* _fragmentSpecConst = nullptr, SpecializationConstants* _tessCtrlSpecConst = nullptr, SpecializationConstants* _tessEvalSpecConst = nullptr, SpecializationConstants* _geomSpecConst = nullptr);
 
+    // index in m_pipelines of (state bits, render pass), -1 if never requested
+    ionS32 FindPipelineIndex(VkRenderPass _renderPass, ionU64 _stateBits) const;
+
+    // VK_NULL_HANDLE if the pipeline of (state bits, render pass) is not created yet
+    VkPipeline FindPipeline(VkRenderPass _renderPass, ionU64 _stateBits) const;
+
+    // A created pipeline of the same render pass to draw with while the right one is compiled.
+    // It has the same dynamic states, so the draw commands stay valid, only the fixed states can differ.
+    VkPipeline FindFallbackPipeline(VkRenderPass _renderPass, ionU64 _stateBits) const;
+
+    // add a pipeline created outside, i.e. by the pre-warming, the program takes the ownership
+    void AddPipeline(VkRenderPass _renderPass, ionU64 _stateBits, VkPipeline _pipeline);
+
+    // reserve the slot of a pipeline queued to the compiler and fill it when done (VK_NULL_HANDLE if the creation failed)
+    ionS32 AddPendingPipeline(VkRenderPass _renderPass, ionU64 _stateBits);
+    void ResolvePendingPipeline(ionS32 _index, VkPipeline _pipeline);
+
     ionVector<EShaderBinding, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>   m_bindings;
     ionVector<PipelineState, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>    m_pipelines;
+    ionVector<ionS32, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>           m_pipelineSlots;    // index in m_pipelines, -1 if empty, power of 2 size
     EVertexLayout               m_vertextLayoutType;
     VkPipelineLayout            m_pipelineLayout;
     VkDescriptorSetLayout       m_descriptorSetLayout;
     const Material*             m_material;
+
+    // stages to push the material constants and the draw constants to, they are the same when the two ranges are merged
+    VkShaderStageFlags          m_constantsStages;
+    VkShaderStageFlags          m_drawConstantsStages;
+    ionU32                      m_drawConstantsOffset;
+    VkShaderStageFlags          m_bindlessTexturesStages;   // 0 if the samplers are in the descriptor set of the program
+    ionU32                      m_bindlessTexturesOffset;
+
+    // the uniform blocks of all the stages, in the same order of the uniform bindings in m_bindings
+    ionVector<UniformBlockLayout, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>     m_uniformBlocks;
+
+    // The descriptor set is built once and reused by all the draws of the material, the per draw uniform blocks are dynamic offsets.
+    // It is replaced only when a binding changes (i.e. a texture streamed or reloaded), see ShaderProgramManager::CommitCurrent
+    VkDescriptorSet             m_descriptorSet;
+    ionVector<DescriptorBindingState, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>   m_descriptorBindings;    // same order of m_bindings
+
+    // the pipelines have to be already destroyed
+    void ClearPipelines();
+
+private:
+    static ionU64 ComputePipelineHash(ionU64 _stateBits, VkRenderPass _renderPass);
+    void InsertPipelineSlot(ionS32 _index);
 };
 
 
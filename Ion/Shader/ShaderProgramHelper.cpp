@@ -16,6 +16,8 @@
 
 #include "../Material/Material.h"
 
+#include "../Texture/TextureManager.h"
+
 #include "../Renderer/RenderCommon.h"
 
 EOS_USING_NAMESPACE
@@ -272,12 +274,14 @@ void ShaderProgramHelper::CreateVertexDescriptor()
 
 void ShaderProgramHelper::CreateDescriptorPools(const VkDevice& _device, VkDescriptorPool& _pool)
 {
-    const ionU32 poolCount = 2;
+    const ionU32 poolCount = 3;
     VkDescriptorPoolSize poolSizes[poolCount];
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     poolSizes[0].descriptorCount = ION_MAX_DESCRIPTOR_UNIFORM_BUFFERS;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     poolSizes[1].descriptorCount = ION_MAX_DESCRIPTOR_IMAGE_SAMPLERS;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = ION_MAX_DESCRIPTOR_STORAGE_BUFFERS;
 
     VkDescriptorPoolCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -291,8 +295,16 @@ void ShaderProgramHelper::CreateDescriptorPools(const VkDevice& _device, VkDescr
     ionAssertReturnVoid(result == VK_SUCCESS, "vkCreateDescriptorPool cannot create descriptor pool!");
 }
 
-void ShaderProgramHelper::CreateDescriptorSetLayout(const VkDevice& _device, ShaderProgram& _shaderProgram, const Shader* _vertexShader, const Shader* _fragmentShader, const Shader* _tessellationControlShader, const Shader* _tessellationEvaluatorShader, const Shader* _geometryShader, const Material* _material)
+void ShaderProgramHelper::CreateDescriptorSetLayout(const VkDevice& _device, ionU32 _maxPushConstantsSize, ShaderProgram& _shaderProgram, const Shader* _vertexShader, const Shader* _fragmentShader, const Shader* _tessellationControlShader, const Shader* _tessellationEvaluatorShader, const Shader* _geometryShader, const Material* _material)
 {
+    // the samplers of a bindless material are read from the table of the texture manager, bound as set 1
+    const ionBool bindlessTextures = _material->UseBindlessTextures();
+    ionAssertReturnVoid(!bindlessTextures || ionTextureManger().IsBindlessEnabled(), "The material " << _material->GetName() << " uses bindless textures, not supported by the device!");
+
+    // the constants read from the buffer of the material manager, at the slot pushed with the draw constants
+    const ionBool constantsBuffer = _material->UseConstantsBuffer() && _material->GetConstantsShaders().IsValid();
+    ionAssertReturnVoid(!constantsBuffer || _material->UseDrawConstants(), "The material " << _material->GetName() << " reads its constants from the buffer but does not push its slot with the draw constants!");
+
     // Descriptor Set Layout
     {
         ionVector<VkDescriptorSetLayoutBinding, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator> layoutBindings;
@@ -306,14 +318,14 @@ void ShaderProgramHelper::CreateDescriptorSetLayout(const VkDevice& _device, Sha
             ionSize uniformCount = _material->GetVertexShaderLayout().m_uniforms.size();
             for (ionSize i = 0; i < uniformCount; ++i)
             {
-                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
                 binding.binding = _material->GetVertexShaderLayout().m_uniforms[i].m_bindingIndex;
                 layoutBindings.push_back(binding);
 
                 _shaderProgram.m_bindings.push_back(EShaderBinding_Uniform);
             }
 
-            ionSize samplerCount = _material->GetVertexShaderLayout().m_samplers.size();
+            ionSize samplerCount = bindlessTextures ? 0 : _material->GetVertexShaderLayout().m_samplers.size();
             for (ionSize i = 0; i < samplerCount; ++i)
             {
                 binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -341,14 +353,14 @@ void ShaderProgramHelper::CreateDescriptorSetLayout(const VkDevice& _device, Sha
             ionSize uniformCount = _material->GetTessellationControlShaderLayout().m_uniforms.size();
             for (ionSize i = 0; i < uniformCount; ++i)
             {
-                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
                 binding.binding = _material->GetTessellationControlShaderLayout().m_uniforms[i].m_bindingIndex;
                 layoutBindings.push_back(binding);
 
                 _shaderProgram.m_bindings.push_back(EShaderBinding_Uniform);
             }
 
-            ionSize samplerCount = _material->GetTessellationControlShaderLayout().m_samplers.size();
+            ionSize samplerCount = bindlessTextures ? 0 : _material->GetTessellationControlShaderLayout().m_samplers.size();
             for (ionSize i = 0; i < samplerCount; ++i)
             {
                 binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -376,14 +388,14 @@ void ShaderProgramHelper::CreateDescriptorSetLayout(const VkDevice& _device, Sha
             ionSize uniformCount = _material->GetTessellationEvaluatorShaderLayout().m_uniforms.size();
             for (ionSize i = 0; i < uniformCount; ++i)
             {
-                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
                 binding.binding = _material->GetTessellationEvaluatorShaderLayout().m_uniforms[i].m_bindingIndex;
                 layoutBindings.push_back(binding);
 
                 _shaderProgram.m_bindings.push_back(EShaderBinding_Uniform);
             }
 
-            ionSize samplerCount = _material->GetTessellationEvaluatorShaderLayout().m_samplers.size();
+            ionSize samplerCount = bindlessTextures ? 0 : _material->GetTessellationEvaluatorShaderLayout().m_samplers.size();
             for (ionSize i = 0; i < samplerCount; ++i)
             {
                 binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -411,14 +423,14 @@ void ShaderProgramHelper::CreateDescriptorSetLayout(const VkDevice& _device, Sha
             ionSize uniformCount = _material->GetGeometryShaderLayout().m_uniforms.size();
             for (ionSize i = 0; i < uniformCount; ++i)
             {
-                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
                 binding.binding = _material->GetGeometryShaderLayout().m_uniforms[i].m_bindingIndex;
                 layoutBindings.push_back(binding);
 
                 _shaderProgram.m_bindings.push_back(EShaderBinding_Uniform);
             }
 
-            ionSize samplerCount = _material->GetGeometryShaderLayout().m_samplers.size();
+            ionSize samplerCount = bindlessTextures ? 0 : _material->GetGeometryShaderLayout().m_samplers.size();
             for (ionSize i = 0; i < samplerCount; ++i)
             {
                 binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -446,14 +458,14 @@ void ShaderProgramHelper::CreateDescriptorSetLayout(const VkDevice& _device, Sha
             ionSize uniformCount = _material->GetFragmentShaderLayout().m_uniforms.size();
             for (ionSize i = 0; i < uniformCount; ++i)
             {
-                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
                 binding.binding = _material->GetFragmentShaderLayout().m_uniforms[i].m_bindingIndex;
                 layoutBindings.push_back(binding);
 
                 _shaderProgram.m_bindings.push_back(EShaderBinding_Uniform);
             }
 
-            ionSize samplerCount = _material->GetFragmentShaderLayout().m_samplers.size();
+            ionSize samplerCount = bindlessTextures ? 0 : _material->GetFragmentShaderLayout().m_samplers.size();
             for (ionSize i = 0; i < samplerCount; ++i)
             {
                 binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -474,6 +486,16 @@ void ShaderProgramHelper::CreateDescriptorSetLayout(const VkDevice& _device, Sha
             }
         }
 
+        if (constantsBuffer)
+        {
+            binding.stageFlags = _material->GetConstantsShaders().m_runtimeStages;
+            binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            binding.binding = static_cast<ionU32>(_material->GetConstantsBufferBinding());
+            layoutBindings.push_back(binding);
+
+            _shaderProgram.m_bindings.push_back(EShaderBinding_MaterialConstants);
+        }
+
         VkDescriptorSetLayoutCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         createInfo.bindingCount = (ionU32)layoutBindings.size();
@@ -488,18 +510,82 @@ void ShaderProgramHelper::CreateDescriptorSetLayout(const VkDevice& _device, Sha
     {
         VkPipelineLayoutCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        createInfo.setLayoutCount = 1;
-        createInfo.pSetLayouts = &_shaderProgram.m_descriptorSetLayout;
+        const VkDescriptorSetLayout setLayouts[] = { _shaderProgram.m_descriptorSetLayout, ionTextureManger().GetBindlessTextureTable().GetDescriptorSetLayout() };
+
+        createInfo.setLayoutCount = bindlessTextures ? 2 : 1;
+        createInfo.pSetLayouts = setLayouts;
 
-        if (_material->GetConstantsShaders().IsValid())
+        VkPushConstantRange pushConstantRanges[3] = {};
+
+        const VkShaderStageFlags constantsStages = _material->GetConstantsShaders().IsValid() && !constantsBuffer ? _material->GetConstantsShaders().m_runtimeStages : 0;
+        const VkShaderStageFlags drawConstantsStages = _material->GetDrawConstantsStages();
+        const VkShaderStageFlags bindlessTexturesStages = bindlessTextures ? _material->GetBindlessTexturesStages() : 0;
+
+        _shaderProgram.m_constantsStages = constantsStages;
+        _shaderProgram.m_drawConstantsStages = drawConstantsStages;
+        _shaderProgram.m_drawConstantsOffset = _material->GetDrawConstantsOffset();
+        _shaderProgram.m_bindlessTexturesStages = bindlessTexturesStages;
+        _shaderProgram.m_bindlessTexturesOffset = _material->GetBindlessTexturesOffset();
+
+        if ((constantsStages & drawConstantsStages) != 0 || (constantsStages & bindlessTexturesStages) != 0 || (drawConstantsStages & bindlessTexturesStages) != 0)
         {
-            VkPushConstantRange pushConstantRange{};
-            pushConstantRange.stageFlags = _material->GetConstantsShaders().m_runtimeStages;
-            pushConstantRange.offset = 0;
-            pushConstantRange.size = static_cast<ionU32>(_material->GetConstantsShaders().GetSizeByte());
+            // two ranges cannot share a stage, so a single range for all and every push has to name all its stages
+            const VkShaderStageFlags allStages = constantsStages | drawConstantsStages | bindlessTexturesStages;
+            _shaderProgram.m_constantsStages = constantsStages != 0 ? allStages : 0;
+            _shaderProgram.m_drawConstantsStages = drawConstantsStages != 0 ? allStages : 0;
+            _shaderProgram.m_bindlessTexturesStages = bindlessTexturesStages != 0 ? allStages : 0;
+
+            pushConstantRanges[0].stageFlags = allStages;
+            pushConstantRanges[0].offset = 0;
+            pushConstantRanges[0].size = bindlessTexturesStages != 0 ? _shaderProgram.m_bindlessTexturesOffset + sizeof(BindlessTextureIndices) : _shaderProgram.m_drawConstantsOffset + sizeof(DrawConstants);
 
             createInfo.pushConstantRangeCount = 1;
-            createInfo.pPushConstantRanges = &pushConstantRange;
+        }
+        else
+        {
+            if (constantsStages != 0)
+            {
+                VkPushConstantRange& pushConstantRange = pushConstantRanges[createInfo.pushConstantRangeCount++];
+                pushConstantRange.stageFlags = constantsStages;
+                pushConstantRange.offset = 0;
+                pushConstantRange.size = static_cast<ionU32>(_material->GetConstantsShaders().GetSizeByte());
+
+                // the block declared by the shaders can be larger than the values of the material, the range has to cover it
+                if (drawConstantsStages == 0 && bindlessTexturesStages == 0)
+                {
+                    const Shader* shaders[] = { _vertexShader, _tessellationControlShader, _tessellationEvaluatorShader, _geometryShader, _fragmentShader };
+                    for (const Shader* shader : shaders)
+                    {
+                        if (shader != nullptr && shader->IsValid() && shader->m_reflection.m_pushConstantsSize > pushConstantRange.size)
+                        {
+                            pushConstantRange.size = shader->m_reflection.m_pushConstantsSize;
+                        }
+                    }
+                }
+            }
+
+            if (drawConstantsStages != 0)
+            {
+                VkPushConstantRange& pushConstantRange = pushConstantRanges[createInfo.pushConstantRangeCount++];
+                pushConstantRange.stageFlags = drawConstantsStages;
+                pushConstantRange.offset = _shaderProgram.m_drawConstantsOffset;
+                pushConstantRange.size = sizeof(DrawConstants);
+            }
+
+            if (bindlessTexturesStages != 0)
+            {
+                VkPushConstantRange& pushConstantRange = pushConstantRanges[createInfo.pushConstantRangeCount++];
+                pushConstantRange.stageFlags = bindlessTexturesStages;
+                pushConstantRange.offset = _shaderProgram.m_bindlessTexturesOffset;
+                pushConstantRange.size = sizeof(BindlessTextureIndices);
+            }
+        }
+
+        createInfo.pPushConstantRanges = createInfo.pushConstantRangeCount > 0 ? pushConstantRanges : nullptr;
+
+        for (ionU32 i = 0; i < createInfo.pushConstantRangeCount; ++i)
+        {
+            ionAssertReturnVoid(pushConstantRanges[i].offset + pushConstantRanges[i].size <= _maxPushConstantsSize, "The push constants of the material " << _material->GetName() << " exceed the maxPushConstantsSize of the device!");
         }
 
         VkResult result = vkCreatePipelineLayout(_device, &createInfo, vkMemory, &_shaderProgram.m_pipelineLayout);
@@ -551,6 +637,121 @@ VkStencilOpState ShaderProgramHelper::GetStencilOpState(ionU64 _stencilStateBits
     return state;
 }
 
+VkCullModeFlags ShaderProgramHelper::GetCullMode(ionU64 _stateBits)
+{
+    switch (_stateBits & ECullingMode_Bits)
+    {
+    case ECullingMode_TwoSide:
+        return VK_CULL_MODE_NONE;
+    case ECullingMode_Back:
+        if (_stateBits & ERasterization_View_Specular)
+        {
+            return VK_CULL_MODE_FRONT_BIT;
+        }
+        else 
+        {
+            return VK_CULL_MODE_BACK_BIT;
+        }
+    case ECullingMode_Front:
+    default:
+        if (_stateBits & ERasterization_View_Specular)
+        {
+            return VK_CULL_MODE_BACK_BIT;
+        }
+        else 
+        {
+            return VK_CULL_MODE_FRONT_BIT;
+        }
+    }
+}
+
+VkFrontFace ShaderProgramHelper::GetFrontFace(ionU64 _stateBits)
+{
+    return (_stateBits & ERasterization_Face_Clockwise) ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+}
+
+VkPipelineDepthStencilStateCreateInfo ShaderProgramHelper::GetDepthStencilState(ionU64 _stateBits, ionBool _depthBounds)
+{
+    VkPipelineDepthStencilStateCreateInfo depthStencilState = {};
+
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_ALWAYS;
+    switch (_stateBits & EDepthFunction_Bits)
+    {
+    case EDepthFunction_Equal:        depthCompareOp = VK_COMPARE_OP_EQUAL; break;
+    case EDepthFunction_Always:        depthCompareOp = VK_COMPARE_OP_ALWAYS; break;
+    case EDepthFunction_Less:        depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL; break;
+    case EDepthFunction_Greater:    depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL; break;
+    }
+
+    VkCompareOp stencilFrontCompareOp = VK_COMPARE_OP_ALWAYS;
+    switch (_stateBits & EStencilFrontFunction_Bits)
+    {
+    case EStencilFrontFunction_Never:            stencilFrontCompareOp = VK_COMPARE_OP_NEVER; break;
+    case EStencilFrontFunction_Lesser:            stencilFrontCompareOp = VK_COMPARE_OP_LESS; break;
+    case EStencilFrontFunction_Equal:            stencilFrontCompareOp = VK_COMPARE_OP_EQUAL; break;
+    case EStencilFrontFunction_LesserOrEqual:    stencilFrontCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL; break;
+    case EStencilFrontFunction_Greater:            stencilFrontCompareOp = VK_COMPARE_OP_GREATER; break;
+    case EStencilFrontFunction_NotEqual:        stencilFrontCompareOp = VK_COMPARE_OP_NOT_EQUAL; break;
+    case EStencilFrontFunction_GreaterOrEqual:    stencilFrontCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL; break;
+    case EStencilFrontFunction_Always:            stencilFrontCompareOp = VK_COMPARE_OP_ALWAYS; break;
+    }
+
+    VkCompareOp stencilBackCompareOp = VK_COMPARE_OP_ALWAYS;
+    switch (_stateBits & EStencilBackFunction_Bits)
+    {
+    case EStencilBackFunction_Never:            stencilBackCompareOp = VK_COMPARE_OP_NEVER; break;
+    case EStencilBackFunction_Lesser:            stencilBackCompareOp = VK_COMPARE_OP_LESS; break;
+    case EStencilBackFunction_Equal:            stencilBackCompareOp = VK_COMPARE_OP_EQUAL; break;
+    case EStencilBackFunction_LesserOrEqual:    stencilBackCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL; break;
+    case EStencilBackFunction_Greater:            stencilBackCompareOp = VK_COMPARE_OP_GREATER; break;
+    case EStencilBackFunction_NotEqual:        stencilBackCompareOp = VK_COMPARE_OP_NOT_EQUAL; break;
+    case EStencilBackFunction_GreaterOrEqual:    stencilBackCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL; break;
+    case EStencilBackFunction_Always:            stencilBackCompareOp = VK_COMPARE_OP_ALWAYS; break;
+    }
+
+    depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilState.depthTestEnable = (_stateBits & EColorMask_Depth) == 0;   //VK_TRUE;
+    depthStencilState.depthWriteEnable = (_stateBits & EColorMask_Depth) == 0;  //(_stateBits & EColorMask_Depth) == 0;
+    depthStencilState.depthCompareOp = depthCompareOp;
+
+    if (_depthBounds)
+    {
+        depthStencilState.depthBoundsTestEnable = (_stateBits & ERasterization_DepthTest_Mask) != 0;
+        depthStencilState.minDepthBounds = 0.0f;
+        depthStencilState.maxDepthBounds = 1.0f;
+    }
+    depthStencilState.stencilTestEnable = (_stateBits & (EStencilFrontFunction_Bits | EStencilOperator_Bits)) != 0;
+
+    ionU32 ref = ionU32((_stateBits & EStencilFunctionReference_RefBits) >> EStencilFunctionReference_RefShift);
+    ionU32 mask = ionU32((_stateBits & EStencilFunctionReference_MaskBits) >> EStencilFunctionReference_MaskShift);
+
+    if (_stateBits & EStencilSeparate_Stencil)
+    {
+        depthStencilState.front = GetStencilOpState(_stateBits & EStencilFrontOperator_Bits);
+        depthStencilState.front.writeMask = 0xFFFFFFFF;
+        depthStencilState.front.compareOp = stencilFrontCompareOp;
+        depthStencilState.front.compareMask = mask;
+        depthStencilState.front.reference = ref;
+
+        depthStencilState.back = GetStencilOpState((_stateBits & EStencilBackOperator_Bits) >> 12);
+        depthStencilState.back.writeMask = 0xFFFFFFFF;
+        depthStencilState.back.compareOp = stencilBackCompareOp;
+        depthStencilState.back.compareMask = mask;
+        depthStencilState.back.reference = ref;
+    }
+    else
+    {
+        depthStencilState.front = GetStencilOpState(_stateBits);
+        depthStencilState.front.writeMask = 0xFFFFFFFF;
+        depthStencilState.front.compareOp = stencilFrontCompareOp;
+        depthStencilState.front.compareMask = mask;
+        depthStencilState.front.reference = ref;
+        depthStencilState.back = depthStencilState.front;
+    }
+
+    return depthStencilState;
+}
+
 VkPipeline ShaderProgramHelper::CreateGraphicsPipeline(const RenderCore& _render, VkRenderPass _renderPass, VkPrimitiveTopology _topology, EVertexLayout _vertexLayoutType, VkPipelineLayout _pipelineLayout, ionU64 _stateBits, 
     VkShaderModule _vertexShader /*= VK_NULL_HANDLE*/, VkShaderModule _fragmentShader /*= VK_NULL_HANDLE*/, VkShaderModule _tessellationControlShader /*= VK_NULL_HANDLE*/, VkShaderModule _tessellationEvaluatorShader /*= VK_NULL_HANDLE*/, VkShaderModule _geometryShader /*= VK_NULL_HANDLE*/,
     SpecializationConstants* _vertexSpecConst /*= nullptr*/, SpecializationConstants* _fragmentSpecConst /*= nullptr*/, SpecializationConstants* _tessCtrlSpecConst /*= nullptr*/, SpecializationConstants* _tessEvalSpecConst /*= nullptr*/, SpecializationConstants* _geomSpecConst /*= nullptr*/)
@@ -572,37 +773,10 @@ VkPipeline ShaderProgramHelper::CreateGraphicsPipeline(const RenderCore& _render
     rasterizationState.rasterizerDiscardEnable = VK_FALSE;
     rasterizationState.depthBiasEnable = (_stateBits & ERasterization_PolygonMode_Offset) != 0;
     rasterizationState.depthClampEnable = VK_FALSE;
-    rasterizationState.frontFace = (_stateBits & ERasterization_Face_Clockwise) ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizationState.frontFace = GetFrontFace(_stateBits);
     rasterizationState.lineWidth = 1.0f;
     rasterizationState.polygonMode = (_stateBits & ERasterization_PolygonMode_Line) ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
-
-    switch (_stateBits & ECullingMode_Bits)
-    {
-    case ECullingMode_TwoSide:
-        rasterizationState.cullMode = VK_CULL_MODE_NONE;
-        break;
-    case ECullingMode_Back:
-        if (_stateBits & ERasterization_View_Specular)
-        {
-            rasterizationState.cullMode = VK_CULL_MODE_FRONT_BIT;
-        }
-        else 
-        {
-            rasterizationState.cullMode = VK_CULL_MODE_BACK_BIT;
-        }
-        break;
-    case ECullingMode_Front:
-    default:
-        if (_stateBits & ERasterization_View_Specular)
-        {
-            rasterizationState.cullMode = VK_CULL_MODE_BACK_BIT;
-        }
-        else 
-        {
-            rasterizationState.cullMode = VK_CULL_MODE_FRONT_BIT;
-        }
-        break;
-    }
+    rasterizationState.cullMode = GetCullMode(_stateBits);
 
     VkPipelineColorBlendAttachmentState colorBlendAttachmentState = {};
     {
@@ -661,84 +835,8 @@ VkPipeline ShaderProgramHelper::CreateGraphicsPipeline(const RenderCore& _render
     colorBlendState.attachmentCount = 1;
     colorBlendState.pAttachments = &colorBlendAttachmentState;
 
-    VkPipelineDepthStencilStateCreateInfo depthStencilState = {};
-    {
-        VkCompareOp depthCompareOp = VK_COMPARE_OP_ALWAYS;
-        switch (_stateBits & EDepthFunction_Bits)
-        {
-        case EDepthFunction_Equal:        depthCompareOp = VK_COMPARE_OP_EQUAL; break;
-        case EDepthFunction_Always:        depthCompareOp = VK_COMPARE_OP_ALWAYS; break;
-        case EDepthFunction_Less:        depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL; break;
-        case EDepthFunction_Greater:    depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL; break;
-        }
-
-        VkCompareOp stencilFrontCompareOp = VK_COMPARE_OP_ALWAYS;
-        switch (_stateBits & EStencilFrontFunction_Bits)
-        {
-        case EStencilFrontFunction_Never:            stencilFrontCompareOp = VK_COMPARE_OP_NEVER; break;
-        case EStencilFrontFunction_Lesser:            stencilFrontCompareOp = VK_COMPARE_OP_LESS; break;
-        case EStencilFrontFunction_Equal:            stencilFrontCompareOp = VK_COMPARE_OP_EQUAL; break;
-        case EStencilFrontFunction_LesserOrEqual:    stencilFrontCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL; break;
-        case EStencilFrontFunction_Greater:            stencilFrontCompareOp = VK_COMPARE_OP_GREATER; break;
-        case EStencilFrontFunction_NotEqual:        stencilFrontCompareOp = VK_COMPARE_OP_NOT_EQUAL; break;
-        case EStencilFrontFunction_GreaterOrEqual:    stencilFrontCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL; break;
-        case EStencilFrontFunction_Always:            stencilFrontCompareOp = VK_COMPARE_OP_ALWAYS; break;
-        }
-
-        VkCompareOp stencilBackCompareOp = VK_COMPARE_OP_ALWAYS;
-        switch (_stateBits & EStencilBackFunction_Bits)
-        {
-        case EStencilBackFunction_Never:            stencilBackCompareOp = VK_COMPARE_OP_NEVER; break;
-        case EStencilBackFunction_Lesser:            stencilBackCompareOp = VK_COMPARE_OP_LESS; break;
-        case EStencilBackFunction_Equal:            stencilBackCompareOp = VK_COMPARE_OP_EQUAL; break;
-        case EStencilBackFunction_LesserOrEqual:    stencilBackCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL; break;
-        case EStencilBackFunction_Greater:            stencilBackCompareOp = VK_COMPARE_OP_GREATER; break;
-        case EStencilBackFunction_NotEqual:        stencilBackCompareOp = VK_COMPARE_OP_NOT_EQUAL; break;
-        case EStencilBackFunction_GreaterOrEqual:    stencilBackCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL; break;
-        case EStencilBackFunction_Always:            stencilBackCompareOp = VK_COMPARE_OP_ALWAYS; break;
-        }
-
-        depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        depthStencilState.depthTestEnable = (_stateBits & EColorMask_Depth) == 0;   //VK_TRUE;
-        depthStencilState.depthWriteEnable = (_stateBits & EColorMask_Depth) == 0;  //(_stateBits & EColorMask_Depth) == 0;
-        depthStencilState.depthCompareOp = depthCompareOp;
-
-        if (_render.GetGPU().m_vkPhysicalDevFeatures.depthBounds)
-        {
-            depthStencilState.depthBoundsTestEnable = (_stateBits & ERasterization_DepthTest_Mask) != 0;
-            depthStencilState.minDepthBounds = 0.0f;
-            depthStencilState.maxDepthBounds = 1.0f;
-        }
-        depthStencilState.stencilTestEnable = (_stateBits & (EStencilFrontFunction_Bits | EStencilOperator_Bits)) != 0;
+    const VkPipelineDepthStencilStateCreateInfo depthStencilState = GetDepthStencilState(_stateBits, _render.GetGPU().m_vkPhysicalDevFeatures.depthBounds == VK_TRUE);
 
-        ionU32 ref = ionU32((_stateBits & EStencilFunctionReference_RefBits) >> EStencilFunctionReference_RefShift);
-        ionU32 mask = ionU32((_stateBits & EStencilFunctionReference_MaskBits) >> EStencilFunctionReference_MaskShift);
-
-        if (_stateBits & EStencilSeparate_Stencil)
-        {
-            depthStencilState.front = GetStencilOpState(_stateBits & EStencilFrontOperator_Bits);
-            depthStencilState.front.writeMask = 0xFFFFFFFF;
-            depthStencilState.front.compareOp = stencilFrontCompareOp;
-            depthStencilState.front.compareMask = mask;
-            depthStencilState.front.reference = ref;
-
-            depthStencilState.back = GetStencilOpState((_stateBits & EStencilBackOperator_Bits) >> 12);
-            depthStencilState.back.writeMask = 0xFFFFFFFF;
-            depthStencilState.back.compareOp = stencilBackCompareOp;
-            depthStencilState.back.compareMask = mask;
-            depthStencilState.back.reference = ref;
-        }
-        else
-        {
-            depthStencilState.front = GetStencilOpState(_stateBits);
-            depthStencilState.front.writeMask = 0xFFFFFFFF;
-            depthStencilState.front.compareOp = stencilFrontCompareOp;
-            depthStencilState.front.compareMask = mask;
-            depthStencilState.front.reference = ref;
-            depthStencilState.back = depthStencilState.front;
-        }
-       
-    }
     // IMPORTANT: These two lines worked for PBR opaque! Keep in mind!
     //depthStencilState.front = depthStencilState.back;
     //depthStencilState.back.compareOp = VK_COMPARE_OP_ALWAYS; 
@@ -827,16 +925,41 @@ VkPipeline ShaderProgramHelper::CreateGraphicsPipeline(const RenderCore& _render
     dynamic.push_back(VK_DYNAMIC_STATE_SCISSOR);
     dynamic.push_back(VK_DYNAMIC_STATE_VIEWPORT);
 
-    if (_stateBits & ERasterization_PolygonMode_Offset)
+    // with the extended dynamic state the values in the create info above are ignored, see RenderCore::ApplyDynamicState
+    const ionBool depthBounds = _render.GetGPU().m_vkPhysicalDevFeatures.depthBounds == VK_TRUE;
+    if (_render.UseExtendedDynamicState())
     {
-        dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS);
+        dynamic.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+        dynamic.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+        dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+        dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+        dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+        dynamic.push_back(VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT);
+        dynamic.push_back(VK_DYNAMIC_STATE_STENCIL_OP_EXT);
+        dynamic.push_back(VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK);
+        dynamic.push_back(VK_DYNAMIC_STATE_STENCIL_REFERENCE);
+
+        if (depthBounds)
+        {
+            dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT);
+            dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_BOUNDS);
+        }
     }
-
-    if (_render.GetGPU().m_vkPhysicalDevFeatures.depthBounds && (_stateBits & ERasterization_DepthTest_Mask))
+    else if (depthBounds && (_stateBits & ERasterization_DepthTest_Mask))
     {
         dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_BOUNDS);
     }
 
+    if (_render.UseExtendedDynamicState2())
+    {
+        dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT);
+        dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS);
+    }
+    else if (_stateBits & ERasterization_PolygonMode_Offset)
+    {
+        dynamic.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS);
+    }
+
     VkPipelineDynamicStateCreateInfo dynamicState = {};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
     dynamicState.dynamicStateCount = static_cast<ionU32>(dynamic.size());
@@ -41,11 +41,16 @@ public:
 
     static void CreateVertexDescriptor();
     static void CreateDescriptorPools(const VkDevice& _device, VkDescriptorPool& _pool);
-    static void CreateDescriptorSetLayout(const VkDevice& _device, ShaderProgram& _shaderProgram, const Shader* _vertexShader, const Shader* _fragmentShader, const Shader* _tessellationControlShader, const Shader* _tessellationEvaluatorShader, const Shader* _geometryShader, const Material* _material);
+    static void CreateDescriptorSetLayout(const VkDevice& _device, ionU32 _maxPushConstantsSize, ShaderProgram& _shaderProgram, const Shader* _vertexShader, const Shader* _fragmentShader, const Shader* _tessellationControlShader, const Shader* _tessellationEvaluatorShader, const Shader* _geometryShader, const Material* _material);
     static VkPipeline CreateGraphicsPipeline(const RenderCore& _render, VkRenderPass _renderPass, VkPrimitiveTopology _topology, EVertexLayout _vertexLayoutType, VkPipelineLayout _pipelineLayout, ionU64 _stateBits, 
         VkShaderModule _vertexShader = VK_NULL_HANDLE, VkShaderModule _fragmentShader = VK_NULL_HANDLE, VkShaderModule _tessellationControlShader = VK_NULL_HANDLE, VkShaderModule _tessellationEvaluatorShader = VK_NULL_HANDLE, VkShaderModule _geometryShader = VK_NULL_HANDLE,
         SpecializationConstants* _vertexSpecConst = nullptr, SpecializationConstants* _fragmentSpecConst = nullptr, SpecializationConstants* _tessCtrlSpecConst = nullptr, SpecializationConstants* _tessEvalSpecConst = nullptr, SpecializationConstants* _geomSpecConst = nullptr);
 
+    // the fixed function state from the render state bits, shared by the pipeline creation and the dynamic state set while recording
+    static VkCullModeFlags GetCullMode(ionU64 _stateBits);
+    static VkFrontFace GetFrontFace(ionU64 _stateBits);
+    static VkPipelineDepthStencilStateCreateInfo GetDepthStencilState(ionU64 _stateBits, ionBool _depthBounds);
+
 private:
     static VkStencilOpState GetStencilOpState(ionU64 _stencilStateBits);
 
@@ -5,6 +5,11 @@
 
 #include "ShaderProgramManager.h"
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
 #include "../GPU/GpuDataStructure.h"
 #include "../GPU/GpuMemoryAllocator.h"
 #include "../GPU/GpuMemoryManager.h"
@@ -16,14 +21,48 @@
 
 #include "../Renderer/VertexCacheManager.h"
 #include "../Texture/Texture.h"
+#include "../Texture/TextureManager.h"
 
 #include "../Material/Material.h"
+#include "../Material/MaterialManager.h"
+
+#include "../Utilities/Tools.h"
 
 
+#define ION_PIPELINE_MANIFEST_FILENAME  "PipelineManifest.bin"
+#define ION_PIPELINE_MANIFEST_MAGIC     0x464D5049      // "IPMF"
+#define ION_PIPELINE_MANIFEST_VERSION   1
+
 EOS_USING_NAMESPACE
 
 ION_NAMESPACE_BEGIN
 
+struct PipelineManifestHeader
+{
+    ionU32  m_magic;
+    ionU32  m_version;
+    ionU64  m_count;
+    ionU64  m_dataHash;
+};
+
+namespace
+{
+    // the name is the only identity of a material stable between runs, unnamed materials are not recorded
+    ION_INLINE ionU64 MaterialNameHash(const Material* _material)
+    {
+        const ionString& name = _material->GetName();
+        return name.empty() ? 0 : Tools::HashFNV1a64(name.c_str(), name.size());
+    }
+
+    ION_INLINE ionU64 PipelineManifestKey(ionU64 _materialHash, ionU64 _stateBits)
+    {
+        return Tools::HashFNV1a64(&_stateBits, sizeof(_stateBits), _materialHash);
+    }
+
+    // bytes written in a uniform block by a parameter, indexed by EBufferParameterType
+    const ionU32 kParameterTypeSize[EBufferParameterType_Count] = { sizeof(Matrix4x4), sizeof(Vector4), sizeof(ionFloat), sizeof(ionS32) };
+}
+
 ShaderProgramManagerAllocator* ShaderProgramManager::GetAllocator()
 {
 	static HeapArea<Settings::kShaderProgamHelperAllocatorSize> memoryArea;
@@ -35,9 +74,22 @@ ShaderProgramManagerAllocator* ShaderProgramManager::GetAllocator()
 
 ShaderProgramManager::ShaderProgramManager() :
     m_current(0),
-    m_currentDescSet(0),
-    m_currentParmBufferOffset(0)
+    m_maxPushConstantsSize(128),
+    m_programGeneration(1),
+    m_prewarmedPipelineCount(0),
+    m_fallbackDrawCount(0),
+    m_skippedDrawCount(0),
+    m_frame(0),
+    m_asyncPipelineCompilation(true),
+    m_pipelineManifestChanged(false),
+    m_currentParmBufferOffset(0),
+    m_frameParmBufferSize(0),
+    m_frameParmBufferEnd(0),
+    m_skinningUniformBuffer(nullptr),
+    m_uniformBuffer(nullptr),
+    m_uniformBufferData(nullptr)
 {
+    memset(&m_descriptorStatistics, 0, sizeof(m_descriptorStatistics));
 }
 
 ShaderProgramManager::~ShaderProgramManager()
@@ -51,20 +103,27 @@ ShaderProgramManager& ShaderProgramManager::Instance()
     return instance;
 }
 
-ionBool ShaderProgramManager::Init(VkDevice _vkDevice)
+ionBool ShaderProgramManager::Init(VkDevice _vkDevice, ionU32 _framesInFlight, ionU32 _maxPushConstantsSize)
 {
     m_vkDevice = _vkDevice;
+    m_maxPushConstantsSize = _maxPushConstantsSize;
 
     ShaderProgramHelper::CreateVertexDescriptor();
 
     ShaderProgramHelper::CreateDescriptorPools(m_vkDevice, m_descriptorPool);
 
     m_uniformBuffer = ionNew(UniformBuffer, GetAllocator());
-    m_uniformBuffer->Alloc(m_vkDevice, nullptr, ION_MAX_DESCRIPTOR_SETS * ION_MAX_DESCRIPTOR_SET_UNIFORMS, EBufferUsage_Dynamic);
+    m_frameParmBufferSize = ION_MAX_DESCRIPTOR_SETS * ION_MAX_DESCRIPTOR_SET_UNIFORMS;
+    m_uniformBuffer->Alloc(m_vkDevice, nullptr, m_frameParmBufferSize * _framesInFlight, EBufferUsage_Dynamic);
+    m_uniformBufferData = static_cast<ionU8*>(m_uniformBuffer->MapBuffer(EBufferMappingType_Write));
 
     m_skinningUniformBuffer = ionNew(UniformBuffer, GetAllocator());
     m_skinningUniformBuffer->Alloc(m_vkDevice, nullptr, sizeof(Vector4), EBufferUsage_Dynamic);
 
+    LoadPipelineManifest();
+
+    m_pipelineCompiler.Init();
+
     return true;
 }
 
@@ -72,6 +131,9 @@ void ShaderProgramManager::UnloadShader(ionSize _index)
 {
     ionAssertReturnVoid(_index >= 0 && _index < m_shaders.size(), "index out of bound");
 
+    // the queued pipelines can be created from this module, so they are completed before destroying it
+    WaitPipelineCompilation();
+
     Shader* shader = m_shaders[_index];
     vkDestroyShaderModule(m_vkDevice, shader->m_shaderModule, vkMemory);
     shader->m_shaderModule = VK_NULL_HANDLE;
@@ -81,6 +143,14 @@ void ShaderProgramManager::UnloadShader(ionSize _index)
 
 void ShaderProgramManager::Shutdown()
 {
+    SavePipelineManifest();
+    m_pipelineManifest.clear();
+
+    // the queued requests refer to the shaders and the programs destroyed below
+    m_pipelineCompiler.WaitIdle();
+    ResolveCompiledPipelines();
+    m_pipelineCompiler.Shutdown();
+
     for (ionSize i = 0; i < m_shaders.size(); ++i) 
     {
 		UnloadShader(i);
@@ -94,29 +164,43 @@ void ShaderProgramManager::Shutdown()
         {
             vkDestroyPipeline(m_vkDevice, shaderProgram.m_pipelines[j].m_pipeline, vkMemory);
         }
-        shaderProgram.m_pipelines.clear();
+        shaderProgram.ClearPipelines();
 
         vkDestroyPipelineLayout(m_vkDevice, shaderProgram.m_pipelineLayout, vkMemory);
         vkDestroyDescriptorSetLayout(m_vkDevice, shaderProgram.m_descriptorSetLayout, vkMemory);
     }
     m_shaderPrograms.clear();
+    ++m_programGeneration;
 
+    m_uniformBuffer->UnmapBuffer();
     m_uniformBuffer->Free();
     ionDelete(m_uniformBuffer, GetAllocator());
     m_uniformBuffer = nullptr;
+    m_uniformBufferData = nullptr;
+
+    for (ionU32 i = 0; i < EBufferParameterType_Count; ++i)
+    {
+        m_renderParamSlots[i].clear();
+    }
+    m_renderParamMatrices.clear();
+    m_renderParamVectors.clear();
+    m_renderParamFloats.clear();
+    m_renderParamIntegers.clear();
+    for (ionU32 i = 0; i < EBufferParameterType_Count; ++i)
+    {
+        m_renderParamScene[i].clear();
+    }
+    m_sceneBlocks.clear();
 
     m_skinningUniformBuffer->Free();
     ionDelete(m_skinningUniformBuffer, GetAllocator());
     m_skinningUniformBuffer = nullptr;
 
- 
+    // the sets of the programs go with the pool
+    m_retiredDescriptorSets.clear();
+
     vkResetDescriptorPool(m_vkDevice, m_descriptorPool, 0);
     vkDestroyDescriptorPool(m_vkDevice, m_descriptorPool, vkMemory);
-
-    memset(m_descriptorSets, 0, sizeof(m_descriptorSets));
-
-
-    m_currentDescSet = 0;
 }
 
 
@@ -124,235 +208,277 @@ void ShaderProgramManager::Shutdown()
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
+ionU32 ShaderProgramManager::GetRenderParamSlot(ionSize _paramHash, EBufferParameterType _type)
+{
+    ionAssertReturnValue(_type < EBufferParameterType_Count, "Invalid parameter type!", 0);
+
+    ionMap<ionSize, ionU32, ShaderProgramManagerAllocator, GetAllocator>& slots = m_renderParamSlots[_type];
+
+    auto search = slots.find(_paramHash);
+    if (search != slots.end())
+    {
+        return search->second;
+    }
+
+    ionU32 slot = 0;
+    switch (_type)
+    {
+    case EBufferParameterType_Matrix:
+        slot = static_cast<ionU32>(m_renderParamMatrices.size());
+        m_renderParamMatrices.push_back(Matrix4x4());
+        break;
+    case EBufferParameterType_Vector:
+        slot = static_cast<ionU32>(m_renderParamVectors.size());
+        m_renderParamVectors.push_back(Vector4());
+        break;
+    case EBufferParameterType_Float:
+        slot = static_cast<ionU32>(m_renderParamFloats.size());
+        m_renderParamFloats.push_back(0.0f);
+        break;
+    case EBufferParameterType_Integer:
+        slot = static_cast<ionU32>(m_renderParamIntegers.size());
+        m_renderParamIntegers.push_back(0);
+        break;
+    default:
+        break;
+    }
+
+    m_renderParamScene[_type].push_back(0);
+
+    slots[_paramHash] = slot;
+
+    return slot;
+}
+
+ionU32 ShaderProgramManager::GetSceneRenderParamSlot(ionSize _paramHash, EBufferParameterType _type)
+{
+    const ionU32 slot = GetRenderParamSlot(_paramHash, _type);
+    if (_type < EBufferParameterType_Count)
+    {
+        m_renderParamScene[_type][slot] = 1;
+    }
+    return slot;
+}
+
+ionU32 ShaderProgramManager::GetRenderParamSlotToWrite(ionSize _paramHash, EBufferParameterType _type)
+{
+    const ionU32 slot = GetRenderParamSlot(_paramHash, _type);
+    if (_type < EBufferParameterType_Count && m_renderParamScene[_type][slot] != 0)
+    {
+        InvalidateSceneBlocks();
+    }
+    return slot;
+}
+
 const Matrix4x4& ShaderProgramManager::GetRenderParamMatrix(const ionString& _param)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     return GetRenderParamMatrix(hash);
 }
 
 const Matrix4x4& ShaderProgramManager::GetRenderParamMatrix(ionSize _paramHash)
 {
-    return m_uniformsMatrix[_paramHash];
+    return m_renderParamMatrices[GetRenderParamSlot(_paramHash, EBufferParameterType_Matrix)];
 }
 
 const Vector4& ShaderProgramManager::GetRenderParamVector(const ionString& _param)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     return GetRenderParamVector(hash);
 }
 
 const Vector4& ShaderProgramManager::GetRenderParamVector(ionSize _paramHash)
 {
-    return m_uniformsVector[_paramHash];
+    return m_renderParamVectors[GetRenderParamSlot(_paramHash, EBufferParameterType_Vector)];
 }
 
 const ionFloat ShaderProgramManager::GetRenderParamFloat(const ionString& _param)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     return GetRenderParamFloat(hash);
 }
 
 const ionFloat ShaderProgramManager::GetRenderParamFloat(ionSize _paramHash)
 {
-    return m_uniformsFloat[_paramHash];
+    return m_renderParamFloats[GetRenderParamSlot(_paramHash, EBufferParameterType_Float)];
 }
 
 const ionS32 ShaderProgramManager::GetRenderParamInteger(const ionString& _param)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     return GetRenderParamInteger(hash);
 }
 
 const ionS32 ShaderProgramManager::GetRenderParamInteger(ionSize _paramHash)
 {
-    return m_uniformsInteger[_paramHash];
+    return m_renderParamIntegers[GetRenderParamSlot(_paramHash, EBufferParameterType_Integer)];
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 void ShaderProgramManager::SetRenderParamMatrix(const ionString& _param, const Matrix4x4& _value)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     SetRenderParamMatrix(hash, _value);
 }
 
 void ShaderProgramManager::SetRenderParamMatrix(ionSize _paramHash, const Matrix4x4& _value)
 {
-    m_uniformsMatrix[_paramHash] = _value;
+    m_renderParamMatrices[GetRenderParamSlotToWrite(_paramHash, EBufferParameterType_Matrix)] = _value;
 }
 
 void ShaderProgramManager::SetRenderParamMatrix(const ionString& _param, const ionFloat* _value)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     SetRenderParamMatrix(hash, _value);
 }
 
 void ShaderProgramManager::SetRenderParamMatrix(ionSize _paramHash, const ionFloat* _value)
 {
     Matrix4x4 m(_value[0], _value[1], _value[2], _value[3], _value[4], _value[5], _value[6], _value[7], _value[8], _value[9], _value[10], _value[11], _value[12], _value[13], _value[14], _value[15]);
-    m_uniformsMatrix[_paramHash] = m;
+    m_renderParamMatrices[GetRenderParamSlotToWrite(_paramHash, EBufferParameterType_Matrix)] = m;
 }
 
 void ShaderProgramManager::SetRenderParamsMatrix(const ionString& _param, const ionFloat* _values, ionU32 _numValues)
 {
-    for (ionU32 i = 0; i < _numValues; ++i)
-    {
-        const ionString indexParam(std::to_string(i).c_str());
-        const ionString fullParam = _param + indexParam;
-        const ionSize hash = std::hash<ionString>{}(fullParam);
-        SetRenderParamMatrix(hash, _values + (i * 16));
-    }
+    SetRenderParamsMatrix(HashedName(_param), _values, _numValues);
 }
 
 void ShaderProgramManager::SetRenderParamsMatrix(const ionString& _param, const ionVector<Matrix4x4, ShaderProgramManagerAllocator, GetAllocator>& _values)
 {
     typedef ionVector<Matrix4x4, ShaderProgramManagerAllocator, GetAllocator>::size_type count_type;
     const count_type count = _values.size();
+    const HashedName name(_param);
     for (count_type i = 0; i < count; ++i)
     {
-        const ionString indexParam(std::to_string(i).c_str());
-        const ionString fullParam = _param + indexParam;
-        const ionSize hash = std::hash<ionString>{}(fullParam);
-        SetRenderParamMatrix(hash, _values[i]);
+        SetRenderParamMatrix(name.GetElement(static_cast<ionU32>(i)), _values[i]);
     }
 }
 
-/*
 void ShaderProgramManager::SetRenderParamsMatrix(ionSize _paramHash, const ionFloat* _values, ionU32 _numValues)
 {
     for (ionU32 i = 0; i < _numValues; ++i)
     {
-        SetRenderParamMatrix(_paramHash, _values + (i * 16));
+        SetRenderParamMatrix(static_cast<ionSize>(Tools::HashNameIndex(_paramHash, i)), _values + (i * 16));
     }
 }
-*/
 
 void ShaderProgramManager::SetRenderParamVector(const ionString& _param, const Vector4& _value)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     SetRenderParamVector(hash, _value);
 }
 
 void ShaderProgramManager::SetRenderParamVector(ionSize _paramHash, const Vector4& _value)
 {
-    m_uniformsVector[_paramHash] = _value;
+    m_renderParamVectors[GetRenderParamSlotToWrite(_paramHash, EBufferParameterType_Vector)] = _value;
 }
 
 void ShaderProgramManager::SetRenderParamVector(const ionString& _param, const ionFloat* _value)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     SetRenderParamVector(hash, _value);
 }
 
 void ShaderProgramManager::SetRenderParamVector(ionSize _paramHash, const ionFloat* _value)
 {
     Vector4 v(_value[0], _value[1], _value[2], _value[3]);
-    m_uniformsVector[_paramHash] = v;
+    m_renderParamVectors[GetRenderParamSlotToWrite(_paramHash, EBufferParameterType_Vector)] = v;
 }
 
 void ShaderProgramManager::SetRenderParamsVector(const ionString& _param, const ionFloat* _values, ionU32 _numValues)
 {
-    for (ionU32 i = 0; i < _numValues; ++i)
-    {
-        const ionString indexParam(std::to_string(i).c_str());
-        const ionString fullParam = _param + indexParam;
-        const ionSize hash = std::hash<ionString>{}(fullParam);
-        SetRenderParamVector(hash, _values + (i * 4));
-    }
+    SetRenderParamsVector(HashedName(_param), _values, _numValues);
 }
 
 void ShaderProgramManager::SetRenderParamsVector(const ionString& _param, const ionVector<Vector4, ShaderProgramManagerAllocator, GetAllocator>& _values)
 {
     typedef ionVector<Vector4, ShaderProgramManagerAllocator, GetAllocator>::size_type count_type;
     const count_type count = _values.size();
-    for (ionU32 i = 0; i < count; ++i)
+    const HashedName name(_param);
+    for (count_type i = 0; i < count; ++i)
     {
-        const ionString indexParam(std::to_string(i).c_str());
-        const ionString fullParam = _param + indexParam;
-        const ionSize hash = std::hash<ionString>{}(fullParam);
-        SetRenderParamVector(hash, _values[i]);
+        SetRenderParamVector(name.GetElement(static_cast<ionU32>(i)), _values[i]);
     }
 }
 
-/*
 void ShaderProgramManager::SetRenderParamsVector(ionSize _paramHash, const ionFloat* _values, ionU32 _numValues)
 {
     for (ionU32 i = 0; i < _numValues; ++i)
     {
-        SetRenderParamVector(_paramHash, _values + (i * 4));
+        SetRenderParamVector(static_cast<ionSize>(Tools::HashNameIndex(_paramHash, i)), _values + (i * 4));
     }
 }
-*/
+
 void ShaderProgramManager::SetRenderParamFloat(const ionString& _param, const ionFloat _value)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     SetRenderParamFloat(hash, _value);
 }
 
 void ShaderProgramManager::SetRenderParamFloat(ionSize _paramHash, const ionFloat _value)
 {
-    m_uniformsFloat[_paramHash] = _value;
+    m_renderParamFloats[GetRenderParamSlotToWrite(_paramHash, EBufferParameterType_Float)] = _value;
 }
 
 void ShaderProgramManager::SetRenderParamsFloat(const ionString& _param, const ionFloat* _values, ionU32 _numValues)
 {
-    for (ionU32 i = 0; i < _numValues; ++i)
-    {
-        const ionString indexParam(std::to_string(i).c_str());
-        const ionString fullParam = _param + indexParam;
-        const ionSize hash = std::hash<ionString>{}(fullParam);
-        SetRenderParamFloat(hash, *(_values + i));
-    }
+    SetRenderParamsFloat(HashedName(_param), _values, _numValues);
 }
-/*
+
 void ShaderProgramManager::SetRenderParamsFloat(ionSize _paramHash, const ionFloat* _values, ionU32 _numValues)
 {
     for (ionU32 i = 0; i < _numValues; ++i)
     {
-        SetRenderParamFloat(_paramHash, *(_values + i));
+        SetRenderParamFloat(static_cast<ionSize>(Tools::HashNameIndex(_paramHash, i)), *(_values + i));
     }
 }
-*/
+
 void ShaderProgramManager::SetRenderParamInteger(const ionString& _param, const ionS32 _value)
 {
-    const ionSize hash = std::hash<ionString>{}(_param);
+    const HashedName hash(_param);
     SetRenderParamInteger(hash, _value);
 }
 
 void ShaderProgramManager::SetRenderParamInteger(ionSize _paramHash, const ionS32 _value)
 {
-    m_uniformsInteger[_paramHash] = _value;
+    m_renderParamIntegers[GetRenderParamSlotToWrite(_paramHash, EBufferParameterType_Integer)] = _value;
 }
 
 void ShaderProgramManager::SetRenderParamsInteger(const ionString& _param, const ionS32* _values, ionU32 _numValues)
 {
-    for (ionU32 i = 0; i < _numValues; ++i)
-    {
-        const ionString indexParam(std::to_string(i).c_str());
-        const ionString fullParam = _param + indexParam;
-        const ionSize hash = std::hash<ionString>{}(fullParam);
-        SetRenderParamInteger(hash, *(_values + i));
-    }
+    SetRenderParamsInteger(HashedName(_param), _values, _numValues);
 }
-/*
+
 void ShaderProgramManager::SetRenderParamsInteger(ionSize _paramHash, const ionS32* _values, ionU32 _numValues)
 {
     for (ionU32 i = 0; i < _numValues; ++i)
     {
-        SetRenderParamInteger(_paramHash, *(_values + i));
+        SetRenderParamInteger(static_cast<ionSize>(Tools::HashNameIndex(_paramHash, i)), *(_values + i));
     }
 }
-*/
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
-void ShaderProgramManager::StartFrame()
+void ShaderProgramManager::StartFrame(ionU32 _frameIndex)
 {
-    m_currentDescSet = 0;
-    m_currentParmBufferOffset = 0;
+    ++m_frame;
 
-    vkResetDescriptorPool(m_vkDevice, m_descriptorPool, 0);
+    // the range of this frame is written again from the beginning, the GPU is done with it
+    m_currentParmBufferOffset = _frameIndex * m_frameParmBufferSize;
+    m_frameParmBufferEnd = m_currentParmBufferOffset + m_frameParmBufferSize;
+    m_sceneBlocks.clear();
+
+    m_fallbackDrawCount = 0;
+    m_skippedDrawCount = 0;
+    memset(&m_descriptorStatistics, 0, sizeof(m_descriptorStatistics));
+
+    // swap in the pipelines compiled during the last frame
+    ResolveCompiledPipelines();
+
+    // the descriptor sets of the programs live across the frames, only the replaced ones are freed
+    ReleaseRetiredDescriptorSets();
 }
 
 void ShaderProgramManager::EndFrame()
@@ -368,7 +494,20 @@ void ShaderProgramManager::BindProgram(ionS32 _index)
     }
 }
 
-void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Material* _material, VkRenderPass _renderPass, ionU64 _stateBits, VkCommandBuffer _commandBuffer)
+ionBool ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Material* _material, VkRenderPass _renderPass, ionU64 _stateBits, VkCommandBuffer _commandBuffer, ionBool _asyncPipeline /*= false*/)
+{
+    DrawCommit commit;
+    if (!PrepareCurrent(_render, _material, _renderPass, _stateBits, commit, _asyncPipeline))
+    {
+        return false;
+    }
+
+    RecordCommit(_commandBuffer, commit);
+
+    return true;
+}
+
+ionBool ShaderProgramManager::PrepareCurrent(const RenderCore& _render, const Material* _material, VkRenderPass _renderPass, ionU64 _stateBits, DrawCommit& _outCommit, ionBool _asyncPipeline /*= false*/)
 {
     ShaderProgram& shaderProgram = m_shaderPrograms[m_current];
 
@@ -382,46 +521,39 @@ void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Materi
 
     _material->GetShaders(vertexShaderIndex, fragmentShaderIndex, tessellationControlIndex, tessellationEvaluationIndex, geometryIndex, useJoint, useSkinning);
 
-    VkPipeline pipeline = shaderProgram.GetPipeline(_render, _renderPass, _stateBits, _material->GetTopology(),
-        vertexShaderIndex != -1 ? m_shaders[vertexShaderIndex]->m_shaderModule : VK_NULL_HANDLE,
-        fragmentShaderIndex != -1 ? m_shaders[fragmentShaderIndex]->m_shaderModule : VK_NULL_HANDLE,
-        tessellationControlIndex != -1 ? m_shaders[tessellationControlIndex]->m_shaderModule : VK_NULL_HANDLE,
-        tessellationEvaluationIndex != -1 ? m_shaders[tessellationEvaluationIndex]->m_shaderModule : VK_NULL_HANDLE,
-        geometryIndex != -1 ? m_shaders[geometryIndex]->m_shaderModule : VK_NULL_HANDLE,
-        vertexShaderIndex != -1 ? m_shaders[vertexShaderIndex]->GetSpecializationConstants() : nullptr,
-        fragmentShaderIndex != -1 ? m_shaders[fragmentShaderIndex]->GetSpecializationConstants() : nullptr,
-        tessellationControlIndex != -1 ? m_shaders[tessellationControlIndex]->GetSpecializationConstants() : nullptr,
-        tessellationEvaluationIndex != -1 ? m_shaders[tessellationEvaluationIndex]->GetSpecializationConstants() : nullptr,
-        geometryIndex != -1 ? m_shaders[geometryIndex]->GetSpecializationConstants() : nullptr);
-
-    VkDescriptorSetAllocateInfo setAllocInfo = {};
-    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    setAllocInfo.pNext = nullptr;
-    setAllocInfo.descriptorPool = m_descriptorPool;
-    setAllocInfo.descriptorSetCount = 1;
-    setAllocInfo.pSetLayouts = &shaderProgram.m_descriptorSetLayout;
+    PipelineShaders shaders;
+    GetPipelineShaders(_material, shaders);
 
-    VkResult result = vkAllocateDescriptorSets(_render.GetDevice(), &setAllocInfo, &m_descriptorSets[m_currentDescSet]);
-    ionAssertReturnVoid(result == VK_SUCCESS, "Cannot allocate the descriptor!");
+    // the bits set while recording by the render core do not create other pipelines
+    const ionU64 pipelineStateBits = _render.GetPipelineStateBits(_stateBits);
 
-    VkDescriptorSet descSet = m_descriptorSets[m_currentDescSet];
-    ++m_currentDescSet;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (_asyncPipeline && m_asyncPipelineCompilation)
+    {
+        pipeline = AcquirePipelineAsync(_render, _material, _renderPass, pipelineStateBits, shaders);
+        if (pipeline == VK_NULL_HANDLE)
+        {
+            // nothing compatible to draw with yet, skip the draw for this frame
+            ++m_skippedDrawCount;
+            return false;
+        }
+    }
+    else
+    {
+        const ionSize pipelineCount = shaderProgram.m_pipelines.size();
 
-    ionS32 writeIndex = 0;
-    ionS32 bufferIndex = 0;
-    ionS32 storageIndex = 0;
-    ionS32 imageIndex = 0;
-    ionS32 bindingIndex = 0;
+        pipeline = shaderProgram.GetPipeline(_render, _renderPass, pipelineStateBits, _material->GetTopology(),
+            shaders.m_vertexShader, shaders.m_fragmentShader, shaders.m_tessellationControlShader, shaders.m_tessellationEvaluatorShader, shaders.m_geometryShader,
+            shaders.m_vertexSpecConst, shaders.m_fragmentSpecConst, shaders.m_tessCtrlSpecConst, shaders.m_tessEvalSpecConst, shaders.m_geomSpecConst);
 
-    VkWriteDescriptorSet writes[ION_MAX_DESCRIPTOR_SET_WRITES];
-    VkDescriptorBufferInfo bufferInfos[ION_MAX_DESCRIPTOR_SET_WRITES];
-    VkDescriptorImageInfo imageInfos[ION_MAX_DESCRIPTOR_SET_WRITES];
-    VkDescriptorBufferInfo storageInfos[ION_MAX_DESCRIPTOR_SET_WRITES];
+        // created at draw time: the next run will create it before the first frame
+        if (shaderProgram.m_pipelines.size() != pipelineCount)
+        {
+            RecordPipelineManifest(_material, pipelineStateBits);
+        }
 
-    memset(&writes, 0, sizeof(writes));
-    memset(&bufferInfos, 0, sizeof(bufferInfos));
-    memset(&imageInfos, 0, sizeof(imageInfos));
-    memset(&storageInfos, 0, sizeof(storageInfos));
+        ionAssertReturnValue(pipeline != VK_NULL_HANDLE, "Cannot get the pipeline!", false);
+    }
 
     ionS32 samplerIndex = 0;
     ionS32 uboIndex = 0;
@@ -438,20 +570,24 @@ void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Materi
     memset(&destBinding, 0, sizeof(destBinding)); 
     memset(&destBindingTexture, 0, sizeof(destBindingTexture));
 
-    UniformBuffer vertParms;
-    if (vertexShaderIndex > -1)
+    // every uniform has its own block in the frame buffer, the stages cannot share one
+    UniformBuffer uniformBlocks[ION_MAX_DESCRIPTOR_SET_WRITES];
+
+    // the blocks are already resolved in the order of the uniform bindings of all the stages
+    const ionSize uniformBlockCount = shaderProgram.m_uniformBlocks.size();
+    ionAssertReturnValue(uniformBlockCount < ION_MAX_DESCRIPTOR_SET_WRITES, "Uniforms exceed count", false);
+    for (ionSize i = 0; i < uniformBlockCount; ++i)
     {
-        ionSize uniformCount = _material->GetVertexShaderLayout().m_uniforms.size();
-        for (ionSize i = 0; i < uniformCount; ++i)
-        {
-            AllocUniformParametersBlockBuffer(_render, _material->GetVertexShaderLayout().m_uniforms[i], vertParms);
+        AllocUniformParametersBlockBuffer(_render, shaderProgram.m_uniformBlocks[i], uniformBlocks[uboIndex]);
 
-            destBinding[uboIndex] = _material->GetVertexShaderLayout().m_uniforms[i].m_bindingIndex;
-            ubos[uboIndex] = &vertParms;
+        destBinding[uboIndex] = shaderProgram.m_uniformBlocks[i].m_bindingIndex;
+        ubos[uboIndex] = &uniformBlocks[uboIndex];
 
-            ++uboIndex;
-        }
+        ++uboIndex;
+    }
 
+    if (vertexShaderIndex > -1)
+    {
         ionSize samplerCount = _material->GetVertexShaderLayout().m_samplers.size();
         for (ionSize i = 0; i < samplerCount; ++i)
         {
@@ -477,10 +613,11 @@ void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Materi
     {
         if (!ionVertexCacheManager().GetJointBuffer(_render.GetJointCacheHandler(), &jointBuffer))
         {
-            ionAssertReturnVoid(false, "CommitCurrent: The jointBuffer is nullptr");
-            return;
+            ionAssertReturnValue(false, "CommitCurrent: The jointBuffer is nullptr", false);
+            return false;
         }
-        ionAssertReturnVoid((jointBuffer.GetOffset() & (_render.GetGPU().m_vkPhysicalDeviceProps.limits.minUniformBufferOffsetAlignment - 1)) == 0, "Error in the joint buffer");
+        ionAssertReturnValue((jointBuffer.GetOffset() & (_render.GetGPU().m_vkPhysicalDeviceProps.limits.minUniformBufferOffsetAlignment - 1)) == 0, "Error in the joint buffer", false);
+        ionAssertReturnValue(jointBuffer.GetSize() <= ION_VERTCACHE_JOINT_BLOCK_RANGE, "Joints exceed the joint block range", false);
 
         ubos[uboIndex++] = &jointBuffer;
     }
@@ -489,20 +626,8 @@ void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Materi
         ubos[uboIndex++] = m_skinningUniformBuffer;
     }
 
-    UniformBuffer tessCtrlParms;
     if (tessellationControlIndex > -1)
     {
-        ionSize uniformCount = _material->GetTessellationControlShaderLayout().m_uniforms.size();
-        for (ionSize i = 0; i < uniformCount; ++i)
-        {
-            AllocUniformParametersBlockBuffer(_render, _material->GetTessellationControlShaderLayout().m_uniforms[i], tessCtrlParms);
-
-            destBinding[uboIndex] = _material->GetTessellationControlShaderLayout().m_uniforms[i].m_bindingIndex;
-            ubos[uboIndex] = &tessCtrlParms;
-
-            ++uboIndex;
-        }
-
         ionSize samplerCount = _material->GetTessellationControlShaderLayout().m_samplers.size();
         for (ionSize i = 0; i < samplerCount; ++i)
         {
@@ -522,20 +647,8 @@ void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Materi
         }
     }
 
-    UniformBuffer tessEvalParms;
     if (tessellationEvaluationIndex > -1)
     {
-        ionSize uniformCount = _material->GetTessellationEvaluatorShaderLayout().m_uniforms.size();
-        for (ionSize i = 0; i < uniformCount; ++i)
-        {
-            AllocUniformParametersBlockBuffer(_render, _material->GetTessellationEvaluatorShaderLayout().m_uniforms[i], tessEvalParms);
-
-            destBinding[uboIndex] = _material->GetTessellationEvaluatorShaderLayout().m_uniforms[i].m_bindingIndex;
-            ubos[uboIndex] = &tessEvalParms;
-
-            ++uboIndex;
-        }
-
         ionSize samplerCount = _material->GetTessellationEvaluatorShaderLayout().m_samplers.size();
         for (ionSize i = 0; i < samplerCount; ++i)
         {
@@ -555,20 +668,8 @@ void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Materi
         }
     }
 
-    UniformBuffer geometryParms;
     if (geometryIndex > -1)
     {
-        ionSize uniformCount = _material->GetGeometryShaderLayout().m_uniforms.size();
-        for (ionSize i = 0; i < uniformCount; ++i)
-        {
-            AllocUniformParametersBlockBuffer(_render, _material->GetGeometryShaderLayout().m_uniforms[i], geometryParms);
-
-            destBinding[uboIndex] = _material->GetGeometryShaderLayout().m_uniforms[i].m_bindingIndex;
-            ubos[uboIndex] = &geometryParms;
-
-            ++uboIndex;
-        }
-
         ionSize samplerCount = _material->GetGeometryShaderLayout().m_samplers.size();
         for (ionSize i = 0; i < samplerCount; ++i)
         {
@@ -588,20 +689,8 @@ void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Materi
         }
     }
 
-    UniformBuffer fragParms;
     if (fragmentShaderIndex > -1)
     {
-        ionSize uniformCount = _material->GetFragmentShaderLayout().m_uniforms.size();
-        for (ionSize i = 0; i < uniformCount; ++i)
-        {
-            AllocUniformParametersBlockBuffer(_render, _material->GetFragmentShaderLayout().m_uniforms[i], fragParms);
-
-            destBinding[uboIndex] = _material->GetFragmentShaderLayout().m_uniforms[i].m_bindingIndex;
-            ubos[uboIndex] = &fragParms;
-
-            ++uboIndex;
-        }
-
         ionSize samplerCount = _material->GetFragmentShaderLayout().m_samplers.size();
         for (ionSize i = 0; i < samplerCount; ++i)
         {
@@ -621,33 +710,60 @@ void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Materi
         }
     }
 
-    ionAssertReturnVoid(uboIndex < ION_MAX_DESCRIPTOR_SET_WRITES, "Uniforms exceed count");
-    ionAssertReturnVoid(samplerIndex < ION_MAX_DESCRIPTOR_SET_WRITES, "Samplers exceed count");
+    ionAssertReturnValue(uboIndex < ION_MAX_DESCRIPTOR_SET_WRITES, "Uniforms exceed count", false);
+    ionAssertReturnValue(samplerIndex < ION_MAX_DESCRIPTOR_SET_WRITES, "Samplers exceed count", false);
+
+    // the samplers of a bindless material are not in the set, only their indices in the table are pushed
+    BindlessTextureIndices bindlessIndices;
+    memset(&bindlessIndices, 0, sizeof(bindlessIndices));
+    if (shaderProgram.m_bindlessTexturesStages != 0)
+    {
+        ionAssertReturnValue(samplerIndex <= ION_BINDLESS_MATERIAL_TEXTURES, "Bindless textures exceed count", false);
+        for (ionS32 i = 0; i < samplerIndex; ++i)
+        {
+            ionAssertReturnValue(textures[i]->GetBindlessIndex() != ION_BINDLESS_INVALID_INDEX, "Texture not in the bindless table!", false);
+
+            bindlessIndices.m_indices[i] = textures[i]->GetBindlessIndex();
+        }
+    }
+
+    ionAssertReturnValue(shaderProgram.m_bindings.size() <= ION_MAX_DESCRIPTOR_SET_WRITES, "Bindings exceed count", false);
+
+    ionU32 bufferIndex = 0;
+    ionU32 storageIndex = 0;
+    ionU32 imageIndex = 0;
+    ionU32 stateCount = 0;
+    ionU32 dynamicOffsetCount = 0;
+
+    DescriptorBindingState states[ION_MAX_DESCRIPTOR_SET_WRITES];
+    VkDescriptorType types[ION_MAX_DESCRIPTOR_SET_WRITES];
+    ionU32 destBindings[ION_MAX_DESCRIPTOR_SET_WRITES];
+    std::pair<ionU32, ionU32> dynamicOffsets[ION_MAX_DESCRIPTOR_SET_WRITES];    // binding, offset of the block
+
+    memset(&states, 0, sizeof(states));
 
     for (ionSize i = 0; i < shaderProgram.m_bindings.size(); ++i)
     {
         EShaderBinding binding = shaderProgram.m_bindings[i];
 
+        DescriptorBindingState& state = states[stateCount];
+
         switch (binding) 
         {
         case EShaderBinding_Uniform:
         {
             UniformBuffer* ubo = ubos[bufferIndex];
 
-            VkDescriptorBufferInfo & bufferInfo = bufferInfos[bufferIndex];
-            memset(&bufferInfo, 0, sizeof(VkDescriptorBufferInfo));
-            bufferInfo.buffer = ubo->GetObject();
-            bufferInfo.offset = ubo->GetOffset();
-            bufferInfo.range = ubo->GetSize();
-
-            VkWriteDescriptorSet & write = writes[writeIndex++];
-            memset(&write, 0, sizeof(VkWriteDescriptorSet));
-            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            write.dstSet = descSet;
-            write.dstBinding = destBinding[bufferIndex++];
-            write.descriptorCount = 1;
-            write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            write.pBufferInfo = &bufferInfo;
+            // the block of this draw is selected by the dynamic offset, so the descriptor does not change between draws.
+            // The joints of every skeleton are read through the same fixed range, whatever their count
+            state.m_buffer = ubo->GetObject();
+            state.m_offset = 0;
+            state.m_range = (ubo == &jointBuffer) ? ION_VERTCACHE_JOINT_BLOCK_RANGE : ubo->GetSize();
+
+            types[stateCount] = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            destBindings[stateCount] = destBinding[bufferIndex++];
+
+            dynamicOffsets[dynamicOffsetCount++] = std::make_pair(destBindings[stateCount], static_cast<ionU32>(ubo->GetOffset()));
 
             break;
         }
@@ -655,179 +771,488 @@ void ShaderProgramManager::CommitCurrent(const RenderCore& _render, const Materi
         {
             const Texture* image = textures[imageIndex];
 
-            VkDescriptorImageInfo & imageInfo = imageInfos[imageIndex];
-            memset(&imageInfo, 0, sizeof(VkDescriptorImageInfo));
+            ionAssertReturnValue(image->GetView() != VK_NULL_HANDLE, "View is null!", false);
 
-            imageInfo.imageLayout = image->GetLayout();
-            imageInfo.imageView = image->GetView();
-            imageInfo.sampler = image->GetSampler();
+            state.m_layout = image->GetLayout();
+            state.m_view = image->GetView();
+            state.m_sampler = image->GetSampler();
 
-            ionAssertReturnVoid(image->GetView() != VK_NULL_HANDLE, "View is null!");
+            types[stateCount] = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            destBindings[stateCount] = destBindingTexture[imageIndex++];
 
-            VkWriteDescriptorSet & write = writes[writeIndex++];
-            memset(&write, 0, sizeof(VkWriteDescriptorSet));
-            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            write.dstSet = descSet;
-            write.dstBinding = destBindingTexture[imageIndex++];
-            write.descriptorCount = 1;
-            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            write.pImageInfo = &imageInfo;
-            
             break;
         }
         case EShaderBinding_Storage:
         {
-            VkDescriptorBufferInfo & storageInfo = storageInfos[storageIndex];
-            memset(&storageInfo, 0, sizeof(VkDescriptorBufferInfo));
-
+            // left empty, and not written, if the cache is not valid
             StorageBuffer storageBuffer;
             if (ionVertexCacheManager().GetStorageBuffer(storage[storageIndex], &storageBuffer))
             {
-                storageInfo.buffer = storageBuffer.GetObject();
-                storageInfo.offset = storageBuffer.GetOffset();
-                storageInfo.range = storageBuffer.GetSize();
-
-                VkWriteDescriptorSet & write = writes[writeIndex++];
-                memset(&write, 0, sizeof(VkWriteDescriptorSet));
-                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                write.dstSet = descSet;
-                write.dstBinding = destBindingStorage[storageIndex++];
-                write.descriptorCount = 1;
-                write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-                write.pBufferInfo = &storageInfo;
+                state.m_buffer = storageBuffer.GetObject();
+                state.m_offset = storageBuffer.GetOffset();
+                state.m_range = storageBuffer.GetSize();
             }
+
+            types[stateCount] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            destBindings[stateCount] = destBindingStorage[storageIndex++];
+
+            break;
+        }
+        case EShaderBinding_MaterialConstants:
+        {
+            // the whole buffer, the same for every material: the slot is in the draw constants
+            const StorageBuffer& constantsBuffer = ionMaterialManger().GetConstantsBuffer();
+            ionAssertReturnValue(constantsBuffer.GetObject() != VK_NULL_HANDLE, "The material constants buffer is not allocated!", false);
+
+            state.m_buffer = constantsBuffer.GetObject();
+            state.m_offset = constantsBuffer.GetOffset();
+            state.m_range = constantsBuffer.GetSize();
+
+            types[stateCount] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            destBindings[stateCount] = static_cast<ionU32>(_material->GetConstantsBufferBinding());
+
             break;
         }
         }
+
+        ++stateCount;
     }
 
-    vkUpdateDescriptorSets(m_vkDevice, writeIndex, writes, 0, nullptr);
+    if (!UpdateDescriptorSet(shaderProgram, states, types, destBindings, stateCount))
+    {
+        return false;
+    }
+
+    // the dynamic offsets are consumed in the order of the binding numbers
+    std::sort(dynamicOffsets, dynamicOffsets + dynamicOffsetCount);
+
+    for (ionU32 i = 0; i < dynamicOffsetCount; ++i)
+    {
+        _outCommit.m_dynamicOffsets[i] = dynamicOffsets[i].second;
+    }
+    _outCommit.m_dynamicOffsetCount = dynamicOffsetCount;
 
-    vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shaderProgram.m_pipelineLayout, 0, 1, &descSet, 0, nullptr);
-    vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    _outCommit.m_pipeline = pipeline;
+    _outCommit.m_pipelineLayout = shaderProgram.m_pipelineLayout;
+    _outCommit.m_descriptorSets[0] = shaderProgram.m_descriptorSet;
+    _outCommit.m_descriptorSets[1] = ionTextureManger().GetBindlessTextureTable().GetDescriptorSet();
+    _outCommit.m_descriptorSetCount = shaderProgram.m_bindlessTexturesStages != 0 ? 2 : 1;
 
     const ConstantsBindingDef& constantsDef = _material->GetConstantsShaders();
 
-    if (constantsDef.IsValid())
+    // not pushed if read from the constants buffer
+    const ionBool pushConstants = constantsDef.IsValid() && shaderProgram.m_constantsStages != 0;
+    _outCommit.m_constantsData = pushConstants ? constantsDef.GetData() : nullptr;
+    _outCommit.m_constantsSize = pushConstants ? static_cast<ionU32>(constantsDef.GetSizeByte()) : 0;
+    _outCommit.m_constantsStages = shaderProgram.m_constantsStages;
+
+    _outCommit.m_drawConstantsStages = shaderProgram.m_drawConstantsStages;
+    _outCommit.m_drawConstantsOffset = shaderProgram.m_drawConstantsOffset;
+
+    _outCommit.m_bindlessTexturesStages = shaderProgram.m_bindlessTexturesStages;
+    _outCommit.m_bindlessTexturesOffset = shaderProgram.m_bindlessTexturesOffset;
+    _outCommit.m_bindlessIndices = bindlessIndices;
+
+    return true;
+}
+
+void ShaderProgramManager::RecordCommit(VkCommandBuffer _commandBuffer, const DrawCommit& _commit)
+{
+    vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _commit.m_pipelineLayout, 0, _commit.m_descriptorSetCount, _commit.m_descriptorSets, _commit.m_dynamicOffsetCount, _commit.m_dynamicOffsets);
+    vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _commit.m_pipeline);
+
+    if (_commit.m_constantsData != nullptr)
+    {
+        vkCmdPushConstants(_commandBuffer, _commit.m_pipelineLayout, _commit.m_constantsStages, 0, _commit.m_constantsSize, _commit.m_constantsData);
+    }
+
+    if (_commit.m_bindlessTexturesStages != 0)
     {
-        vkCmdPushConstants(_commandBuffer, shaderProgram.m_pipelineLayout, constantsDef.m_runtimeStages, 0, static_cast<ionU32>(constantsDef.GetSizeByte()), constantsDef.GetData());
+        vkCmdPushConstants(_commandBuffer, _commit.m_pipelineLayout, _commit.m_bindlessTexturesStages, _commit.m_bindlessTexturesOffset, sizeof(BindlessTextureIndices), &_commit.m_bindlessIndices);
     }
 }
 
-void ShaderProgramManager::AllocUniformParametersBlockBuffer(const RenderCore& _render, const UniformBinding& _uniform, UniformBuffer& _ubo)
+void ShaderProgramManager::RecordDrawConstants(VkCommandBuffer _commandBuffer, const DrawCommit& _commit, const DrawConstants& _constants)
 {
-    // gather all informations
-    static const ionU32 sMaxParamsAmount = 32;
-    ionSize counterForType[EBufferParameterType_Count];
-    ionSize indexForType[EBufferParameterType_Count][sMaxParamsAmount];
+    if (_commit.m_drawConstantsStages != 0)
+    {
+        vkCmdPushConstants(_commandBuffer, _commit.m_pipelineLayout, _commit.m_drawConstantsStages, _commit.m_drawConstantsOffset, sizeof(DrawConstants), &_constants);
+    }
+}
 
-    memset(&counterForType, 0, sizeof(counterForType));
-    memset(&indexForType, 0, sizeof(indexForType));
+void ShaderProgramManager::PushDrawConstants(VkCommandBuffer _commandBuffer, const DrawConstants& _constants)
+{
+    const ShaderProgram& shaderProgram = m_shaderPrograms[m_current];
+    if (shaderProgram.m_drawConstantsStages != 0)
+    {
+        vkCmdPushConstants(_commandBuffer, shaderProgram.m_pipelineLayout, shaderProgram.m_drawConstantsStages, shaderProgram.m_drawConstantsOffset, sizeof(DrawConstants), &_constants);
+    }
+}
 
-    const ionSize numParmsType = _uniform.m_type.size();
-    for (ionSize i = 0; i < numParmsType; ++i)
+ionBool ShaderProgramManager::UpdateDescriptorSet(ShaderProgram& _shaderProgram, const DescriptorBindingState* _states, const VkDescriptorType* _types, const ionU32* _destBindings, ionU32 _count)
+{
+    if (_shaderProgram.m_descriptorSet != VK_NULL_HANDLE && _shaderProgram.m_descriptorBindings.size() == _count)
     {
-        const EBufferParameterType type = _uniform.m_type[i];
-        switch (type)
+        ionBool changed = false;
+        for (ionU32 i = 0; i < _count && !changed; ++i)
         {
-        case EBufferParameterType_Vector:
-            indexForType[EBufferParameterType_Vector][counterForType[EBufferParameterType_Vector]] = i;
-            ++counterForType[EBufferParameterType_Vector];
-            break;
-        case EBufferParameterType_Matrix:
-            indexForType[EBufferParameterType_Matrix][counterForType[EBufferParameterType_Matrix]] = i;
-            ++counterForType[EBufferParameterType_Matrix];
-            break;
-        case EBufferParameterType_Float:
-            indexForType[EBufferParameterType_Float][counterForType[EBufferParameterType_Float]] = i;
-            ++counterForType[EBufferParameterType_Float];
-            break;
-        case EBufferParameterType_Integer:
-            indexForType[EBufferParameterType_Integer][counterForType[EBufferParameterType_Integer]] = i;
-            ++counterForType[EBufferParameterType_Integer];
-            break;
-        default:
-            break;
+            changed = _shaderProgram.m_descriptorBindings[i] != _states[i];
+        }
+
+        if (!changed)
+        {
+            ++m_descriptorStatistics.m_reusedSets;
+            return true;
         }
     }
 
+    VkDescriptorSetAllocateInfo setAllocInfo = {};
+    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocInfo.pNext = nullptr;
+    setAllocInfo.descriptorPool = m_descriptorPool;
+    setAllocInfo.descriptorSetCount = 1;
+    setAllocInfo.pSetLayouts = &_shaderProgram.m_descriptorSetLayout;
 
-    /*
-    ORDER OF UNIFORM ELEMENTS
-    Matrix
-    Vector
-    Float
-    Integer
-    */
+    VkDescriptorSet descSet = VK_NULL_HANDLE;
+    VkResult result = vkAllocateDescriptorSets(m_vkDevice, &setAllocInfo, &descSet);
+    ionAssertReturnValue(result == VK_SUCCESS, "Cannot allocate the descriptor!", false);
 
-    const ionSize numParmsMatrix = counterForType[EBufferParameterType_Matrix];
-    const ionSize sizeMatrix = numParmsMatrix * sizeof(Matrix4x4);
+    ionU32 writeIndex = 0;
 
-    const ionSize numParmsVector = counterForType[EBufferParameterType_Vector];
-    const ionSize sizeVector = numParmsVector * sizeof(Vector4);
+    VkWriteDescriptorSet writes[ION_MAX_DESCRIPTOR_SET_WRITES];
+    VkDescriptorBufferInfo bufferInfos[ION_MAX_DESCRIPTOR_SET_WRITES];
+    VkDescriptorImageInfo imageInfos[ION_MAX_DESCRIPTOR_SET_WRITES];
 
-    const ionSize numParmsFloat = counterForType[EBufferParameterType_Float];
-    const ionSize sizeFloat = numParmsFloat * sizeof(ionFloat);
+    memset(&writes, 0, sizeof(writes));
+    memset(&bufferInfos, 0, sizeof(bufferInfos));
+    memset(&imageInfos, 0, sizeof(imageInfos));
 
-    const ionSize numParmsInt = counterForType[EBufferParameterType_Integer];
-    const ionSize sizeInt = numParmsInt * sizeof(ionS32);
+    for (ionU32 i = 0; i < _count; ++i)
+    {
+        const DescriptorBindingState& state = _states[i];
 
+        VkWriteDescriptorSet& write = writes[writeIndex];
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descSet;
+        write.dstBinding = _destBindings[i];
+        write.descriptorCount = 1;
+        write.descriptorType = _types[i];
 
-    const ionSize size = sizeMatrix + sizeVector + sizeFloat + sizeInt;
-    const ionSize mask = _render.GetGPU().m_vkPhysicalDeviceProps.limits.minUniformBufferOffsetAlignment - 1;
-    const ionSize alignedSize = (size + mask) & ~mask;
+        if (_types[i] == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+        {
+            VkDescriptorImageInfo& imageInfo = imageInfos[writeIndex];
+            imageInfo.imageLayout = state.m_layout;
+            imageInfo.imageView = state.m_view;
+            imageInfo.sampler = state.m_sampler;
 
-    //
-    _ubo.ReferenceTo(*m_uniformBuffer, m_currentParmBufferOffset, alignedSize);
+            write.pImageInfo = &imageInfo;
+        }
+        else
+        {
+            if (state.m_buffer == VK_NULL_HANDLE)
+            {
+                continue;
+            }
 
+            VkDescriptorBufferInfo& bufferInfo = bufferInfos[writeIndex];
+            bufferInfo.buffer = state.m_buffer;
+            bufferInfo.offset = state.m_offset;
+            bufferInfo.range = state.m_range;
 
-    Matrix4x4* uniformsMatrix = (Matrix4x4*)_ubo.MapBuffer(EBufferMappingType_Write);
-    for (ionSize i = 0; i < numParmsMatrix; ++i)
-    {
-        uniformsMatrix[i] = GetRenderParamMatrix(_uniform.m_runtimeParameters[indexForType[EBufferParameterType_Matrix][i]]);
-    }
+            write.pBufferInfo = &bufferInfo;
+        }
 
-    Vector4* uniformsVector = (Vector4*)_ubo.MapBuffer(EBufferMappingType_Write, (sizeof(Matrix4x4) * numParmsMatrix));
-    for (ionSize i = 0; i < numParmsVector; ++i)
-    {
-        uniformsVector[i] = GetRenderParamVector(_uniform.m_runtimeParameters[indexForType[EBufferParameterType_Vector][i]]);
+        ++writeIndex;
     }
 
-    ionFloat* uniformsFloat = (ionFloat*)_ubo.MapBuffer(EBufferMappingType_Write, (sizeof(Matrix4x4) * numParmsMatrix) + (sizeof(Vector4) * numParmsVector));
-    for (ionSize i = 0; i < numParmsFloat; ++i)
+    vkUpdateDescriptorSets(m_vkDevice, writeIndex, writes, 0, nullptr);
+
+    ++m_descriptorStatistics.m_allocatedSets;
+    m_descriptorStatistics.m_descriptorWrites += writeIndex;
+
+    // the old set can still be used by the frames in flight
+    if (_shaderProgram.m_descriptorSet != VK_NULL_HANDLE)
     {
-        uniformsFloat[i] = GetRenderParamFloat(_uniform.m_runtimeParameters[indexForType[EBufferParameterType_Float][i]]);
+        RetiredDescriptorSet retired;
+        retired.m_descriptorSet = _shaderProgram.m_descriptorSet;
+        retired.m_frame = m_frame;
+        m_retiredDescriptorSets.push_back(retired);
     }
 
-    ionS32* uniformsInt = (ionS32*)_ubo.MapBuffer(EBufferMappingType_Write, (sizeof(Matrix4x4) * numParmsMatrix) + (sizeof(Vector4) * numParmsVector) + (sizeof(ionFloat) * numParmsFloat));
-    for (ionSize i = 0; i < numParmsInt; ++i)
+    _shaderProgram.m_descriptorSet = descSet;
+    _shaderProgram.m_descriptorBindings.resize(_count);
+    for (ionU32 i = 0; i < _count; ++i)
     {
-        uniformsInt[i] = GetRenderParamInteger(_uniform.m_runtimeParameters[indexForType[EBufferParameterType_Integer][i]]);
+        _shaderProgram.m_descriptorBindings[i] = _states[i];
     }
 
-    _ubo.UnmapBuffer();
-
-    m_currentParmBufferOffset += alignedSize;
+    return true;
 }
 
-ionS32 ShaderProgramManager::FindShader(const ionString& _path, const ionString& _name, EShaderStage _stage)
+void ShaderProgramManager::ReleaseRetiredDescriptorSets()
 {
-    ionVector<ionFloat, ShaderProgramManagerAllocator, GetAllocator> emptySpecializationConstants;
-    return FindShader(_path, _name, _stage, emptySpecializationConstants);
-}
+    // same delay of the textures released by the streaming: more frames than the ones in flight
+    static const ionU64 kReleaseDelayFrames = 4;
 
+    for (auto it = m_retiredDescriptorSets.begin(); it != m_retiredDescriptorSets.end();)
+    {
+        if (it->m_frame + kReleaseDelayFrames > m_frame)
+        {
+            ++it;
+            continue;
+        }
 
-ionS32 ShaderProgramManager::FindShader(const ionString& _path, const ionString& _name, EShaderStage _stage, const ionVector<ionFloat, ShaderProgramManagerAllocator, GetAllocator>& _specializationConstantValues)
+        vkFreeDescriptorSets(m_vkDevice, m_descriptorPool, 1, &it->m_descriptorSet);
+
+        it = m_retiredDescriptorSets.erase(it);
+    }
+}
+
+void ShaderProgramManager::LinkUniformBlocks(ShaderProgram& _shaderProgram, const ShaderLayoutDef& _layout, const Shader* _shader)
 {
-    for (ionS32 i = 0; i < m_shaders.size(); ++i)
+    const ionSize uniformCount = _layout.m_uniforms.size();
+    for (ionSize i = 0; i < uniformCount; ++i)
     {
-        Shader* shader = m_shaders[i];
-        if (shader->m_name == _name && shader->m_stage == _stage)
+        const UniformBinding& uniform = _layout.m_uniforms[i];
+
+        UniformBlockLayout block;
+        block.m_bindingIndex = uniform.m_bindingIndex;
+        block.m_size = 0;
+        block.m_sceneKey = 0;
+
+        const ReflectedDescriptor* reflected = _shader->m_reflection.m_isValid ? _shader->m_reflection.FindDescriptor(0, uniform.m_bindingIndex) : nullptr;
+        if (reflected == nullptr || reflected->m_type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || reflected->m_hasUnsupportedMembers || !LinkReflectedUniformBlock(uniform, *reflected, block))
         {
-            LoadShader(i);
-            return i;
+            LinkDeclaredUniformBlock(uniform, block);
         }
-    }
+
+        // the same (type, slot, offset) sequence means the same content, whatever the program
+        const ionSize parameterCount = block.m_parameters.size();
+        block.m_sceneKey = parameterCount > 0 ? Tools::kFNV1aOffset64 : 0;
+        for (ionSize j = 0; j < parameterCount && block.m_sceneKey != 0; ++j)
+        {
+            const UniformParameterSlot& parameter = block.m_parameters[j];
+            block.m_sceneKey = (m_renderParamScene[parameter.m_type][parameter.m_slot] != 0) ? Tools::HashFNV1a64(&parameter, sizeof(parameter), block.m_sceneKey) : 0;
+        }
+
+        _shaderProgram.m_uniformBlocks.push_back(block);
+    }
+}
+
+ionBool ShaderProgramManager::LinkReflectedUniformBlock(const UniformBinding& _uniform, const ReflectedDescriptor& _reflected, UniformBlockLayout& _outBlock)
+{
+    const ionSize declaredCount = _uniform.m_runtimeParameters.size();
+    const ionSize memberCount = _reflected.m_members.size();
+    for (ionSize i = 0; i < memberCount; ++i)
+    {
+        const ReflectedBlockMember& member = _reflected.m_members[i];
+
+        EBufferParameterType type = member.m_isInteger ? EBufferParameterType_Integer : EBufferParameterType_Float;
+        if (member.m_components == 16)
+        {
+            type = EBufferParameterType_Matrix;
+        }
+        else if (member.m_components > 1)
+        {
+            type = EBufferParameterType_Vector;
+        }
+
+        // the members are found by name, what the layout declares is only checked
+        for (ionSize j = 0; j < declaredCount; ++j)
+        {
+            if (_uniform.m_runtimeParameters[j] == member.m_nameHash && _uniform.m_type[j] != type)
+            {
+                ionAssertReturnValue(false, "A parameter of the uniform has a different type in the shader!", false);
+            }
+        }
+
+        UniformParameterSlot parameter;
+        parameter.m_type = type;
+        parameter.m_slot = GetRenderParamSlot(member.m_nameHash, type);
+        parameter.m_offset = member.m_offset;
+        parameter.m_components = (type == EBufferParameterType_Vector) ? std::min(member.m_components, 4u) : kParameterTypeSize[type] / static_cast<ionU32>(sizeof(ionFloat));
+        _outBlock.m_parameters.push_back(parameter);
+
+        const ionU32 end = member.m_offset + parameter.m_components * static_cast<ionU32>(sizeof(ionFloat));
+        _outBlock.m_size = end > _outBlock.m_size ? end : _outBlock.m_size;
+    }
+
+    _outBlock.m_size = _reflected.m_blockSize > _outBlock.m_size ? _reflected.m_blockSize : _outBlock.m_size;
+
+    return true;
+}
+
+void ShaderProgramManager::LinkDeclaredUniformBlock(const UniformBinding& _uniform, UniformBlockLayout& _outBlock)
+{
+    /*
+    ORDER OF UNIFORM ELEMENTS, the same of EBufferParameterType
+    Matrix
+    Vector
+    Float
+    Integer
+    */
+    _outBlock.m_parameters.clear();
+    _outBlock.m_size = 0;
+
+    const ionSize numParmsType = _uniform.m_type.size();
+    for (ionU32 t = 0; t < EBufferParameterType_Count; ++t)
+    {
+        const EBufferParameterType type = static_cast<EBufferParameterType>(t);
+        for (ionSize j = 0; j < numParmsType; ++j)
+        {
+            if (_uniform.m_type[j] != type)
+            {
+                continue;
+            }
+
+            UniformParameterSlot parameter;
+            parameter.m_type = type;
+            parameter.m_slot = GetRenderParamSlot(_uniform.m_runtimeParameters[j], type);
+            parameter.m_offset = _outBlock.m_size;
+            parameter.m_components = kParameterTypeSize[t] / static_cast<ionU32>(sizeof(ionFloat));
+            _outBlock.m_parameters.push_back(parameter);
+
+            _outBlock.m_size += kParameterTypeSize[t];
+        }
+    }
+}
+
+void ShaderProgramManager::ValidateShaderLayout(const Shader* _shader, const ShaderLayoutDef& _layout, const Material* _material) const
+{
+#ifdef _DEBUG
+    const ionBool bindlessTextures = _material->UseBindlessTextures();
+    const ShaderReflection& reflection = _shader->m_reflection;
+    if (!reflection.m_isValid)
+    {
+        return;
+    }
+
+    for (const UniformBinding& uniform : _layout.m_uniforms)
+    {
+        const ReflectedDescriptor* reflected = reflection.FindDescriptor(0, uniform.m_bindingIndex);
+        ionAssert(reflected != nullptr && reflected->m_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, "A uniform of the layout is not a uniform block of the shader " << _shader->m_name.c_str());
+    }
+    // the bindless samplers are not declared by the shader, their textures are read from the table in set 1
+    for (ionSize i = 0; i < _layout.m_samplers.size() && !bindlessTextures; ++i)
+    {
+        const ReflectedDescriptor* reflected = reflection.FindDescriptor(0, _layout.m_samplers[i].m_bindingIndex);
+        ionAssert(reflected != nullptr && reflected->m_type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, "A sampler of the layout is not a sampler of the shader " << _shader->m_name.c_str());
+    }
+    for (const StorageBinding& storage : _layout.m_storages)
+    {
+        const ReflectedDescriptor* reflected = reflection.FindDescriptor(0, storage.m_bindingIndex);
+        ionAssert(reflected != nullptr && reflected->m_type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, "A storage of the layout is not a storage buffer of the shader " << _shader->m_name.c_str());
+    }
+
+    // the other way around, a descriptor missing in the layout is missing in the descriptor set layout of the program
+    for (const ReflectedDescriptor& reflected : reflection.m_descriptors)
+    {
+        if (bindlessTextures && reflected.m_set == 1 && reflected.m_binding == 0)
+        {
+            continue;
+        }
+
+        ionBool declared = false;
+        for (const UniformBinding& uniform : _layout.m_uniforms)
+        {
+            declared |= (uniform.m_bindingIndex == reflected.m_binding);
+        }
+        for (const SamplerBinding& sampler : _layout.m_samplers)
+        {
+            declared |= (!bindlessTextures && sampler.m_bindingIndex == reflected.m_binding);
+        }
+        for (const StorageBinding& storage : _layout.m_storages)
+        {
+            declared |= (storage.m_bindingIndex == reflected.m_binding);
+        }
+        declared |= (_material->UseConstantsBuffer() && static_cast<ionU32>(_material->GetConstantsBufferBinding()) == reflected.m_binding);
+
+        ionAssert(reflected.m_set == 0 && declared, "A descriptor of the shader is not in the layout of the material " << _shader->m_name.c_str() << " binding " << reflected.m_binding);
+    }
+#endif
+}
+
+void ShaderProgramManager::AllocUniformParametersBlockBuffer(const RenderCore& _render, const UniformBlockLayout& _block, UniformBuffer& _ubo)
+{
+    const ionSize mask = _render.GetGPU().m_vkPhysicalDeviceProps.limits.minUniformBufferOffsetAlignment - 1;
+    const ionSize alignedSize = (_block.m_size + mask) & ~mask;
+
+    if (_block.m_sceneKey != 0)
+    {
+        const ionSize sceneBlockCount = m_sceneBlocks.size();
+        for (ionSize i = 0; i < sceneBlockCount; ++i)
+        {
+            const SceneBlock& sceneBlock = m_sceneBlocks[i];
+            if (sceneBlock.m_sceneKey == _block.m_sceneKey && sceneBlock.m_size == alignedSize)
+            {
+                _ubo.ReferenceTo(*m_uniformBuffer, sceneBlock.m_offset, alignedSize);
+                ++m_descriptorStatistics.m_sharedSceneBlocks;
+                return;
+            }
+        }
+    }
+
+    ionAssertReturnVoid(m_currentParmBufferOffset + alignedSize <= m_frameParmBufferEnd, "Out of uniform buffer memory for the frame!");
+
+    if (_block.m_sceneKey != 0)
+    {
+        SceneBlock sceneBlock;
+        sceneBlock.m_sceneKey = _block.m_sceneKey;
+        sceneBlock.m_offset = m_currentParmBufferOffset;
+        sceneBlock.m_size = alignedSize;
+        m_sceneBlocks.push_back(sceneBlock);
+    }
+
+    _ubo.ReferenceTo(*m_uniformBuffer, m_currentParmBufferOffset, alignedSize);
+
+    // straight copies from the flat storage into the mapped block, everything has been resolved when the program was linked
+    ionU8* data = m_uniformBufferData + m_currentParmBufferOffset;
+
+    const ionSize parameterCount = _block.m_parameters.size();
+    for (ionSize i = 0; i < parameterCount; ++i)
+    {
+        const UniformParameterSlot& parameter = _block.m_parameters[i];
+        switch (parameter.m_type)
+        {
+        case EBufferParameterType_Matrix:
+            *reinterpret_cast<Matrix4x4*>(data + parameter.m_offset) = m_renderParamMatrices[parameter.m_slot];
+            break;
+        case EBufferParameterType_Vector:
+            // a vec2 can be 8 bytes aligned only, and a vec3 is followed by the next member: just its components, unaligned
+            memcpy(data + parameter.m_offset, &m_renderParamVectors[parameter.m_slot], parameter.m_components * sizeof(ionFloat));
+            break;
+        case EBufferParameterType_Float:
+            *reinterpret_cast<ionFloat*>(data + parameter.m_offset) = m_renderParamFloats[parameter.m_slot];
+            break;
+        case EBufferParameterType_Integer:
+            *reinterpret_cast<ionS32*>(data + parameter.m_offset) = m_renderParamIntegers[parameter.m_slot];
+            break;
+        default:
+            break;
+        }
+    }
+
+    m_currentParmBufferOffset += alignedSize;
+}
+
+ionS32 ShaderProgramManager::FindShader(const ionString& _path, const ionString& _name, EShaderStage _stage)
+{
+    ionVector<ionFloat, ShaderProgramManagerAllocator, GetAllocator> emptySpecializationConstants;
+    return FindShader(_path, _name, _stage, emptySpecializationConstants);
+}
+
+
+ionS32 ShaderProgramManager::FindShader(const ionString& _path, const ionString& _name, EShaderStage _stage, const ionVector<ionFloat, ShaderProgramManagerAllocator, GetAllocator>& _specializationConstantValues)
+{
+    for (ionS32 i = 0; i < m_shaders.size(); ++i)
+    {
+        Shader* shader = m_shaders[i];
+        if (shader->m_name == _name && shader->m_stage == _stage)
+        {
+            LoadShader(i);
+            return i;
+        }
+    }
 
     Shader* shader = ionNew(Shader, GetAllocator());
     shader->m_path = _path;
@@ -851,6 +1276,16 @@ ionS32 ShaderProgramManager::FindShader(const ionString& _path, const ionString&
     return index;
 }
 
+ionU64 ShaderProgramManager::GetShaderCodeHash(ionS32 _index) const
+{
+    if (_index < 0 || _index >= static_cast<ionS32>(m_shaders.size()))
+    {
+        return 0;
+    }
+
+    return m_shaders[_index]->m_codeHash;
+}
+
 void ShaderProgramManager::LoadShader(ionS32 _index)
 {
     if (m_shaders[_index]->m_shaderModule != VK_NULL_HANDLE)
@@ -900,6 +1335,10 @@ void ShaderProgramManager::LoadShader(Shader* _shader)
 
 		VkResult result = vkCreateShaderModule(m_vkDevice, &createInfo, vkMemory, &_shader->m_shaderModule);
 
+        // the programs take the layout of the uniform blocks from here, a module without it falls back to the layout of the material
+        _shader->m_reflection.Parse(createInfo.pCode, fileSize / sizeof(ionU32));
+        _shader->m_codeHash = Tools::HashFNV1a64(binary, fileSize);
+
 		ionDeleteRaw(binary, GetAllocator());
 
 		ionAssertReturnVoid(result == VK_SUCCESS, "Cannot create shader!");
@@ -912,20 +1351,12 @@ void ShaderProgramManager::LoadShader(Shader* _shader)
 
 ionS32 ShaderProgramManager::FindProgram(const Material* _material)
 {
-    for (ionSize i = 0; i < m_shaderPrograms.size(); ++i)
+    // the program index is cached on the material, the generation tells if the programs have been cleared since then
+    if (_material->m_programGeneration == m_programGeneration &&
+        _material->m_programIndex >= 0 && _material->m_programIndex < static_cast<ionS32>(m_shaderPrograms.size()) &&
+        m_shaderPrograms[_material->m_programIndex].m_material == _material)
     {
-        ShaderProgram& prog = m_shaderPrograms[i];
-        if ((prog.m_material == _material) /*&&         // NOT SURE THIS STILL NEED!
-            (prog.m_material->GetVertexShaderLayout() == _material->GetVertexShaderLayout()) && 
-            (prog.m_material->GetFragmentShaderLayout() == _material->GetFragmentShaderLayout()) &&
-            (prog.m_material->GetTessellationControlShaderLayout() == _material->GetTessellationControlShaderLayout()) &&
-            (prog.m_material->GetTessellationEvaluatorShaderLayout() == _material->GetTessellationEvaluatorShaderLayout()) &&
-            (prog.m_material->GetGeometryShaderLayout() == _material->GetGeometryShaderLayout()) &&
-            (prog.m_material->GetComputeShaderLayout() == _material->GetComputeShaderLayout())*/
-            )
-        {
-            return (ionS32)i;
-        }
+        return _material->m_programIndex;
     }
 
     ShaderProgram program;
@@ -950,18 +1381,51 @@ ionS32 ShaderProgramManager::FindProgram(const Material* _material)
     const Shader* tessEvalShader = tessellationEvaluationIndex > -1 && tessellationEvaluationIndex < shaderCount ? m_shaders[tessellationEvaluationIndex] : nullptr;
     const Shader* geometryShader = geometryIndex > -1 && geometryIndex < shaderCount ? m_shaders[geometryIndex] : nullptr;
 
-    ShaderProgramHelper::CreateDescriptorSetLayout(m_vkDevice, program, vertexShader, fragmentShader, tessControlShader, tessEvalShader, geometryShader, _material);
+    ShaderProgramHelper::CreateDescriptorSetLayout(m_vkDevice, m_maxPushConstantsSize, program, vertexShader, fragmentShader, tessControlShader, tessEvalShader, geometryShader, _material);
+
+    // same stages and order of the uniform bindings of the layout
+    if (vertexShader && vertexShader->IsValid())
+    {
+        ValidateShaderLayout(vertexShader, _material->GetVertexShaderLayout(), _material);
+        LinkUniformBlocks(program, _material->GetVertexShaderLayout(), vertexShader);
+    }
+    if (tessControlShader && tessControlShader->IsValid())
+    {
+        ValidateShaderLayout(tessControlShader, _material->GetTessellationControlShaderLayout(), _material);
+        LinkUniformBlocks(program, _material->GetTessellationControlShaderLayout(), tessControlShader);
+    }
+    if (tessEvalShader && tessEvalShader->IsValid())
+    {
+        ValidateShaderLayout(tessEvalShader, _material->GetTessellationEvaluatorShaderLayout(), _material);
+        LinkUniformBlocks(program, _material->GetTessellationEvaluatorShaderLayout(), tessEvalShader);
+    }
+    if (geometryShader && geometryShader->IsValid())
+    {
+        ValidateShaderLayout(geometryShader, _material->GetGeometryShaderLayout(), _material);
+        LinkUniformBlocks(program, _material->GetGeometryShaderLayout(), geometryShader);
+    }
+    if (fragmentShader && fragmentShader->IsValid())
+    {
+        ValidateShaderLayout(fragmentShader, _material->GetFragmentShaderLayout(), _material);
+        LinkUniformBlocks(program, _material->GetFragmentShaderLayout(), fragmentShader);
+    }
 
     // skinning here?
 
     m_shaderPrograms.push_back(program);
 
     const ionS32 index = (ionS32)(m_shaderPrograms.size() - 1);
+
+    _material->m_programIndex = index;
+    _material->m_programGeneration = m_programGeneration;
+
     return index;
 }
 
 void ShaderProgramManager::Restart()
 {
+    WaitPipelineCompilation();
+
     for (ionSize i = 0; i < m_shaderPrograms.size(); ++i)
     {
         ShaderProgram& shaderProgram = m_shaderPrograms[i];
@@ -970,15 +1434,351 @@ void ShaderProgramManager::Restart()
         {
             vkDestroyPipeline(m_vkDevice, shaderProgram.m_pipelines[j].m_pipeline, vkMemory);
         }
-        shaderProgram.m_pipelines.clear();
+        shaderProgram.ClearPipelines();
 
         vkDestroyPipelineLayout(m_vkDevice, shaderProgram.m_pipelineLayout, vkMemory);
         vkDestroyDescriptorSetLayout(m_vkDevice, shaderProgram.m_descriptorSetLayout, vkMemory);
     }
     m_shaderPrograms.clear();
+    ++m_programGeneration;
 
+    // frees the sets of the programs as well
+    m_retiredDescriptorSets.clear();
     vkResetDescriptorPool(m_vkDevice, m_descriptorPool, 0);
 }
 
+void ShaderProgramManager::GetPipelineShaders(const Material* _material, PipelineShaders& _outShaders)
+{
+    ionS32  vertexShaderIndex = -1;
+    ionS32  fragmentShaderIndex = -1;
+    ionS32  tessellationControlIndex = -1;
+    ionS32  tessellationEvaluationIndex = -1;
+    ionS32  geometryIndex = -1;
+    ionBool useJoint = false;
+    ionBool useSkinning = false;
+
+    _material->GetShaders(vertexShaderIndex, fragmentShaderIndex, tessellationControlIndex, tessellationEvaluationIndex, geometryIndex, useJoint, useSkinning);
+
+    _outShaders.m_vertexShader = vertexShaderIndex != -1 ? m_shaders[vertexShaderIndex]->m_shaderModule : VK_NULL_HANDLE;
+    _outShaders.m_fragmentShader = fragmentShaderIndex != -1 ? m_shaders[fragmentShaderIndex]->m_shaderModule : VK_NULL_HANDLE;
+    _outShaders.m_tessellationControlShader = tessellationControlIndex != -1 ? m_shaders[tessellationControlIndex]->m_shaderModule : VK_NULL_HANDLE;
+    _outShaders.m_tessellationEvaluatorShader = tessellationEvaluationIndex != -1 ? m_shaders[tessellationEvaluationIndex]->m_shaderModule : VK_NULL_HANDLE;
+    _outShaders.m_geometryShader = geometryIndex != -1 ? m_shaders[geometryIndex]->m_shaderModule : VK_NULL_HANDLE;
+
+    _outShaders.m_vertexSpecConst = vertexShaderIndex != -1 ? m_shaders[vertexShaderIndex]->GetSpecializationConstants() : nullptr;
+    _outShaders.m_fragmentSpecConst = fragmentShaderIndex != -1 ? m_shaders[fragmentShaderIndex]->GetSpecializationConstants() : nullptr;
+    _outShaders.m_tessCtrlSpecConst = tessellationControlIndex != -1 ? m_shaders[tessellationControlIndex]->GetSpecializationConstants() : nullptr;
+    _outShaders.m_tessEvalSpecConst = tessellationEvaluationIndex != -1 ? m_shaders[tessellationEvaluationIndex]->GetSpecializationConstants() : nullptr;
+    _outShaders.m_geomSpecConst = geometryIndex != -1 ? m_shaders[geometryIndex]->GetSpecializationConstants() : nullptr;
+}
+
+void ShaderProgramManager::FillPipelineRequest(const RenderCore& _render, const Material* _material, ionS32 _programIndex, VkRenderPass _renderPass, ionU64 _stateBits, const PipelineShaders& _shaders, PipelineRequest& _outRequest) const
+{
+    const ShaderProgram& program = m_shaderPrograms[_programIndex];
+
+    _outRequest.m_render = &_render;
+    _outRequest.m_programIndex = _programIndex;
+    _outRequest.m_programGeneration = m_programGeneration;
+    _outRequest.m_pipelineIndex = -1;
+    _outRequest.m_renderPass = _renderPass;
+    _outRequest.m_stateBits = _stateBits;
+    _outRequest.m_topology = _material->GetTopology();
+    _outRequest.m_vertexLayoutType = program.m_vertextLayoutType;
+    _outRequest.m_pipelineLayout = program.m_pipelineLayout;
+    _outRequest.m_shaders = _shaders;
+    _outRequest.m_pipeline = VK_NULL_HANDLE;
+}
+
+VkPipeline ShaderProgramManager::AcquirePipelineAsync(const RenderCore& _render, const Material* _material, VkRenderPass _renderPass, ionU64 _stateBits, const PipelineShaders& _shaders)
+{
+    ShaderProgram& shaderProgram = m_shaderPrograms[m_current];
+
+    const ionS32 index = shaderProgram.FindPipelineIndex(_renderPass, _stateBits);
+    if (index >= 0 && shaderProgram.m_pipelines[index].m_pipeline != VK_NULL_HANDLE)
+    {
+        return shaderProgram.m_pipelines[index].m_pipeline;
+    }
+
+    // never requested: queue it, a failed compilation is not queued again
+    if (index < 0)
+    {
+        PipelineRequest request;
+        FillPipelineRequest(_render, _material, m_current, _renderPass, _stateBits, _shaders, request);
+        request.m_pipelineIndex = shaderProgram.AddPendingPipeline(_renderPass, _stateBits);
+
+        m_pipelineCompiler.Enqueue(request);
+
+        RecordPipelineManifest(_material, _stateBits);
+    }
+
+    VkPipeline fallback = shaderProgram.FindFallbackPipeline(_renderPass, _stateBits);
+    if (fallback != VK_NULL_HANDLE)
+    {
+        ++m_fallbackDrawCount;
+    }
+
+    return fallback;
+}
+
+void ShaderProgramManager::ResolveCompiledPipelines()
+{
+    m_compiledPipelines.clear();
+    m_pipelineCompiler.CollectCompleted(m_compiledPipelines);
+
+    for (ionSize i = 0; i < m_compiledPipelines.size(); ++i)
+    {
+        const PipelineRequest& request = m_compiledPipelines[i];
+
+        // the programs have been cleared in the meantime
+        if (request.m_programGeneration != m_programGeneration)
+        {
+            vkDestroyPipeline(m_vkDevice, request.m_pipeline, vkMemory);
+            continue;
+        }
+
+        ShaderProgram& program = m_shaderPrograms[request.m_programIndex];
+
+        // already created synchronously by a draw not allowed to wait
+        if (program.m_pipelines[request.m_pipelineIndex].m_pipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(m_vkDevice, request.m_pipeline, vkMemory);
+            continue;
+        }
+
+        program.ResolvePendingPipeline(request.m_pipelineIndex, request.m_pipeline);
+    }
+
+    m_compiledPipelines.clear();
+}
+
+void ShaderProgramManager::WaitPipelineCompilation()
+{
+    m_pipelineCompiler.WaitIdle();
+    ResolveCompiledPipelines();
+}
+
+void ShaderProgramManager::PrewarmPipelines(const RenderCore& _render, VkRenderPass _renderPass, const ionVector<const Material*, ShaderProgramManagerAllocator, GetAllocator>& _materials)
+{
+    ionAssertReturnVoid(_renderPass != VK_NULL_HANDLE, "The render pass has to be created before pre-warming the pipelines!");
+
+    struct MaterialByName
+    {
+        ionU64                  m_hash;
+        const Material*         m_material;
+
+        bool operator<(const MaterialByName& _other) const { return m_hash < _other.m_hash; }
+    };
+
+    ionVector<PipelineRequest, ShaderProgramManagerAllocator, GetAllocator> jobs;
+    ionMap<ionU64, ionBool, ShaderProgramManagerAllocator, GetAllocator> queued;
+
+    // the programs are created here on the calling thread, the workers only create the pipelines
+    auto addJob = [&](const Material* _material, ionU64 _stateBits)
+    {
+        // a manifest written without the extended dynamic state has bits which are now dynamic
+        const ionU64 stateBits = _render.GetPipelineStateBits(_stateBits);
+
+        PipelineShaders shaders;
+        GetPipelineShaders(_material, shaders);
+        if (shaders.m_vertexShader == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        const ionS32 programIndex = FindProgram(_material);
+        if (m_shaderPrograms[programIndex].FindPipelineIndex(_renderPass, stateBits) >= 0)
+        {
+            return;
+        }
+
+        const ionU64 key = Tools::HashFNV1a64(&programIndex, sizeof(programIndex), stateBits);
+        if (!queued.insert(std::make_pair(key, true)).second)
+        {
+            return;
+        }
+
+        PipelineRequest job;
+        FillPipelineRequest(_render, _material, programIndex, _renderPass, stateBits, shaders, job);
+        jobs.push_back(job);
+    };
+
+    // same state bits of the draw, see RenderCore::SetState
+    const ionU64 depthTestBits = _render.GetStateBits() & ERasterization_DepthTest_Mask;
+
+    ionVector<MaterialByName, ShaderProgramManagerAllocator, GetAllocator> materialsByName;
+    materialsByName.reserve(_materials.size());
+
+    for (ionSize i = 0; i < _materials.size(); ++i)
+    {
+        const Material* material = _materials[i];
+        addJob(material, material->GetState().GetStateBits() | depthTestBits);
+
+        const ionU64 hash = MaterialNameHash(material);
+        if (hash != 0)
+        {
+            MaterialByName entry;
+            entry.m_hash = hash;
+            entry.m_material = material;
+            materialsByName.push_back(entry);
+        }
+    }
+
+    // the combinations drawn by the previous runs, for the materials with the same name
+    if (!m_pipelineManifest.empty() && !materialsByName.empty())
+    {
+        std::sort(materialsByName.begin(), materialsByName.end());
+
+        for (ionMap<ionU64, PipelineManifestEntry, ShaderProgramManagerAllocator, GetAllocator>::const_iterator it = m_pipelineManifest.cbegin(); it != m_pipelineManifest.cend(); ++it)
+        {
+            MaterialByName search;
+            search.m_hash = it->second.m_materialHash;
+            search.m_material = nullptr;
+
+            auto range = std::equal_range(materialsByName.cbegin(), materialsByName.cend(), search);
+            for (auto match = range.first; match != range.second; ++match)
+            {
+                addJob(match->m_material, it->second.m_stateBits);
+            }
+        }
+    }
+
+    if (jobs.empty())
+    {
+        return;
+    }
+
+    // vkCreateGraphicsPipelines can be called from more threads on the same cache, the driver synchronizes the access
+    const ionU32 jobCount = static_cast<ionU32>(jobs.size());
+    const ionU32 workerCount = std::max(1u, std::min(std::thread::hardware_concurrency(), jobCount));
+
+    std::atomic<ionU32> nextJob(0);
+    auto createPipelines = [&]()
+    {
+        for (ionU32 i = nextJob++; i < jobCount; i = nextJob++)
+        {
+            jobs[i].m_pipeline = PipelineCompiler::Create(jobs[i]);
+        }
+    };
+
+    // the calling thread is one of the workers
+    ionVector<std::thread, ShaderProgramManagerAllocator, GetAllocator> workers;
+    workers.reserve(workerCount - 1);
+    for (ionU32 i = 1; i < workerCount; ++i)
+    {
+        workers.push_back(std::thread(createPipelines));
+    }
+    createPipelines();
+    for (ionSize i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+
+    for (ionU32 i = 0; i < jobCount; ++i)
+    {
+        const PipelineRequest& job = jobs[i];
+        if (job.m_pipeline != VK_NULL_HANDLE)
+        {
+            m_shaderPrograms[job.m_programIndex].AddPipeline(_renderPass, job.m_stateBits, job.m_pipeline);
+            ++m_prewarmedPipelineCount;
+        }
+    }
+}
+
+void ShaderProgramManager::RecordPipelineManifest(const Material* _material, ionU64 _stateBits)
+{
+    const ionU64 materialHash = MaterialNameHash(_material);
+    if (materialHash == 0)
+    {
+        return;
+    }
+
+    PipelineManifestEntry entry;
+    entry.m_materialHash = materialHash;
+    entry.m_stateBits = _stateBits;
+
+    if (m_pipelineManifest.insert(std::make_pair(PipelineManifestKey(materialHash, _stateBits), entry)).second)
+    {
+        m_pipelineManifestChanged = true;
+    }
+}
+
+void ShaderProgramManager::LoadPipelineManifest()
+{
+    m_pipelineManifest.clear();
+    m_pipelineManifestChanged = false;
+
+    const ionString path = ionFileSystemManager().GetCachePath() + ION_PIPELINE_MANIFEST_FILENAME;
+
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return;
+    }
+
+    const ionSize fileSize = static_cast<ionSize>(file.tellg());
+    if (fileSize < sizeof(PipelineManifestHeader))
+    {
+        return;
+    }
+
+    file.seekg(0, std::ios::beg);
+
+    PipelineManifestHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(PipelineManifestHeader));
+
+    if (header.m_magic != ION_PIPELINE_MANIFEST_MAGIC || header.m_version != ION_PIPELINE_MANIFEST_VERSION ||
+        header.m_count == 0 || fileSize != sizeof(PipelineManifestHeader) + header.m_count * sizeof(PipelineManifestEntry))
+    {
+        return;
+    }
+
+    ionVector<PipelineManifestEntry, ShaderProgramManagerAllocator, GetAllocator> entries;
+    entries.resize(static_cast<ionSize>(header.m_count));
+    file.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PipelineManifestEntry)));
+
+    if (!file.good() || Tools::HashFNV1a64(entries.data(), entries.size() * sizeof(PipelineManifestEntry)) != header.m_dataHash)
+    {
+        return;
+    }
+
+    for (ionSize i = 0; i < entries.size(); ++i)
+    {
+        m_pipelineManifest.insert(std::make_pair(PipelineManifestKey(entries[i].m_materialHash, entries[i].m_stateBits), entries[i]));
+    }
+}
+
+void ShaderProgramManager::SavePipelineManifest()
+{
+    if (!m_pipelineManifestChanged || m_pipelineManifest.empty())
+    {
+        return;
+    }
+
+    const ionSize dataSize = m_pipelineManifest.size() * sizeof(PipelineManifestEntry);
+
+    ionVector<ionU8, ShaderProgramManagerAllocator, GetAllocator> fileData;
+    fileData.resize(sizeof(PipelineManifestHeader) + dataSize);
+
+    PipelineManifestEntry* entries = reinterpret_cast<PipelineManifestEntry*>(fileData.data() + sizeof(PipelineManifestHeader));
+    for (ionMap<ionU64, PipelineManifestEntry, ShaderProgramManagerAllocator, GetAllocator>::const_iterator it = m_pipelineManifest.cbegin(); it != m_pipelineManifest.cend(); ++it)
+    {
+        *entries++ = it->second;
+    }
+
+    PipelineManifestHeader header = {};
+    header.m_magic = ION_PIPELINE_MANIFEST_MAGIC;
+    header.m_version = ION_PIPELINE_MANIFEST_VERSION;
+    header.m_count = m_pipelineManifest.size();
+    header.m_dataHash = Tools::HashFNV1a64(fileData.data() + sizeof(PipelineManifestHeader), dataSize);
+
+    MemUtils::MemCpy(fileData.data(), &header, sizeof(PipelineManifestHeader));
+
+    const ionString path = ionFileSystemManager().GetCachePath() + ION_PIPELINE_MANIFEST_FILENAME;
+    if (ionFileSystemManager().WriteFileAtomic(path, fileData.data(), fileData.size()))
+    {
+        m_pipelineManifestChanged = false;
+    }
+}
+
 
 ION_NAMESPACE_END
\ No newline at end of file
@@ -20,6 +20,7 @@
 #include "../Core/MemorySettings.h"
 
 #include "ShaderProgram.h"
+#include "PipelineCompiler.h"
 
 
 EOS_USING_NAMESPACE
@@ -29,6 +30,14 @@ ION_NAMESPACE_BEGIN
 using ShaderProgramManagerAllocator = MemoryAllocator<FreeListBestSearchAllocationPolicy, MultiThreadPolicy, MemoryBoundsCheck, MemoryTag, MemoryLog>;
 
 
+struct DescriptorStatistics
+{
+    ionU32  m_allocatedSets;        // descriptor sets allocated because a material is drawn the first time or its bindings changed
+    ionU32  m_descriptorWrites;     // descriptors written in the allocated sets
+    ionU32  m_reusedSets;           // draws bound to the cached set of the material
+    ionU32  m_sharedSceneBlocks;    // scene uniform blocks bound at the offset of the one already written for the camera
+};
+
 class Material;
 class RenderCore;
 class ION_DLL ShaderProgramManager final
@@ -39,7 +48,7 @@ public:
 public:
     static ShaderProgramManager& Instance();
 
-    ionBool Init(VkDevice _vkDevice);
+    ionBool Init(VkDevice _vkDevice, ionU32 _framesInFlight, ionU32 _maxPushConstantsSize);
     void    Shutdown();
 
     ShaderProgramManager();
@@ -49,6 +58,7 @@ public:
 
     /*
     IMPORTANT
+    Only for the shader modules without reflection (see LinkUniformBlocks), the others take the offsets from the module.
     When a uniform is defined, in order to optimize the memory, I assume that all type are
     grouped.
     So in the shader all uniform must be set in this way:
@@ -59,8 +69,26 @@ public:
     as well as in the shader layout on code side.
     */
 
+    //////////////////////////////////////////////////////////////////////////
+    // Every parameter has a slot in the flat storage of its type, assigned the first time it is used and kept until the shutdown.
+    // The programs resolve the slots of their uniforms once when linked, the code setting a parameter every draw
+    // should get its slot once and use the "At" setters, the ones taking the name or the hash look up the slot every call.
+    ionU32  GetRenderParamSlot(ionSize _paramHash, EBufferParameterType _type);
+
+    // A scene parameter changes only between the cameras (view, projection, lights...), it has to be marked before the programs are linked.
+    // The uniform blocks made only of scene parameters are written once and shared by all the draws until InvalidateSceneBlocks,
+    // so after changing them with the "At" setters InvalidateSceneBlocks has to be called, the other setters do it by themselves.
+    ionU32  GetSceneRenderParamSlot(ionSize _paramHash, EBufferParameterType _type);
+    void    InvalidateSceneBlocks() { m_sceneBlocks.clear(); }
+
+    void    SetRenderParamMatrixAt(ionU32 _slot, const Matrix4x4& _value) { m_renderParamMatrices[_slot] = _value; }
+    void    SetRenderParamVectorAt(ionU32 _slot, const Vector4& _value) { m_renderParamVectors[_slot] = _value; }
+    void    SetRenderParamFloatAt(ionU32 _slot, const ionFloat _value) { m_renderParamFloats[_slot] = _value; }
+    void    SetRenderParamIntegerAt(ionU32 _slot, const ionS32 _value) { m_renderParamIntegers[_slot] = _value; }
+
     //////////////////////////////////////////////////////////////////////////
     // if parameter not found, return a vector 0 and create this new hash! BE CAREFUL!
+    // the reference is valid until a new parameter of the same type is created
     const   Matrix4x4& GetRenderParamMatrix(const ionString& _param);
     const   Matrix4x4& GetRenderParamMatrix(ionSize _paramHash);
 
@@ -73,13 +101,15 @@ public:
     const   ionS32 GetRenderParamInteger(const ionString& _param);
     const   ionS32 GetRenderParamInteger(ionSize _paramHash);
 
+    // the render loop should use the overloads with the hash (ION_*_PARAM_HASH or a HashedName), which never build nor hash a string:
+    // the elements of the arrays are the name followed by the index, hashed by Tools::HashNameIndex
     void    SetRenderParamMatrix(const ionString& _param, const Matrix4x4& _value);
     void    SetRenderParamMatrix(ionSize _paramHash, const Matrix4x4& _value);
     void    SetRenderParamMatrix(const ionString& _param, const ionFloat* _value);
     void    SetRenderParamMatrix(ionSize _paramHash, const ionFloat* _value);
     void    SetRenderParamsMatrix(const ionString& _param, const ionFloat* _values, ionU32 _numValues);
     void    SetRenderParamsMatrix(const ionString& _param, const ionVector<Matrix4x4, ShaderProgramManagerAllocator, GetAllocator>& _values);
-    //void    SetRenderParamsMatrix(ionSize _paramHash, const ionFloat* _values, ionU32 _numValues);
+    void    SetRenderParamsMatrix(ionSize _paramHash, const ionFloat* _values, ionU32 _numValues);
 
     void    SetRenderParamVector(const ionString& _param, const Vector4& _value);
     void    SetRenderParamVector(ionSize _paramHash, const Vector4& _value);
@@ -87,17 +117,17 @@ public:
     void    SetRenderParamVector(ionSize _paramHash, const ionFloat* _value);
     void    SetRenderParamsVector(const ionString& _param, const ionFloat* _values, ionU32 _numValues);
     void    SetRenderParamsVector(const ionString& _param, const ionVector<Vector4, ShaderProgramManagerAllocator, GetAllocator>& _values);
-    //void    SetRenderParamsVector(ionSize _paramHash, const ionFloat* _values, ionU32 _numValues);
+    void    SetRenderParamsVector(ionSize _paramHash, const ionFloat* _values, ionU32 _numValues);
 
     void    SetRenderParamFloat(const ionString& _param, const ionFloat _value);
     void    SetRenderParamFloat(ionSize _paramHash, const ionFloat _value);
     void    SetRenderParamsFloat(const ionString& _param, const ionFloat* _values, ionU32 _numValues);
-    //void    SetRenderParamsFloat(ionSize _paramHash, const ionFloat* _values, ionU32 _numValues);
+    void    SetRenderParamsFloat(ionSize _paramHash, const ionFloat* _values, ionU32 _numValues);
 
     void    SetRenderParamInteger(const ionString& _param, const ionS32 _value);
     void    SetRenderParamInteger(ionSize _paramHash, const ionS32 _value);
     void    SetRenderParamsInteger(const ionString& _param, const ionS32* _values, ionU32 _numValues);
-    //void    SetRenderParamsInteger(ionSize _paramHash, const ionS32* _values, ionU32 _numValues);
+    void    SetRenderParamsInteger(ionSize _paramHash, const ionS32* _values, ionU32 _numValues);
 
     //////////////////////////////////////////////////////////////////////////
 
@@ -105,14 +135,47 @@ public:
     ionS32  FindShader(const ionString& _path, const ionString& _name, EShaderStage _stage);
     ionS32  FindShader(const ionString& _path, const ionString& _name, EShaderStage _stage, const ionVector<ionFloat, ShaderProgramManagerAllocator, GetAllocator>& _specializationConstantValues);
 
-    void    StartFrame();
+    void    StartFrame(ionU32 _frameIndex);
     void    EndFrame();
     void    BindProgram(ionS32 _index);
-    void    CommitCurrent(const RenderCore& _render, const Material* _material, VkRenderPass _renderPass, ionU64 _stateBits, VkCommandBuffer _commandBuffer);
+    // false if nothing has been bound and the draw has to be skipped
+    // _asyncPipeline: a missing pipeline is queued to the pipeline compiler and the draw uses a fallback pipeline of the same program, or is skipped, until it is ready
+    ionBool CommitCurrent(const RenderCore& _render, const Material* _material, VkRenderPass _renderPass, ionU64 _stateBits, VkCommandBuffer _commandBuffer, ionBool _asyncPipeline = false);
+
+    // CommitCurrent in two steps: the prepare writes the uniform blocks and the descriptor set and has to run on the render thread, in the order of the draws.
+    // The record only reads the commit, so the commits of a render pass can be recorded by other threads, see CommandRecorder
+    ionBool PrepareCurrent(const RenderCore& _render, const Material* _material, VkRenderPass _renderPass, ionU64 _stateBits, DrawCommit& _outCommit, ionBool _asyncPipeline = false);
+    static void RecordCommit(VkCommandBuffer _commandBuffer, const DrawCommit& _commit);
+    static void RecordDrawConstants(VkCommandBuffer _commandBuffer, const DrawCommit& _commit, const DrawConstants& _constants);
     ionS32  FindProgram(const Material* _material);
 
+    // after CommitCurrent, only for the programs of the materials using the draw constants
+    void    PushDrawConstants(VkCommandBuffer _commandBuffer, const DrawConstants& _constants);
+
+    // Create the pipelines of the materials drawn in the render pass before their first draw, in parallel and sharing the pipeline cache.
+    // Together with the state bits of the material are created the ones recorded in the pipeline manifest by the previous runs.
+    void    PrewarmPipelines(const RenderCore& _render, VkRenderPass _renderPass, const ionVector<const Material*, ShaderProgramManagerAllocator, GetAllocator>& _materials);
+    ionU32  GetPrewarmedPipelineCount() const { return m_prewarmedPipelineCount; }
+
+    void    SetAsyncPipelineCompilation(ionBool _enable) { m_asyncPipelineCompilation = _enable; }
+    ionBool IsAsyncPipelineCompilation() const { return m_asyncPipelineCompilation; }
+
+    // of the device, see Material::GetPushConstantsSize
+    ionU32  GetMaxPushConstantsSize() const { return m_maxPushConstantsSize; }
+
+    // block until the queued pipelines are compiled, needed before destroying a render pass they can refer to
+    void    WaitPipelineCompilation();
+
+    // of the current frame
+    ionU32  GetFallbackDrawCount() const { return m_fallbackDrawCount; }
+    ionU32  GetSkippedDrawCount() const { return m_skippedDrawCount; }
+    const DescriptorStatistics& GetDescriptorStatistics() const { return m_descriptorStatistics; }
+
     void    UnloadShader(ionSize _index);
 
+    // of the SPIR-V of the shader as loaded, 0 for an invalid index
+    ionU64  GetShaderCodeHash(ionS32 _index) const;
+
     void    Restart();
 
 private:
@@ -122,7 +185,50 @@ private:
     void    LoadShader(ionS32 _index);
     void    LoadShader(Shader* _shader);
 
-    void    AllocUniformParametersBlockBuffer(const RenderCore& _render, const UniformBinding& _uniform, UniformBuffer& _ubo);
+    // Resolve the parameters of the uniforms of a stage to their slots and offsets in the block.
+    // The blocks take the members and the offsets reflected from the shader module, so any std140 order works and the layout
+    // of the material needs only the binding; without reflection (stripped names, structs...) they are packed as declared in the layout.
+    void    LinkUniformBlocks(ShaderProgram& _shaderProgram, const ShaderLayoutDef& _layout, const Shader* _shader);
+    ionBool LinkReflectedUniformBlock(const UniformBinding& _uniform, const ReflectedDescriptor& _reflected, UniformBlockLayout& _outBlock);
+    void    LinkDeclaredUniformBlock(const UniformBinding& _uniform, UniformBlockLayout& _outBlock);
+
+    // report the bindings of the layout of the material not matching the ones of the shader module, debug only
+    void    ValidateShaderLayout(const Shader* _shader, const ShaderLayoutDef& _layout, const Material* _material) const;
+    ionU32  GetRenderParamSlotToWrite(ionSize _paramHash, EBufferParameterType _type);
+    void    AllocUniformParametersBlockBuffer(const RenderCore& _render, const UniformBlockLayout& _block, UniformBuffer& _ubo);
+
+    // write the descriptor set of the program if its bindings changed since the last draw, the old one is retired
+    ionBool UpdateDescriptorSet(ShaderProgram& _shaderProgram, const DescriptorBindingState* _states, const VkDescriptorType* _types, const ionU32* _destBindings, ionU32 _count);
+    void    ReleaseRetiredDescriptorSets();
+
+    struct SceneBlock
+    {
+        ionU64                      m_sceneKey;
+        ionSize                     m_offset;           // in the uniform buffer of the frame
+        ionSize                     m_size;
+    };
+
+    struct RetiredDescriptorSet
+    {
+        VkDescriptorSet             m_descriptorSet;
+        ionU64                      m_frame;
+    };
+
+    struct PipelineManifestEntry
+    {
+        ionU64                      m_materialHash;     // of the name of the material
+        ionU64                      m_stateBits;
+    };
+
+    void    GetPipelineShaders(const Material* _material, PipelineShaders& _outShaders);
+    void    FillPipelineRequest(const RenderCore& _render, const Material* _material, ionS32 _programIndex, VkRenderPass _renderPass, ionU64 _stateBits, const PipelineShaders& _shaders, PipelineRequest& _outRequest) const;
+
+    VkPipeline AcquirePipelineAsync(const RenderCore& _render, const Material* _material, VkRenderPass _renderPass, ionU64 _stateBits, const PipelineShaders& _shaders);
+    void    ResolveCompiledPipelines();
+
+    void    LoadPipelineManifest();
+    void    SavePipelineManifest();
+    void    RecordPipelineManifest(const Material* _material, ionU64 _stateBits);
 
 public:
     ionVector<ShaderProgram, ShaderProgramManagerAllocator, GetAllocator> m_shaderPrograms;
@@ -130,21 +236,49 @@ public:
 private:
     VkDevice                m_vkDevice;
     ionS32                  m_current;
+    ionU32                  m_maxPushConstantsSize;
+    ionU32                  m_programGeneration;    // incremented when the programs are cleared, see Material::m_programIndex
+    ionU32                  m_prewarmedPipelineCount;
+    ionU32                  m_fallbackDrawCount;
+    ionU32                  m_skippedDrawCount;
+    ionU64                  m_frame;
+    DescriptorStatistics    m_descriptorStatistics;
+    ionBool                 m_asyncPipelineCompilation;
+    ionBool                 m_pipelineManifestChanged;
     ionVector<Shader*, ShaderProgramManagerAllocator, GetAllocator>       m_shaders;
 
-    // are a map where the key is the hash of the name of the uniform in the shader and the value the vector associated
-    ionMap<ionSize, Vector4, ShaderProgramManagerAllocator, GetAllocator>     m_uniformsVector;
-    ionMap<ionSize, Matrix4x4, ShaderProgramManagerAllocator, GetAllocator>     m_uniformsMatrix;
-    ionMap<ionSize, ionFloat, ShaderProgramManagerAllocator, GetAllocator>   m_uniformsFloat;
-    ionMap<ionSize, ionS32, ShaderProgramManagerAllocator, GetAllocator>     m_uniformsInteger;
+    // per type, the key is the hash of the name of the uniform in the shader and the value the slot in the storage below
+    ionMap<ionSize, ionU32, ShaderProgramManagerAllocator, GetAllocator>      m_renderParamSlots[EBufferParameterType_Count];
+
+    ionVector<Matrix4x4, ShaderProgramManagerAllocator, GetAllocator>         m_renderParamMatrices;
+    ionVector<Vector4, ShaderProgramManagerAllocator, GetAllocator>           m_renderParamVectors;
+    ionVector<ionFloat, ShaderProgramManagerAllocator, GetAllocator>          m_renderParamFloats;
+    ionVector<ionS32, ShaderProgramManagerAllocator, GetAllocator>            m_renderParamIntegers;
+
+    // per type, 1 if the slot is a scene parameter
+    ionVector<ionU8, ShaderProgramManagerAllocator, GetAllocator>             m_renderParamScene[EBufferParameterType_Count];
 
-    ionS32                  m_currentDescSet;
+    // the scene blocks already written for the current camera, just a few so a linear search is enough
+    ionVector<SceneBlock, ShaderProgramManagerAllocator, GetAllocator>        m_sceneBlocks;
+
+    // (material, state bits) drawn so far, the key is the hash of the entry
+    ionMap<ionU64, PipelineManifestEntry, ShaderProgramManagerAllocator, GetAllocator>   m_pipelineManifest;
+
+    PipelineCompiler        m_pipelineCompiler;
+    ionVector<PipelineRequest, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>  m_compiledPipelines;
+
+    // the uniform buffer has a range per frame in flight, the blocks of a frame are written in its range while the GPU reads the other ones
     ionSize                 m_currentParmBufferOffset;
+    ionSize                 m_frameParmBufferSize;
+    ionSize                 m_frameParmBufferEnd;
     VkDescriptorPool        m_descriptorPool;
-    VkDescriptorSet         m_descriptorSets[ION_MAX_DESCRIPTOR_SETS];
+
+    // replaced sets of the programs, freed when the frames in flight are done with them
+    ionVector<RetiredDescriptorSet, ShaderProgramManagerAllocator, GetAllocator>  m_retiredDescriptorSets;
 
     UniformBuffer*          m_skinningUniformBuffer;
     UniformBuffer*          m_uniformBuffer;
+    ionU8*                  m_uniformBufferData;    // persistently mapped
 };
 
 ION_NAMESPACE_END
@@ -0,0 +1,517 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Shader\ShaderReflection.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#include "ShaderReflection.h"
+
+#include <cstring>
+#include <string>
+
+#include "../Utilities/HashedName.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+namespace
+{
+    // from the SPIR-V specification, just what is read here
+    const ionU32 kSpirvMagicNumber = 0x07230203;
+    const ionU32 kSpirvHeaderWordCount = 5;
+    const ionU32 kSpirvInvalidBinding = 0xFFFFFFFF;
+
+    enum ESpirvOp : ionU32
+    {
+        ESpirvOp_MemberName = 6,
+        ESpirvOp_TypeBool = 20,
+        ESpirvOp_TypeInt = 21,
+        ESpirvOp_TypeFloat = 22,
+        ESpirvOp_TypeVector = 23,
+        ESpirvOp_TypeMatrix = 24,
+        ESpirvOp_TypeImage = 25,
+        ESpirvOp_TypeSampler = 26,
+        ESpirvOp_TypeSampledImage = 27,
+        ESpirvOp_TypeArray = 28,
+        ESpirvOp_TypeRuntimeArray = 29,
+        ESpirvOp_TypeStruct = 30,
+        ESpirvOp_TypePointer = 32,
+        ESpirvOp_Constant = 43,
+        ESpirvOp_Variable = 59,
+        ESpirvOp_Decorate = 71,
+        ESpirvOp_MemberDecorate = 72
+    };
+
+    enum ESpirvDecoration : ionU32
+    {
+        ESpirvDecoration_BufferBlock = 3,
+        ESpirvDecoration_RowMajor = 4,
+        ESpirvDecoration_ArrayStride = 6,
+        ESpirvDecoration_MatrixStride = 7,
+        ESpirvDecoration_Binding = 33,
+        ESpirvDecoration_DescriptorSet = 34,
+        ESpirvDecoration_Offset = 35
+    };
+
+    enum ESpirvStorageClass : ionU32
+    {
+        ESpirvStorageClass_UniformConstant = 0,
+        ESpirvStorageClass_Uniform = 2,
+        ESpirvStorageClass_PushConstant = 9,
+        ESpirvStorageClass_StorageBuffer = 12
+    };
+
+    enum ESpirvDim : ionU32
+    {
+        ESpirvDim_Buffer = 5,
+        ESpirvDim_SubpassData = 6
+    };
+
+    ION_INLINE ionU64 MemberKey(ionU32 _structId, ionU32 _member)
+    {
+        return (static_cast<ionU64>(_structId) << 32) | _member;
+    }
+
+    // The module indexed by id, the decorations come before the types so everything is collected first and resolved later
+    class SpirvModule
+    {
+    public:
+        SpirvModule(const ionU32* _code) : m_code(_code) {}
+
+        ionBool Index(ionSize _wordCount, ionVector<ionU32, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>& _outVariables)
+        {
+            const ionU32 bound = m_code[3];
+            m_definitions.resize(bound, 0);
+            m_bindings.resize(bound, kSpirvInvalidBinding);
+            m_sets.resize(bound, 0);
+            m_arrayStrides.resize(bound, 0);
+            m_bufferBlocks.resize(bound, 0);
+
+            ionSize word = kSpirvHeaderWordCount;
+            while (word < _wordCount)
+            {
+                const ionU32 wordCount = m_code[word] >> 16;
+                const ionU32 opCode = m_code[word] & 0xFFFF;
+
+                ionAssertReturnValue(wordCount > 0 && word + wordCount <= _wordCount, "Corrupted SPIR-V module!", false);
+
+                const ionU32* operands = m_code + word + 1;
+                switch (opCode)
+                {
+                case ESpirvOp_MemberName:
+                {
+                    // literal string, nul terminated and padded to the word
+                    const char* name = reinterpret_cast<const char*>(operands + 2);
+                    const ionSize maxLength = (wordCount - 3) * sizeof(ionU32);
+                    m_memberNames[MemberKey(operands[0], operands[1])] = ionString(name, strnlen(name, maxLength));
+                }
+                break;
+
+                case ESpirvOp_Decorate:
+                    ionAssertReturnValue(operands[0] < bound, "Corrupted SPIR-V module!", false);
+                    switch (operands[1])
+                    {
+                    case ESpirvDecoration_BufferBlock:      m_bufferBlocks[operands[0]] = 1; break;
+                    case ESpirvDecoration_ArrayStride:      m_arrayStrides[operands[0]] = operands[2]; break;
+                    case ESpirvDecoration_Binding:          m_bindings[operands[0]] = operands[2]; break;
+                    case ESpirvDecoration_DescriptorSet:    m_sets[operands[0]] = operands[2]; break;
+                    default: break;
+                    }
+                    break;
+
+                case ESpirvOp_MemberDecorate:
+                    switch (operands[2])
+                    {
+                    case ESpirvDecoration_Offset:           m_memberOffsets[MemberKey(operands[0], operands[1])] = operands[3]; break;
+                    case ESpirvDecoration_MatrixStride:     m_memberMatrixStrides[MemberKey(operands[0], operands[1])] = operands[3]; break;
+                    case ESpirvDecoration_RowMajor:         m_memberRowMajors[MemberKey(operands[0], operands[1])] = 1; break;
+                    default: break;
+                    }
+                    break;
+
+                case ESpirvOp_TypeBool:
+                case ESpirvOp_TypeInt:
+                case ESpirvOp_TypeFloat:
+                case ESpirvOp_TypeVector:
+                case ESpirvOp_TypeMatrix:
+                case ESpirvOp_TypeImage:
+                case ESpirvOp_TypeSampler:
+                case ESpirvOp_TypeSampledImage:
+                case ESpirvOp_TypeArray:
+                case ESpirvOp_TypeRuntimeArray:
+                case ESpirvOp_TypeStruct:
+                case ESpirvOp_TypePointer:
+                    ionAssertReturnValue(operands[0] < bound, "Corrupted SPIR-V module!", false);
+                    m_definitions[operands[0]] = static_cast<ionU32>(word);
+                    break;
+
+                case ESpirvOp_Constant:
+                case ESpirvOp_Variable:
+                    ionAssertReturnValue(operands[1] < bound, "Corrupted SPIR-V module!", false);
+                    m_definitions[operands[1]] = static_cast<ionU32>(word);
+                    if (opCode == ESpirvOp_Variable)
+                    {
+                        _outVariables.push_back(static_cast<ionU32>(word));
+                    }
+                    break;
+
+                default:
+                    break;
+                }
+
+                word += wordCount;
+            }
+
+            return true;
+        }
+
+        // the instruction defining the id, the result is at [1] for the types and at [2] for constants and variables
+        const ionU32* Definition(ionU32 _id) const { return (_id < m_definitions.size() && m_definitions[_id] != 0) ? m_code + m_definitions[_id] : nullptr; }
+        ionU32 OpCode(ionU32 _id) const { const ionU32* instruction = Definition(_id); return instruction != nullptr ? (instruction[0] & 0xFFFF) : 0; }
+        ionU32 WordCount(ionU32 _id) const { const ionU32* instruction = Definition(_id); return instruction != nullptr ? (instruction[0] >> 16) : 0; }
+
+        ionU32 ConstantValue(ionU32 _id) const
+        {
+            const ionU32* instruction = Definition(_id);
+            return (instruction != nullptr && OpCode(_id) == ESpirvOp_Constant) ? instruction[3] : 0;
+        }
+
+        ionU32 Binding(ionU32 _id) const { return m_bindings[_id]; }
+        ionU32 Set(ionU32 _id) const { return m_sets[_id]; }
+        ionBool IsBufferBlock(ionU32 _id) const { return m_bufferBlocks[_id] != 0; }
+
+        template<typename T>
+        static ionBool Find(const ionMap<ionU64, T, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>& _map, ionU64 _key, T& _outValue)
+        {
+            auto search = _map.find(_key);
+            if (search == _map.end())
+            {
+                return false;
+            }
+            _outValue = search->second;
+            return true;
+        }
+
+        // bytes of the type in a block laid out by the decorations, _member is the member of _structId having this type for the matrices
+        ionU32 SizeOf(ionU32 _typeId, ionU32 _structId = 0, ionU32 _member = 0) const
+        {
+            const ionU32* instruction = Definition(_typeId);
+            if (instruction == nullptr)
+            {
+                return 0;
+            }
+
+            switch (OpCode(_typeId))
+            {
+            case ESpirvOp_TypeBool:
+                return 4;
+
+            case ESpirvOp_TypeInt:
+            case ESpirvOp_TypeFloat:
+                return instruction[2] / 8;
+
+            case ESpirvOp_TypeVector:
+                return instruction[3] * SizeOf(instruction[2]);
+
+            case ESpirvOp_TypeMatrix:
+            {
+                const ionU32 columnType = instruction[2];
+                const ionU32 columns = instruction[3];
+                const ionU32 rows = OpCode(columnType) == ESpirvOp_TypeVector ? Definition(columnType)[3] : 1;
+
+                ionU32 stride = 0;
+                ionU8 rowMajor = 0;
+                Find(m_memberMatrixStrides, MemberKey(_structId, _member), stride);
+                Find(m_memberRowMajors, MemberKey(_structId, _member), rowMajor);
+
+                if (stride == 0)
+                {
+                    return columns * SizeOf(columnType);
+                }
+                return (rowMajor != 0 ? rows : columns) * stride;
+            }
+
+            case ESpirvOp_TypeArray:
+            {
+                const ionU32 length = ConstantValue(instruction[3]);
+                const ionU32 stride = m_arrayStrides[_typeId];
+                return length * (stride != 0 ? stride : SizeOf(instruction[2], _structId, _member));
+            }
+
+            case ESpirvOp_TypeStruct:
+            {
+                ionU32 size = 0;
+                const ionU32 memberCount = WordCount(_typeId) - 2;
+                for (ionU32 i = 0; i < memberCount; ++i)
+                {
+                    ionU32 offset = 0;
+                    Find(m_memberOffsets, MemberKey(_typeId, i), offset);
+
+                    const ionU32 end = offset + SizeOf(instruction[2 + i], _typeId, i);
+                    size = end > size ? end : size;
+                }
+                return size;
+            }
+
+            default:
+                // runtime arrays have no size
+                return 0;
+            }
+        }
+
+        // false if the member cannot be filled by a render parameter
+        ionBool AddMember(const ionString& _name, ionU32 _typeId, ionU32 _offset, ionU32 _structId, ionU32 _member, ReflectedDescriptor& _descriptor) const
+        {
+            const ionU32* instruction = Definition(_typeId);
+            if (instruction == nullptr)
+            {
+                return false;
+            }
+
+            ReflectedBlockMember member;
+            member.m_nameHash = HashedName(_name);
+            member.m_offset = _offset;
+            member.m_isInteger = false;
+
+            switch (OpCode(_typeId))
+            {
+            case ESpirvOp_TypeFloat:
+                member.m_components = 1;
+                if (instruction[2] != 32)
+                {
+                    return false;
+                }
+                break;
+
+            case ESpirvOp_TypeInt:
+                member.m_components = 1;
+                member.m_isInteger = true;
+                if (instruction[2] != 32)
+                {
+                    return false;
+                }
+                break;
+
+            case ESpirvOp_TypeVector:
+                member.m_components = instruction[3];
+                if (OpCode(instruction[2]) != ESpirvOp_TypeFloat || SizeOf(instruction[2]) != 4)
+                {
+                    return false;
+                }
+                break;
+
+            case ESpirvOp_TypeMatrix:
+            {
+                ionU32 stride = 0;
+                ionU8 rowMajor = 0;
+                Find(m_memberMatrixStrides, MemberKey(_structId, _member), stride);
+                Find(m_memberRowMajors, MemberKey(_structId, _member), rowMajor);
+
+                // only the Matrix4x4 layout
+                member.m_components = 16;
+                if (instruction[3] != 4 || SizeOf(instruction[2]) != 16 || stride != 16 || rowMajor != 0)
+                {
+                    return false;
+                }
+            }
+            break;
+
+            default:
+                return false;
+            }
+
+            _descriptor.m_members.push_back(member);
+
+            return true;
+        }
+
+        void AddMembers(ionU32 _structId, ReflectedDescriptor& _descriptor) const
+        {
+            const ionU32* instruction = Definition(_structId);
+            const ionU32 memberCount = WordCount(_structId) - 2;
+            for (ionU32 i = 0; i < memberCount; ++i)
+            {
+                const ionU64 key = MemberKey(_structId, i);
+
+                ionU32 offset = 0;
+                ionString name;
+                if (!Find(m_memberOffsets, key, offset) || !Find(m_memberNames, key, name) || name.empty())
+                {
+                    _descriptor.m_hasUnsupportedMembers = true;
+                    continue;
+                }
+
+                const ionU32 typeId = instruction[2 + i];
+                if (OpCode(typeId) == ESpirvOp_TypeArray)
+                {
+                    const ionU32* arrayInstruction = Definition(typeId);
+                    const ionU32 length = ConstantValue(arrayInstruction[3]);
+                    const ionU32 stride = m_arrayStrides[typeId];
+                    for (ionU32 j = 0; j < length; ++j)
+                    {
+                        const ionString indexName(std::to_string(j).c_str());
+                        if (!AddMember(name + indexName, arrayInstruction[2], offset + j * stride, _structId, i, _descriptor))
+                        {
+                            _descriptor.m_hasUnsupportedMembers = true;
+                        }
+                    }
+                }
+                else if (!AddMember(name, typeId, offset, _structId, i, _descriptor))
+                {
+                    _descriptor.m_hasUnsupportedMembers = true;
+                }
+            }
+        }
+
+    private:
+        const ionU32*   m_code;
+
+        ionVector<ionU32, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>    m_definitions;     // word of the instruction defining the id, 0 if not defined
+        ionVector<ionU32, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>    m_bindings;
+        ionVector<ionU32, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>    m_sets;
+        ionVector<ionU32, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>    m_arrayStrides;
+        ionVector<ionU8, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>     m_bufferBlocks;
+
+        // the key is (struct, member), see MemberKey
+        ionMap<ionU64, ionU32, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>       m_memberOffsets;
+        ionMap<ionU64, ionU32, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>       m_memberMatrixStrides;
+        ionMap<ionU64, ionU8, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>        m_memberRowMajors;
+        ionMap<ionU64, ionString, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>    m_memberNames;
+    };
+}
+
+ionBool ShaderReflection::Parse(const ionU32* _code, ionSize _wordCount)
+{
+    Clear();
+
+    ionAssertReturnValue(_code != nullptr && _wordCount > kSpirvHeaderWordCount && _code[0] == kSpirvMagicNumber, "Not a SPIR-V module!", false);
+
+    SpirvModule module(_code);
+
+    ionVector<ionU32, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator> variables;
+    if (!module.Index(_wordCount, variables))
+    {
+        return false;
+    }
+
+    const ionSize variableCount = variables.size();
+    for (ionSize i = 0; i < variableCount; ++i)
+    {
+        // OpVariable: result type, result id, storage class
+        const ionU32* instruction = _code + variables[i];
+        const ionU32 variableId = instruction[2];
+        const ionU32 storageClass = instruction[3];
+
+        const ionU32* pointer = module.Definition(instruction[1]);
+        if (pointer == nullptr || (pointer[0] & 0xFFFF) != ESpirvOp_TypePointer)
+        {
+            continue;
+        }
+        ionU32 typeId = pointer[3];
+
+        if (storageClass == ESpirvStorageClass_PushConstant)
+        {
+            const ionU32 size = module.SizeOf(typeId);
+            m_pushConstantsSize = size > m_pushConstantsSize ? size : m_pushConstantsSize;
+            continue;
+        }
+
+        if ((storageClass != ESpirvStorageClass_UniformConstant && storageClass != ESpirvStorageClass_Uniform && storageClass != ESpirvStorageClass_StorageBuffer) ||
+            module.Binding(variableId) == kSpirvInvalidBinding)
+        {
+            continue;
+        }
+
+        ReflectedDescriptor descriptor;
+        descriptor.m_set = module.Set(variableId);
+        descriptor.m_binding = module.Binding(variableId);
+        descriptor.m_count = 1;
+        descriptor.m_blockSize = 0;
+        descriptor.m_hasUnsupportedMembers = false;
+
+        if (module.OpCode(typeId) == ESpirvOp_TypeArray)
+        {
+            descriptor.m_count = module.ConstantValue(module.Definition(typeId)[3]);
+            typeId = module.Definition(typeId)[2];
+        }
+        else if (module.OpCode(typeId) == ESpirvOp_TypeRuntimeArray)
+        {
+            descriptor.m_count = 0;
+            typeId = module.Definition(typeId)[2];
+        }
+
+        const ionU32* type = module.Definition(typeId);
+        switch (module.OpCode(typeId))
+        {
+        case ESpirvOp_TypeStruct:
+            descriptor.m_blockSize = module.SizeOf(typeId);
+            if (storageClass == ESpirvStorageClass_StorageBuffer || module.IsBufferBlock(typeId))
+            {
+                descriptor.m_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            }
+            else
+            {
+                descriptor.m_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                module.AddMembers(typeId, descriptor);
+            }
+            break;
+
+        case ESpirvOp_TypeSampledImage:
+            descriptor.m_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            break;
+
+        case ESpirvOp_TypeSampler:
+            descriptor.m_type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            break;
+
+        case ESpirvOp_TypeImage:
+            // OpTypeImage: result, sampled type, dim, depth, arrayed, multisampled, sampled (1 with a sampler, 2 storage), format
+            if (type[3] == ESpirvDim_SubpassData)
+            {
+                descriptor.m_type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            }
+            else if (type[3] == ESpirvDim_Buffer)
+            {
+                descriptor.m_type = type[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            }
+            else
+            {
+                descriptor.m_type = type[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+            break;
+
+        default:
+            // acceleration structures and whatever else is not used by the engine
+            continue;
+        }
+
+        m_descriptors.push_back(descriptor);
+    }
+
+    m_isValid = true;
+
+    return true;
+}
+
+void ShaderReflection::Clear()
+{
+    m_descriptors.clear();
+    m_pushConstantsSize = 0;
+    m_isValid = false;
+}
+
+const ReflectedDescriptor* ShaderReflection::FindDescriptor(ionU32 _set, ionU32 _binding) const
+{
+    const ionSize descriptorCount = m_descriptors.size();
+    for (ionSize i = 0; i < descriptorCount; ++i)
+    {
+        if (m_descriptors[i].m_set == _set && m_descriptors[i].m_binding == _binding)
+        {
+            return &m_descriptors[i];
+        }
+    }
+    return nullptr;
+}
+
+ION_NAMESPACE_END
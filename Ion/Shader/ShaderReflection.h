@@ -0,0 +1,61 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Shader\ShaderReflection.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "../Dependencies/Eos/Eos/Eos.h"
+
+#include "../Core/CoreDefs.h"
+
+#include "ShaderProgramHelper.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+// A member of a uniform block which can be filled from a render parameter: a 32 bit scalar, a float vector or a column major mat4.
+// The elements of an array are expanded with the name of the array followed by the index, as UniformBinding::AddParameter does.
+struct ReflectedBlockMember
+{
+    ionSize                     m_nameHash;     // HashedName of the name, the same of UniformBinding::m_runtimeParameters
+    ionU32                      m_offset;       // in bytes from the beginning of the block
+    ionU32                      m_components;   // 1 scalar, 2 to 4 vector, 16 matrix
+    ionBool                     m_isInteger;
+};
+
+struct ReflectedDescriptor
+{
+    ionU32                      m_set;
+    ionU32                      m_binding;
+    VkDescriptorType            m_type;         // the uniform blocks are VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, dynamic or not is a choice of the layout
+    ionU32                      m_count;        // of an array of descriptors, 0 if unsized
+    ionU32                      m_blockSize;    // uniform and storage blocks, padding included
+    ionBool                     m_hasUnsupportedMembers;    // structs, mat3, row major or stripped names: the block cannot be filled from the members
+    ionVector<ReflectedBlockMember, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>  m_members;
+};
+
+// What a SPIR-V module declares, read from the module when the shader is loaded: descriptors, layout of the uniform blocks and push constants.
+// Only the types, the decorations and the names of the members (debug information, kept by glslc unless stripped) are parsed.
+struct ShaderReflection
+{
+    ionVector<ReflectedDescriptor, ShaderHelperAllocator, ShaderProgramHelper::GetAllocator>  m_descriptors;
+    ionU32                      m_pushConstantsSize;    // 0 if the stage has no push constants
+    ionBool                     m_isValid;
+
+    ShaderReflection() : m_pushConstantsSize(0), m_isValid(false) {}
+
+    ionBool Parse(const ionU32* _code, ionSize _wordCount);
+    void    Clear();
+
+    const ReflectedDescriptor* FindDescriptor(ionU32 _set, ionU32 _binding) const;
+};
+
+ION_NAMESPACE_END
@@ -0,0 +1,1007 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Texture\BasisTranscoder.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#include "BasisTranscoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+namespace
+{
+    static const ionU8 kKTX2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+    // identifier, header (9 x u32), index (4 x u32 and 2 x u64), then one entry (3 x u64) per level
+    static const ionSize kKTX2HeaderOffset = 12;
+    static const ionSize kKTX2IndexOffset = 48;
+    static const ionSize kKTX2LevelIndexOffset = 80;
+    static const ionSize kKTX2LevelIndexEntrySize = 24;
+    static const ionU32  kKTX2SupercompressionBasisLZ = 1;
+    static const ionU32  kKTX2MaxSize = 16384;
+
+    // BasisLZ global data: header (2 x u16 and 4 x u32), then one image description (5 x u32) per image
+    static const ionSize kBasisLZHeaderSize = 20;
+    static const ionSize kBasisLZImageDescSize = 20;
+    static const ionU32  kBasisLZImageFlagPFrame = 0x2;
+
+    // the Huffman codes are canonical as in Deflate, and so are the code length codes
+    static const ionU32 kHuffmanMaxCodeSize = 16;
+    static const ionU32 kHuffmanMaxSymbolsLog2 = 14;
+    static const ionU32 kHuffmanCodeLengthCodes = 21;
+    static const ionU8  kHuffmanCodeLengthOrder[kHuffmanCodeLengthCodes] = { 17, 18, 19, 20, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15, 16 };
+
+    static const ionU32 kEndpointPredRepeatSymbol = 256;
+    static const ionU32 kEndpointPredRepeatMin = 3;
+    static const ionU32 kEndpointPredRepeatBits = 4;
+    static const ionU32 kSelectorRunMin = 3;
+    static const ionU32 kSelectorRunLongSymbol = 63;
+    static const ionU32 kSelectorRunLongBits = 7;
+
+    static const ionS32 kETC1IntensityTable[8][4] =
+    {
+        { -8, -2, 2, 8 }, { -17, -5, 5, 17 }, { -29, -9, 9, 29 }, { -42, -13, 13, 42 },
+        { -60, -18, 18, 60 }, { -80, -24, 24, 80 }, { -106, -33, 33, 106 }, { -183, -47, 47, 183 }
+    };
+
+    ION_INLINE ionU32 ReadU16(const ionU8* _data)
+    {
+        return static_cast<ionU32>(_data[0]) | (static_cast<ionU32>(_data[1]) << 8);
+    }
+
+    ION_INLINE ionU32 ReadU32(const ionU8* _data)
+    {
+        return ReadU16(_data) | (ReadU16(_data + 2) << 16);
+    }
+
+    ION_INLINE ionU64 ReadU64(const ionU8* _data)
+    {
+        return static_cast<ionU64>(ReadU32(_data)) | (static_cast<ionU64>(ReadU32(_data + 4)) << 32);
+    }
+
+    ION_INLINE ionBool IsInRange(ionU64 _offset, ionU64 _length, ionU64 _size)
+    {
+        return _offset <= _size && _length <= _size - _offset;
+    }
+
+    // LSB first, past the end of the data it reads zeros: the decoders check the values they get
+    class BitReader
+    {
+    public:
+        BitReader(const ionU8* _data, ionSize _size) : m_data(_data), m_end(_data + _size), m_buffer(0), m_bufferSize(0) {}
+
+        ionU32 GetBits(ionU32 _count)
+        {
+            ionU32 result = 0;
+            ionU32 shift = 0;
+            while (_count > 0)
+            {
+                if (m_bufferSize == 0)
+                {
+                    m_buffer = (m_data < m_end) ? *m_data++ : 0;
+                    m_bufferSize = 8;
+                }
+
+                const ionU32 count = std::min(_count, m_bufferSize);
+                result |= (m_buffer & ((1u << count) - 1)) << shift;
+                m_buffer >>= count;
+                m_bufferSize -= count;
+                shift += count;
+                _count -= count;
+            }
+            return result;
+        }
+
+        // chunks of _chunkBits, each one followed by a bit telling if another chunk follows
+        ionBool DecodeVLC(ionU32 _chunkBits, ionU32& _outValue)
+        {
+            const ionU32 chunkSize = 1u << _chunkBits;
+
+            _outValue = 0;
+            for (ionU32 shift = 0; shift < 32; shift += _chunkBits)
+            {
+                const ionU32 chunk = GetBits(_chunkBits + 1);
+                _outValue += (chunk & (chunkSize - 1)) << shift;
+                if ((chunk & chunkSize) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        const ionU8*    m_data;
+        const ionU8*    m_end;
+        ionU32          m_buffer;
+        ionU32          m_bufferSize;
+    };
+
+    class HuffmanTable
+    {
+    public:
+        ionBool Init(const ionU8* _codeSizes, ionU32 _count)
+        {
+            memset(m_counts, 0, sizeof(m_counts));
+            m_symbols.clear();
+
+            for (ionU32 i = 0; i < _count; ++i)
+            {
+                if (_codeSizes[i] > kHuffmanMaxCodeSize)
+                {
+                    return false;
+                }
+                ++m_counts[_codeSizes[i]];
+            }
+            m_counts[0] = 0;
+
+            // an over subscribed set of lengths has no code
+            ionS32 left = 1;
+            for (ionU32 i = 1; i <= kHuffmanMaxCodeSize; ++i)
+            {
+                left = (left << 1) - m_counts[i];
+                if (left < 0)
+                {
+                    return false;
+                }
+            }
+
+            // symbols sorted by code size and then by value, the order of the canonical codes
+            ionS32 offsets[kHuffmanMaxCodeSize + 1];
+            offsets[0] = 0;
+            offsets[1] = 0;
+            for (ionU32 i = 1; i < kHuffmanMaxCodeSize; ++i)
+            {
+                offsets[i + 1] = offsets[i] + m_counts[i];
+            }
+
+            m_symbols.resize(static_cast<ionSize>(offsets[kHuffmanMaxCodeSize] + m_counts[kHuffmanMaxCodeSize]));
+            for (ionU32 i = 0; i < _count; ++i)
+            {
+                if (_codeSizes[i] != 0)
+                {
+                    m_symbols[offsets[_codeSizes[i]]++] = static_cast<ionU16>(i);
+                }
+            }
+
+            return true;
+        }
+
+        ionBool IsValid() const { return !m_symbols.empty(); }
+
+        // the codes are stored from their most significant bit
+        ionBool Decode(BitReader& _reader, ionU32& _outSymbol) const
+        {
+            ionS32 code = 0;
+            ionS32 first = 0;
+            ionS32 index = 0;
+            for (ionU32 i = 1; i <= kHuffmanMaxCodeSize; ++i)
+            {
+                code |= static_cast<ionS32>(_reader.GetBits(1));
+
+                const ionS32 count = m_counts[i];
+                if (code - count < first)
+                {
+                    _outSymbol = m_symbols[static_cast<ionSize>(index + (code - first))];
+                    return true;
+                }
+
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+            return false;
+        }
+
+    private:
+        ionS32  m_counts[kHuffmanMaxCodeSize + 1];
+        ionVector<ionU16, TextureAllocator, Texture::GetAllocator> m_symbols;
+    };
+
+    ionBool ReadHuffmanTable(BitReader& _reader, HuffmanTable& _outTable)
+    {
+        const ionU32 symbolCount = _reader.GetBits(kHuffmanMaxSymbolsLog2);
+        if (symbolCount == 0)
+        {
+            return _outTable.Init(nullptr, 0);
+        }
+
+        const ionU32 codeLengthCodeCount = _reader.GetBits(5);
+        if (codeLengthCodeCount < 1 || codeLengthCodeCount > kHuffmanCodeLengthCodes)
+        {
+            return false;
+        }
+
+        ionU8 codeLengthCodeSizes[kHuffmanCodeLengthCodes] = {};
+        for (ionU32 i = 0; i < codeLengthCodeCount; ++i)
+        {
+            codeLengthCodeSizes[kHuffmanCodeLengthOrder[i]] = static_cast<ionU8>(_reader.GetBits(3));
+        }
+
+        HuffmanTable codeLengthTable;
+        if (!codeLengthTable.Init(codeLengthCodeSizes, kHuffmanCodeLengthCodes) || !codeLengthTable.IsValid())
+        {
+            return false;
+        }
+
+        // 0-16 code size, 17 and 18 runs of zeros, 19 and 20 repeat the previous size
+        ionVector<ionU8, TextureAllocator, Texture::GetAllocator> codeSizes;
+        codeSizes.resize(symbolCount, 0);
+
+        ionU32 current = 0;
+        while (current < symbolCount)
+        {
+            ionU32 code = 0;
+            if (!codeLengthTable.Decode(_reader, code))
+            {
+                return false;
+            }
+
+            if (code <= kHuffmanMaxCodeSize)
+            {
+                codeSizes[current++] = static_cast<ionU8>(code);
+            }
+            else if (code == 17 || code == 18)
+            {
+                current += (code == 17) ? _reader.GetBits(3) + 3 : _reader.GetBits(7) + 11;
+            }
+            else
+            {
+                if (current == 0 || codeSizes[current - 1] == 0)
+                {
+                    return false;
+                }
+
+                const ionU8 previous = codeSizes[current - 1];
+                const ionU32 repeat = (code == 19) ? _reader.GetBits(2) + 3 : _reader.GetBits(6) + 7;
+                if (current + repeat > symbolCount)
+                {
+                    return false;
+                }
+
+                for (ionU32 i = 0; i < repeat; ++i)
+                {
+                    codeSizes[current++] = previous;
+                }
+            }
+        }
+
+        if (current != symbolCount)
+        {
+            return false;
+        }
+
+        return _outTable.Init(codeSizes.data(), symbolCount);
+    }
+
+    struct Endpoint
+    {
+        ionU8   m_color5[3];
+        ionU8   m_intensity;
+    };
+
+    // 2 bits per pixel, row y in the byte y, pixel x in the bits 2x: the selectors go from the darkest to the brightest color
+    typedef ionU32 Selectors;
+
+    struct BlockIndices
+    {
+        ionU16  m_endpoint;
+        ionU16  m_selectors;
+    };
+
+    struct SliceTables
+    {
+        HuffmanTable    m_endpointPred;
+        HuffmanTable    m_deltaEndpoint;
+        HuffmanTable    m_selector;
+        HuffmanTable    m_selectorRun;
+        ionU32          m_selectorHistorySize;
+    };
+
+    ionBool DecodeEndpoints(const ionU8* _data, ionSize _size, ionU32 _count, ionVector<Endpoint, TextureAllocator, Texture::GetAllocator>& _outEndpoints)
+    {
+        BitReader reader(_data, _size);
+
+        HuffmanTable color5Delta[3];
+        HuffmanTable intensityDelta;
+        if (!ReadHuffmanTable(reader, color5Delta[0]) || !ReadHuffmanTable(reader, color5Delta[1]) || !ReadHuffmanTable(reader, color5Delta[2]) || !ReadHuffmanTable(reader, intensityDelta))
+        {
+            return false;
+        }
+
+        if (!color5Delta[0].IsValid() || !color5Delta[1].IsValid() || !color5Delta[2].IsValid() || !intensityDelta.IsValid())
+        {
+            return false;
+        }
+
+        const ionBool grayscale = reader.GetBits(1) != 0;
+
+        _outEndpoints.resize(_count);
+
+        // each component is a delta from the previous endpoint, with a table chosen by the previous value
+        ionU32 previousColor5[3] = { 16, 16, 16 };
+        ionU32 previousIntensity = 0;
+        for (ionU32 i = 0; i < _count; ++i)
+        {
+            Endpoint& endpoint = _outEndpoints[i];
+
+            ionU32 delta = 0;
+            if (!intensityDelta.Decode(reader, delta))
+            {
+                return false;
+            }
+            previousIntensity = (previousIntensity + delta) & 7;
+            endpoint.m_intensity = static_cast<ionU8>(previousIntensity);
+
+            const ionU32 componentCount = grayscale ? 1 : 3;
+            for (ionU32 c = 0; c < componentCount; ++c)
+            {
+                const HuffmanTable& table = (previousColor5[c] <= 9) ? color5Delta[0] : (previousColor5[c] <= 21) ? color5Delta[1] : color5Delta[2];
+                if (!table.Decode(reader, delta))
+                {
+                    return false;
+                }
+                previousColor5[c] = (previousColor5[c] + delta) & 31;
+                endpoint.m_color5[c] = static_cast<ionU8>(previousColor5[c]);
+            }
+
+            if (grayscale)
+            {
+                endpoint.m_color5[1] = endpoint.m_color5[0];
+                endpoint.m_color5[2] = endpoint.m_color5[0];
+            }
+        }
+
+        return true;
+    }
+
+    ionBool DecodeSelectors(const ionU8* _data, ionSize _size, ionU32 _count, ionVector<Selectors, TextureAllocator, Texture::GetAllocator>& _outSelectors)
+    {
+        BitReader reader(_data, _size);
+
+        // the global and the hybrid codebooks are not used by the KTX2 files
+        if (reader.GetBits(1) != 0 || reader.GetBits(1) != 0)
+        {
+            return false;
+        }
+
+        _outSelectors.resize(_count);
+
+        const ionBool raw = reader.GetBits(1) != 0;
+        if (raw)
+        {
+            for (ionU32 i = 0; i < _count; ++i)
+            {
+                _outSelectors[i] = reader.GetBits(8) | (reader.GetBits(8) << 8) | (reader.GetBits(8) << 16) | (reader.GetBits(8) << 24);
+            }
+            return true;
+        }
+
+        HuffmanTable deltaSelector;
+        if (!ReadHuffmanTable(reader, deltaSelector) || (_count > 1 && !deltaSelector.IsValid()))
+        {
+            return false;
+        }
+
+        // the first one is raw, the other rows are xored with the same row of the previous one
+        Selectors previous = 0;
+        for (ionU32 i = 0; i < _count; ++i)
+        {
+            Selectors current = 0;
+            for (ionU32 row = 0; row < 4; ++row)
+            {
+                ionU32 value = 0;
+                if (i == 0)
+                {
+                    value = reader.GetBits(8);
+                }
+                else if (deltaSelector.Decode(reader, value))
+                {
+                    value = (value ^ (previous >> (row * 8))) & 0xFF;
+                }
+                else
+                {
+                    return false;
+                }
+                current |= value << (row * 8);
+            }
+
+            _outSelectors[i] = current;
+            previous = current;
+        }
+
+        return true;
+    }
+
+    ionBool DecodeTables(const ionU8* _data, ionSize _size, SliceTables& _outTables)
+    {
+        BitReader reader(_data, _size);
+
+        if (!ReadHuffmanTable(reader, _outTables.m_endpointPred) || !ReadHuffmanTable(reader, _outTables.m_deltaEndpoint) || !ReadHuffmanTable(reader, _outTables.m_selector) || !ReadHuffmanTable(reader, _outTables.m_selectorRun))
+        {
+            return false;
+        }
+
+        _outTables.m_selectorHistorySize = reader.GetBits(13);
+
+        return _outTables.m_endpointPred.IsValid() && _outTables.m_selector.IsValid() && _outTables.m_selectorHistorySize > 0;
+    }
+
+    // the endpoint of a block is predicted from the left, upper or upper left block, or coded as a delta from the previous one:
+    // the predictors of 2x2 blocks are coded together on the even rows.
+    // The selectors are coded as indices, as entries of a history of the recent ones, or as runs of the last used one
+    ionBool DecodeSlice(const ionU8* _data, ionSize _size, ionU32 _blocksX, ionU32 _blocksY, ionU32 _endpointCount, ionU32 _selectorCount, const SliceTables& _tables, ionVector<BlockIndices, TextureAllocator, Texture::GetAllocator>& _outBlocks)
+    {
+        struct BlockPrediction
+        {
+            ionU16  m_endpoint;
+            ionU8   m_predictors;
+        };
+
+        BitReader reader(_data, _size);
+
+        ionVector<BlockPrediction, TextureAllocator, Texture::GetAllocator> predictions[2];
+        predictions[0].resize(_blocksX);
+        predictions[1].resize(_blocksX);
+
+        // approximate move to front: a used entry moves halfway to the front, a new one replaces the second half
+        ionVector<ionU32, TextureAllocator, Texture::GetAllocator> selectorHistory;
+        selectorHistory.resize(_tables.m_selectorHistorySize, 0);
+        ionU32 selectorHistoryRover = _tables.m_selectorHistorySize / 2;
+
+        const ionU32 selectorHistoryFirstSymbol = _selectorCount;
+        const ionU32 selectorRunSymbol = _selectorCount + _tables.m_selectorHistorySize;
+        const ionU32 blockCount = _blocksX * _blocksY;
+
+        _outBlocks.resize(blockCount);
+
+        ionU32 predictors = 0;
+        ionU32 previousPredictors = 0;
+        ionU32 predictorsRepeat = 0;
+        ionU32 previousEndpoint = 0;
+        ionU32 selectorRun = 0;
+
+        for (ionU32 y = 0; y < _blocksY; ++y)
+        {
+            const ionU32 current = y & 1;
+
+            for (ionU32 x = 0; x < _blocksX; ++x)
+            {
+                if ((x & 1) == 0)
+                {
+                    if ((y & 1) == 0)
+                    {
+                        if (predictorsRepeat > 0)
+                        {
+                            --predictorsRepeat;
+                            predictors = previousPredictors;
+                        }
+                        else
+                        {
+                            if (!_tables.m_endpointPred.Decode(reader, predictors))
+                            {
+                                return false;
+                            }
+
+                            if (predictors == kEndpointPredRepeatSymbol)
+                            {
+                                if (!reader.DecodeVLC(kEndpointPredRepeatBits, predictorsRepeat))
+                                {
+                                    return false;
+                                }
+                                predictorsRepeat += kEndpointPredRepeatMin - 1;
+                                predictors = previousPredictors;
+                            }
+                            else
+                            {
+                                previousPredictors = predictors;
+                            }
+                        }
+
+                        // the lower 2x2 row uses the last 4 bits
+                        predictions[current ^ 1][x].m_predictors = static_cast<ionU8>(predictors >> 4);
+                    }
+                    else
+                    {
+                        predictors = predictions[current][x].m_predictors;
+                    }
+                }
+
+                ionU32 endpoint = 0;
+                const ionU32 predictor = predictors & 3;
+                predictors >>= 2;
+
+                switch (predictor)
+                {
+                case 0:     // left
+                    if (x == 0)
+                    {
+                        return false;
+                    }
+                    endpoint = previousEndpoint;
+                    break;
+                case 1:     // upper
+                    if (y == 0)
+                    {
+                        return false;
+                    }
+                    endpoint = predictions[current ^ 1][x].m_endpoint;
+                    break;
+                case 2:     // upper left
+                    if (x == 0 || y == 0)
+                    {
+                        return false;
+                    }
+                    endpoint = predictions[current ^ 1][x - 1].m_endpoint;
+                    break;
+                default:
+                    if (!_tables.m_deltaEndpoint.Decode(reader, endpoint))
+                    {
+                        return false;
+                    }
+                    endpoint += previousEndpoint;
+                    if (endpoint >= _endpointCount)
+                    {
+                        endpoint -= _endpointCount;
+                    }
+                    break;
+                }
+
+                if (endpoint >= _endpointCount)
+                {
+                    return false;
+                }
+
+                predictions[current][x].m_endpoint = static_cast<ionU16>(endpoint);
+                previousEndpoint = endpoint;
+
+                ionU32 selectors = 0;
+                if (selectorRun > 0)
+                {
+                    --selectorRun;
+                    selectors = selectorHistory[0];
+                }
+                else
+                {
+                    ionU32 symbol = 0;
+                    if (!_tables.m_selector.Decode(reader, symbol))
+                    {
+                        return false;
+                    }
+
+                    if (symbol == selectorRunSymbol)
+                    {
+                        ionU32 runSymbol = 0;
+                        if (!_tables.m_selectorRun.Decode(reader, runSymbol))
+                        {
+                            return false;
+                        }
+
+                        if (runSymbol == kSelectorRunLongSymbol)
+                        {
+                            if (!reader.DecodeVLC(kSelectorRunLongBits, selectorRun))
+                            {
+                                return false;
+                            }
+                            selectorRun += kSelectorRunMin;
+                        }
+                        else
+                        {
+                            selectorRun = runSymbol + kSelectorRunMin;
+                        }
+
+                        if (selectorRun > blockCount)
+                        {
+                            return false;
+                        }
+
+                        selectors = selectorHistory[0];
+                        --selectorRun;
+                    }
+                    else if (symbol >= selectorHistoryFirstSymbol)
+                    {
+                        const ionU32 index = symbol - selectorHistoryFirstSymbol;
+                        if (index >= _tables.m_selectorHistorySize)
+                        {
+                            return false;
+                        }
+
+                        selectors = selectorHistory[index];
+                        if (index != 0)
+                        {
+                            std::swap(selectorHistory[index / 2], selectorHistory[index]);
+                        }
+                    }
+                    else
+                    {
+                        selectors = symbol;
+
+                        selectorHistory[selectorHistoryRover++] = symbol;
+                        if (selectorHistoryRover == _tables.m_selectorHistorySize)
+                        {
+                            selectorHistoryRover = _tables.m_selectorHistorySize / 2;
+                        }
+                    }
+                }
+
+                if (selectors >= _selectorCount)
+                {
+                    return false;
+                }
+
+                BlockIndices& block = _outBlocks[y * _blocksX + x];
+                block.m_endpoint = static_cast<ionU16>(endpoint);
+                block.m_selectors = static_cast<ionU16>(selectors);
+            }
+        }
+
+        return true;
+    }
+
+    void DecodeBlockColors(const Endpoint& _endpoint, ionU8 _outColors[4][3])
+    {
+        for (ionU32 c = 0; c < 3; ++c)
+        {
+            const ionS32 base = (_endpoint.m_color5[c] << 3) | (_endpoint.m_color5[c] >> 2);
+            for (ionU32 i = 0; i < 4; ++i)
+            {
+                _outColors[i][c] = static_cast<ionU8>(std::min(std::max(base + kETC1IntensityTable[_endpoint.m_intensity][i], 0), 255));
+            }
+        }
+    }
+
+    ION_INLINE ionU32 PackColor565(const ionU8* _rgb)
+    {
+        const ionU32 r = (_rgb[0] * 31 + 127) / 255;
+        const ionU32 g = (_rgb[1] * 63 + 127) / 255;
+        const ionU32 b = (_rgb[2] * 31 + 127) / 255;
+        return (r << 11) | (g << 5) | b;
+    }
+
+    ION_INLINE void UnpackColor565(ionU32 _color, ionS32* _outRGB)
+    {
+        const ionS32 r = (_color >> 11) & 31;
+        const ionS32 g = (_color >> 5) & 63;
+        const ionS32 b = _color & 31;
+        _outRGB[0] = (r << 3) | (r >> 2);
+        _outRGB[1] = (g << 2) | (g >> 4);
+        _outRGB[2] = (b << 3) | (b >> 2);
+    }
+
+    // palette of the 4 colors mode, color0 greater than color1: equal colors would select the 3 colors mode, every pixel uses color0
+    ionU32 ComputeBC1Indices(const ionU8* _pixels, ionU32 _color0, ionU32 _color1, ionU32& _outIndices)
+    {
+        ionS32 palette[4][3];
+        UnpackColor565(_color0, palette[0]);
+        UnpackColor565(_color1, palette[1]);
+        for (ionU32 c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (palette[0][c] * 2 + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + palette[1][c] * 2) / 3;
+        }
+
+        const ionU32 paletteSize = (_color0 != _color1) ? 4 : 1;
+
+        ionU32 error = 0;
+        _outIndices = 0;
+        for (ionU32 i = 0; i < 16; ++i)
+        {
+            ionU32 best = 0;
+            ionS32 bestDistance = 0x7FFFFFFF;
+            for (ionU32 p = 0; p < paletteSize; ++p)
+            {
+                const ionS32 dr = _pixels[i * 4] - palette[p][0];
+                const ionS32 dg = _pixels[i * 4 + 1] - palette[p][1];
+                const ionS32 db = _pixels[i * 4 + 2] - palette[p][2];
+                const ionS32 distance = dr * dr + dg * dg + db * db;
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            _outIndices |= best << (i * 2);
+            error += static_cast<ionU32>(bestDistance);
+        }
+
+        return error;
+    }
+
+    // An ETC1S block has at most 4 colors, not evenly spaced: every pair of them is tried as endpoints and the one with the lowest error is kept
+    void EncodeBC1(const ionU8* _pixels, ionU8* _outBlock)
+    {
+        const ionU8* colors[16];
+        ionU32 colorCount = 0;
+        for (ionU32 i = 0; i < 16; ++i)
+        {
+            ionU32 j = 0;
+            while (j < colorCount && memcmp(colors[j], &_pixels[i * 4], 3) != 0)
+            {
+                ++j;
+            }
+            if (j == colorCount)
+            {
+                colors[colorCount++] = &_pixels[i * 4];
+            }
+        }
+
+        ionU32 bestColor0 = 0;
+        ionU32 bestColor1 = 0;
+        ionU32 bestIndices = 0;
+        ionU32 bestError = ~0u;
+        for (ionU32 a = 0; a < colorCount && bestError > 0; ++a)
+        {
+            for (ionU32 b = a; b < colorCount && bestError > 0; ++b)
+            {
+                ionU32 color0 = PackColor565(colors[a]);
+                ionU32 color1 = PackColor565(colors[b]);
+                if (color0 < color1)
+                {
+                    std::swap(color0, color1);
+                }
+
+                ionU32 indices = 0;
+                const ionU32 error = ComputeBC1Indices(_pixels, color0, color1, indices);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestColor0 = color0;
+                    bestColor1 = color1;
+                    bestIndices = indices;
+                }
+            }
+        }
+
+        _outBlock[0] = static_cast<ionU8>(bestColor0);
+        _outBlock[1] = static_cast<ionU8>(bestColor0 >> 8);
+        _outBlock[2] = static_cast<ionU8>(bestColor1);
+        _outBlock[3] = static_cast<ionU8>(bestColor1 >> 8);
+        for (ionU32 i = 0; i < 4; ++i)
+        {
+            _outBlock[4 + i] = static_cast<ionU8>(bestIndices >> (i * 8));
+        }
+    }
+
+    // 8 alpha values mode between the min and the max, equal values select the 6 values mode where the index 0 is alpha0 as well
+    void EncodeBC3Alpha(const ionU8* _pixels, ionU8* _outBlock)
+    {
+        ionU32 minAlpha = 255;
+        ionU32 maxAlpha = 0;
+        for (ionU32 i = 0; i < 16; ++i)
+        {
+            minAlpha = std::min<ionU32>(minAlpha, _pixels[i * 4 + 3]);
+            maxAlpha = std::max<ionU32>(maxAlpha, _pixels[i * 4 + 3]);
+        }
+
+        ionU64 indices = 0;
+        if (maxAlpha != minAlpha)
+        {
+            ionS32 palette[8];
+            palette[0] = static_cast<ionS32>(maxAlpha);
+            palette[1] = static_cast<ionS32>(minAlpha);
+            for (ionS32 i = 1; i < 7; ++i)
+            {
+                palette[i + 1] = ((7 - i) * palette[0] + i * palette[1] + 3) / 7;
+            }
+
+            for (ionU32 i = 0; i < 16; ++i)
+            {
+                ionU64 best = 0;
+                ionS32 bestDistance = 256;
+                for (ionU32 p = 0; p < 8; ++p)
+                {
+                    const ionS32 distance = std::abs(_pixels[i * 4 + 3] - palette[p]);
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+                indices |= best << (i * 3);
+            }
+        }
+
+        _outBlock[0] = static_cast<ionU8>(maxAlpha);
+        _outBlock[1] = static_cast<ionU8>(minAlpha);
+        for (ionU32 i = 0; i < 6; ++i)
+        {
+            _outBlock[2 + i] = static_cast<ionU8>(indices >> (i * 8));
+        }
+    }
+}
+
+
+ionBool BasisTranscoder::IsKTX2(const ionU8* _data, ionSize _size)
+{
+    return _data != nullptr && _size >= sizeof(kKTX2Identifier) && memcmp(_data, kKTX2Identifier, sizeof(kKTX2Identifier)) == 0;
+}
+
+ionBool BasisTranscoder::Transcode(const ionU8* _data, ionSize _size, ionBool _blockCompressed, BasisTranscodedImage& _outImage)
+{
+    if (!IsKTX2(_data, _size) || _size < kKTX2LevelIndexOffset)
+    {
+        return false;
+    }
+
+    // vkFormat, typeSize, pixelWidth, pixelHeight, pixelDepth, layerCount, faceCount, levelCount, supercompressionScheme
+    ionU32 header[9];
+    for (ionU32 i = 0; i < 9; ++i)
+    {
+        header[i] = ReadU32(_data + kKTX2HeaderOffset + i * 4);
+    }
+
+    const ionU32 width = header[2];
+    const ionU32 height = header[3];
+    const ionU32 numLevels = std::max(header[7], 1u);
+
+    // ETC1S has no Vulkan format, UASTC has no supercompression or Zstandard
+    if (header[0] != 0 || header[8] != kKTX2SupercompressionBasisLZ)
+    {
+        return false;
+    }
+
+    // 2D only
+    if (width == 0 || height == 0 || width > kKTX2MaxSize || height > kKTX2MaxSize || header[4] > 1 || header[5] > 1 || header[6] != 1)
+    {
+        return false;
+    }
+
+    if (!IsInRange(kKTX2LevelIndexOffset, static_cast<ionU64>(numLevels) * kKTX2LevelIndexEntrySize, _size))
+    {
+        return false;
+    }
+
+    const ionU64 globalDataOffset = ReadU64(_data + kKTX2IndexOffset + 16);
+    const ionU64 globalDataSize = ReadU64(_data + kKTX2IndexOffset + 24);
+    if (!IsInRange(globalDataOffset, globalDataSize, _size) || globalDataSize < kBasisLZHeaderSize + numLevels * kBasisLZImageDescSize)
+    {
+        return false;
+    }
+
+    const ionU8* globalData = _data + globalDataOffset;
+    const ionU32 endpointCount = ReadU16(globalData);
+    const ionU32 selectorCount = ReadU16(globalData + 2);
+    const ionU64 endpointsSize = ReadU32(globalData + 4);
+    const ionU64 selectorsSize = ReadU32(globalData + 8);
+    const ionU64 tablesSize = ReadU32(globalData + 12);
+
+    const ionU64 endpointsOffset = kBasisLZHeaderSize + numLevels * kBasisLZImageDescSize;
+    const ionU64 selectorsOffset = endpointsOffset + endpointsSize;
+    const ionU64 tablesOffset = selectorsOffset + selectorsSize;
+    if (endpointCount == 0 || selectorCount == 0 || !IsInRange(endpointsOffset, endpointsSize + selectorsSize + tablesSize, globalDataSize))
+    {
+        return false;
+    }
+
+    ionVector<Endpoint, TextureAllocator, Texture::GetAllocator> endpoints;
+    ionVector<Selectors, TextureAllocator, Texture::GetAllocator> selectors;
+    SliceTables tables;
+    if (!DecodeEndpoints(globalData + endpointsOffset, static_cast<ionSize>(endpointsSize), endpointCount, endpoints) ||
+        !DecodeSelectors(globalData + selectorsOffset, static_cast<ionSize>(selectorsSize), selectorCount, selectors) ||
+        !DecodeTables(globalData + tablesOffset, static_cast<ionSize>(tablesSize), tables))
+    {
+        return false;
+    }
+
+    // all the images have the alpha slice or none of them
+    const ionBool hasAlpha = ReadU32(globalData + kBasisLZHeaderSize + 16) > 0;
+
+    _outImage.m_width = width;
+    _outImage.m_height = height;
+    _outImage.m_numLevels = numLevels;
+    _outImage.m_format = _blockCompressed ? (hasAlpha ? ETextureFormat_BC3 : ETextureFormat_BC1) : ETextureFormat_RGBA8;
+
+    ionSize levelsSize = 0;
+    for (ionU32 level = 0; level < numLevels; ++level)
+    {
+        levelsSize += Texture::GetLevelSize(_outImage.m_format, std::max(width >> level, 1u), std::max(height >> level, 1u));
+    }
+    _outImage.m_levels.resize(levelsSize);
+
+    ionVector<BlockIndices, TextureAllocator, Texture::GetAllocator> colorBlocks;
+    ionVector<BlockIndices, TextureAllocator, Texture::GetAllocator> alphaBlocks;
+
+    ionU8* output = _outImage.m_levels.data();
+    for (ionU32 level = 0; level < numLevels; ++level)
+    {
+        const ionU32 levelWidth = std::max(width >> level, 1u);
+        const ionU32 levelHeight = std::max(height >> level, 1u);
+        const ionU32 blocksX = (levelWidth + 3) / 4;
+        const ionU32 blocksY = (levelHeight + 3) / 4;
+
+        const ionU8* levelIndex = _data + kKTX2LevelIndexOffset + level * kKTX2LevelIndexEntrySize;
+        const ionU64 levelOffset = ReadU64(levelIndex);
+        const ionU64 levelSize = ReadU64(levelIndex + 8);
+        if (!IsInRange(levelOffset, levelSize, _size))
+        {
+            return false;
+        }
+
+        // flags, rgbSliceByteOffset, rgbSliceByteLength, alphaSliceByteOffset, alphaSliceByteLength
+        const ionU8* imageDesc = globalData + kBasisLZHeaderSize + level * kBasisLZImageDescSize;
+        const ionU32 flags = ReadU32(imageDesc);
+        const ionU32 colorOffset = ReadU32(imageDesc + 4);
+        const ionU32 colorSize = ReadU32(imageDesc + 8);
+        const ionU32 alphaOffset = ReadU32(imageDesc + 12);
+        const ionU32 alphaSize = ReadU32(imageDesc + 16);
+        if ((flags & kBasisLZImageFlagPFrame) != 0 || !IsInRange(colorOffset, colorSize, levelSize) || (hasAlpha && (alphaSize == 0 || !IsInRange(alphaOffset, alphaSize, levelSize))))
+        {
+            return false;
+        }
+
+        const ionU8* levelData = _data + levelOffset;
+        if (!DecodeSlice(levelData + colorOffset, colorSize, blocksX, blocksY, endpointCount, selectorCount, tables, colorBlocks))
+        {
+            return false;
+        }
+        if (hasAlpha && !DecodeSlice(levelData + alphaOffset, alphaSize, blocksX, blocksY, endpointCount, selectorCount, tables, alphaBlocks))
+        {
+            return false;
+        }
+
+        for (ionU32 by = 0; by < blocksY; ++by)
+        {
+            for (ionU32 bx = 0; bx < blocksX; ++bx)
+            {
+                const ionU32 blockIndex = by * blocksX + bx;
+
+                ionU8 colors[4][3];
+                ionU8 alphas[4][3];
+                DecodeBlockColors(endpoints[colorBlocks[blockIndex].m_endpoint], colors);
+                const Selectors colorSelectors = selectors[colorBlocks[blockIndex].m_selectors];
+
+                // the alpha slice is gray, the green channel is used
+                Selectors alphaSelectors = 0;
+                if (hasAlpha)
+                {
+                    DecodeBlockColors(endpoints[alphaBlocks[blockIndex].m_endpoint], alphas);
+                    alphaSelectors = selectors[alphaBlocks[blockIndex].m_selectors];
+                }
+
+                ionU8 pixels[16 * 4];
+                for (ionU32 i = 0; i < 16; ++i)
+                {
+                    const ionU32 shift = (i / 4) * 8 + (i % 4) * 2;
+                    const ionU8* color = colors[(colorSelectors >> shift) & 3];
+                    pixels[i * 4] = color[0];
+                    pixels[i * 4 + 1] = color[1];
+                    pixels[i * 4 + 2] = color[2];
+                    pixels[i * 4 + 3] = hasAlpha ? alphas[(alphaSelectors >> shift) & 3][1] : 255;
+                }
+
+                if (_outImage.m_format == ETextureFormat_BC1)
+                {
+                    EncodeBC1(pixels, output + blockIndex * 8);
+                }
+                else if (_outImage.m_format == ETextureFormat_BC3)
+                {
+                    EncodeBC3Alpha(pixels, output + blockIndex * 16);
+                    EncodeBC1(pixels, output + blockIndex * 16 + 8);
+                }
+                else
+                {
+                    // the blocks on the right and bottom edges can be partially outside the level
+                    const ionU32 columns = std::min(4u, levelWidth - bx * 4);
+                    const ionU32 rows = std::min(4u, levelHeight - by * 4);
+                    for (ionU32 row = 0; row < rows; ++row)
+                    {
+                        memcpy(output + ((static_cast<ionSize>(by) * 4 + row) * levelWidth + bx * 4) * 4, &pixels[row * 16], columns * 4);
+                    }
+                }
+            }
+        }
+
+        output += Texture::GetLevelSize(_outImage.m_format, levelWidth, levelHeight);
+    }
+
+    return true;
+}
+
+ION_NAMESPACE_END
@@ -0,0 +1,45 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Texture\BasisTranscoder.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+#include "../Core/CoreDefs.h"
+
+#include "../Dependencies/Eos/Eos/Eos.h"
+
+#include "../Core/MemoryWrapper.h"
+
+#include "TextureCommon.h"
+#include "Texture.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+// Levels transcoded from a KTX2 file, tightly packed from level 0 as described in Texture::GetLevelsSize
+struct BasisTranscodedImage
+{
+    ionU32          m_width;
+    ionU32          m_height;
+    ionU32          m_numLevels;
+    ETextureFormat  m_format;
+    ionVector<ionU8, TextureAllocator, Texture::GetAllocator> m_levels;
+};
+
+// CPU transcoder of the KTX2 images of KHR_texture_basisu.
+// Only 2D images supercompressed with BasisLZ (ETC1S) are supported: UASTC and Zstandard fail, and the glTF loader
+// falls back on the "source" image of the texture.
+// There is no shared state, so more images can be transcoded at the same time from different threads.
+class BasisTranscoder
+{
+public:
+    static ionBool IsKTX2(const ionU8* _data, ionSize _size);
+
+    // _blockCompressed gives ETextureFormat_BC1, or ETextureFormat_BC3 when the image has alpha, otherwise ETextureFormat_RGBA8
+    static ionBool Transcode(const ionU8* _data, ionSize _size, ionBool _blockCompressed, BasisTranscodedImage& _outImage);
+};
+
+ION_NAMESPACE_END
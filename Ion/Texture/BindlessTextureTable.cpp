@@ -0,0 +1,193 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Texture\BindlessTextureTable.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#include "BindlessTextureTable.h"
+
+#include <algorithm>
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+BindlessTextureTable::BindlessTextureTable() :
+    m_vkDevice(VK_NULL_HANDLE),
+    m_descriptorSetLayout(VK_NULL_HANDLE),
+    m_descriptorPool(VK_NULL_HANDLE),
+    m_descriptorSet(VK_NULL_HANDLE),
+    m_frame(0),
+    m_capacity(0)
+{
+}
+
+BindlessTextureTable::~BindlessTextureTable()
+{
+}
+
+void BindlessTextureTable::Init(VkDevice _vkDevice, ionU32 _deviceLimit)
+{
+    m_vkDevice = _vkDevice;
+    m_capacity = std::min(static_cast<ionU32>(ION_BINDLESS_MAX_TEXTURES), _deviceLimit);
+
+    if (m_capacity == 0)
+    {
+        return;
+    }
+
+    {
+        VkDescriptorSetLayoutBinding binding = {};
+        binding.binding = 0;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        binding.descriptorCount = m_capacity;
+        binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+        // the free elements are never written and the new ones are written while the set is bound by the frames in flight
+        const VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+        bindingFlagsInfo.bindingCount = 1;
+        bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+        VkDescriptorSetLayoutCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        createInfo.pNext = &bindingFlagsInfo;
+        createInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+        createInfo.bindingCount = 1;
+        createInfo.pBindings = &binding;
+
+        VkResult result = vkCreateDescriptorSetLayout(m_vkDevice, &createInfo, vkMemory, &m_descriptorSetLayout);
+        ionAssertReturnVoid(result == VK_SUCCESS, "Cannot create the bindless descriptor set layout!");
+    }
+
+    {
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSize.descriptorCount = m_capacity;
+
+        VkDescriptorPoolCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+        createInfo.maxSets = 1;
+        createInfo.poolSizeCount = 1;
+        createInfo.pPoolSizes = &poolSize;
+
+        VkResult result = vkCreateDescriptorPool(m_vkDevice, &createInfo, vkMemory, &m_descriptorPool);
+        ionAssertReturnVoid(result == VK_SUCCESS, "Cannot create the bindless descriptor pool!");
+    }
+
+    {
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+        VkResult result = vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &m_descriptorSet);
+        ionAssertReturnVoid(result == VK_SUCCESS, "Cannot allocate the bindless descriptor set!");
+    }
+
+    // the lowest indices first
+    m_freeIndices.reserve(m_capacity);
+    for (ionU32 i = m_capacity; i > 0; --i)
+    {
+        m_freeIndices.push_back(i - 1);
+    }
+}
+
+void BindlessTextureTable::Shutdown()
+{
+    ReleasePending(m_frame, true);
+
+    m_freeIndices.clear();
+    m_descriptorSet = VK_NULL_HANDLE;
+
+    if (m_descriptorPool != VK_NULL_HANDLE)
+    {
+        // the set is freed with its pool
+        vkDestroyDescriptorPool(m_vkDevice, m_descriptorPool, vkMemory);
+        m_descriptorPool = VK_NULL_HANDLE;
+    }
+
+    if (m_descriptorSetLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorSetLayout(m_vkDevice, m_descriptorSetLayout, vkMemory);
+        m_descriptorSetLayout = VK_NULL_HANDLE;
+    }
+
+    m_capacity = 0;
+}
+
+void BindlessTextureTable::Add(Texture* _texture)
+{
+    if (!IsEnabled() || _texture->m_view == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    ionAssertReturnVoid(_texture->m_bindlessIndex == ION_BINDLESS_INVALID_INDEX, "The texture is already in the bindless table!");
+    ionAssertReturnVoid(!m_freeIndices.empty(), "The bindless table is full, the texture " << _texture->GetName() << " cannot be read by index!");
+
+    const ionU32 index = m_freeIndices.back();
+    m_freeIndices.pop_back();
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.sampler = _texture->m_sampler;
+    imageInfo.imageView = _texture->m_view;
+    imageInfo.imageLayout = _texture->m_layout;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_descriptorSet;
+    write.dstBinding = 0;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(m_vkDevice, 1, &write, 0, nullptr);
+
+    _texture->m_bindlessIndex = index;
+}
+
+void BindlessTextureTable::Remove(Texture* _texture)
+{
+    if (_texture->m_bindlessIndex == ION_BINDLESS_INVALID_INDEX)
+    {
+        return;
+    }
+
+    // the element keeps the old descriptor, never read again by the new draws
+    if (IsEnabled())
+    {
+        m_pendingIndices.push_back({ _texture->m_bindlessIndex, m_frame });
+    }
+
+    _texture->m_bindlessIndex = ION_BINDLESS_INVALID_INDEX;
+}
+
+void BindlessTextureTable::ReleasePending(ionU64 _frame, ionBool _force)
+{
+    // same delay used by the texture manager: more frames than the ones in flight
+    static const ionU64 kReleaseDelayFrames = 4;
+
+    m_frame = _frame;
+
+    for (auto it = m_pendingIndices.begin(); it != m_pendingIndices.end();)
+    {
+        if (!_force && it->m_frame + kReleaseDelayFrames > m_frame)
+        {
+            ++it;
+            continue;
+        }
+
+        m_freeIndices.push_back(it->m_index);
+
+        it = m_pendingIndices.erase(it);
+    }
+}
+
+ION_NAMESPACE_END
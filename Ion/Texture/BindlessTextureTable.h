@@ -0,0 +1,78 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Texture\BindlessTextureTable.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "../Core/CoreDefs.h"
+
+#include "../Dependencies/Eos/Eos/Eos.h"
+
+#include "Texture.h"
+
+
+#define ION_BINDLESS_MAX_TEXTURES       16384
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+// All the textures of the TextureManager in a single partially bound array of combined image samplers (VK_EXT_descriptor_indexing),
+// so a material can read them by index from one descriptor set instead of writing its own descriptors (see Material::SetBindlessTexturesStages).
+// The element of a texture is written when its view is created and retired when destroyed or replaced (eviction, streaming):
+// a retired element is reused only after the frames in flight are done with it, so the pending command buffers never see it changing.
+class ION_DLL BindlessTextureTable final
+{
+public:
+    BindlessTextureTable();
+    ~BindlessTextureTable();
+
+    // _deviceLimit is the number of update after bind sampled images of the device, 0 if the descriptor indexing is not supported
+    void        Init(VkDevice _vkDevice, ionU32 _deviceLimit);
+    void        Shutdown();
+
+    ionBool     IsEnabled() const { return m_descriptorSet != VK_NULL_HANDLE; }
+
+    VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_descriptorSetLayout; }
+    VkDescriptorSet GetDescriptorSet() const { return m_descriptorSet; }
+
+    // write the view and the sampler of the texture in a free element, the index is stored in the texture
+    void        Add(Texture* _texture);
+    void        Remove(Texture* _texture);
+
+    // the retired elements are given back when the frames in flight are done with them
+    void        ReleasePending(ionU64 _frame, ionBool _force);
+
+    ionU32      GetCapacity() const { return m_capacity; }
+    ionU32      GetUsedCount() const { return m_capacity - static_cast<ionU32>(m_freeIndices.size() + m_pendingIndices.size()); }
+
+private:
+    BindlessTextureTable(const BindlessTextureTable& _Orig) = delete;
+    BindlessTextureTable& operator = (const BindlessTextureTable&) = delete;
+
+private:
+    struct PendingIndex
+    {
+        ionU32              m_index;
+        ionU64              m_frame;
+    };
+
+    VkDevice                m_vkDevice;
+    VkDescriptorSetLayout   m_descriptorSetLayout;
+    VkDescriptorPool        m_descriptorPool;
+    VkDescriptorSet         m_descriptorSet;
+
+    ionVector<ionU32, TextureAllocator, Texture::GetAllocator>          m_freeIndices;
+    ionVector<PendingIndex, TextureAllocator, Texture::GetAllocator>    m_pendingIndices;
+
+    ionU64                  m_frame;
+    ionU32                  m_capacity;
+};
+
+ION_NAMESPACE_END
@@ -17,6 +17,8 @@
 
 #include "../Core/MemorySettings.h"
 
+#include "../Utilities/Tools.h"
+
 #include "../Dependencies/Miscellaneous/stb_image.h"
 /*
 #define STBI_MSC_SECURE_CRT
@@ -144,11 +146,13 @@ ionBool CubemapHelper::Convert()
     if (IsCubeCross())
     {
         CubemapFromCross();
+        ConvertFacesToHalf();
         return true;
     }
     else if (IsLatLong())
     {
         CubemapFromLatLong();
+        ConvertFacesToHalf();
         return true;
     }
     else
@@ -157,6 +161,45 @@ ionBool CubemapHelper::Convert()
     }
 }
 
+void CubemapHelper::ConvertFacesToHalf()
+{
+    // the faces are generated from the decoded float data, the texture stores half float
+    if (!m_isHDR || Texture::BitsPerFormat(m_format) != 64)
+    {
+        return;
+    }
+
+    const ionSize texelCount = static_cast<ionSize>(m_sizePerFace) * m_sizePerFace;
+    for (ionU32 i = 0; i < 6; ++i)
+    {
+        const ionFloat* source = static_cast<const ionFloat*>(m_output[i]);
+        ionU16* dest = static_cast<ionU16*>(ionNewRaw(texelCount * 4 * sizeof(ionU16), GetAllocator()));
+
+        if (m_component == 4)
+        {
+            Tools::ConvertFloatToHalf(source, dest, texelCount * 4);
+        }
+        else
+        {
+            // RGB to RGBA, alpha 1
+            const ionU16 one = Tools::FloatToHalf(1.0f);
+            for (ionSize t = 0; t < texelCount; ++t)
+            {
+                Tools::ConvertFloatToHalf(source + t * m_component, dest + t * 4, static_cast<ionSize>(m_component));
+                for (ionS32 c = m_component; c < 4; ++c)
+                {
+                    dest[t * 4 + c] = one;
+                }
+            }
+        }
+
+        ionDeleteRaw(m_output[i], GetAllocator());
+        m_output[i] = dest;
+    }
+
+    m_component = 4;
+}
+
 void CubemapHelper::CopyBufferRegion(const void* _source, void* _dest, ionU32 _sourceImageWidth, ionU32 _component, ionU32 _bppPerChannel, ionU32 _destSize, ionU32 _x, ionU32 _y)
 {
     const ionU8* sourceFace = (const ionU8*)_source;
@@ -257,13 +300,13 @@ void CubemapHelper::CubemapFromCross()
     {
         m_sizePerFace = m_width / 3;
         m_numLevelsPerFace = CalculateMipMapPerFace(m_sizePerFace, m_sizePerFace);
-        GenerateCubemapFromCrossVertical(m_buffer, m_output, Texture::BitsPerFormat(m_format));
+        GenerateCubemapFromCrossVertical(m_buffer, m_output, GetSourceBitsPerPixel());
     }
     else
     {
         m_sizePerFace = m_width / 4;
         m_numLevelsPerFace = CalculateMipMapPerFace(m_sizePerFace, m_sizePerFace);
-        GenerateCubemapFromCrossHorizontal(m_buffer, m_output, Texture::BitsPerFormat(m_format));
+        GenerateCubemapFromCrossHorizontal(m_buffer, m_output, GetSourceBitsPerPixel());
     }
 }
 
@@ -282,7 +325,7 @@ void CubemapHelper::CubemapFromLatLong()
     {
         m_component = 4;
 
-        ionU32 bppPerChannel = Texture::BitsPerFormat(m_format) / 32;
+        ionU32 bppPerChannel = GetSourceBitsPerPixel() / 32;
 
         void* rgba = ionNewRaw(m_width * m_height * m_component * bppPerChannel, GetAllocator());
 
@@ -300,7 +343,7 @@ void CubemapHelper::CubemapFromLatLong()
                 rgb += 3;
             }
 
-            GenerateCubemapFromLatLong<ionFloat>(rgba, m_output, Texture::BitsPerFormat(m_format));
+            GenerateCubemapFromLatLong<ionFloat>(rgba, m_output, GetSourceBitsPerPixel());
         }
         else
         {
@@ -316,7 +359,7 @@ void CubemapHelper::CubemapFromLatLong()
                 rgb += 3;
             }
 
-            GenerateCubemapFromLatLong<ionU8>(rgba, m_output, Texture::BitsPerFormat(m_format));
+            GenerateCubemapFromLatLong<ionU8>(rgba, m_output, GetSourceBitsPerPixel());
         }
 
         ionDeleteRaw(rgba, GetAllocator());
@@ -325,11 +368,11 @@ void CubemapHelper::CubemapFromLatLong()
     {
         if (m_isHDR)
         {
-            GenerateCubemapFromLatLong<ionFloat>(m_buffer, m_output, Texture::BitsPerFormat(m_format));
+            GenerateCubemapFromLatLong<ionFloat>(m_buffer, m_output, GetSourceBitsPerPixel());
         }
         else
         {
-            GenerateCubemapFromLatLong<ionU8>(m_buffer, m_output, Texture::BitsPerFormat(m_format));
+            GenerateCubemapFromLatLong<ionU8>(m_buffer, m_output, GetSourceBitsPerPixel());
         }
     }
 }
@@ -73,6 +73,10 @@ private:
 
     void CubemapFromCross();
     void CubemapFromLatLong();
+    void ConvertFacesToHalf();
+
+    // size of the decoded texel: float channels for HDR images, 8 bits otherwise (4 channels)
+    ionU32 GetSourceBitsPerPixel() const { return m_isHDR ? 128 : 32; }
 
 private:
     ionS32 m_width;
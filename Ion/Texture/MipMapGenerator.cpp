@@ -0,0 +1,503 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Texture\MipMapGenerator.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#include "MipMapGenerator.h"
+
+#include <fstream>
+#include <algorithm>
+
+#include "../GPU/GpuMemoryManager.h"
+
+#include "../Core/FileSystemManager.h"
+
+
+#define ION_MIPMAP_GENERATOR_TILE_SIZE          64      // level 0 texels reduced by a work group, TILE_SIZE of GenerateMipMaps.comp
+#define ION_MIPMAP_GENERATOR_SETS_PER_POOL      32
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+struct MipMapGeneratorParams
+{
+    ionU32  m_width;
+    ionU32  m_height;
+    ionU32  m_numMips;
+    ionU32  m_numWorkGroups;
+    ionU32  m_srgb;
+};
+
+MipMapGeneratorAllocator* MipMapGenerator::GetAllocator()
+{
+    static HeapArea<Settings::kMipMapGeneratorAllocatorSize> memoryArea;
+    static MipMapGeneratorAllocator memoryAllocator(memoryArea, "MipMapGeneratorFreeListAllocator");
+
+    return &memoryAllocator;
+}
+
+MipMapGenerator::MipMapGenerator() :
+    m_vkPhysicalDevice(VK_NULL_HANDLE),
+    m_vkDevice(VK_NULL_HANDLE),
+    m_shaderModule(VK_NULL_HANDLE),
+    m_descriptorSetLayout(VK_NULL_HANDLE),
+    m_pipelineLayout(VK_NULL_HANDLE),
+    m_pipeline(VK_NULL_HANDLE),
+    m_counterBuffer(VK_NULL_HANDLE),
+    m_frame(0),
+    m_dispatchCount(0),
+    m_pipelineState(EPipelineState_NotCreated),
+    m_isSupported(false)
+{
+}
+
+MipMapGenerator::~MipMapGenerator()
+{
+}
+
+void MipMapGenerator::Init(VkPhysicalDevice _vkPhysicalDevice, VkDevice _vkDevice, ionS32 _vkQueueFamilyIndex)
+{
+    m_vkPhysicalDevice = _vkPhysicalDevice;
+    m_vkDevice = _vkDevice;
+
+    // the features are enabled by RenderCore when the device supports them
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(m_vkPhysicalDevice, &features);
+
+    ionU32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_vkPhysicalDevice, &queueFamilyCount, nullptr);
+
+    ionVector<VkQueueFamilyProperties, MipMapGeneratorAllocator, GetAllocator> queueFamilies;
+    queueFamilies.resize(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_vkPhysicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    const ionBool hasCompute = _vkQueueFamilyIndex >= 0 && static_cast<ionU32>(_vkQueueFamilyIndex) < queueFamilyCount && (queueFamilies[_vkQueueFamilyIndex].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+
+    m_isSupported = hasCompute &&
+        features.shaderStorageImageReadWithoutFormat == VK_TRUE &&
+        features.shaderStorageImageWriteWithoutFormat == VK_TRUE &&
+        features.shaderStorageImageArrayDynamicIndexing == VK_TRUE;
+
+    // created up front, so the textures ask for the storage usage only when the dispatch can really be recorded
+    if (m_isSupported)
+    {
+        CreatePipeline();
+    }
+}
+
+void MipMapGenerator::Shutdown()
+{
+    ReleasePending(m_frame, true);
+
+    DestroyPipeline();
+
+    m_pipelineState = EPipelineState_NotCreated;
+}
+
+ionBool MipMapGenerator::IsFormatSupported(VkFormat _format) const
+{
+    if (!m_isSupported || m_pipelineState != EPipelineState_Ready)
+    {
+        return false;
+    }
+
+    VkFormatProperties formatProps;
+    vkGetPhysicalDeviceFormatProperties(m_vkPhysicalDevice, _format, &formatProps);
+
+    return (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
+ionBool MipMapGenerator::CreatePipeline()
+{
+    if (m_pipelineState != EPipelineState_NotCreated)
+    {
+        return m_pipelineState == EPipelineState_Ready;
+    }
+
+    // unless everything below succeed the blit is used
+    m_pipelineState = EPipelineState_Failed;
+
+    {
+        const ionString shaderPath = ionFileSystemManager().GetShadersPath() + ION_MIPMAP_GENERATOR_SHADER_NAME + ".comp.spv";
+
+        std::ifstream fileStream(shaderPath.c_str(), std::ios::binary);
+        if (!fileStream.is_open())
+        {
+            return false;
+        }
+
+        fileStream.seekg(0, std::ios_base::end);
+        const ionSize fileSize = fileStream.tellg();
+        if (fileSize == 0 || fileSize % sizeof(ionU32) != 0)
+        {
+            return false;
+        }
+
+        char* binary = reinterpret_cast<char*>(ionNewRaw(fileSize, GetAllocator()));
+
+        fileStream.seekg(0, std::ios_base::beg);
+        fileStream.read(binary, fileSize);
+
+        VkShaderModuleCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = fileSize;
+        createInfo.pCode = reinterpret_cast<const ionU32*>(binary);
+
+        VkResult result = vkCreateShaderModule(m_vkDevice, &createInfo, vkMemory, &m_shaderModule);
+
+        ionDeleteRaw(binary, GetAllocator());
+
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create the mip map generation shader!", false);
+    }
+
+    {
+        VkDescriptorSetLayoutBinding bindings[2] = {};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[0].descriptorCount = ION_MIPMAP_GENERATOR_MAX_LEVELS;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        createInfo.bindingCount = 2;
+        createInfo.pBindings = bindings;
+
+        VkResult result = vkCreateDescriptorSetLayout(m_vkDevice, &createInfo, vkMemory, &m_descriptorSetLayout);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create the mip map generation descriptor set layout!", false);
+    }
+
+    {
+        VkPushConstantRange pushConstantRange = {};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(MipMapGeneratorParams);
+
+        VkPipelineLayoutCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        createInfo.setLayoutCount = 1;
+        createInfo.pSetLayouts = &m_descriptorSetLayout;
+        createInfo.pushConstantRangeCount = 1;
+        createInfo.pPushConstantRanges = &pushConstantRange;
+
+        VkResult result = vkCreatePipelineLayout(m_vkDevice, &createInfo, vkMemory, &m_pipelineLayout);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create the mip map generation pipeline layout!", false);
+    }
+
+    {
+        VkComputePipelineCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        createInfo.stage.module = m_shaderModule;
+        createInfo.stage.pName = "main";
+        createInfo.layout = m_pipelineLayout;
+
+        VkResult result = vkCreateComputePipelines(m_vkDevice, VK_NULL_HANDLE, 1, &createInfo, vkMemory, &m_pipeline);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create the mip map generation pipeline!", false);
+    }
+
+    // one counter of finished work groups per layer
+    {
+        VkBufferCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = ION_MIPMAP_GENERATOR_MAX_LAYERS * sizeof(ionU32);
+        createInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkResult result = vkCreateBuffer(m_vkDevice, &createInfo, vkMemory, &m_counterBuffer);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot create the mip map generation counter buffer!", false);
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements(m_vkDevice, m_counterBuffer, &memoryRequirements);
+
+        GpuMemoryCreateInfo memoryCreateInfo = {};
+        memoryCreateInfo.m_size = memoryRequirements.size;
+        memoryCreateInfo.m_align = memoryRequirements.alignment;
+        memoryCreateInfo.m_memoryTypeBits = memoryRequirements.memoryTypeBits;
+        memoryCreateInfo.m_usage = EMemoryUsage_GPU;
+        memoryCreateInfo.m_type = EGpuMemoryType_Buffer;
+
+        m_counterAllocation = ionGPUMemoryManager().Alloc(memoryCreateInfo);
+        ionAssertReturnValue(m_counterAllocation.m_result == VK_SUCCESS, "Cannot Allocate memory!", false);
+
+        result = vkBindBufferMemory(m_vkDevice, m_counterBuffer, m_counterAllocation.m_memory, m_counterAllocation.m_offset);
+        ionAssertReturnValue(result == VK_SUCCESS, "Cannot bind the buffer memory!", false);
+    }
+
+    m_pipelineState = EPipelineState_Ready;
+
+    return true;
+}
+
+void MipMapGenerator::DestroyPipeline()
+{
+    for (VkDescriptorPool pool : m_descriptorPools)
+    {
+        vkDestroyDescriptorPool(m_vkDevice, pool, vkMemory);
+    }
+    m_descriptorPools.clear();
+
+    if (m_counterBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(m_vkDevice, m_counterBuffer, vkMemory);
+        ionGPUMemoryManager().Free(m_counterAllocation);
+
+        m_counterBuffer = VK_NULL_HANDLE;
+        m_counterAllocation = GpuMemoryAllocation();
+    }
+
+    if (m_pipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(m_vkDevice, m_pipeline, vkMemory);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+
+    if (m_pipelineLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyPipelineLayout(m_vkDevice, m_pipelineLayout, vkMemory);
+        m_pipelineLayout = VK_NULL_HANDLE;
+    }
+
+    if (m_descriptorSetLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorSetLayout(m_vkDevice, m_descriptorSetLayout, vkMemory);
+        m_descriptorSetLayout = VK_NULL_HANDLE;
+    }
+
+    if (m_shaderModule != VK_NULL_HANDLE)
+    {
+        vkDestroyShaderModule(m_vkDevice, m_shaderModule, vkMemory);
+        m_shaderModule = VK_NULL_HANDLE;
+    }
+}
+
+VkDescriptorSet MipMapGenerator::AllocateDescriptorSet(VkDescriptorPool& _outPool)
+{
+    VkDescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+    // a scene load can generate many textures in the same frame: the pools are added when the previous ones are full
+    for (VkDescriptorPool pool : m_descriptorPools)
+    {
+        allocateInfo.descriptorPool = pool;
+        if (vkAllocateDescriptorSets(m_vkDevice, &allocateInfo, &descriptorSet) == VK_SUCCESS)
+        {
+            _outPool = pool;
+            return descriptorSet;
+        }
+    }
+
+    VkDescriptorPoolSize poolSizes[2];
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[0].descriptorCount = ION_MIPMAP_GENERATOR_SETS_PER_POOL * ION_MIPMAP_GENERATOR_MAX_LEVELS;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = ION_MIPMAP_GENERATOR_SETS_PER_POOL;
+
+    VkDescriptorPoolCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    createInfo.maxSets = ION_MIPMAP_GENERATOR_SETS_PER_POOL;
+    createInfo.poolSizeCount = 2;
+    createInfo.pPoolSizes = poolSizes;
+    createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkResult result = vkCreateDescriptorPool(m_vkDevice, &createInfo, vkMemory, &pool);
+    ionAssertReturnValue(result == VK_SUCCESS, "Cannot create the mip map generation descriptor pool!", VK_NULL_HANDLE);
+
+    m_descriptorPools.push_back(pool);
+
+    allocateInfo.descriptorPool = pool;
+    result = vkAllocateDescriptorSets(m_vkDevice, &allocateInfo, &descriptorSet);
+    ionAssertReturnValue(result == VK_SUCCESS, "Cannot allocate the mip map generation descriptor set!", VK_NULL_HANDLE);
+
+    _outPool = pool;
+    return descriptorSet;
+}
+
+ionBool MipMapGenerator::Generate(VkCommandBuffer _commandBuffer, VkImage _image, VkFormat _format, ionU32 _width, ionU32 _height, ionU32 _numLevels, ionU32 _numLayers, ionBool _srgb)
+{
+    if (_numLevels < 2 || _numLevels > ION_MIPMAP_GENERATOR_MAX_LEVELS || _numLayers > ION_MIPMAP_GENERATOR_MAX_LAYERS)
+    {
+        return false;
+    }
+
+    const ionU32 tilesX = (_width + ION_MIPMAP_GENERATOR_TILE_SIZE - 1) / ION_MIPMAP_GENERATOR_TILE_SIZE;
+    const ionU32 tilesY = (_height + ION_MIPMAP_GENERATOR_TILE_SIZE - 1) / ION_MIPMAP_GENERATOR_TILE_SIZE;
+    const ionU32 numWorkGroups = tilesX * tilesY;
+
+    // minimum maxComputeWorkGroupCount guaranteed by Vulkan
+    if (numWorkGroups > 65535)
+    {
+        return false;
+    }
+
+    if (!IsFormatSupported(_format))
+    {
+        return false;
+    }
+
+    PendingGeneration pending = {};
+    pending.m_frame = m_frame;
+
+    pending.m_descriptorSet = AllocateDescriptorSet(pending.m_pool);
+    if (pending.m_descriptorSet == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    // one view per level with all the layers, the unused slots repeat the last level and are never written
+    VkDescriptorImageInfo imageInfos[ION_MIPMAP_GENERATOR_MAX_LEVELS];
+    for (ionU32 i = 0; i < _numLevels; ++i)
+    {
+        VkImageViewCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        createInfo.image = _image;
+        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        createInfo.format = _format;
+        createInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        createInfo.subresourceRange.baseMipLevel = i;
+        createInfo.subresourceRange.levelCount = 1;
+        createInfo.subresourceRange.baseArrayLayer = 0;
+        createInfo.subresourceRange.layerCount = _numLayers;
+
+        VkResult result = vkCreateImageView(m_vkDevice, &createInfo, vkMemory, &pending.m_views[i]);
+        ++pending.m_viewCount;
+
+        if (result != VK_SUCCESS)
+        {
+            pending.m_views[i] = VK_NULL_HANDLE;
+            m_pendingGenerations.push_back(pending);
+            ionAssertReturnValue(false, "Cannot create the mip map generation image view!", false);
+        }
+    }
+
+    for (ionU32 i = 0; i < ION_MIPMAP_GENERATOR_MAX_LEVELS; ++i)
+    {
+        imageInfos[i].sampler = VK_NULL_HANDLE;
+        imageInfos[i].imageView = pending.m_views[std::min(i, _numLevels - 1)];
+        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = m_counterBuffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writes[2] = {};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = pending.m_descriptorSet;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorCount = ION_MIPMAP_GENERATOR_MAX_LEVELS;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[0].pImageInfo = imageInfos;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = pending.m_descriptorSet;
+    writes[1].dstBinding = 1;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[1].pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(m_vkDevice, 2, writes, 0, nullptr);
+
+    m_pendingGenerations.push_back(pending);
+
+    // the counters can still be in use by the previous generation recorded in the same command buffer
+    VkBufferMemoryBarrier bufferBarrier = {};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = m_counterBuffer;
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+    vkCmdFillBuffer(_commandBuffer, m_counterBuffer, 0, VK_WHOLE_SIZE, 0);
+
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    VkImageMemoryBarrier imageBarrier = {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = _image;
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageBarrier.subresourceRange.baseMipLevel = 0;
+    imageBarrier.subresourceRange.levelCount = _numLevels;
+    imageBarrier.subresourceRange.baseArrayLayer = 0;
+    imageBarrier.subresourceRange.layerCount = _numLayers;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &bufferBarrier, 1, &imageBarrier);
+
+    MipMapGeneratorParams params;
+    params.m_width = _width;
+    params.m_height = _height;
+    params.m_numMips = _numLevels - 1;
+    params.m_numWorkGroups = numWorkGroups;
+    params.m_srgb = _srgb ? 1 : 0;
+
+    vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &pending.m_descriptorSet, 0, nullptr);
+    vkCmdPushConstants(_commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MipMapGeneratorParams), &params);
+    vkCmdDispatch(_commandBuffer, numWorkGroups, 1, _numLayers);
+
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    ++m_dispatchCount;
+
+    return true;
+}
+
+void MipMapGenerator::ReleasePending(ionU64 _frame, ionBool _force)
+{
+    // same delay used by the texture manager: more frames than the ones in flight
+    static const ionU64 kReleaseDelayFrames = 4;
+
+    m_frame = _frame;
+
+    for (auto it = m_pendingGenerations.begin(); it != m_pendingGenerations.end();)
+    {
+        if (!_force && it->m_frame + kReleaseDelayFrames > m_frame)
+        {
+            ++it;
+            continue;
+        }
+
+        for (ionU32 i = 0; i < it->m_viewCount; ++i)
+        {
+            if (it->m_views[i] != VK_NULL_HANDLE)
+            {
+                vkDestroyImageView(m_vkDevice, it->m_views[i], vkMemory);
+            }
+        }
+
+        vkFreeDescriptorSets(m_vkDevice, it->m_pool, 1, &it->m_descriptorSet);
+
+        it = m_pendingGenerations.erase(it);
+    }
+}
+
+ION_NAMESPACE_END
@@ -0,0 +1,110 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Texture\MipMapGenerator.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "../Core/CoreDefs.h"
+
+#include "../Dependencies/Eos/Eos/Eos.h"
+
+#include "../GPU/GpuDataStructure.h"
+#include "../GPU/GpuMemoryAllocator.h"
+
+#include "../Core/MemoryWrapper.h"
+
+#include "../Core/MemorySettings.h"
+
+
+#define ION_MIPMAP_GENERATOR_SHADER_NAME    "GenerateMipMaps"
+#define ION_MIPMAP_GENERATOR_MAX_LEVELS     16      // must match MAX_MIP_LEVELS of GenerateMipMaps.comp
+#define ION_MIPMAP_GENERATOR_MAX_LAYERS     6
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+using MipMapGeneratorAllocator = MemoryAllocator<FreeListBestSearchAllocationPolicy, MultiThreadPolicy, MemoryBoundsCheck, MemoryTag, MemoryLog>;
+
+
+// Generates the whole mip chain of all the layers of an image with a single compute dispatch, instead of a blit and a barrier per level and per layer.
+// It needs the storage image support of the format and the device features to read and write storage images without format,
+// when not available (or when the shader is missing) Generate returns false and the caller has to fall back to the blit.
+// The pipeline is created by Init, no format is reported as supported if it failed.
+class ION_DLL MipMapGenerator final
+{
+public:
+    static MipMapGeneratorAllocator* GetAllocator();
+
+public:
+    MipMapGenerator();
+    ~MipMapGenerator();
+
+    void        Init(VkPhysicalDevice _vkPhysicalDevice, VkDevice _vkDevice, ionS32 _vkQueueFamilyIndex);
+    void        Shutdown();
+
+    // the image has to be created with VK_IMAGE_USAGE_STORAGE_BIT to use the compute path, false until the pipeline is ready
+    ionBool     IsFormatSupported(VkFormat _format) const;
+
+    // Record the generation of the levels 1 to _numLevels - 1 of all the layers from the level 0.
+    // The levels are expected in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL after the upload and are left in VK_IMAGE_LAYOUT_GENERAL.
+    // _srgb filters the content in linear space, for sRGB encoded data stored in a UNORM format.
+    ionBool     Generate(VkCommandBuffer _commandBuffer, VkImage _image, VkFormat _format, ionU32 _width, ionU32 _height, ionU32 _numLevels, ionU32 _numLayers, ionBool _srgb);
+
+    // the views and descriptor sets of a generation are released when the frames in flight are done with them
+    void        ReleasePending(ionU64 _frame, ionBool _force);
+
+    ionU32      GetDispatchCount() const { return m_dispatchCount; }
+
+private:
+    MipMapGenerator(const MipMapGenerator& _Orig) = delete;
+    MipMapGenerator& operator = (const MipMapGenerator&) = delete;
+
+    ionBool     CreatePipeline();
+    void        DestroyPipeline();
+    VkDescriptorSet AllocateDescriptorSet(VkDescriptorPool& _outPool);
+
+private:
+    enum EPipelineState
+    {
+        EPipelineState_NotCreated = 0,
+        EPipelineState_Ready,
+        EPipelineState_Failed
+    };
+
+    struct PendingGeneration
+    {
+        VkImageView         m_views[ION_MIPMAP_GENERATOR_MAX_LEVELS];
+        ionU32              m_viewCount;
+        VkDescriptorPool    m_pool;
+        VkDescriptorSet     m_descriptorSet;
+        ionU64              m_frame;
+    };
+
+    VkPhysicalDevice        m_vkPhysicalDevice;
+    VkDevice                m_vkDevice;
+
+    VkShaderModule          m_shaderModule;
+    VkDescriptorSetLayout   m_descriptorSetLayout;
+    VkPipelineLayout        m_pipelineLayout;
+    VkPipeline              m_pipeline;
+
+    VkBuffer                m_counterBuffer;
+    GpuMemoryAllocation     m_counterAllocation;
+
+    ionVector<VkDescriptorPool, MipMapGeneratorAllocator, GetAllocator>   m_descriptorPools;
+    ionVector<PendingGeneration, MipMapGeneratorAllocator, GetAllocator>  m_pendingGenerations;
+
+    ionU64                  m_frame;
+    ionU32                  m_dispatchCount;
+    EPipelineState          m_pipelineState;
+    ionBool                 m_isSupported;      // device features and compute on the graphics queue
+};
+
+ION_NAMESPACE_END
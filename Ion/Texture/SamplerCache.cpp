@@ -0,0 +1,122 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Texture\SamplerCache.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#include "SamplerCache.h"
+
+#include "../GPU/GpuMemoryManager.h"
+
+#include "../Utilities/Tools.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+SamplerCacheAllocator* SamplerCache::GetAllocator()
+{
+    static HeapArea<Settings::kSamplerCacheAllocatorSize> memoryArea;
+    static SamplerCacheAllocator memoryAllocator(memoryArea, "SamplerCacheFreeListAllocator");
+
+    return &memoryAllocator;
+}
+
+SamplerCache::SamplerCache() : m_vkDevice(VK_NULL_HANDLE)
+{
+}
+
+SamplerCache::~SamplerCache()
+{
+}
+
+void SamplerCache::Init(VkDevice _vkDevice)
+{
+    m_vkDevice = _vkDevice;
+}
+
+void SamplerCache::Shutdown()
+{
+    // any sampler still here has been leaked by some texture, but destroy it anyway
+    for (auto it = m_samplers.begin(); it != m_samplers.end(); ++it)
+    {
+        vkDestroySampler(m_vkDevice, it->second.m_sampler, vkMemory);
+    }
+
+    m_samplers.clear();
+    m_samplerToKey.clear();
+}
+
+ionU64 SamplerCache::ComputeKey(const VkSamplerCreateInfo& _createInfo)
+{
+    // hash field by field, the padding of the struct is not guaranteed to be zeroed
+    ionU64 key = Tools::kFNV1aOffset64;
+    key = Tools::HashFNV1a64(&_createInfo.flags, sizeof(_createInfo.flags), key);
+    key = Tools::HashFNV1a64(&_createInfo.magFilter, sizeof(_createInfo.magFilter), key);
+    key = Tools::HashFNV1a64(&_createInfo.minFilter, sizeof(_createInfo.minFilter), key);
+    key = Tools::HashFNV1a64(&_createInfo.mipmapMode, sizeof(_createInfo.mipmapMode), key);
+    key = Tools::HashFNV1a64(&_createInfo.addressModeU, sizeof(_createInfo.addressModeU), key);
+    key = Tools::HashFNV1a64(&_createInfo.addressModeV, sizeof(_createInfo.addressModeV), key);
+    key = Tools::HashFNV1a64(&_createInfo.addressModeW, sizeof(_createInfo.addressModeW), key);
+    key = Tools::HashFNV1a64(&_createInfo.mipLodBias, sizeof(_createInfo.mipLodBias), key);
+    key = Tools::HashFNV1a64(&_createInfo.anisotropyEnable, sizeof(_createInfo.anisotropyEnable), key);
+    key = Tools::HashFNV1a64(&_createInfo.maxAnisotropy, sizeof(_createInfo.maxAnisotropy), key);
+    key = Tools::HashFNV1a64(&_createInfo.compareEnable, sizeof(_createInfo.compareEnable), key);
+    key = Tools::HashFNV1a64(&_createInfo.compareOp, sizeof(_createInfo.compareOp), key);
+    key = Tools::HashFNV1a64(&_createInfo.minLod, sizeof(_createInfo.minLod), key);
+    key = Tools::HashFNV1a64(&_createInfo.maxLod, sizeof(_createInfo.maxLod), key);
+    key = Tools::HashFNV1a64(&_createInfo.borderColor, sizeof(_createInfo.borderColor), key);
+    key = Tools::HashFNV1a64(&_createInfo.unnormalizedCoordinates, sizeof(_createInfo.unnormalizedCoordinates), key);
+    return key;
+}
+
+VkSampler SamplerCache::Acquire(const VkSamplerCreateInfo& _createInfo)
+{
+    ionAssertReturnValue(_createInfo.pNext == nullptr, "Sampler with extension chain cannot be cached!", VK_NULL_HANDLE);
+
+    const ionU64 key = ComputeKey(_createInfo);
+
+    auto search = m_samplers.find(key);
+    if (search != m_samplers.end())
+    {
+        ++search->second.m_refCount;
+        return search->second.m_sampler;
+    }
+
+    SamplerEntry entry;
+    entry.m_refCount = 1;
+    entry.m_sampler = VK_NULL_HANDLE;
+
+    VkResult result = vkCreateSampler(m_vkDevice, &_createInfo, vkMemory, &entry.m_sampler);
+    ionAssertReturnValue(result == VK_SUCCESS, "Cannot create sampler", VK_NULL_HANDLE);
+
+    m_samplers[key] = entry;
+    m_samplerToKey[entry.m_sampler] = key;
+
+    return entry.m_sampler;
+}
+
+void SamplerCache::Release(VkSampler _sampler)
+{
+    if (_sampler == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    auto searchKey = m_samplerToKey.find(_sampler);
+    ionAssertReturnVoid(searchKey != m_samplerToKey.end(), "Sampler not created by the cache!");
+
+    auto search = m_samplers.find(searchKey->second);
+    if (--search->second.m_refCount > 0)
+    {
+        return;
+    }
+
+    vkDestroySampler(m_vkDevice, _sampler, vkMemory);
+
+    m_samplers.erase(search);
+    m_samplerToKey.erase(searchKey);
+}
+
+ION_NAMESPACE_END
@@ -0,0 +1,68 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Texture\SamplerCache.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "../Core/CoreDefs.h"
+
+#include "../Dependencies/Eos/Eos/Eos.h"
+
+#include "../Core/MemoryWrapper.h"
+
+#include "../Core/MemorySettings.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+using SamplerCacheAllocator = MemoryAllocator<FreeListBestSearchAllocationPolicy, MultiThreadPolicy, MemoryBoundsCheck, MemoryTag, MemoryLog>;
+
+
+// A scene uses just a handful of different sampler states, so the samplers are shared by all the textures with the same state.
+// The samplers are reference counted and destroyed when the last texture using them release them.
+// Being stable for the whole life of the texture they can be used as immutable samplers in the descriptor set layouts.
+class ION_DLL SamplerCache final
+{
+public:
+    static SamplerCacheAllocator* GetAllocator();
+
+public:
+    SamplerCache();
+    ~SamplerCache();
+
+    void        Init(VkDevice _vkDevice);
+    void        Shutdown();
+
+    // pNext must be nullptr, all the other fields are part of the key
+    VkSampler   Acquire(const VkSamplerCreateInfo& _createInfo);
+    void        Release(VkSampler _sampler);
+
+    ionSize     GetSamplerCount() const { return m_samplers.size(); }
+
+private:
+    SamplerCache(const SamplerCache& _Orig) = delete;
+    SamplerCache& operator = (const SamplerCache&) = delete;
+
+    static ionU64 ComputeKey(const VkSamplerCreateInfo& _createInfo);
+
+private:
+    struct SamplerEntry
+    {
+        VkSampler   m_sampler;
+        ionU32      m_refCount;
+    };
+
+    VkDevice    m_vkDevice;
+
+    ionMap<ionU64, SamplerEntry, SamplerCacheAllocator, GetAllocator>   m_samplers;
+    ionMap<VkSampler, ionU64, SamplerCacheAllocator, GetAllocator>      m_samplerToKey;
+};
+
+ION_NAMESPACE_END
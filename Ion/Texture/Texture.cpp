@@ -27,6 +27,8 @@
 
 #include "CubemapHelper.h"
 
+#include "../Utilities/Tools.h"
+
 EOS_USING_NAMESPACE
 ION_NAMESPACE_BEGIN
 
@@ -54,11 +56,28 @@ Texture::Texture(VkDevice _vkDevice, const ionString& _name) :
     m_optUsage = ETextureUsage_RGBA;
     m_optTextureType = ETextureType_2D;
     m_optFormat = ETextureFormat_None;
+
+    m_sourceHash = 0;
+    m_contentKey = 0;
+    m_lastUsedFrame = 0;
+
+    m_sourceWidth = 0;
+    m_sourceHeight = 0;
+    m_sourceNumLevels = 0;
+    m_streamedLevel = 0;
+    m_requestedLevel = 0;
+    m_requestedFrame = 0;
+    m_isStreamed = false;
+    m_sourceLevels = nullptr;
+    m_sourceLevelsSize = 0;
+
+    m_bindlessIndex = ION_BINDLESS_INVALID_INDEX;
 }
 
 Texture::~Texture()
 {
     Destroy();
+    ReleaseSourceLevels();
 }
 
 void Texture::ConvertFrom3ChannelTo4Channel(ionU32 _width, ionU32 _height, const ionU8* _inBuffer, ionU8* _outBuffer)
@@ -114,6 +133,11 @@ ionBool Texture::LoadTextureFromBuffer(ionU32 _width, ionU32 _height, ionU32 _co
 
 ionBool Texture::LoadTextureFromFile(const ionString& _path)
 {
+    if (IsStreamingCandidate())
+    {
+        return LoadStreamedTextureFromFile(_path);
+    }
+
     ionS32 w = 0, h = 0, c = 0;
     ionU8* buffer = stbi_load(_path.c_str(), &w, &h, &c, 0);
 
@@ -136,6 +160,285 @@ ionBool Texture::LoadTextureFromFile(const ionString& _path)
     return result;
 }
 
+ionBool Texture::IsStreamingCandidate() const
+{
+    // only 2D textures with a mip chain and 32 bits per texel, which are decoded always as RGBA8
+    if (!ionTextureManger().IsMipStreamingEnabled() || m_optTextureType != ETextureType_2D || m_optFilterMin <= ETextureFilterMin_Nearest)
+    {
+        return false;
+    }
+
+    return m_optUsage == ETextureUsage_RGBA || m_optUsage == ETextureUsage_RGB1 || m_optUsage == ETextureUsage_RGB;
+}
+
+ionBool Texture::DecodeSourceLevels(const ionString& _path)
+{
+    ionS32 w = 0, h = 0, c = 0;
+    ionU8* buffer = stbi_load(_path.c_str(), &w, &h, &c, 4);
+    ionAssertReturnValue(buffer != nullptr, "Cannot decode the texture file!", false);
+
+    // full chain of the source
+    m_width = w;
+    m_height = h;
+    m_numLevels = 0;
+
+    GenerateOptions();
+
+    m_sourceWidth = m_width;
+    m_sourceHeight = m_height;
+    m_sourceNumLevels = m_numLevels;
+
+    m_sourceLevelsSize = GetLevelsSize();
+    m_sourceLevels = (ionU8*)ionNewRaw(sizeof(ionU8) * m_sourceLevelsSize, GetAllocator());
+
+    MemUtils::MemCpy(m_sourceLevels, buffer, static_cast<ionSize>(m_sourceWidth) * m_sourceHeight * 4);
+    stbi_image_free(buffer);
+
+    ionU8* level = m_sourceLevels;
+    ionU32 width = m_sourceWidth;
+    ionU32 height = m_sourceHeight;
+    for (ionU32 i = 1; i < m_sourceNumLevels; ++i)
+    {
+        ionU8* nextLevel = level + static_cast<ionSize>(width) * height * 4;
+        DownsampleRGBA8(width, height, level, nextLevel);
+
+        level = nextLevel;
+        width = std::max(width >> 1, 1u);
+        height = std::max(height >> 1, 1u);
+    }
+
+    return true;
+}
+
+void Texture::ReleaseSourceLevels()
+{
+    if (m_sourceLevels != nullptr)
+    {
+        ionDeleteRaw(m_sourceLevels, GetAllocator());
+        m_sourceLevels = nullptr;
+        m_sourceLevelsSize = 0;
+    }
+}
+
+ionSize Texture::GetSourceLevelOffset(ionU32 _level) const
+{
+    ionSize offset = 0;
+    for (ionU32 i = 0; i < _level; ++i)
+    {
+        offset += static_cast<ionSize>(std::max(m_sourceWidth >> i, 1u)) * std::max(m_sourceHeight >> i, 1u) * 4;
+    }
+    return offset;
+}
+
+ionBool Texture::LoadStreamedTextureFromFile(const ionString& _path)
+{
+    // the levels are not kept after an eviction, a reload decodes the file again
+    if (m_sourceLevels == nullptr && !DecodeSourceLevels(_path))
+    {
+        return false;
+    }
+
+    // first load: start from a small level, the draws will request the finer ones
+    if (!m_isStreamed)
+    {
+        m_streamedLevel = 0;
+        while (m_streamedLevel + 1 < m_sourceNumLevels && ((m_sourceWidth >> m_streamedLevel) > ION_TEXTURE_STREAMING_INITIAL_SIZE || (m_sourceHeight >> m_streamedLevel) > ION_TEXTURE_STREAMING_INITIAL_SIZE))
+        {
+            ++m_streamedLevel;
+        }
+        m_isStreamed = true;
+    }
+    m_streamedLevel = std::min(m_streamedLevel, m_sourceNumLevels - 1);
+
+    // the levels not resident are never uploaded, the resident ones are already reduced
+    m_width = std::max(m_sourceWidth >> m_streamedLevel, 1u);
+    m_height = std::max(m_sourceHeight >> m_streamedLevel, 1u);
+    m_numLevels = m_sourceNumLevels - m_streamedLevel;
+
+    ionBool result = Create();
+    if (result)
+    {
+        UploadTextureLevels(m_sourceLevels + GetSourceLevelOffset(m_streamedLevel));
+    }
+
+    // the whole chain is on the GPU, nothing finer can be requested
+    if (m_streamedLevel == 0)
+    {
+        ReleaseSourceLevels();
+    }
+
+    return result;
+}
+
+ionBool Texture::StreamLevels(VkImage _residentImage, ionU32 _residentLevel, ionU32 _level)
+{
+    ionAssertReturnValue(_level < m_sourceNumLevels && _residentLevel < m_sourceNumLevels, "Streamed level out of range!", false);
+
+    // only the finer levels come from the source, decoded again if released since the last upload
+    if (_level < _residentLevel && m_sourceLevels == nullptr)
+    {
+        ionAssertReturnValue(DecodeSourceLevels(m_sourcePath), "Cannot decode the source of the streamed texture!", false);
+    }
+
+    m_streamedLevel = _level;
+    m_width = std::max(m_sourceWidth >> m_streamedLevel, 1u);
+    m_height = std::max(m_sourceHeight >> m_streamedLevel, 1u);
+    m_numLevels = m_sourceNumLevels - m_streamedLevel;
+
+    if (!Create())
+    {
+        return false;
+    }
+
+    // the staging comes first, because it can submit and restart the command buffer
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    ionSize offset = 0;
+    ionSize uploadSize = 0;
+    if (_level < _residentLevel)
+    {
+        uploadSize = GetSourceLevelOffset(_residentLevel) - GetSourceLevelOffset(_level);
+
+        ionU8* data = ionStagingBufferManager().Stage(uploadSize, ION_MEMORY_ALIGNMENT_SIZE, commandBuffer, buffer, offset);
+        ionAssertReturnValue(data != nullptr, "Cannot stage the streamed levels!", false);
+
+        MemUtils::MemCpy(data, m_sourceLevels + GetSourceLevelOffset(_level), uploadSize);
+    }
+
+    // kept only while the texture is still going toward its finest level
+    if (_level == 0 || _level > _residentLevel)
+    {
+        ReleaseSourceLevels();
+    }
+    else
+    {
+        commandBuffer = ionStagingBufferManager().GetCommandBuffer();
+        ionAssertReturnValue(commandBuffer != VK_NULL_HANDLE, "Cannot get the staging command buffer!", false);
+    }
+
+    VkImageMemoryBarrier barriers[2] = {};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = m_image;
+    barriers[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barriers[0].subresourceRange.baseMipLevel = 0;
+    barriers[0].subresourceRange.levelCount = m_numLevels;
+    barriers[0].subresourceRange.baseArrayLayer = 0;
+    barriers[0].subresourceRange.layerCount = 1;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    // the resident image stays in the layout sampled by the frames in flight, the copy only reads it
+    barriers[1] = barriers[0];
+    barriers[1].image = _residentImage;
+    barriers[1].subresourceRange.levelCount = m_sourceNumLevels - _residentLevel;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+    // the levels in both images, from the finest of the two
+    const ionU32 firstCopiedLevel = std::max(_level, _residentLevel);
+    ionVector<VkImageCopy, TextureAllocator, GetAllocator> copies;
+    copies.resize(m_sourceNumLevels - firstCopiedLevel);
+    for (ionU32 i = firstCopiedLevel; i < m_sourceNumLevels; ++i)
+    {
+        VkImageCopy& copy = copies[i - firstCopiedLevel];
+        copy = {};
+        copy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy.srcSubresource.mipLevel = i - _residentLevel;
+        copy.srcSubresource.baseArrayLayer = 0;
+        copy.srcSubresource.layerCount = 1;
+        copy.dstSubresource = copy.srcSubresource;
+        copy.dstSubresource.mipLevel = i - _level;
+        copy.extent.width = std::max(m_sourceWidth >> i, 1u);
+        copy.extent.height = std::max(m_sourceHeight >> i, 1u);
+        copy.extent.depth = 1;
+    }
+    vkCmdCopyImage(commandBuffer, _residentImage, VK_IMAGE_LAYOUT_GENERAL, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<ionU32>(copies.size()), copies.data());
+
+    // the finer levels not resident before
+    if (uploadSize > 0)
+    {
+        ionVector<VkBufferImageCopy, TextureAllocator, GetAllocator> regions;
+        regions.resize(_residentLevel - _level);
+
+        ionSize levelOffset = offset;
+        for (ionU32 i = _level; i < _residentLevel; ++i)
+        {
+            const ionU32 width = std::max(m_sourceWidth >> i, 1u);
+            const ionU32 height = std::max(m_sourceHeight >> i, 1u);
+
+            VkBufferImageCopy& imgCopy = regions[i - _level];
+            imgCopy = {};
+            imgCopy.bufferOffset = levelOffset;
+            imgCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            imgCopy.imageSubresource.mipLevel = i - _level;
+            imgCopy.imageSubresource.baseArrayLayer = 0;
+            imgCopy.imageSubresource.layerCount = 1;
+            imgCopy.imageExtent.width = width;
+            imgCopy.imageExtent.height = height;
+            imgCopy.imageExtent.depth = 1;
+
+            levelOffset += static_cast<ionSize>(width) * height * 4;
+        }
+        vkCmdCopyBufferToImage(commandBuffer, buffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<ionU32>(regions.size()), regions.data());
+    }
+
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barriers[0]);
+
+    return true;
+}
+
+ionU32 Texture::ComputeStreamingLevel(ionFloat _screenSize) const
+{
+    const ionFloat sourceSize = static_cast<ionFloat>(std::max(m_sourceWidth, m_sourceHeight));
+    if (_screenSize >= sourceSize)
+    {
+        return 0;
+    }
+
+    const ionFloat level = std::floor(std::log2(sourceSize / std::max(_screenSize, 1.0f)));
+    return std::min(static_cast<ionU32>(level), m_sourceNumLevels - 1);
+}
+
+void Texture::DownsampleRGBA8(ionU32 _width, ionU32 _height, const ionU8* _inBuffer, ionU8* _outBuffer)
+{
+    const ionU32 outWidth = std::max(_width >> 1, 1u);
+    const ionU32 outHeight = std::max(_height >> 1, 1u);
+
+    // with odd or 1 texel sizes the last row/column is reused
+    for (ionU32 y = 0; y < outHeight; ++y)
+    {
+        const ionU32 y0 = std::min(y * 2, _height - 1);
+        const ionU32 y1 = std::min(y * 2 + 1, _height - 1);
+        for (ionU32 x = 0; x < outWidth; ++x)
+        {
+            const ionU32 x0 = std::min(x * 2, _width - 1);
+            const ionU32 x1 = std::min(x * 2 + 1, _width - 1);
+
+            const ionU8* t00 = _inBuffer + (static_cast<ionSize>(y0) * _width + x0) * 4;
+            const ionU8* t01 = _inBuffer + (static_cast<ionSize>(y0) * _width + x1) * 4;
+            const ionU8* t10 = _inBuffer + (static_cast<ionSize>(y1) * _width + x0) * 4;
+            const ionU8* t11 = _inBuffer + (static_cast<ionSize>(y1) * _width + x1) * 4;
+
+            ionU8* out = _outBuffer + (static_cast<ionSize>(y) * outWidth + x) * 4;
+            for (ionU32 c = 0; c < 4; ++c)
+            {
+                out[c] = static_cast<ionU8>((t00[c] + t01[c] + t10[c] + t11[c] + 2) / 4);
+            }
+        }
+    }
+}
+
 ionBool Texture::LoadCubeTextureFromFile(const ionString& _path)
 {
     GenerateOptions();
@@ -211,6 +514,20 @@ void Texture::GenerateMipMaps()
         return;
     }
 
+    // all the levels of all the layers in a single dispatch, the blit below is the fall back
+    // recorded after the upload of the level 0, in the same staging command buffer
+    VkCommandBuffer generationCommandBuffer = ionStagingBufferManager().GetCommandBuffer();
+    if (generationCommandBuffer != VK_NULL_HANDLE)
+    {
+        // only the skyboxes are known to be color data, the other usages can be normals or masks
+        const ionBool srgb = m_optUsage == ETextureUsage_Skybox;
+
+        if (ionTextureManger().GetMipMapGenerator().Generate(generationCommandBuffer, m_image, m_format, m_width, m_height, m_numLevels, GetNumLayers(), srgb))
+        {
+            return;
+        }
+    }
+
     ionSize size = m_width * m_height * BitsPerFormat(m_optFormat) / 8;
 
 
@@ -355,8 +672,43 @@ void Texture::GenerateOptions()
     }
 }
 
-ionBool Texture::CreateFromFile(const ionString& _path)
+ionU64 Texture::HashFile(const ionString& _path, ionU64 _seed)
+{
+    std::ifstream file(_path.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        return _seed;
+    }
+
+    ionU64 hash = _seed;
+
+    char chunk[64 * 1024];
+    while (file.good())
+    {
+        file.read(chunk, sizeof(chunk));
+        const std::streamsize readCount = file.gcount();
+        if (readCount <= 0)
+        {
+            break;
+        }
+        hash = Tools::HashFNV1a64(chunk, static_cast<ionSize>(readCount), hash);
+    }
+
+    return hash;
+}
+
+ionBool Texture::CreateFromFile(const ionString& _path, ionU64 _sourceHash /*= 0*/)
 {
+    m_sourceHash = 0;
+
+    // a different source restart the streaming from the smallest level
+    if (_path != m_sourcePath)
+    {
+        m_isStreamed = false;
+        ReleaseSourceLevels();
+    }
+    m_sourcePath = _path;
+
     if (m_optTextureType == ETextureType_Cubic)
     {
         m_optRepeat = ETextureRepeat_Clamp;
@@ -375,6 +727,8 @@ ionBool Texture::CreateFromFile(const ionString& _path)
 
         if (isSingleFile)
         {
+            m_sourceHash = HashFile(_path, Tools::kFNV1aOffset64);
+
             // "cross version" (both top vertical or horizontal)
             if (!LoadCubeTextureFromFile(_path))
             {
@@ -400,9 +754,11 @@ ionBool Texture::CreateFromFile(const ionString& _path)
 
 			ionString suffix[6] { "_right.", "_left.", "_top.", "_bottom.", "_front.", "_back." };
             ionVector<ionString, TextureAllocator, GetAllocator> paths; paths.resize(6);
+            m_sourceHash = Tools::kFNV1aOffset64;
             for (ionU32 i = 0; i < 6; ++i)
             {
                 paths[i] = path + suffix[i] + ext;
+                m_sourceHash = HashFile(paths[i], m_sourceHash);
             }
 
             if (!LoadCubeTextureFromFiles(paths))
@@ -413,6 +769,8 @@ ionBool Texture::CreateFromFile(const ionString& _path)
     }
     else if (m_optTextureType == ETextureType_2D)
     {
+        m_sourceHash = (_sourceHash != 0) ? _sourceHash : HashFile(_path, Tools::kFNV1aOffset64);
+
         if (!LoadTextureFromFile(_path))
         {
             ionAssertReturnValue(false, "Cannot load 2d texture!", false);
@@ -426,8 +784,11 @@ ionBool Texture::CreateFromFile(const ionString& _path)
     return true;
 }
 
-ionBool Texture::CreateFromBuffer(ionU32 _width, ionU32 _height, ionU32 _component, const ionU8* _buffer, VkDeviceSize _bufferSize)
+ionBool Texture::CreateFromBuffer(ionU32 _width, ionU32 _height, ionU32 _component, const ionU8* _buffer, VkDeviceSize _bufferSize, ionU64 _sourceHash /*= 0*/)
 {
+    m_sourceHash = (_sourceHash != 0) ? _sourceHash : Tools::HashFNV1a64(_buffer, static_cast<ionSize>(_bufferSize));
+    m_sourcePath.clear();
+
     if (!LoadTextureFromBuffer( _width, _height, _component, _buffer))
     {
         ionAssertReturnValue(false, "Cannot load binary texture!", false);
@@ -436,6 +797,22 @@ ionBool Texture::CreateFromBuffer(ionU32 _width, ionU32 _height, ionU32 _compone
     return true;
 }
 
+ionBool Texture::CreateFromLevels(ionU32 _width, ionU32 _height, ETextureFormat _format, ETextureRepeat _repeat, ETextureType _type, ionU32 _numLevel, const ionU8* _buffer, ionSize _bufferSize)
+{
+    if (!GenerateTexture(_width, _height, _format, _repeat, _type, _numLevel))
+    {
+        ionAssertReturnValue(false, "Cannot generate texture from levels!", false);
+    }
+
+    ionAssertReturnValue(_bufferSize == GetLevelsSize(), "Buffer size does not match the texture levels!", false);
+
+    m_sourceHash = Tools::HashFNV1a64(_buffer, _bufferSize);
+
+    UploadTextureLevels(_buffer);
+
+    return true;
+}
+
 ionBool Texture::GenerateTexture(ionU32 _width, ionU32 _height, ETextureFormat _format, ETextureRepeat _repeat, ETextureType _type /*= ETextureType_2D*/, ionU32 _numLevel /*= 1*/)
 {
     m_width = _width;
@@ -444,6 +821,8 @@ ionBool Texture::GenerateTexture(ionU32 _width, ionU32 _height, ETextureFormat _
     m_optRepeat = _repeat;
     m_numLevels = _numLevel;
     m_optTextureType = _type;
+    m_sourceHash = 0;
+    m_sourcePath.clear();
 
     GenerateOptions();
 
@@ -480,6 +859,15 @@ ionBool Texture::Create()
                 createInfo.usage &= ~VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
                 createInfo.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
             }
+            else if (IsBlockCompressed(m_optFormat))
+            {
+                // cannot be a render target, all the levels are uploaded
+                createInfo.usage &= ~VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            }
+            else if (m_numLevels > 1 && ionTextureManger().GetMipMapGenerator().IsFormatSupported(m_format))
+            {
+                createInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+            }
             createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
             createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -522,6 +910,12 @@ ionBool Texture::Create()
             ionAssertReturnValue(result == VK_SUCCESS, "Cannot create image view!", false);
         }
 
+        // a depth and stencil view cannot be sampled, it would be invalid in the table
+        if (m_optFormat != ETextureFormat_Depth)
+        {
+            ionTextureManger().GetBindlessTextureTable().Add(this);
+        }
+
         return true;
     }
     else
@@ -542,11 +936,13 @@ ionU32 Texture::BitsPerFormat(ETextureFormat _format)
     case ETextureFormat_Alpha:              return 8;
     case ETextureFormat_Luminance8:         return 8;
     case ETextureFormat_Intensity8:         return 8;
-    case ETextureFormat_HDR:                return 128; //64;//48;
+    case ETextureFormat_HDR:                return 64;
     case ETextureFormat_BRDF:               return 32;
     case ETextureFormat_Depth:              return 32;  // should be 24, but it works with 32
-    case ETextureFormat_Irradiance:             return 128;
+    case ETextureFormat_Irradiance:             return 64;
     case ETextureFormat_PrefilteredEnvironment: return 64;
+    case ETextureFormat_BC1:                return 4;
+    case ETextureFormat_BC3:                return 8;
     default:
         ionAssertReturnValue(false, "Invalid format!", 0);
         return 0;
@@ -615,6 +1011,92 @@ void Texture::UploadTextureToMemory(ionU32 _mipMapLevel, ionU32 _width, ionU32 _
     vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
+ionSize Texture::GetLevelSize(ETextureFormat _format, ionU32 _width, ionU32 _height)
+{
+    if (IsBlockCompressed(_format))
+    {
+        // 16 pixels per block
+        return static_cast<ionSize>((_width + 3) / 4) * ((_height + 3) / 4) * BitsPerFormat(_format) * 2;
+    }
+
+    return static_cast<ionSize>(_width) * _height * (BitsPerFormat(_format) / 8);
+}
+
+ionSize Texture::GetLevelsSize() const
+{
+    ionSize size = 0;
+    for (ionU32 i = 0; i < m_numLevels; ++i)
+    {
+        size += GetLevelSize(m_optFormat, std::max(m_width >> i, 1u), std::max(m_height >> i, 1u));
+    }
+
+    return size * GetNumLayers();
+}
+
+void Texture::UploadTextureLevels(const ionU8* _buffer)
+{
+    const ionSize size = GetLevelsSize();
+    const ionU32 layerCount = GetNumLayers();
+
+    VkBuffer buffer;
+    VkCommandBuffer commandBuffer;
+    ionSize offset = 0;
+    ionU8* data = ionStagingBufferManager().Stage(size, ION_MEMORY_ALIGNMENT_SIZE, commandBuffer, buffer, offset);
+    ionAssertReturnVoid(data != nullptr, "Cannot stage texture levels!");
+
+    MemUtils::MemCpy(data, _buffer, size);
+
+    // one region per level, each one covers all the layers
+    ionVector<VkBufferImageCopy, TextureAllocator, GetAllocator> regions;
+    regions.resize(m_numLevels);
+
+    ionSize levelOffset = offset;
+    for (ionU32 i = 0; i < m_numLevels; ++i)
+    {
+        const ionU32 width = std::max(m_width >> i, 1u);
+        const ionU32 height = std::max(m_height >> i, 1u);
+
+        VkBufferImageCopy& imgCopy = regions[i];
+        imgCopy = {};
+        imgCopy.bufferOffset = levelOffset;
+        imgCopy.bufferRowLength = 0;
+        imgCopy.bufferImageHeight = 0;
+        imgCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imgCopy.imageSubresource.mipLevel = i;
+        imgCopy.imageSubresource.baseArrayLayer = 0;
+        imgCopy.imageSubresource.layerCount = layerCount;
+        imgCopy.imageExtent.width = width;
+        imgCopy.imageExtent.height = height;
+        imgCopy.imageExtent.depth = 1;
+
+        levelOffset += GetLevelSize(m_optFormat, width, height) * layerCount;
+    }
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = m_numLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = layerCount;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkCmdCopyBufferToImage(commandBuffer, buffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<ionU32>(regions.size()), regions.data());
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
 VkFormat Texture::GetVulkanFormatFromTextureFormat(ETextureFormat _format)
 {
     switch (_format)
@@ -626,11 +1108,13 @@ VkFormat Texture::GetVulkanFormatFromTextureFormat(ETextureFormat _format)
     case ETextureFormat_Luminance8: return VK_FORMAT_R8_UNORM;
     case ETextureFormat_Intensity8: return VK_FORMAT_R8_UNORM;
     case ETextureFormat_RGB565: return VK_FORMAT_R8G8B8_UNORM;      // fall back on this format
-    case ETextureFormat_HDR: return VK_FORMAT_R32G32B32A32_SFLOAT;// VK_FORMAT_R16G16B16A16_SFLOAT;
+    case ETextureFormat_HDR: return VK_FORMAT_R16G16B16A16_SFLOAT;
     case ETextureFormat_BRDF: return VK_FORMAT_R16G16_SFLOAT;
     case ETextureFormat_Depth: return ionTextureManger().GetDepthFormat(); //VK_FORMAT_R8G8B8_UNORM;
-    case ETextureFormat_Irradiance: return VK_FORMAT_R32G32B32A32_SFLOAT;
+    case ETextureFormat_Irradiance: return VK_FORMAT_R16G16B16A16_SFLOAT;
     case ETextureFormat_PrefilteredEnvironment: return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case ETextureFormat_BC1: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case ETextureFormat_BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
     default:
         return VK_FORMAT_UNDEFINED;
     }
@@ -736,7 +1220,7 @@ ionBool Texture::CreateSampler()
     createInfo.compareOp = (m_optFormat == ETextureFormat_Depth) ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_NEVER;
     createInfo.unnormalizedCoordinates = VK_FALSE;
     createInfo.minLod = 0;
-    createInfo.maxLod = static_cast<ionFloat>(m_numLevels);
+    createInfo.maxLod = VK_LOD_CLAMP_NONE;     // the view already limits the levels, so the sampler does not depend on the texture and can be shared
 
     GetVulkanFiltersFromTextureFilters(m_optFilterMin, m_optFilterMag, createInfo.minFilter, createInfo.magFilter, createInfo.mipmapMode);
 
@@ -789,17 +1273,33 @@ ionBool Texture::CreateSampler()
     }
 
 
-    VkResult result = vkCreateSampler(m_vkDevice, &createInfo, vkMemory, &m_sampler);
-    ionAssertReturnValue(result == VK_SUCCESS, "Cannot create sampler", false);
+    m_sampler = ionTextureManger().GetSamplerCache().Acquire(createInfo);
+    ionAssertReturnValue(m_sampler != VK_NULL_HANDLE, "Cannot create sampler", false);
 
     return true;
 }
 
+ionBool Texture::Reload()
+{
+    ionAssertReturnValue(IsEvictable(), "Only textures loaded from file can be reloaded!", false);
+
+    if (IsResident())
+    {
+        return true;
+    }
+
+    // copy, because CreateFromFile set it again
+    const ionString path = m_sourcePath;
+    return CreateFromFile(path, m_sourceHash);
+}
+
 void Texture::Destroy()
 {
+    ionTextureManger().GetBindlessTextureTable().Remove(this);
+
     if (m_sampler != VK_NULL_HANDLE)
     {
-        vkDestroySampler(m_vkDevice, m_sampler, vkMemory);
+        ionTextureManger().GetSamplerCache().Release(m_sampler);
         m_sampler = VK_NULL_HANDLE;
     }
 
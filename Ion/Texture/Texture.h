@@ -48,15 +48,55 @@ public:
     ionS32 GetWidth() const { return static_cast<ionS32>(m_width); }
     ionS32 GetHeight() const { return static_cast<ionS32>(m_height); }
     ionU32 GetComponent() const { return BitsPerFormat(m_optFormat) / 8; }
-    ionU32 GetSize() const { return m_width * m_height * GetComponent(); }
+    ionU32 GetSize() const { return static_cast<ionU32>(GetLevelSize(m_optFormat, m_width, m_height)); }
+
+    ionU32 GetNumLevels() const { return m_numLevels; }
+    ionU32 GetNumLayers() const { return (m_optTextureType == ETextureType_Cubic) ? 6 : 1; }
+    ETextureFormat GetTextureFormat() const { return m_optFormat; }
+    ETextureType GetTextureType() const { return m_optTextureType; }
+
+    // Size in bytes of all the levels of all the layers, tightly packed level by level (all layers of level 0, then all layers of level 1, etc)
+    ionSize GetLevelsSize() const;
+
+    // Hash of the source content (file bytes or input buffer), 0 if the texture has been generated
+    ionU64 GetSourceHash() const { return m_sourceHash; }
+
+    // Residency: only the textures loaded from file can be evicted, because they can be reloaded from the same path
+    ionBool IsResident() const { return m_image != VK_NULL_HANDLE; }
+    ionBool IsEvictable() const { return !m_sourcePath.empty(); }
+    VkDeviceSize GetAllocationSize() const { return m_allocation.m_size; }
+    ionU64 GetLastUsedFrame() const { return m_lastUsedFrame; }
+
+    // Mip streaming: a streamed texture keeps on the GPU only the levels from GetStreamedLevel() of the source image,
+    // so GetWidth/GetHeight/GetNumLevels describe the resident image, the source ones are given here.
+    // All the levels of the decoded source are kept on the CPU only while the texture is streaming toward finer levels:
+    // they are released once level 0 is resident, when streaming to a coarser level and on eviction, and decoded again from the file when needed
+    ionBool IsStreamed() const { return m_isStreamed; }
+    ionU32 GetStreamedLevel() const { return m_streamedLevel; }
+    ionU32 GetSourceWidth() const { return m_sourceWidth; }
+    ionU32 GetSourceHeight() const { return m_sourceHeight; }
+    ionU32 GetSourceNumLevels() const { return m_sourceNumLevels; }
+
+    // Element of the texture in the bindless table of the TextureManager, it changes every time the view is recreated (eviction, streaming).
+    // ION_BINDLESS_INVALID_INDEX when the table is not enabled or the texture is not resident
+    ionU32 GetBindlessIndex() const { return m_bindlessIndex; }
 
     static ionU32 BitsPerFormat(ETextureFormat _format);
+    static ionBool IsBlockCompressed(ETextureFormat _format) { return _format == ETextureFormat_BC1 || _format == ETextureFormat_BC3; }
+
+    // Size in bytes of one layer of a level, the block compressed formats round it up to whole blocks
+    static ionSize GetLevelSize(ETextureFormat _format, ionU32 _width, ionU32 _height);
+
+    static VkFormat GetVulkanFormatFromTextureFormat(ETextureFormat _format);
 
 private:
     friend class TextureManager;
+    friend class BindlessTextureTable;
 
-    ionBool CreateFromFile(const ionString& _path);
-    ionBool CreateFromBuffer(ionU32 _width, ionU32 _height, ionU32 _component, const ionU8* _buffer, VkDeviceSize _bufferSize);
+    // _sourceHash can be passed when already computed by the caller, 0 means to compute it here
+    ionBool CreateFromFile(const ionString& _path, ionU64 _sourceHash = 0);
+    ionBool CreateFromBuffer(ionU32 _width, ionU32 _height, ionU32 _component, const ionU8* _buffer, VkDeviceSize _bufferSize, ionU64 _sourceHash = 0);
+    ionBool CreateFromLevels(ionU32 _width, ionU32 _height, ETextureFormat _format, ETextureRepeat _repeat, ETextureType _type, ionU32 _numLevel, const ionU8* _buffer, ionSize _bufferSize);
     ionBool Create();
 
     ionBool Save(const ionString& _path) const;
@@ -68,12 +108,25 @@ private:
 
     void Destroy();
 
+    // reload the GPU data after an eviction, all the options are kept
+    ionBool Reload();
+
     ionBool CreateSampler();
-    VkFormat GetVulkanFormatFromTextureFormat(ETextureFormat _format);
     VkComponentMapping GetVulkanComponentMappingFromTextureFormat(ETextureFormat _format);
     void GetVulkanFiltersFromTextureFilters(ETextureFilterMin _min0, ETextureFilterMag _mag0, VkFilter& _min, VkFilter& _mag, VkSamplerMipmapMode& _mipmap);
 
     ionBool LoadTextureFromFile(const ionString& _path);
+    ionBool LoadStreamedTextureFromFile(const ionString& _path);
+    ionBool IsStreamingCandidate() const;
+    // decode the file and reduce it to the whole chain of m_sourceLevels
+    ionBool DecodeSourceLevels(const ionString& _path);
+    void    ReleaseSourceLevels();
+    ionSize GetSourceLevelOffset(ionU32 _level) const;
+    // recreate the image from _level of the source: the levels still resident in _residentImage (from _residentLevel) are copied on the GPU,
+    // only the finer ones are uploaded from m_sourceLevels. _residentImage has to be kept alive until the staging buffer is submitted
+    ionBool StreamLevels(VkImage _residentImage, ionU32 _residentLevel, ionU32 _level);
+    // finest source level needed to draw the whole UV range over _screenSize pixels
+    ionU32  ComputeStreamingLevel(ionFloat _screenSize) const;
     ionBool LoadCubeTextureFromFile(const ionString& _path);
     ionBool LoadCubeTextureFromFiles(const ionVector<ionString, TextureAllocator, GetAllocator>& paths);
 
@@ -87,6 +140,14 @@ private:
 
     void UploadTextureBuffer(const ionU8* _buffer, ionU32 _component, ionU32 _index = 0 /* index of texture for cube-map, 0 by default */);
 
+    // box filter of a RGBA8 image to the next level
+    static void DownsampleRGBA8(ionU32 _width, ionU32 _height, const ionU8* _inBuffer, ionU8* _outBuffer);
+
+    // upload all the levels and layers at once, buffer laid out as described in GetLevelsSize
+    void UploadTextureLevels(const ionU8* _buffer);
+
+    static ionU64 HashFile(const ionString& _path, ionU64 _seed);
+
 private:
 	ionString               m_name;
     VkDevice                m_vkDevice;
@@ -111,6 +172,24 @@ private:
     ionU32                  m_numLevels;        // if this is set to 0, during generation it will be 1 for ETextureFilter_Nearest or ETextureFilter_Linear filters, otherwise will be based on the size
 
     ionU32                  m_maxAnisotropy;    // 1 means DISABLED anisotropy
+
+    ionU64                  m_sourceHash;
+    ionU64                  m_contentKey;       // set by the TextureManager when the texture is shared by content, 0 otherwise
+    ionU64                  m_lastUsedFrame;    // 0 means never used by a draw, so not tracked by the residency
+
+    ionString               m_sourcePath;       // not empty only for textures loaded from file
+
+    ionU32                  m_sourceWidth;
+    ionU32                  m_sourceHeight;
+    ionU32                  m_sourceNumLevels;
+    ionU32                  m_streamedLevel;    // first level of the source resident on the GPU
+    ionU32                  m_requestedLevel;   // finest level requested by the draws of m_requestedFrame
+    ionU64                  m_requestedFrame;
+    ionBool                 m_isStreamed;
+    ionU8*                  m_sourceLevels;     // RGBA8, all the levels of the source laid out as in GetLevelsSize, only while a streamed texture needs finer levels
+    ionSize                 m_sourceLevelsSize;
+
+    ionU32                  m_bindlessIndex;
 };
 
 
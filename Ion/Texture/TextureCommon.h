@@ -8,6 +8,10 @@
 #include "../Core/CoreDefs.h"
 
 
+#define ION_TEXTURE_STREAMING_INITIAL_SIZE      64      // largest side of the first level uploaded for a streamed texture
+#define ION_BINDLESS_INVALID_INDEX              0xFFFFFFFF
+
+
 ION_NAMESPACE_BEGIN
 
 enum ETextureType
@@ -35,7 +39,7 @@ enum ETextureFormat
     ETextureFormat_RGBA8,   // 32 bpp
     ETextureFormat_XRGB8,   // 32 bpp
     ETextureFormat_RGB565,  // 16 bpp
-    ETextureFormat_HDR,     // RGBE, floating point, 48 bpp (3 x 16 bits)
+    ETextureFormat_HDR,     // RGBA half float, 64 bpp (4 x 16 bits): the float data from the decoder is converted before the upload
 
     ETextureFormat_Depth,   // 24 bpp
 
@@ -49,8 +53,12 @@ enum ETextureFormat
     ETextureFormat_Intensity8,            //  8 bpp
 
     ETextureFormat_BRDF,             // 32 bpp, 16 red and 16 green, used for PBR
-    ETextureFormat_Irradiance,
-    ETextureFormat_PrefilteredEnvironment
+    ETextureFormat_Irradiance,              // 64 bpp, RGBA half float
+    ETextureFormat_PrefilteredEnvironment,  // 64 bpp, RGBA half float
+
+    // block compressed, 4x4 pixels per block: the levels are uploaded as they are, no mip map generation
+    ETextureFormat_BC1,     //  4 bpp, RGB
+    ETextureFormat_BC3      //  8 bpp, RGBA
 };
 
  enum ETextureUsage
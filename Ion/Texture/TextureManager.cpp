@@ -5,14 +5,41 @@
 
 #include "TextureManager.h"
 
+#include <algorithm>
+
 #include "../Dependencies/Eos/Eos/Eos.h"
 
 #include "../Renderer/RenderCore.h"
 
+#include "../Core/FileSystemManager.h"
+
+#include "../GPU/GpuMemoryManager.h"
+
+#include "../Utilities/Tools.h"
+#include "../Utilities/HashedName.h"
+
+
+#define ION_TEXTURE_CACHE_MAGIC     0x4E4F4954      // "TION"
+#define ION_TEXTURE_CACHE_VERSION   2               // 2: irradiance stored as half float
+
 EOS_USING_NAMESPACE
 
 ION_NAMESPACE_BEGIN
 
+struct TextureCacheHeader
+{
+    ionU32  m_magic;
+    ionU32  m_version;
+    ionU64  m_key;
+    ionU32  m_width;
+    ionU32  m_height;
+    ionU32  m_numLevels;
+    ionU32  m_type;
+    ionU32  m_format;
+    ionU32  m_padding;
+    ionU64  m_dataSize;
+};
+
 TextureManagerAllocator* TextureManager::GetAllocator()
 {
 	static HeapArea<Settings::kTextureManagerAllocatorSize> memoryArea;
@@ -21,8 +48,9 @@ TextureManagerAllocator* TextureManager::GetAllocator()
 	return &memoryAllocator;
 }
 
-TextureManager::TextureManager()
+TextureManager::TextureManager() : m_vkPhysicalDevice(VK_NULL_HANDLE), m_residencyBudget(0), m_residentSize(0), m_residencyFrame(1), m_streamingUploadsPerFrame(2), m_mipStreaming(false)
 {
+    memset(&m_statistics, 0, sizeof(m_statistics));
 }
 
 TextureManager::~TextureManager()
@@ -35,10 +63,15 @@ TextureManager& TextureManager::Instance()
     return instance;
 }
 
-void TextureManager::Init(VkDevice _vkDevice, ETextureSamplesPerBit _textureSample)
+void TextureManager::Init(VkPhysicalDevice _vkPhysicalDevice, VkDevice _vkDevice, ionS32 _vkQueueFamilyIndex, ETextureSamplesPerBit _textureSample, ionU32 _bindlessTextureCount /*= 0*/)
 {
+    m_vkPhysicalDevice = _vkPhysicalDevice;
     m_vkDevice = _vkDevice;
     m_mainSamplesPerBit = _textureSample;
+
+    m_samplerCache.Init(_vkDevice);
+    m_mipMapGenerator.Init(_vkPhysicalDevice, _vkDevice, _vkQueueFamilyIndex);
+    m_bindlessTextureTable.Init(_vkDevice, _bindlessTextureCount);
 }
 
 void TextureManager::Shutdown()
@@ -47,11 +80,24 @@ void TextureManager::Shutdown()
     ionMap<ionSize, Texture*, TextureManagerAllocator, GetAllocator>::iterator it = begin;
     for (; it != end; ++it)
     {
-        DestroyTexture(it->second);
-        ionDelete(it->second, Texture::GetAllocator());
+        // shared textures are referenced by more names, delete them once
+        if (ReleaseTexture(it->second))
+        {
+            DestroyTexture(it->second);
+            ionDelete(it->second, Texture::GetAllocator());
+        }
     }
 
     m_hashTexture.clear();
+    m_contentTexture.clear();
+    m_residentTextures.clear();
+    m_residentSize = 0;
+
+    ReleasePending(true);
+
+    m_bindlessTextureTable.Shutdown();
+    m_mipMapGenerator.Shutdown();
+    m_samplerCache.Shutdown();
 }
 
 VkSamplerAddressMode TextureManager::ConvertAddressMode(ETextureRepeat _repeat)
@@ -77,16 +123,23 @@ Texture* TextureManager::CreateTextureFromFile(const ionString& _name, const ion
         return nullptr;
     }
 
-    Texture* texture = GetTexture(_name);
-    if (texture == nullptr)
-    {
-        texture = CreateTexture(m_vkDevice, _name);
-    }
-    else
+    // the hash is over the encoded file, so an image already loaded is never decoded again
+    ionU64 sourceHash = 0;
+    ionU64 contentKey = 0;
+    if (_type == ETextureType_2D)
     {
-        DestroyTexture(texture);
+        sourceHash = Texture::HashFile(_path, Tools::kFNV1aOffset64);
+        contentKey = ComputeContentKey(sourceHash, 0, 0, 0, _filterMin, _filterMag, _repeat, _usage, _type, _maxAnisotrpy, _customRepeatU, _customRepeatV, _customRepeatW);
+
+        Texture* shared = AddContentReference(_name, contentKey);
+        if (shared != nullptr)
+        {
+            return shared;
+        }
     }
 
+    Texture* texture = PrepareTexture(_name);
+
     texture->m_optUsage = _usage;
     texture->m_optFilterMin = _filterMin;
     texture->m_optFilterMag = _filterMag;
@@ -97,8 +150,13 @@ Texture* TextureManager::CreateTextureFromFile(const ionString& _name, const ion
     texture->m_optCustomRepeat[2] = ConvertAddressMode(_customRepeatW);
     texture->m_maxAnisotropy = _maxAnisotrpy;
 
-    if (texture->CreateFromFile(_path))
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    if (texture->CreateFromFile(_path, sourceHash))
     {
+        if (contentKey != 0)
+        {
+            RegisterContent(texture, contentKey, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count());
+        }
         return texture;
     }
     else
@@ -114,16 +172,17 @@ Texture* TextureManager::CreateTextureFromBuffer(const ionString& _name, ionU32
         return nullptr;
     }
 
-    Texture* texture = GetTexture(_name);
-    if (texture == nullptr)
-    {
-        texture = CreateTexture(m_vkDevice, _name);
-    }
-    else
+    const ionU64 sourceHash = Tools::HashFNV1a64(_buffer, static_cast<ionSize>(_bufferSize));
+    const ionU64 contentKey = ComputeContentKey(sourceHash, _width, _height, _component, _filterMin, _filterMag, _repeat, _usage, _type, _maxAnisotrpy, _customRepeatU, _customRepeatV, _customRepeatW);
+
+    Texture* shared = AddContentReference(_name, contentKey);
+    if (shared != nullptr)
     {
-        DestroyTexture(texture);
+        return shared;
     }
 
+    Texture* texture = PrepareTexture(_name);
+
     texture->m_optUsage = _usage;
     texture->m_optFilterMin = _filterMin;
     texture->m_optFilterMag = _filterMag;
@@ -134,8 +193,10 @@ Texture* TextureManager::CreateTextureFromBuffer(const ionString& _name, ionU32
     texture->m_optCustomRepeat[2] = ConvertAddressMode(_customRepeatW);
     texture->m_maxAnisotropy = _maxAnisotrpy;
 
-    if (texture->CreateFromBuffer(_width, _height, _component, _buffer, _bufferSize))
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    if (texture->CreateFromBuffer(_width, _height, _component, _buffer, _bufferSize, sourceHash))
     {
+        RegisterContent(texture, contentKey, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count());
         return texture;
     }
     else
@@ -144,23 +205,54 @@ Texture* TextureManager::CreateTextureFromBuffer(const ionString& _name, ionU32
     }
 }
 
-Texture* TextureManager::GenerateTexture(const ionString& _name, ionU32 _width, ionU32 _height, ETextureFormat _format, ETextureFilterMin _filterMin /*= ETextureFilterMin_Linear_MipMap_Linear*/, ETextureFilterMag _filterMag /*= ETextureFilterMag_Linear*/, ETextureRepeat _repeat/*= ETextureRepeat_Repeat*/, ETextureType _type /*= ETextureType_2D*/, ionU32 _numLevel /*= 1*/, ionU32 _maxAnisotrpy /*= 1*/, ETextureRepeat _customRepeatU /*= ETextureRepeat_Repeat*/, ETextureRepeat _customRepeatV /*= ETextureRepeat_Repeat*/, ETextureRepeat _customRepeatW /*= ETextureRepeat_Repeat*/)
+Texture* TextureManager::CreateTextureFromLevels(const ionString& _name, ionU32 _width, ionU32 _height, ETextureFormat _format, ionU32 _numLevel, const ionU8* _buffer, ionSize _bufferSize, ETextureFilterMin _filterMin /*= ETextureFilterMin_Linear_MipMap_Linear*/, ETextureFilterMag _filterMag /*= ETextureFilterMag_Linear*/, ETextureRepeat _repeat /*= ETextureRepeat_Repeat*/, ionU32 _maxAnisotrpy /*= 1*/, ETextureRepeat _customRepeatU /*= ETextureRepeat_Repeat*/, ETextureRepeat _customRepeatV /*= ETextureRepeat_Repeat*/, ETextureRepeat _customRepeatW /*= ETextureRepeat_Repeat*/)
 {
-    if (_name.empty())
+    if (_name.empty() || _buffer == nullptr)
     {
         return nullptr;
     }
 
-    Texture* texture = GetTexture(_name);
-    if (texture == nullptr)
+    // the format and the levels are not in the options, the same bytes can be a different image: they seed the hash
+    const ionU32 layout[] = { static_cast<ionU32>(_format), _numLevel };
+    const ionU64 sourceHash = Tools::HashFNV1a64(_buffer, _bufferSize, Tools::HashFNV1a64(layout, sizeof(layout)));
+    const ionU64 contentKey = ComputeContentKey(sourceHash, _width, _height, Texture::BitsPerFormat(_format), _filterMin, _filterMag, _repeat, ETextureUsage_RGBA, ETextureType_2D, _maxAnisotrpy, _customRepeatU, _customRepeatV, _customRepeatW);
+
+    Texture* shared = AddContentReference(_name, contentKey);
+    if (shared != nullptr)
     {
-        texture = CreateTexture(m_vkDevice, _name);
+        return shared;
+    }
+
+    Texture* texture = PrepareTexture(_name);
+
+    texture->m_optFilterMin = _filterMin;
+    texture->m_optFilterMag = _filterMag;
+    texture->m_optCustomRepeat[0] = ConvertAddressMode(_customRepeatU);
+    texture->m_optCustomRepeat[1] = ConvertAddressMode(_customRepeatV);
+    texture->m_optCustomRepeat[2] = ConvertAddressMode(_customRepeatW);
+    texture->m_maxAnisotropy = _maxAnisotrpy;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    if (texture->CreateFromLevels(_width, _height, _format, _repeat, ETextureType_2D, _numLevel, _buffer, _bufferSize))
+    {
+        RegisterContent(texture, contentKey, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count());
+        return texture;
     }
     else
     {
-        DestroyTexture(texture);
+        return nullptr;
+    }
+}
+
+Texture* TextureManager::GenerateTexture(const ionString& _name, ionU32 _width, ionU32 _height, ETextureFormat _format, ETextureFilterMin _filterMin /*= ETextureFilterMin_Linear_MipMap_Linear*/, ETextureFilterMag _filterMag /*= ETextureFilterMag_Linear*/, ETextureRepeat _repeat/*= ETextureRepeat_Repeat*/, ETextureType _type /*= ETextureType_2D*/, ionU32 _numLevel /*= 1*/, ionU32 _maxAnisotrpy /*= 1*/, ETextureRepeat _customRepeatU /*= ETextureRepeat_Repeat*/, ETextureRepeat _customRepeatV /*= ETextureRepeat_Repeat*/, ETextureRepeat _customRepeatW /*= ETextureRepeat_Repeat*/)
+{
+    if (_name.empty())
+    {
+        return nullptr;
     }
 
+    Texture* texture = PrepareTexture(_name);
+
     texture->m_maxAnisotropy = _maxAnisotrpy;
     texture->m_optFilterMin = _filterMin;
     texture->m_optFilterMag = _filterMag;
@@ -184,7 +276,7 @@ Texture* TextureManager::GetTexture(const ionString& _name) const
         return nullptr;
     }
     
-    ionSize hash = std::hash<ionString>{}(_name);   // from the original with extension
+    ionSize hash = HashedName(_name);   // from the original with extension
 
     auto search = m_hashTexture.find(hash);
     if (search != m_hashTexture.end())
@@ -197,6 +289,122 @@ Texture* TextureManager::GetTexture(const ionString& _name) const
     }
 }
 
+ionBool TextureManager::IsFormatSupported(ETextureFormat _format) const
+{
+    if (m_vkPhysicalDevice == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    if (Texture::IsBlockCompressed(_format))
+    {
+        VkPhysicalDeviceFeatures features = {};
+        vkGetPhysicalDeviceFeatures(m_vkPhysicalDevice, &features);
+        if (features.textureCompressionBC != VK_TRUE)
+        {
+            return false;
+        }
+    }
+
+    VkFormatProperties formatProps = {};
+    vkGetPhysicalDeviceFormatProperties(m_vkPhysicalDevice, Texture::GetVulkanFormatFromTextureFormat(_format), &formatProps);
+
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (formatProps.optimalTilingFeatures & required) == required;
+}
+
+Texture* TextureManager::LoadTextureCache(const ionString& _name, const ionString& _path, ionU64 _key, ETextureFilterMin _filterMin /*= ETextureFilterMin_Linear_MipMap_Linear*/, ETextureFilterMag _filterMag /*= ETextureFilterMag_Linear*/, ETextureRepeat _repeat /*= ETextureRepeat_Clamp*/, ionU32 _maxAnisotrpy /*= 1*/)
+{
+    if (_name.empty() || _path.empty())
+    {
+        return nullptr;
+    }
+
+    std::ifstream file(_path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return nullptr;
+    }
+
+    const ionSize fileSize = static_cast<ionSize>(file.tellg());
+    if (fileSize < sizeof(TextureCacheHeader))
+    {
+        return nullptr;
+    }
+
+    file.seekg(0, std::ios::beg);
+
+    TextureCacheHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(TextureCacheHeader));
+
+    if (header.m_magic != ION_TEXTURE_CACHE_MAGIC || header.m_version != ION_TEXTURE_CACHE_VERSION || header.m_key != _key)
+    {
+        return nullptr;
+    }
+
+    if (header.m_dataSize == 0 || fileSize != sizeof(TextureCacheHeader) + header.m_dataSize)
+    {
+        return nullptr;
+    }
+
+    ionU8* levels = (ionU8*)ionNewRaw(static_cast<ionSize>(header.m_dataSize), Texture::GetAllocator());
+    file.read(reinterpret_cast<char*>(levels), static_cast<std::streamsize>(header.m_dataSize));
+    const ionBool readSucceeded = file.good();
+    file.close();
+
+    Texture* texture = nullptr;
+    if (readSucceeded)
+    {
+        texture = PrepareTexture(_name);
+
+        texture->m_maxAnisotropy = _maxAnisotrpy;
+        texture->m_optFilterMin = _filterMin;
+        texture->m_optFilterMag = _filterMag;
+
+        if (!texture->CreateFromLevels(header.m_width, header.m_height, static_cast<ETextureFormat>(header.m_format), _repeat, static_cast<ETextureType>(header.m_type), header.m_numLevels, levels, static_cast<ionSize>(header.m_dataSize)))
+        {
+            DestroyTexture(_name);
+            texture = nullptr;
+        }
+    }
+
+    ionDeleteRaw(levels, Texture::GetAllocator());
+
+    return texture;
+}
+
+ionBool TextureManager::SaveTextureCache(const ionString& _path, ionU64 _key, const Texture* _texture, const ionU8* _levels, ionSize _levelsSize) const
+{
+    if (_path.empty() || _texture == nullptr || _levels == nullptr)
+    {
+        return false;
+    }
+
+    ionAssertReturnValue(_levelsSize == _texture->GetLevelsSize(), "Levels size does not match the texture!", false);
+
+    TextureCacheHeader header = {};
+    header.m_magic = ION_TEXTURE_CACHE_MAGIC;
+    header.m_version = ION_TEXTURE_CACHE_VERSION;
+    header.m_key = _key;
+    header.m_width = static_cast<ionU32>(_texture->GetWidth());
+    header.m_height = static_cast<ionU32>(_texture->GetHeight());
+    header.m_numLevels = _texture->GetNumLevels();
+    header.m_type = static_cast<ionU32>(_texture->GetTextureType());
+    header.m_format = static_cast<ionU32>(_texture->GetTextureFormat());
+    header.m_dataSize = _levelsSize;
+
+    const ionSize fileSize = sizeof(TextureCacheHeader) + _levelsSize;
+    ionU8* fileData = (ionU8*)ionNewRaw(fileSize, Texture::GetAllocator());
+    MemUtils::MemCpy(fileData, &header, sizeof(TextureCacheHeader));
+    MemUtils::MemCpy(fileData + sizeof(TextureCacheHeader), _levels, _levelsSize);
+
+    const ionBool result = ionFileSystemManager().WriteFileAtomic(_path, fileData, fileSize);
+
+    ionDeleteRaw(fileData, Texture::GetAllocator());
+
+    return result;
+}
+
 ionBool TextureManager::SaveTexture(const ionString& _path, const Texture* _texture) const
 {
     if (_path.empty() || _texture == nullptr)
@@ -209,7 +417,7 @@ ionBool TextureManager::SaveTexture(const ionString& _path, const Texture* _text
 
 void TextureManager::DestroyTexture(const ionString& _name)
 {
-    ionSize hash = std::hash<ionString>{}(_name);
+    ionSize hash = HashedName(_name);
     DestroyTexture(hash);
 }
 
@@ -220,7 +428,7 @@ Texture* TextureManager::CreateTexture(VkDevice _vkDevice, const ionString& _nam
         return nullptr;
     }
 
-    ionSize hash = std::hash<ionString>{}(_name);
+    ionSize hash = HashedName(_name);
 
     // just to inform the user
     auto search = m_hashTexture.find(hash);
@@ -238,12 +446,316 @@ void TextureManager::DestroyTexture(ionSize _hash)
     auto search = m_hashTexture.find(_hash);
     if (search != m_hashTexture.end())
     {
-        DestroyTexture(search->second);
-        ionDelete(search->second, Texture::GetAllocator());
+        Texture* texture = search->second;
         m_hashTexture.erase(_hash);
+
+        if (ReleaseTexture(texture))
+        {
+            RemoveResident(texture);
+            DestroyTexture(texture);
+            ionDelete(texture, Texture::GetAllocator());
+        }
     }
 }
 
+ionU64 TextureManager::ComputeContentKey(ionU64 _sourceHash, ionU32 _width, ionU32 _height, ionU32 _component, ETextureFilterMin _filterMin, ETextureFilterMag _filterMag, ETextureRepeat _repeat, ETextureUsage _usage, ETextureType _type, ionU32 _maxAnisotrpy, ETextureRepeat _customRepeatU, ETextureRepeat _customRepeatV, ETextureRepeat _customRepeatW) const
+{
+    // the sampler is owned by the texture, so the options are part of the identity as well
+    const ionS32 options[] = 
+    { 
+        static_cast<ionS32>(_width), static_cast<ionS32>(_height), static_cast<ionS32>(_component),
+        _filterMin, _filterMag, _repeat, _usage, _type, static_cast<ionS32>(_maxAnisotrpy),
+        _customRepeatU, _customRepeatV, _customRepeatW 
+    };
+
+    const ionU64 key = Tools::HashFNV1a64(options, sizeof(options), _sourceHash);
+    return key != 0 ? key : 1;
+}
+
+Texture* TextureManager::AddContentReference(const ionString& _name, ionU64 _contentKey)
+{
+    auto search = m_contentTexture.find(_contentKey);
+    if (search == m_contentTexture.end())
+    {
+        return nullptr;
+    }
+
+    TextureContentEntry& entry = search->second;
+
+    Texture* current = GetTexture(_name);
+    if (current == entry.m_texture)
+    {
+        return current;     // same name and same content, nothing to do
+    }
+
+    if (current != nullptr)
+    {
+        DestroyTexture(_name);
+    }
+
+    m_hashTexture[HashedName(_name)] = entry.m_texture;
+    ++entry.m_refCount;
+
+    ++m_statistics.m_sharedReferences;
+    m_statistics.m_savedVideoMemory += entry.m_texture->GetLevelsSize();
+    m_statistics.m_savedLoadMicroseconds += entry.m_loadMicroseconds;
+
+    return entry.m_texture;
+}
+
+void TextureManager::RegisterContent(Texture* _texture, ionU64 _contentKey, ionU64 _loadMicroseconds)
+{
+    TextureContentEntry entry;
+    entry.m_texture = _texture;
+    entry.m_loadMicroseconds = _loadMicroseconds;
+    entry.m_refCount = 1;
+
+    _texture->m_contentKey = _contentKey;
+    m_contentTexture[_contentKey] = entry;
+
+    ++m_statistics.m_uniqueTextures;
+}
+
+Texture* TextureManager::PrepareTexture(const ionString& _name)
+{
+    Texture* texture = GetTexture(_name);
+
+    // never overwrite a texture shared by content: detach this name and create a new one
+    if (texture != nullptr && texture->m_contentKey != 0)
+    {
+        DestroyTexture(_name);
+        texture = nullptr;
+    }
+
+    if (texture == nullptr)
+    {
+        texture = CreateTexture(m_vkDevice, _name);
+    }
+    else
+    {
+        DestroyTexture(texture);
+    }
+
+    return texture;
+}
+
+ionBool TextureManager::ReleaseTexture(Texture* _texture)
+{
+    if (_texture == nullptr || _texture->m_contentKey == 0)
+    {
+        return true;
+    }
+
+    auto search = m_contentTexture.find(_texture->m_contentKey);
+    if (search == m_contentTexture.end())
+    {
+        return true;
+    }
+
+    if (--search->second.m_refCount > 0)
+    {
+        return false;
+    }
+
+    m_contentTexture.erase(search);
+    _texture->m_contentKey = 0;
+
+    return true;
+}
+
+void TextureManager::RemoveResident(Texture* _texture)
+{
+    if (_texture->m_lastUsedFrame == 0)
+    {
+        return;
+    }
+
+    auto search = std::find(m_residentTextures.begin(), m_residentTextures.end(), _texture);
+    if (search != m_residentTextures.end())
+    {
+        m_residentTextures.erase(search);
+    }
+}
+
+void TextureManager::MarkTextureUsed(const Texture* _texture, ionFloat _screenSize /*= 0.0f*/)
+{
+    if (_texture == nullptr)
+    {
+        return;
+    }
+
+    // the residency state is not part of the logical state of the texture
+    Texture* texture = const_cast<Texture*>(_texture);
+
+    if (texture->m_lastUsedFrame == 0)
+    {
+        m_residentTextures.push_back(texture);
+    }
+    texture->m_lastUsedFrame = m_residencyFrame;
+
+    if (texture->m_isStreamed && _screenSize > 0.0f)
+    {
+        const ionU32 level = texture->ComputeStreamingLevel(_screenSize);
+        if (texture->m_requestedFrame != m_residencyFrame || level < texture->m_requestedLevel)
+        {
+            texture->m_requestedLevel = level;
+        }
+        texture->m_requestedFrame = m_residencyFrame;
+    }
+
+    // the upload goes through the staging buffer, submitted when the frame starts
+    if (!texture->IsResident() && texture->IsEvictable())
+    {
+        if (texture->Reload())
+        {
+            ++m_statistics.m_reloads;
+        }
+    }
+}
+
+void TextureManager::StreamTexture(Texture* _texture, ionU32 _level)
+{
+    // the frames in flight can still sample the current image: keep it alive until they are done
+    PendingRelease pending;
+    pending.m_allocation = _texture->m_allocation;
+    pending.m_image = _texture->m_image;
+    pending.m_view = _texture->m_view;
+    pending.m_sampler = _texture->m_sampler;
+    pending.m_frame = m_residencyFrame;
+    m_pendingReleases.push_back(pending);
+
+    _texture->m_allocation = GpuMemoryAllocation();
+    _texture->m_image = VK_NULL_HANDLE;
+    _texture->m_view = VK_NULL_HANDLE;
+    _texture->m_sampler = VK_NULL_HANDLE;
+
+    // the resident levels are copied from the current image, only the missing finer ones come from the source levels of the texture
+    if (_texture->StreamLevels(pending.m_image, _texture->m_streamedLevel, _level))
+    {
+        ++m_statistics.m_streamingUpdates;
+    }
+}
+
+void TextureManager::ReleasePending(ionBool _force)
+{
+    // same delay of the eviction: more frames than the ones in flight
+    static const ionU64 kReleaseDelayFrames = 4;
+
+    for (auto it = m_pendingReleases.begin(); it != m_pendingReleases.end();)
+    {
+        if (!_force && it->m_frame + kReleaseDelayFrames > m_residencyFrame)
+        {
+            ++it;
+            continue;
+        }
+
+        m_samplerCache.Release(it->m_sampler);
+        vkDestroyImageView(m_vkDevice, it->m_view, vkMemory);
+        vkDestroyImage(m_vkDevice, it->m_image, vkMemory);
+        ionGPUMemoryManager().Free(it->m_allocation);
+
+        it = m_pendingReleases.erase(it);
+    }
+
+    m_mipMapGenerator.ReleasePending(m_residencyFrame, _force);
+    m_bindlessTextureTable.ReleasePending(m_residencyFrame, _force);
+}
+
+void TextureManager::UpdateStreaming()
+{
+    ReleasePending(false);
+
+    if (!m_mipStreaming)
+    {
+        return;
+    }
+
+    struct StreamingRequest
+    {
+        Texture*    m_texture;
+        ionU32      m_level;
+        ionU32      m_priority;
+    };
+
+    ionVector<StreamingRequest, TextureManagerAllocator, GetAllocator> requests;
+    for (Texture* texture : m_residentTextures)
+    {
+        if (!texture->m_isStreamed || !texture->IsResident() || texture->m_requestedFrame != m_residencyFrame)
+        {
+            continue;
+        }
+
+        const ionU32 current = texture->m_streamedLevel;
+        const ionU32 wanted = texture->m_requestedLevel;
+
+        // finer levels are loaded as soon as needed, coarser only when 2 levels away to avoid the ping pong on the boundary
+        if (wanted < current)
+        {
+            requests.push_back({ texture, wanted, (current - wanted) * 2 });
+        }
+        else if (wanted > current + 1)
+        {
+            requests.push_back({ texture, wanted, wanted - current });
+        }
+    }
+
+    // the biggest visible error first, the missing details before the memory savings
+    std::sort(requests.begin(), requests.end(), [](const StreamingRequest& _a, const StreamingRequest& _b) { return _a.m_priority > _b.m_priority; });
+
+    const ionSize count = std::min(requests.size(), static_cast<ionSize>(m_streamingUploadsPerFrame));
+    for (ionSize i = 0; i < count; ++i)
+    {
+        StreamTexture(requests[i].m_texture, requests[i].m_level);
+    }
+}
+
+void TextureManager::UpdateResidency()
+{
+    // a texture not used for more frames than the ones in flight is not referenced anymore by any command buffer
+    static const ionU64 kEvictionDelayFrames = 4;
+
+    m_residentSize = 0;
+    for (Texture* texture : m_residentTextures)
+    {
+        if (texture->IsResident())
+        {
+            m_residentSize += static_cast<ionSize>(texture->GetAllocationSize());
+        }
+    }
+
+    if (m_residencyBudget > 0 && m_residentSize > m_residencyBudget)
+    {
+        // least recently used first
+        ionVector<Texture*, TextureManagerAllocator, GetAllocator> candidates;
+        for (Texture* texture : m_residentTextures)
+        {
+            if (texture->IsResident() && texture->IsEvictable() && texture->m_lastUsedFrame + kEvictionDelayFrames <= m_residencyFrame)
+            {
+                candidates.push_back(texture);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const Texture* _a, const Texture* _b) { return _a->m_lastUsedFrame < _b->m_lastUsedFrame; });
+
+        for (Texture* texture : candidates)
+        {
+            if (m_residentSize <= m_residencyBudget)
+            {
+                break;
+            }
+
+            m_residentSize -= static_cast<ionSize>(texture->GetAllocationSize());
+            texture->Destroy();
+            // the reload decodes the file again
+            texture->ReleaseSourceLevels();
+
+            ++m_statistics.m_evictions;
+        }
+    }
+
+    ++m_residencyFrame;
+}
+
 void TextureManager::DestroyTexture(Texture* _texture)
 {
     if (_texture != nullptr)
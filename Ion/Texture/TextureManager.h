@@ -13,6 +13,9 @@
 
 #include "TextureCommon.h"
 #include "Texture.h"
+#include "SamplerCache.h"
+#include "MipMapGenerator.h"
+#include "BindlessTextureTable.h"
 
 #include "../Core/MemorySettings.h"
 
@@ -28,6 +31,17 @@ using TextureManagerAllocator = MemoryAllocator<FreeListBestSearchAllocationPoli
 
 class RenderCore;
 
+struct TextureStatistics
+{
+    ionU32  m_uniqueTextures;           // textures created from file or buffer and shared by content
+    ionU32  m_sharedReferences;         // requests satisfied by a texture already loaded with the same content
+    ionU64  m_savedVideoMemory;         // bytes not allocated thanks to the sharing
+    ionU64  m_savedLoadMicroseconds;    // decode and upload time not spent thanks to the sharing
+    ionU32  m_evictions;                // textures destroyed on the GPU to stay under the residency budget
+    ionU32  m_reloads;                  // evicted textures loaded again because used by a draw
+    ionU32  m_streamingUpdates;         // streamed textures recreated with a different first level
+};
+
 class ION_DLL TextureManager final
 {
 public:
@@ -39,7 +53,8 @@ public:
     TextureManager();
     ~TextureManager();
 
-    void        Init(VkDevice _vkDevice, ETextureSamplesPerBit _textureSample);
+    // _bindlessTextureCount is the device limit of the bindless table, 0 to disable it
+    void        Init(VkPhysicalDevice _vkPhysicalDevice, VkDevice _vkDevice, ionS32 _vkQueueFamilyIndex, ETextureSamplesPerBit _textureSample, ionU32 _bindlessTextureCount = 0);
     void        Shutdown();
 
     void        SetDepthFormat(VkFormat _depthFormat) { m_depthFormat = _depthFormat; }
@@ -50,10 +65,20 @@ public:
 
     Texture*    CreateTextureFromFile(const ionString& _name, const ionString& _path, ETextureFilterMin _filterMin = ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag _filterMag = ETextureFilterMag_Linear, ETextureRepeat _repeat = ETextureRepeat_Repeat, ETextureUsage _usage = ETextureUsage_RGBA, ETextureType _type = ETextureType_2D, ionU32 _maxAnisotrpy = 1, ETextureRepeat _customRepeatU = ETextureRepeat_Repeat, ETextureRepeat _customRepeatV = ETextureRepeat_Repeat, ETextureRepeat _customRepeatW = ETextureRepeat_Repeat);
     Texture*    CreateTextureFromBuffer(const ionString& _name, ionU32 _width, ionU32 _height, ionU32 _component, const ionU8* _buffer, VkDeviceSize _bufferSize, ETextureFilterMin _filterMin = ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag _filterMag = ETextureFilterMag_Linear, ETextureRepeat _repeat = ETextureRepeat_Repeat, ETextureUsage _usage = ETextureUsage_RGBA, ETextureType _type = ETextureType_2D, ionU32 _maxAnisotrpy = 1, ETextureRepeat _customRepeatU = ETextureRepeat_Repeat, ETextureRepeat _customRepeatV = ETextureRepeat_Repeat, ETextureRepeat _customRepeatW = ETextureRepeat_Repeat);
+    // Levels prepared by the caller (e.g. transcoded), laid out as described in Texture::GetLevelsSize. Shared by content as the buffers
+    Texture*    CreateTextureFromLevels(const ionString& _name, ionU32 _width, ionU32 _height, ETextureFormat _format, ionU32 _numLevel, const ionU8* _buffer, ionSize _bufferSize, ETextureFilterMin _filterMin = ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag _filterMag = ETextureFilterMag_Linear, ETextureRepeat _repeat = ETextureRepeat_Repeat, ionU32 _maxAnisotrpy = 1, ETextureRepeat _customRepeatU = ETextureRepeat_Repeat, ETextureRepeat _customRepeatV = ETextureRepeat_Repeat, ETextureRepeat _customRepeatW = ETextureRepeat_Repeat);
     Texture*    GenerateTexture(const ionString& _name, ionU32 _width, ionU32 _height, ETextureFormat _format, ETextureFilterMin _filterMin = ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag _filterMag = ETextureFilterMag_Linear, ETextureRepeat _repeat = ETextureRepeat_Repeat, ETextureType _type = ETextureType_2D, ionU32 _numLevel = 1, ionU32 _maxAnisotrpy = 1, ETextureRepeat _customRepeatU = ETextureRepeat_Repeat, ETextureRepeat _customRepeatV = ETextureRepeat_Repeat, ETextureRepeat _customRepeatW = ETextureRepeat_Repeat);
 
     Texture*    GetTexture(const ionString& _name) const;
 
+    // true when a 2D texture of _format can be sampled on this device
+    ionBool     IsFormatSupported(ETextureFormat _format) const;
+
+    // Cache of texture generated at runtime (all levels and layers), the key must identify uniquely the content (source hash and generation parameters)
+    // Load returns nullptr if the file is missing, stale (key or version mismatch) or corrupted
+    Texture*    LoadTextureCache(const ionString& _name, const ionString& _path, ionU64 _key, ETextureFilterMin _filterMin = ETextureFilterMin_Linear_MipMap_Linear, ETextureFilterMag _filterMag = ETextureFilterMag_Linear, ETextureRepeat _repeat = ETextureRepeat_Clamp, ionU32 _maxAnisotrpy = 1);
+    ionBool     SaveTextureCache(const ionString& _path, ionU64 _key, const Texture* _texture, const ionU8* _levels, ionSize _levelsSize) const;
+
     ionBool     SaveTexture(const ionString& _path, const Texture* _texture) const;
 
     void        GenerateMipMaps(Texture* _texture);
@@ -63,6 +88,32 @@ public:
 
     const ETextureSamplesPerBit& GetMainSamplePerBits() const { return m_mainSamplesPerBit; }
 
+    const TextureStatistics& GetStatistics() const { return m_statistics; }
+
+    SamplerCache& GetSamplerCache() { return m_samplerCache; }
+    MipMapGenerator& GetMipMapGenerator() { return m_mipMapGenerator; }
+    BindlessTextureTable& GetBindlessTextureTable() { return m_bindlessTextureTable; }
+    ionBool     IsBindlessEnabled() const { return m_bindlessTextureTable.IsEnabled(); }
+
+    // Residency budget in bytes of video memory for the textures used by the draws, 0 (default) means unlimited.
+    // When over budget the least recently used textures loaded from file are evicted, and reloaded when used again.
+    void        SetResidencyBudget(ionSize _budget) { m_residencyBudget = _budget; }
+    ionSize     GetResidencyBudget() const { return m_residencyBudget; }
+    ionSize     GetResidentSize() const { return m_residentSize; }
+
+    // Mip streaming of the 2D textures loaded from file (disabled by default, it affects only the textures loaded after enabling it).
+    // They start with the levels up to ION_TEXTURE_STREAMING_INITIAL_SIZE and are recreated with the first level needed by the draws,
+    // at most _uploadsPerFrame textures per frame. The file is decoded only once: a step copies the resident levels on the GPU and uploads only the missing ones.
+    void        SetMipStreaming(ionBool _enabled, ionU32 _uploadsPerFrame = 2) { m_mipStreaming = _enabled; m_streamingUploadsPerFrame = _uploadsPerFrame; }
+    ionBool     IsMipStreamingEnabled() const { return m_mipStreaming; }
+
+    // called for every texture bound by a visible draw, before the frame starts
+    // _screenSize is the size in pixels of the whole UV range on screen, 0 if unknown (no streaming request)
+    void        MarkTextureUsed(const Texture* _texture, ionFloat _screenSize = 0.0f);
+    // called once per frame, after all the textures used has been marked, streaming first
+    void        UpdateStreaming();
+    void        UpdateResidency();
+
 private:
     VkSamplerAddressMode ConvertAddressMode(ETextureRepeat _repeat);
 
@@ -70,9 +121,52 @@ private:
     void        DestroyTexture(Texture* _texture);
     void        DestroyTexture(ionSize _hash);          // this one actually destroy/delete the texture!
 
+    // Textures loaded from file or buffer are indexed by content (source bytes and options) as well, so different names
+    // can point to the same Texture. The texture is destroyed when the last name referencing it is destroyed.
+    ionU64      ComputeContentKey(ionU64 _sourceHash, ionU32 _width, ionU32 _height, ionU32 _component, ETextureFilterMin _filterMin, ETextureFilterMag _filterMag, ETextureRepeat _repeat, ETextureUsage _usage, ETextureType _type, ionU32 _maxAnisotrpy, ETextureRepeat _customRepeatU, ETextureRepeat _customRepeatV, ETextureRepeat _customRepeatW) const;
+    Texture*    AddContentReference(const ionString& _name, ionU64 _contentKey);
+    void        RegisterContent(Texture* _texture, ionU64 _contentKey, ionU64 _loadMicroseconds);
+    Texture*    PrepareTexture(const ionString& _name);
+    ionBool     ReleaseTexture(Texture* _texture);     // true when nobody else reference it and has to be deleted
+    void        RemoveResident(Texture* _texture);
+    void        StreamTexture(Texture* _texture, ionU32 _level);
+    void        ReleasePending(ionBool _force);
+
 private:
+    VkPhysicalDevice    m_vkPhysicalDevice;
     VkDevice    m_vkDevice;
+    struct TextureContentEntry
+    {
+        Texture*    m_texture;
+        ionU64      m_loadMicroseconds;
+        ionU32      m_refCount;
+    };
+
     ionMap<ionSize, Texture*, TextureManagerAllocator, GetAllocator> m_hashTexture;
+    ionMap<ionU64, TextureContentEntry, TextureManagerAllocator, GetAllocator> m_contentTexture;
+    ionVector<Texture*, TextureManagerAllocator, GetAllocator> m_residentTextures;     // textures used at least once by a draw
+
+    // GPU objects replaced by the streaming, still used by the frames in flight
+    struct PendingRelease
+    {
+        GpuMemoryAllocation m_allocation;
+        VkImage             m_image;
+        VkImageView         m_view;
+        VkSampler           m_sampler;
+        ionU64              m_frame;
+    };
+    ionVector<PendingRelease, TextureManagerAllocator, GetAllocator> m_pendingReleases;
+
+    SamplerCache            m_samplerCache;
+    MipMapGenerator         m_mipMapGenerator;
+    BindlessTextureTable    m_bindlessTextureTable;
+    TextureStatistics       m_statistics;
+
+    ionSize                 m_residencyBudget;
+    ionSize                 m_residentSize;
+    ionU64                  m_residencyFrame;
+    ionU32                  m_streamingUploadsPerFrame;
+    ionBool                 m_mipStreaming;
 
     ETextureSamplesPerBit   m_mainSamplesPerBit;
     VkFormat                m_depthFormat;
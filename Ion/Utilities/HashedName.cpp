@@ -0,0 +1,69 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Utilities\HashedName.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#include "HashedName.h"
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+namespace
+{
+    // the names are only added, never removed: the strings returned by GetName stay valid
+    struct NameTable
+    {
+        std::mutex  m_mutex;
+        ionMap<ionSize, ionString, HashedNameAllocator, HashedName::GetAllocator> m_names;
+    };
+
+    NameTable& GetNameTable()
+    {
+        static NameTable table;
+        return table;
+    }
+}
+
+HashedNameAllocator* HashedName::GetAllocator()
+{
+    static HeapArea<Settings::kHashedNameAllocatorSize> memoryArea;
+    static HashedNameAllocator memoryAllocator(memoryArea, "HashedNameFreeListAllocator");
+
+    return &memoryAllocator;
+}
+
+HashedName HashedName::Intern(const ionString& _name)
+{
+    const HashedName name(_name);
+
+    NameTable& table = GetNameTable();
+    std::lock_guard<std::mutex> lock(table.m_mutex);
+
+    auto search = table.m_names.find(name.GetHash());
+    if (search == table.m_names.end())
+    {
+        table.m_names.insert(std::make_pair(name.GetHash(), _name));
+    }
+    else
+    {
+        ionAssert(search->second == _name, "Hash collision between the names " << search->second.c_str() << " and " << _name.c_str());
+    }
+
+    return name;
+}
+
+const ionString& HashedName::GetName(ionSize _hash)
+{
+    static const ionString empty;
+
+    NameTable& table = GetNameTable();
+    std::lock_guard<std::mutex> lock(table.m_mutex);
+
+    auto search = table.m_names.find(_hash);
+    return search != table.m_names.end() ? search->second : empty;
+}
+
+ION_NAMESPACE_END
@@ -0,0 +1,105 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Utilities\HashedName.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+#include "../Core/CoreDefs.h"
+#include "../Core/StandardIncludes.h"
+
+#include "../Dependencies/Eos/Eos/Eos.h"
+#include "../Core/MemoryWrapper.h"
+
+#include "../Core/MemorySettings.h"
+
+#include "Tools.h"
+
+
+// the hash of a literal, forced to be computed at compile time
+#define ION_HASHED_NAME(name)   (std::integral_constant<ionU64, ion::Tools::HashName(name)>::value)
+
+
+EOS_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+
+using HashedNameAllocator = MemoryAllocator<FreeListBestSearchAllocationPolicy, MultiThreadPolicy, MemoryBoundsCheck, MemoryTag, MemoryLog>;
+
+
+namespace Tools
+{
+    // FNV-1a of a null terminated name, the same value of HashFNV1a64 on its characters and of std::hash<ionString> on x64,
+    // so the hashes computed at compile time on the literals match the ones computed at load time on the strings
+    constexpr ionU64 HashName(const char* _name, ionU64 _seed = kFNV1aOffset64)
+    {
+        ionU64 hash = _seed;
+        for (; *_name != '\0'; ++_name)
+        {
+            hash ^= static_cast<ionU64>(static_cast<ionU8>(*_name));
+            hash *= kFNV1aPrime64;
+        }
+        return hash;
+    }
+
+    // The name of an element of an array is the name of the array followed by the index, as UniformBinding::AddParameter does:
+    // its hash continues the one of the name of the array with the decimal digits, without building the string
+    constexpr ionU64 HashNameIndex(ionU64 _nameHash, ionU32 _index)
+    {
+        ionU32 divisor = 1;
+        while (_index / divisor >= 10)
+        {
+            divisor *= 10;
+        }
+
+        ionU64 hash = _nameHash;
+        for (; divisor > 0; divisor /= 10)
+        {
+            hash ^= static_cast<ionU64>('0' + (_index / divisor) % 10);
+            hash *= kFNV1aPrime64;
+        }
+        return hash;
+    }
+}
+
+// A name reduced to its hash, the key of the render parameters and of the resources in the managers.
+// Built from a literal is computed at compile time, so the render loop never builds nor hashes a string.
+// The names built at runtime can be interned, to get back the string from the hash (logs, debug, serialization)
+class ION_DLL HashedName final
+{
+public:
+    static HashedNameAllocator* GetAllocator();
+
+    // keep the string in the table, once per name
+    static HashedName Intern(const ionString& _name);
+
+    // empty if the name has never been interned
+    static const ionString& GetName(ionSize _hash);
+
+    static constexpr HashedName FromHash(ionSize _hash)
+    {
+        HashedName name;
+        name.m_hash = _hash;
+        return name;
+    }
+
+public:
+    constexpr HashedName() : m_hash(0) {}
+    constexpr explicit HashedName(const char* _name) : m_hash(static_cast<ionSize>(Tools::HashName(_name))) {}
+    explicit HashedName(const ionString& _name) : m_hash(static_cast<ionSize>(Tools::HashName(_name.c_str()))) {}
+
+    constexpr ionSize GetHash() const { return m_hash; }
+    constexpr operator ionSize() const { return m_hash; }
+
+    // the element _index of the array with this name
+    constexpr HashedName GetElement(ionU32 _index) const { return FromHash(static_cast<ionSize>(Tools::HashNameIndex(m_hash, _index))); }
+
+    constexpr ionBool operator==(const HashedName& _other) const { return m_hash == _other.m_hash; }
+    constexpr ionBool operator!=(const HashedName& _other) const { return m_hash != _other.m_hash; }
+
+private:
+    ionSize     m_hash;
+};
+
+ION_NAMESPACE_END
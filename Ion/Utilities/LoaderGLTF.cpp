@@ -5,9 +5,13 @@
 
 #include "LoaderGLTF.h"
 
+#include <atomic>
+#include <thread>
+
 #include "../Scene/Entity.h"
 
 #include "../Texture/TextureManager.h"
+#include "../Texture/BasisTranscoder.h"
 #include "../Material/MaterialManager.h"
 
 #include "../Dependencies/Eos/Eos/Eos.h"
@@ -59,6 +63,35 @@ LoaderGLTF::~LoaderGLTF()
 }
 
 
+// KTX2 container, used by KHR_texture_basisu
+static const char* kKTX2MimeType = "image/ktx2";
+
+// The stb loader fails on KTX2 and tinygltf then fails the whole model: keep the file as it is, it is transcoded by the texture pass
+bool LoadImageDataKTX2Aware(tinygltf::Image* _image, std::string* _err, int _reqWidth, int _reqHeight, const unsigned char* _bytes, int _size, void* _userData)
+{
+    // identifier, vkFormat, typeSize, pixelWidth, pixelHeight
+    if (_size >= 28 && BasisTranscoder::IsKTX2(_bytes, static_cast<ionSize>(_size)))
+    {
+        _image->width = static_cast<int>(_bytes[20] | (_bytes[21] << 8) | (_bytes[22] << 16) | (_bytes[23] << 24));
+        _image->height = static_cast<int>(_bytes[24] | (_bytes[25] << 8) | (_bytes[26] << 16) | (_bytes[27] << 24));
+        _image->component = 4;
+        _image->mimeType = kKTX2MimeType;
+        _image->image.assign(_bytes, _bytes + _size);
+
+        return true;
+    }
+
+    return tinygltf::LoadImageData(_image, _err, _reqWidth, _reqHeight, _bytes, _size, _userData);
+}
+
+struct BasisTranscodeJob
+{
+    ionS32                  m_image;
+    ionBool                 m_transcoded;
+    BasisTranscodedImage    m_result;
+};
+
+
 void UpdateBoundingBox(Node* _node, BoundingBox& _mainBoundingBoxToUpdate)
 {
     if (_node->GetNodeType() == ENodeType_Entity)
@@ -85,6 +118,37 @@ void UpdateBoundingBox(Node* _node, BoundingBox& _mainBoundingBoxToUpdate)
     }
 }
 
+void DeduplicateMaterials(Node* _node)
+{
+    if (_node->GetNodeType() == ENodeType_Entity)
+    {
+        Entity* entity = dynamic_cast<Entity*>(_node);
+
+        const ionU32 meshCount = entity->GetMeshCount();
+        for (ionU32 i = 0; i < meshCount; ++i)
+        {
+            Mesh* mesh = entity->GetMesh(i);
+            if (mesh->GetMaterial() != nullptr)
+            {
+                mesh->SetMaterial(ionMaterialManger().Deduplicate(mesh->GetMaterial()));
+            }
+        }
+    }
+
+    if (_node->GetChildren().empty())
+    {
+        return;
+    }
+
+    const ionVector<Node*, NodeAllocator, Node::GetAllocator>& children = _node->GetChildren();
+    ionVector<Node*, NodeAllocator, Node::GetAllocator>::const_iterator begin = children.cbegin(), end = children.cend(), it = begin;
+    for (; it != end; ++it)
+    {
+        Node* nh = (*it);
+        DeduplicateMaterials(nh);
+    }
+}
+
 // for some reasons, tinygltf must be declared in source file: I was unable to declare any of its structures in header file
 void LoadNode(const tinygltf::Node& _node, const tinygltf::Model& _model, MeshRenderer* _meshRenderer, Node*& _entityHandle, ionMap<ionU32, Node*, LoaderGLTFAllocator, LoaderGLTF::GetAllocator>& _nodeIndexToNodePointer, ionMap<ionS32, ionString, LoaderGLTFAllocator, LoaderGLTF::GetAllocator>& _textureIndexToTextureName, ionMap<ionS32, ionString, LoaderGLTFAllocator, LoaderGLTF::GetAllocator>& _materialIndexToMaterialName
     /*, ionBool _generateNormalWhenMissing, ionBool _generateTangentWhenMissing, ionBool _setBitangentSign*/)
@@ -814,11 +878,19 @@ void LoadNode(const tinygltf::Node& _node, const tinygltf::Model& _model, MeshRe
                     {
                         ionU32 bindingIndex = 0;
 
+                        // the constants are read from the buffer of the material manager while it has free slots, so only the draw constants are pushed.
+                        // Otherwise the model matrix is pushed after the constants, unless they do not fit in the push constants of the device
+                        const ionBool useConstantsBuffer = !usingMorphTarget && material->SetConstantsBufferBinding(ION_PBR_CONSTANTS_BUFFER_BINDING);
+                        const ionBool pushDrawConstants = useConstantsBuffer || ION_PBR_DRAW_CONSTANTS_OFFSET + sizeof(DrawConstants) <= ionShaderProgramManager().GetMaxPushConstantsSize();
+
                         //
                         UniformBinding uniformVertex;
                         uniformVertex.m_bindingIndex = bindingIndex++;
-                        uniformVertex.m_parameters.push_back(ION_MODEL_MATRIX_PARAM);
-                        uniformVertex.m_type.push_back(EBufferParameterType_Matrix);
+                        if (!pushDrawConstants)
+                        {
+                            uniformVertex.m_parameters.push_back(ION_MODEL_MATRIX_PARAM);
+                            uniformVertex.m_type.push_back(EBufferParameterType_Matrix);
+                        }
                         uniformVertex.m_parameters.push_back(ION_VIEW_MATRIX_PARAM);
                         uniformVertex.m_type.push_back(EBufferParameterType_Matrix);
                         uniformVertex.m_parameters.push_back(ION_PROJ_MATRIX_PARAM);
@@ -851,11 +923,15 @@ void LoadNode(const tinygltf::Node& _node, const tinygltf::Model& _model, MeshRe
                         uniformFragment.m_type.push_back(EBufferParameterType_Float);
                         uniformFragment.m_parameters.push_back(ION_PREFILTERED_CUBE_MIP_LEVELS_FLOAT_PARAM);
                         uniformFragment.m_type.push_back(EBufferParameterType_Float);
+                        uniformFragment.m_parameters.push_back(ION_USE_IRRADIANCE_SH_FLOAT_PARAM);
+                        uniformFragment.m_type.push_back(EBufferParameterType_Float);
+                        uniformFragment.AddParameter(ION_IRRADIANCE_SH_VECTOR_ARRAY_PARAM, EBufferParameterType_Vector, ION_SH_COEFFICIENTS_COUNT);
 
                         //
                         SamplerBinding samplerIrradiance;
                         samplerIrradiance.m_bindingIndex = bindingIndex++;
-                        samplerIrradiance.m_texture = ionRenderManager().GetIrradianceCubemap();
+                        // with the spherical harmonics the irradiance cube map is not sampled and could be missing, bind any valid cube map
+                        samplerIrradiance.m_texture = ionRenderManager().IsUsingIrradianceSH() ? ionRenderManager().GetPrefilteredEnvironmentCubemap() : ionRenderManager().GetIrradianceCubemap();
 
                         SamplerBinding prefilteredMap;
                         prefilteredMap.m_bindingIndex = bindingIndex++;
@@ -974,17 +1050,34 @@ void LoadNode(const tinygltf::Node& _node, const tinygltf::Model& _model, MeshRe
                         material->SetVertexLayout(_meshRenderer->GetLayout());
                         material->SetConstantsShaders(constants);
 
+                        if (useConstantsBuffer)
+                        {
+                            // the fragment shader indexes the buffer by the material index of the draw constants
+                            ionAssert(bindingIndex == ION_PBR_CONSTANTS_BUFFER_BINDING, "The constants buffer of the PBR material does not follow its samplers!");
+                            material->SetDrawConstantsStages(static_cast<EPushConstantStage>(EPushConstantStage_Vertex | EPushConstantStage_Fragment));
+                        }
+                        else if (pushDrawConstants)
+                        {
+                            material->SetDrawConstantsStages(EPushConstantStage_Vertex);
+                            ionAssert(material->GetDrawConstantsOffset() == ION_PBR_DRAW_CONSTANTS_OFFSET, "The constants of the PBR material do not match the draw constants offset of its vertex shaders!");
+                        }
+
                         ionS32 vertexShaderIndex = -1;
                         ionS32 fragmentShaderIndex = -1;
 
                         if (usingMorphTarget)
                         {
-                            vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_PBR_MORPH_SHADER_NAME, EShaderStage_Vertex);
+                            vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), pushDrawConstants ? ION_PBR_MORPH_DRAW_SHADER_NAME : ION_PBR_MORPH_SHADER_NAME, EShaderStage_Vertex);
                             fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_PBR_MORPH_SHADER_NAME, EShaderStage_Fragment);
                         }
+                        else if (useConstantsBuffer)
+                        {
+                            vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_PBR_BUFFER_SHADER_NAME, EShaderStage_Vertex);
+                            fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_PBR_BUFFER_SHADER_NAME, EShaderStage_Fragment);
+                        }
                         else
                         {
-                            vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_PBR_SHADER_NAME, EShaderStage_Vertex);
+                            vertexShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), pushDrawConstants ? ION_PBR_DRAW_SHADER_NAME : ION_PBR_SHADER_NAME, EShaderStage_Vertex);
                             fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_PBR_SHADER_NAME, EShaderStage_Fragment);
                         }
 
@@ -1092,6 +1185,14 @@ void LoadNode(const tinygltf::Node& _node, const tinygltf::Model& _model, MeshRe
                     material->SetVertexLayout(_meshRenderer->GetLayout());
                     material->SetConstantsShaders(constants);
 
+                    // the unlit material reads its textures from the bindless table when the device supports it
+                    const ionBool bindlessTextures = !usingMorphTarget && !material->IsDiffuseLight() && ionTextureManger().IsBindlessEnabled();
+                    if (bindlessTextures)
+                    {
+                        material->SetBindlessTexturesStages(EPushConstantStage_Fragment);
+                        ionAssert(material->GetBindlessTexturesOffset() == ION_UNLIT_BINDLESS_TEXTURES_OFFSET, "The constants of the unlit material do not match the texture indices offset of its fragment shader!");
+                    }
+
                     ionS32 vertexShaderIndex = -1;
                     ionS32 fragmentShaderIndex = -1;
 
@@ -1118,7 +1219,7 @@ void LoadNode(const tinygltf::Node& _node, const tinygltf::Model& _model, MeshRe
                         }
                         else
                         {
-                            fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), ION_UNLIT_SHADER_NAME, EShaderStage_Fragment);
+                            fragmentShaderIndex = ionShaderProgramManager().FindShader(ionFileSystemManager().GetShadersPath(), bindlessTextures ? ION_UNLIT_BINDLESS_SHADER_NAME : ION_UNLIT_SHADER_NAME, EShaderStage_Fragment);
                         }
                     }
 
@@ -1659,6 +1760,8 @@ ionBool LoaderGLTF::Load(const ionString & _filePath, Camera* _camToUpdatePtr, N
     tinygltf::TinyGLTF  gltf;
     std::string         err;
 
+    gltf.SetImageLoader(&LoadImageDataKTX2Aware, nullptr);
+
     //
     if (_filePath.find_last_of('/') != std::string::npos)
     {
@@ -1728,13 +1831,74 @@ ionBool LoaderGLTF::Load(const ionString & _filePath, Camera* _camToUpdatePtr, N
     const ionString underscore = "_";
     const ionString backslash = "/";
 
+    //////////////////////////////////////////////////////////////////////////
+    // 0. Transcode the KHR_texture_basisu images, all together on worker threads: the textures are created on this thread below
+    ionVector<BasisTranscodeJob, LoaderGLTFAllocator, GetAllocator> basisuJobs;
+    ionMap<ionS32, ionU32, LoaderGLTFAllocator, GetAllocator> basisuImageToJob;
+    for (ionSize i = 0; i < model.textures.size(); ++i)
+    {
+        const ionS32 basisuSource = model.textures[i].basisuSource;
+        if (basisuSource >= 0 && basisuSource < static_cast<ionS32>(model.images.size()) && basisuImageToJob.find(basisuSource) == basisuImageToJob.end())
+        {
+            basisuImageToJob.insert(std::pair<ionS32, ionU32>(basisuSource, static_cast<ionU32>(basisuJobs.size())));
+
+            basisuJobs.push_back(BasisTranscodeJob());
+            basisuJobs.back().m_image = basisuSource;
+            basisuJobs.back().m_transcoded = false;
+        }
+    }
+
+    if (!basisuJobs.empty())
+    {
+        // BC1 and BC3 when the device can sample them, otherwise RGBA8
+        const ionBool blockCompressed = ionTextureManger().IsFormatSupported(ETextureFormat_BC1) && ionTextureManger().IsFormatSupported(ETextureFormat_BC3);
+
+        const ionU32 jobCount = static_cast<ionU32>(basisuJobs.size());
+        const ionU32 workerCount = std::max(1u, std::min(std::thread::hardware_concurrency(), jobCount));
+
+        std::atomic<ionU32> nextJob(0);
+        auto transcodeImages = [&]()
+        {
+            for (ionU32 i = nextJob++; i < jobCount; i = nextJob++)
+            {
+                const tinygltf::Image& image = model.images[basisuJobs[i].m_image];
+                basisuJobs[i].m_transcoded = BasisTranscoder::Transcode(image.image.data(), image.image.size(), blockCompressed, basisuJobs[i].m_result);
+            }
+        };
+
+        // the calling thread is one of the workers
+        ionVector<std::thread, LoaderGLTFAllocator, GetAllocator> workers;
+        workers.reserve(workerCount - 1);
+        for (ionU32 i = 1; i < workerCount; ++i)
+        {
+            workers.push_back(std::thread(transcodeImages));
+        }
+        transcodeImages();
+        for (ionSize i = 0; i < workers.size(); ++i)
+        {
+            workers[i].join();
+        }
+    }
+
     //////////////////////////////////////////////////////////////////////////
     // 1. Load all the texture inside the texture manager
     for (ionSize i = 0; i < model.textures.size(); ++i)
     {
         const tinygltf::Texture& tex = model.textures[i];
 
-        const tinygltf::Image& image = model.images[tex.source];
+        // KHR_texture_basisu: UASTC, Zstandard or a broken file are not transcoded, and "source" is used as fallback
+        const BasisTranscodeJob* transcoded = nullptr;
+        auto basisuSearch = basisuImageToJob.find(tex.basisuSource);
+        if (basisuSearch != basisuImageToJob.end() && basisuJobs[basisuSearch->second].m_transcoded)
+        {
+            transcoded = &basisuJobs[basisuSearch->second];
+        }
+
+        // "source" is optional, a texture without it has no image to load: the materials get the null texture
+        if (transcoded == nullptr && (tex.source < 0 || tex.source >= static_cast<ionS32>(model.images.size()) || model.images[tex.source].mimeType == kKTX2MimeType))
+        {
+            continue;
+        }
   
         ETextureRepeat repeatU = ETextureRepeat_Repeat;
         ETextureRepeat repeatV = ETextureRepeat_Repeat;
@@ -1820,7 +1984,32 @@ ionBool LoaderGLTF::Load(const ionString & _filePath, Camera* _camToUpdatePtr, N
                 repeatW = ETextureRepeat_Repeat;
             }
         }
-        
+
+        if (transcoded != nullptr)
+        {
+            const tinygltf::Image& basisuImage = model.images[transcoded->m_image];
+
+            ionString name = basisuImage.name.c_str();
+            if (name.empty() && !basisuImage.uri.empty())
+            {
+                name = basisuImage.uri.substr(basisuImage.uri.find_last_of("/\\") + 1).c_str();
+            }
+            if (name.empty())
+            {
+                ionString val = std::to_string(i).c_str();
+                name = filenameNoExt + underscore + val;
+            }
+
+            textureIndexToTextureName.insert(std::pair<ionS32, ionString>((ionS32)i, name));
+
+            const BasisTranscodedImage& result = transcoded->m_result;
+            ionTextureManger().CreateTextureFromLevels(name, result.m_width, result.m_height, result.m_format, result.m_numLevels, result.m_levels.data(), result.m_levels.size(), filterMin, filterMag, ETextureRepeat_Custom, 1U, repeatU, repeatV, repeatW);
+
+            continue;
+        }
+
+        const tinygltf::Image& image = model.images[tex.source];
+
         if (image.uri.empty())                    // no uri, so image could be stored in binary format
         {
 			ionString name = image.name.c_str();  // no filename, I just give you one
@@ -2130,11 +2319,15 @@ ionBool LoaderGLTF::Load(const ionString & _filePath, Camera* _camToUpdatePtr, N
     LoadAnimations(filenameNoExt.c_str(), model, entityPtr, nodeIndexToNodePointer);
 
     //
-    // 5. for the main bounding box: if missing create, if present expand to the maximum one
+    // 5. now that every material is fully set, the meshes drawing the same share one material, so one program and its pipelines
+    DeduplicateMaterials(_entity);
+
+    //
+    // 6. for the main bounding box: if missing create, if present expand to the maximum one
     UpdateBoundingBox(_entity, *_entity->GetBoundingBox());
 
     //
-    // 6. camera set, for now just one and perspective
+    // 7. camera set, for now just one and perspective
     if (model.cameras.size() > 0)
     {
         if (model.cameras[0].type == "perspective")
@@ -0,0 +1,165 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Utilities\SphericalHarmonics.cpp
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#include "SphericalHarmonics.h"
+
+#include <thread>
+
+#include "../Texture/Texture.h"
+
+#include "Tools.h"
+
+
+NIX_USING_NAMESPACE
+
+
+ION_NAMESPACE_BEGIN
+
+
+namespace
+{
+    // clamped cosine convolution per band (PI, 2PI/3, PI/4) already divided by PI
+    static const ionFloat kBandConvolution[ION_SH_COEFFICIENTS_COUNT] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+    ION_INLINE void EvaluateBasis(ionFloat _x, ionFloat _y, ionFloat _z, ionFloat* _outBasis)
+    {
+        _outBasis[0] = 0.282095f;
+        _outBasis[1] = 0.488603f * _y;
+        _outBasis[2] = 0.488603f * _z;
+        _outBasis[3] = 0.488603f * _x;
+        _outBasis[4] = 1.092548f * _x * _y;
+        _outBasis[5] = 1.092548f * _y * _z;
+        _outBasis[6] = 0.315392f * (3.0f * _z * _z - 1.0f);
+        _outBasis[7] = 1.092548f * _x * _z;
+        _outBasis[8] = 0.546274f * (_x * _x - _y * _y);
+    }
+
+    // same orientation used by Vulkan when sampling a cube map
+    ION_INLINE void FaceDirection(ionU32 _faceIndex, ionFloat _s, ionFloat _t, ionFloat& _outX, ionFloat& _outY, ionFloat& _outZ)
+    {
+        switch (_faceIndex)
+        {
+        case 0: _outX = 1.0f;   _outY = -_t;    _outZ = -_s;    break;  // +X
+        case 1: _outX = -1.0f;  _outY = -_t;    _outZ = _s;     break;  // -X
+        case 2: _outX = _s;     _outY = 1.0f;   _outZ = _t;     break;  // +Y
+        case 3: _outX = _s;     _outY = -1.0f;  _outZ = -_t;    break;  // -Y
+        case 4: _outX = _s;     _outY = -_t;    _outZ = 1.0f;   break;  // +Z
+        default: _outX = -_s;   _outY = -_t;    _outZ = -1.0f;  break;  // -Z
+        }
+    }
+}
+
+
+ionBool SphericalHarmonics::ProjectIrradiance(const ionU8* _faces, ionU32 _size, ETextureFormat _format, Vector4 _outCoefficients[ION_SH_COEFFICIENTS_COUNT])
+{
+    ionAssertReturnValue(_faces != nullptr && _size > 0, "Invalid cube map to project!", false);
+    ionAssertReturnValue(_format == ETextureFormat_RGBA8 || _format == ETextureFormat_HDR, "Format not supported for the spherical harmonics projection!", false);
+
+    const ionSize faceSize = static_cast<ionSize>(_size) * _size * (Texture::BitsPerFormat(_format) / 8);
+
+    // every face accumulates on its own slot, so no synchronization is needed
+    Vector4 faceCoefficients[6][ION_SH_COEFFICIENTS_COUNT];
+    ionFloat faceWeight[6];
+
+    std::thread workers[6];
+    for (ionU32 i = 0; i < 6; ++i)
+    {
+        workers[i] = std::thread(&SphericalHarmonics::ProjectFace, _faces + faceSize * i, i, _size, _format, faceCoefficients[i], &faceWeight[i]);
+    }
+    for (ionU32 i = 0; i < 6; ++i)
+    {
+        workers[i].join();
+    }
+
+    ionFloat totalWeight = 0.0f;
+    for (ionU32 k = 0; k < ION_SH_COEFFICIENTS_COUNT; ++k)
+    {
+        _outCoefficients[k] = MathFunctions::Splat(0.0f);
+    }
+    for (ionU32 i = 0; i < 6; ++i)
+    {
+        totalWeight += faceWeight[i];
+        for (ionU32 k = 0; k < ION_SH_COEFFICIENTS_COUNT; ++k)
+        {
+            _outCoefficients[k] += faceCoefficients[i][k];
+        }
+    }
+
+    ionAssertReturnValue(totalWeight > 0.0f, "Cube map projection without weight!", false);
+
+    // the sum of the texel solid angles must be 4 PI, normalize to remove the discretization error
+    const ionFloat normalization = (4.0f * NIX_PI) / totalWeight;
+    for (ionU32 k = 0; k < ION_SH_COEFFICIENTS_COUNT; ++k)
+    {
+        const Scalar scale = normalization * kBandConvolution[k];
+        _outCoefficients[k] = _outCoefficients[k] * scale;
+    }
+
+    return true;
+}
+
+void SphericalHarmonics::ProjectFace(const ionU8* _face, ionU32 _faceIndex, ionU32 _size, ETextureFormat _format, Vector4* _outCoefficients, ionFloat* _outWeight)
+{
+    Vector4 accumulator[ION_SH_COEFFICIENTS_COUNT];
+    for (ionU32 k = 0; k < ION_SH_COEFFICIENTS_COUNT; ++k)
+    {
+        accumulator[k] = MathFunctions::Splat(0.0f);
+    }
+
+    const ionFloat invSize = 1.0f / static_cast<ionFloat>(_size);
+    const ionU16* faceHalf = reinterpret_cast<const ionU16*>(_face);
+
+    ionFloat basis[ION_SH_COEFFICIENTS_COUNT];
+    ionFloat weightSum = 0.0f;
+
+    for (ionU32 y = 0; y < _size; ++y)
+    {
+        const ionFloat t = 2.0f * (static_cast<ionFloat>(y) + 0.5f) * invSize - 1.0f;
+        for (ionU32 x = 0; x < _size; ++x)
+        {
+            const ionFloat s = 2.0f * (static_cast<ionFloat>(x) + 0.5f) * invSize - 1.0f;
+
+            // solid angle of the texel
+            const ionFloat lengthSq = 1.0f + s * s + t * t;
+            const ionFloat weight = 4.0f * invSize * invSize / (lengthSq * std::sqrt(lengthSq));
+
+            ionFloat dirX, dirY, dirZ;
+            FaceDirection(_faceIndex, s, t, dirX, dirY, dirZ);
+
+            const ionFloat invLength = 1.0f / std::sqrt(lengthSq);
+            EvaluateBasis(dirX * invLength, dirY * invLength, dirZ * invLength, basis);
+
+            const ionSize texel = static_cast<ionSize>(y) * _size + x;
+            Vector4 color;
+            if (_format == ETextureFormat_HDR)
+            {
+                ionFloat rgba[4];
+                Tools::ConvertHalfToFloat(faceHalf + texel * 4, rgba, 4);
+                color = MathFunctions::Set(rgba[0], rgba[1], rgba[2], 0.0f);
+            }
+            else
+            {
+                const ionU8* rgba = _face + texel * 4;
+                color = MathFunctions::Set(rgba[0] / 255.0f, rgba[1] / 255.0f, rgba[2] / 255.0f, 0.0f);
+            }
+
+            for (ionU32 k = 0; k < ION_SH_COEFFICIENTS_COUNT; ++k)
+            {
+                const Scalar factor = basis[k] * weight;
+                accumulator[k] += color * factor;
+            }
+
+            weightSum += weight;
+        }
+    }
+
+    for (ionU32 k = 0; k < ION_SH_COEFFICIENTS_COUNT; ++k)
+    {
+        _outCoefficients[k] = accumulator[k];
+    }
+    *_outWeight = weightSum;
+}
+
+ION_NAMESPACE_END
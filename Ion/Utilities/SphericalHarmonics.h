@@ -0,0 +1,35 @@
+// Copyright (c) 2025-2025 Michele Condo'
+// File: C:\Projects\Ion\Ion\Utilities\SphericalHarmonics.h
+// Licensed under the GPL-3.0 License. See LICENSE file in the project root for full license information.
+
+
+#pragma once
+
+#include "../Core/CoreDefs.h"
+
+#include "../Texture/TextureCommon.h"
+
+#include "../Dependencies/Nix/Nix/Nix.h"
+
+
+#define ION_SH_COEFFICIENTS_COUNT   9       // L2, 3 bands
+
+
+NIX_USING_NAMESPACE
+
+ION_NAMESPACE_BEGIN
+
+class ION_DLL SphericalHarmonics
+{
+public:
+    // Project a cubemap (6 faces of _size x _size, one after the other) into 9 L2 coefficients of irradiance.
+    // The coefficients are already convolved with the clamped cosine and divided by PI, so evaluating them with the
+    // standard basis gives the same value of the irradiance cubemap generated by IrradianceCube.frag.
+    // Every face is processed in its own thread, only ETextureFormat_RGBA8 and ETextureFormat_HDR (half float) are supported.
+    static ionBool ProjectIrradiance(const ionU8* _faces, ionU32 _size, ETextureFormat _format, Vector4 _outCoefficients[ION_SH_COEFFICIENTS_COUNT]);
+
+private:
+    static void ProjectFace(const ionU8* _face, ionU32 _faceIndex, ionU32 _size, ETextureFormat _format, Vector4* _outCoefficients, ionFloat* _outWeight);
+};
+
+ION_NAMESPACE_END
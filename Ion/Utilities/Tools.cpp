@@ -5,6 +5,9 @@
 
 #include "Tools.h"
 
+#include <intrin.h>
+#include <immintrin.h>
+
 ION_NAMESPACE_BEGIN
 
 namespace Tools
@@ -80,6 +83,162 @@ namespace Tools
         return hash;
     }
 
+    ionU64 HashFNV1a64(const void* _data, ionSize _size, ionU64 _seed /*= kFNV1aOffset64*/)
+    {
+        ionU64 hash = _seed;
+        const ionU8* p = reinterpret_cast<const ionU8*>(_data);
+
+        for (ionSize i = 0; i < _size; ++i)
+        {
+            hash ^= static_cast<ionU64>(p[i]);
+            hash *= kFNV1aPrime64;
+        }
+        return hash;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // F16C instructions are VEX encoded, so the OS must save the AVX state as well
+    static ionBool IsF16CSupported()
+    {
+        static const ionBool supported = []()
+        {
+            ionS32 info[4];
+            __cpuid(info, 1);
+
+            const ionBool f16c = (info[2] & (1 << 29)) != 0;
+            const ionBool avx = (info[2] & (1 << 28)) != 0;
+            const ionBool osxsave = (info[2] & (1 << 27)) != 0;
+
+            return f16c && avx && osxsave && ((_xgetbv(0) & 0x6) == 0x6);
+        }();
+
+        return supported;
+    }
+
+    ionU16 FloatToHalf(ionFloat _value)
+    {
+        ionU32 bits = 0;
+        MemUtils::MemCpy(&bits, &_value, sizeof(bits));
+
+        const ionU16 sign = static_cast<ionU16>((bits >> 16) & 0x8000);
+        const ionU32 abs = bits & 0x7FFFFFFF;
+
+        // Inf and NaN (keep it a NaN)
+        if (abs >= 0x7F800000)
+        {
+            return sign | 0x7C00 | (abs > 0x7F800000 ? 0x0200 : 0);
+        }
+
+        // bigger than the max half once rounded
+        if (abs >= 0x477FF000)
+        {
+            return sign | 0x7C00;
+        }
+
+        // subnormal half (or zero)
+        if (abs < 0x38800000)
+        {
+            if (abs < 0x33000000)
+            {
+                return sign;
+            }
+
+            const ionU32 exponent = abs >> 23;
+            const ionU32 mantissa = (abs & 0x007FFFFF) | 0x00800000;
+            const ionU32 shift = 126 - exponent;
+
+            ionU32 half = mantissa >> shift;
+            const ionU32 remainder = mantissa & ((1u << shift) - 1);
+            const ionU32 halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (half & 1)))
+            {
+                ++half;
+            }
+            return sign | static_cast<ionU16>(half);
+        }
+
+        // normal: rebias the exponent from 127 to 15, the carry of the rounding goes in the exponent
+        ionU32 half = (abs - 0x38000000) >> 13;
+        const ionU32 remainder = abs & 0x1FFF;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        {
+            ++half;
+        }
+        return sign | static_cast<ionU16>(half);
+    }
+
+    ionFloat HalfToFloat(ionU16 _value)
+    {
+        const ionU32 sign = static_cast<ionU32>(_value & 0x8000) << 16;
+        const ionU32 exponent = (_value >> 10) & 0x1F;
+        ionU32 mantissa = _value & 0x03FF;
+
+        ionU32 bits = 0;
+        if (exponent == 0x1F)
+        {
+            bits = sign | 0x7F800000 | (mantissa << 13);
+        }
+        else if (exponent != 0)
+        {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        else if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // subnormal half is a normal float
+            ionU32 floatExponent = 113;
+            while ((mantissa & 0x0400) == 0)
+            {
+                mantissa <<= 1;
+                --floatExponent;
+            }
+            bits = sign | (floatExponent << 23) | ((mantissa & 0x03FF) << 13);
+        }
+
+        ionFloat value = 0.0f;
+        MemUtils::MemCpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void ConvertFloatToHalf(const ionFloat* _in, ionU16* _out, ionSize _count)
+    {
+        ionSize i = 0;
+        if (IsF16CSupported())
+        {
+            for (; i + 8 <= _count; i += 8)
+            {
+                const __m256 value = _mm256_loadu_ps(_in + i);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(_out + i), _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+            }
+        }
+
+        for (; i < _count; ++i)
+        {
+            _out[i] = FloatToHalf(_in[i]);
+        }
+    }
+
+    void ConvertHalfToFloat(const ionU16* _in, ionFloat* _out, ionSize _count)
+    {
+        ionSize i = 0;
+        if (IsF16CSupported())
+        {
+            for (; i + 8 <= _count; i += 8)
+            {
+                const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_in + i));
+                _mm256_storeu_ps(_out + i, _mm256_cvtph_ps(value));
+            }
+        }
+
+        for (; i < _count; ++i)
+        {
+            _out[i] = HalfToFloat(_in[i]);
+        }
+    }
+
     //////////////////////////////////////////////////////////////////////////
 #include <winsock2.h>
 #include <iphlpapi.h>
@@ -23,6 +23,18 @@ namespace Tools
     ionU32 Hash32(const void* _data, ionU32 _size, ionU32 _seed = 0);
     ionU64 Hash64(const void* _data, ionU32 _size, ionU64 _seed = 0);
 
+    // FNV-1a, fast enough to be used on big binary blob (file contents, texture data, etc)
+    // Passing the previous result as seed allows to hash data coming in chunks
+    static constexpr ionU64 kFNV1aOffset64 = 14695981039346656037ull;
+    static constexpr ionU64 kFNV1aPrime64 = 1099511628211ull;
+    ionU64 HashFNV1a64(const void* _data, ionSize _size, ionU64 _seed = kFNV1aOffset64);
+
+    // IEEE half float conversion (round to nearest even), the array versions use F16C when supported by the CPU
+    ionU16 FloatToHalf(ionFloat _value);
+    ionFloat HalfToFloat(ionU16 _value);
+    void ConvertFloatToHalf(const ionFloat* _in, ionU16* _out, ionSize _count);
+    void ConvertHalfToFloat(const ionU16* _in, ionFloat* _out, ionSize _count);
+
     // very windows Dependant
     void GetPhysicalAddress(ionString& _outAddress, ionU64& _outAddressNum);
 }